@@ -1564,9 +1564,7 @@ void psxDma3(u32 madr, u32 bcr, u32 chcr) {
 				psxCpu->Notify(R3000ACPU_NOTIFY_DMA3_EXE_LOAD, NULL);
 			}
 
-#ifdef PSXREC
 			psxCpu->Clear(madr, cdsize / 4);
-#endif
 
 			pTransfer += cdsize;
 
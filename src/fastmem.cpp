@@ -0,0 +1,355 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Fastmem: the whole 4GB PSX address space mapped into host virtual memory
+ *
+ *  Generalized from the MIPS dynarec's SHMEM_MIRRORING/TMPFS_MIRRORING
+ * support (recompiler/mips/mem_mapping.cpp), which only maps RAM and the
+ * 0x1f00_0000 region below a fixed address for its own use.
+ *
+ *  2MB RAM, the 64KB psxH region and 512KB BIOS ROM are placed in one
+ * memfd object. The emulator's own psxM,psxH,psxR pointers are ordinary
+ * read/write mappings of it. Separately, a 4GB region is reserved with no
+ * access rights, and these are mapped into it at their PS1 addresses:
+ *
+ *   0x0000_0000-0x007f_ffff  RAM, mirrored 4X    (KUSEG)  read/write
+ *   0x8000_0000-0x807f_ffff  RAM, mirrored 4X    (KSEG0)  read/write
+ *   0xa000_0000-0xa07f_ffff  RAM, mirrored 4X    (KSEG1)  read/write
+ *   0x1f80_0000-0x1f80_0fff  Scratchpad page     (KUSEG)  read/write
+ *   0x9f80_0000-0x9f80_0fff  Scratchpad page     (KSEG0)  read/write
+ *   0xbf80_0000-0xbf80_0fff  Scratchpad page     (KSEG1)  read/write
+ *   0x1fc0_0000-0x1fc7_ffff  BIOS ROM            (KUSEG)  read-only
+ *   0x9fc0_0000-0x9fc7_ffff  BIOS ROM            (KSEG0)  read-only
+ *   0xbfc0_0000-0xbfc7_ffff  BIOS ROM            (KSEG1)  read-only
+ *
+ *  Everything else (HW I/O, Expansion region, cache control port, unused
+ * space) stays inaccessible, as do ROM pages for writes and RAM pages for
+ * writes while the cache is isolated. Accesses to them raise SIGSEGV. The
+ * handler decodes the faulting mov/movzx emitted by the accessors in
+ * fastmem.h and emulates it with psxMemRead*()/psxMemWrite*(). Those route
+ * HW I/O to psxHwRead*()/psxHwWrite*() and deal with everything else just
+ * like without fastmem. Execution then resumes after the faulting opcode.
+ */
+
+#include "fastmem.h"
+
+#ifdef USE_FASTMEM
+
+#include <signal.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* Uncomment for debug logging to console */
+//#define FASTMEM_LOG printf
+
+#ifndef FASTMEM_LOG
+#define FASTMEM_LOG(...)
+#endif
+
+// Extra 64KB past the 4GB so unaligned accesses at the top can't reach
+//  past the reserved region
+#define FASTMEM_SIZE     (0x100000000ULL + 0x10000)
+
+// Offsets of regions in the memfd object
+#define FASTMEM_FD_RAM   0x000000
+#define FASTMEM_FD_HW    0x200000
+#define FASTMEM_FD_ROM   0x210000
+#define FASTMEM_FD_SIZE  0x290000
+
+u8 *fastmem_base;
+
+static int fastmem_fd = -1;
+static struct sigaction fastmem_old_sigsegv;
+
+// PSX segments RAM, scratchpad and BIOS ROM are mirrored in
+static const u32 fastmem_segments[] = { 0x00000000, 0x80000000, 0xa0000000 };
+
+static bool fastmem_map(u32 mem, size_t size, int prot, off_t fd_offset)
+{
+	void *p = mmap(fastmem_base + mem, size, prot, MAP_SHARED|MAP_FIXED,
+	               fastmem_fd, fd_offset);
+	if (p == MAP_FAILED) {
+		printf("Error: fastmem mmap() of %zuKB at PSX address 0x%08x failed.\n",
+		       size/1024, mem);
+		return false;
+	}
+	return true;
+}
+
+static s8 *fastmem_map_view(size_t size, off_t fd_offset)
+{
+	void *p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fastmem_fd, fd_offset);
+	return (p == MAP_FAILED) ? NULL : (s8 *)p;
+}
+
+
+/* Host register numbers (as encoded in ModRM/SIB) to ucontext gregs[] */
+static const int fastmem_gregs[16] = {
+	REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+	REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+enum { FM_LD8, FM_LD16, FM_LD32, FM_ST8, FM_ST16, FM_ST32 };
+
+/* Emulate faulting host opcode at RIP in 'uc', if it's one of the fastmem
+ *  accessors. Returns false if it isn't.
+ */
+static bool fastmem_emulate(ucontext_t *uc)
+{
+	greg_t *gregs = uc->uc_mcontext.gregs;
+	const u8 *p = (const u8 *)gregs[REG_RIP];
+	bool opsize16 = false;
+	u8 rex = 0;
+	int type;
+
+	if (*p == 0x66) {
+		opsize16 = true;
+		p++;
+	}
+	if ((*p & 0xf0) == 0x40)
+		rex = *p++;
+	if (rex & 0x08) // REX.W: 64-bit operand, not a fastmem access
+		return false;
+
+	switch (*p++) {
+		case 0x8b: type = FM_LD32; break;                          // mov r32,m32
+		case 0x89: type = opsize16 ? FM_ST16 : FM_ST32; break;     // mov m16/32,r
+		case 0x88: type = FM_ST8; break;                           // mov m8,r8
+		case 0x0f:
+			switch (*p++) {
+				case 0xb6: type = FM_LD8; break;                   // movzx r32,m8
+				case 0xb7: type = FM_LD16; break;                  // movzx r32,m16
+				default: return false;
+			}
+			break;
+		default:
+			return false;
+	}
+	if (opsize16 && type != FM_ST16)
+		return false;
+
+	// Decode ModRM, SIB and displacement into effective address
+	const u8 modrm = *p++;
+	const int mod = modrm >> 6;
+	const int reg = ((modrm >> 3) & 7) | ((rex & 0x04) << 1);
+	const int rm = modrm & 7;
+	uptr ea = 0;
+
+	if (mod == 3)
+		return false;
+
+	if (rm == 4) {
+		const u8 sib = *p++;
+		const int index = ((sib >> 3) & 7) | ((rex & 0x02) << 2);
+		const int base = (sib & 7) | ((rex & 0x01) << 3);
+		if (index != 4)
+			ea = (uptr)gregs[fastmem_gregs[index]] << (sib >> 6);
+		if ((base & 7) == 5 && mod == 0) {
+			s32 disp;
+			memcpy(&disp, p, 4);
+			ea += disp;
+			p += 4;
+		} else {
+			ea += gregs[fastmem_gregs[base]];
+		}
+	} else {
+		if (rm == 5 && mod == 0) // RIP-relative
+			return false;
+		ea = gregs[fastmem_gregs[rm | ((rex & 0x01) << 3)]];
+	}
+
+	if (mod == 1) {
+		ea += (s8)*p;
+		p += 1;
+	} else if (mod == 2) {
+		s32 disp;
+		memcpy(&disp, p, 4);
+		ea += disp;
+		p += 4;
+	}
+
+	if (ea < (uptr)fastmem_base || ea >= (uptr)fastmem_base + 0x100000000ULL)
+		return false;
+
+	const u32 mem = (u32)(ea - (uptr)fastmem_base);
+	greg_t *r = &gregs[fastmem_gregs[reg]];
+
+	FASTMEM_LOG("fastmem: type %d access to 0x%08x\n", type, mem);
+
+	// Writing a 32-bit host reg zero-extends it, same as the real opcode
+	switch (type) {
+		case FM_LD8:  *r = psxMemRead8(mem);  break;
+		case FM_LD16: *r = psxMemRead16(mem); break;
+		case FM_LD32: *r = psxMemRead32(mem); break;
+		case FM_ST8:
+			// Without REX, regs 4..7 are AH,CH,DH,BH
+			if (!rex && reg >= 4)
+				psxMemWrite8(mem, gregs[fastmem_gregs[reg - 4]] >> 8);
+			else
+				psxMemWrite8(mem, *r);
+			break;
+		case FM_ST16: psxMemWrite16(mem, *r); break;
+		case FM_ST32: psxMemWrite32(mem, *r); break;
+	}
+
+	gregs[REG_RIP] = (greg_t)p;
+	return true;
+}
+
+static void fastmem_sigsegv(int sig, siginfo_t *si, void *ctx)
+{
+	const u8 *addr = (const u8 *)si->si_addr;
+
+	if (fastmem_base && addr >= fastmem_base && addr < fastmem_base + FASTMEM_SIZE &&
+	    fastmem_emulate((ucontext_t *)ctx))
+		return;
+
+	// Not ours: pass it on to whoever had SIGSEGV before us
+	if (fastmem_old_sigsegv.sa_flags & SA_SIGINFO) {
+		fastmem_old_sigsegv.sa_sigaction(sig, si, ctx);
+	} else if (fastmem_old_sigsegv.sa_handler != SIG_DFL &&
+	           fastmem_old_sigsegv.sa_handler != SIG_IGN) {
+		fastmem_old_sigsegv.sa_handler(sig);
+	} else {
+		// Restore default action, fault happens again on return
+		sigaction(SIGSEGV, &fastmem_old_sigsegv, NULL);
+	}
+}
+
+int fastmem_init(void)
+{
+	bool success = true;
+	s8 *ram = NULL, *hw = NULL, *rom = NULL;
+	struct sigaction sa;
+
+	if (sysconf(_SC_PAGESIZE) != 4096) {
+		printf("ERROR: fastmem expects a system page size of 4096 bytes\n");
+		return -1;
+	}
+
+	printf("Mapping PSX address space for fastmem\n");
+
+	fastmem_fd = memfd_create("pcsx4all_fastmem", 0);
+	if (fastmem_fd < 0) {
+		printf("Error creating memfd for fastmem\n");
+		success = false;
+		goto exit;
+	}
+
+	if (ftruncate(fastmem_fd, FASTMEM_FD_SIZE) < 0) {
+		printf("Error in call to ftruncate(), could not get PSX memory\n");
+		success = false;
+		goto exit;
+	}
+
+	// Emulator's own read/write views of RAM, scratchpad+HW I/O, ROM
+	ram = fastmem_map_view(0x200000, FASTMEM_FD_RAM);
+	hw  = fastmem_map_view(0x10000,  FASTMEM_FD_HW);
+	rom = fastmem_map_view(0x80000,  FASTMEM_FD_ROM);
+	if (!ram || !hw || !rom) {
+		printf("Error mapping PSX memory views\n");
+		success = false;
+		goto exit;
+	}
+
+	// Reserve guest address space: nothing is accessible until mapped
+	fastmem_base = (u8 *)mmap(NULL, FASTMEM_SIZE, PROT_NONE,
+	                          MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if (fastmem_base == MAP_FAILED) {
+		printf("Error reserving %lluMB of address space for fastmem\n",
+		       (unsigned long long)(FASTMEM_SIZE >> 20));
+		fastmem_base = NULL;
+		success = false;
+		goto exit;
+	}
+
+	for (size_t i = 0; i < sizeof(fastmem_segments)/sizeof(fastmem_segments[0]); i++) {
+		const u32 seg = fastmem_segments[i];
+		for (u32 mirror = 0; mirror < 0x800000; mirror += 0x200000)
+			success = success && fastmem_map(seg + mirror, 0x200000,
+			                                 PROT_READ|PROT_WRITE, FASTMEM_FD_RAM);
+		success = success && fastmem_map(seg + 0x1f800000, 0x1000,
+		                                 PROT_READ|PROT_WRITE, FASTMEM_FD_HW);
+		success = success && fastmem_map(seg + 0x1fc00000, 0x80000,
+		                                 PROT_READ, FASTMEM_FD_ROM);
+	}
+	if (!success)
+		goto exit;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = fastmem_sigsegv;
+	sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGSEGV, &sa, &fastmem_old_sigsegv) < 0) {
+		printf("Error installing fastmem SIGSEGV handler\n");
+		success = false;
+		goto exit;
+	}
+
+	psxM = ram;  psxM_allocated = true;
+	psxH = hw;   psxH_allocated = true;
+	psxR = rom;  psxR_allocated = true;
+	printf(" ..mapped to %p\n", (void *)fastmem_base);
+
+exit:
+	if (!success) {
+		perror(__func__);
+		printf("ERROR: Failed to map PSX address space, fastmem is disabled.\n");
+		if (fastmem_base)
+			munmap(fastmem_base, FASTMEM_SIZE);
+		fastmem_base = NULL;
+		if (ram) munmap(ram, 0x200000);
+		if (hw)  munmap(hw, 0x10000);
+		if (rom) munmap(rom, 0x80000);
+	}
+
+	// Mappings keep the memory object alive
+	if (fastmem_fd >= 0)
+		close(fastmem_fd);
+	fastmem_fd = -1;
+
+	return success ? 0 : -1;
+}
+
+void fastmem_shutdown(void)
+{
+	if (!fastmem_base)
+		return;
+
+	sigaction(SIGSEGV, &fastmem_old_sigsegv, NULL);
+
+	munmap(fastmem_base, FASTMEM_SIZE);
+	fastmem_base = NULL;
+
+	munmap(psxM, 0x200000);  psxM = NULL;  psxM_allocated = false;
+	munmap(psxH, 0x10000);   psxH = NULL;  psxH_allocated = false;
+	munmap(psxR, 0x80000);   psxR = NULL;  psxR_allocated = false;
+}
+
+void fastmem_set_ram_writable(bool writable)
+{
+	if (!fastmem_base)
+		return;
+
+	const int prot = writable ? (PROT_READ|PROT_WRITE) : PROT_READ;
+	for (size_t i = 0; i < sizeof(fastmem_segments)/sizeof(fastmem_segments[0]); i++)
+		mprotect(fastmem_base + fastmem_segments[i], 0x800000, prot);
+}
+
+#endif // USE_FASTMEM
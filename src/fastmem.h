@@ -0,0 +1,178 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Fastmem: the whole 4GB PSX address space mapped into host virtual memory
+ *
+ *  Guest address 'mem' lives at host address 'fastmem_base + mem', so a
+ * RAM, scratchpad or BIOS ROM access is a single host load or store. See
+ * fastmem.cpp for the layout and for how everything else is handled.
+ *
+ *  Enabled by USE_FASTMEM (Linux x86-64 hosts only). If mapping fails at
+ * runtime, fastmem_base stays NULL and psxMemRead*()/psxMemWrite*() are
+ * used as before.
+ */
+
+#ifndef FASTMEM_H
+#define FASTMEM_H
+
+#include "psxcommon.h"
+#include "psxmem.h"
+#include "r3000a.h"
+
+#ifdef USE_FASTMEM
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error "USE_FASTMEM is only supported on Linux x86-64 hosts"
+#endif
+
+extern u8 *fastmem_base;
+
+int  fastmem_init(void);
+void fastmem_shutdown(void);
+
+// Make guest RAM mirrors read-only while the cache is isolated, so stores
+//  fault and go through psxMemWrite*(), which discards them.
+void fastmem_set_ram_writable(bool writable);
+
+/* Raw accessors. These must stay single mov/movzx instructions with a
+ *  (base,index) memory operand: the SIGSEGV handler decodes and emulates
+ *  exactly these forms when they touch a page that isn't mapped.
+ */
+static inline u8 fastmem_ld8(u32 mem)
+{
+	u32 val;
+	__asm__ __volatile__("movzbl (%1,%2), %0"
+	                     : "=r" (val) : "r" (fastmem_base), "r" ((uptr)mem) : "memory");
+	return val;
+}
+
+static inline u16 fastmem_ld16(u32 mem)
+{
+	u32 val;
+	__asm__ __volatile__("movzwl (%1,%2), %0"
+	                     : "=r" (val) : "r" (fastmem_base), "r" ((uptr)mem) : "memory");
+	return val;
+}
+
+static inline u32 fastmem_ld32(u32 mem)
+{
+	u32 val;
+	__asm__ __volatile__("movl (%1,%2), %0"
+	                     : "=r" (val) : "r" (fastmem_base), "r" ((uptr)mem) : "memory");
+	return val;
+}
+
+static inline void fastmem_st8(u32 mem, u8 val)
+{
+	__asm__ __volatile__("movb %b0, (%1,%2)"
+	                     : : "q" (val), "r" (fastmem_base), "r" ((uptr)mem) : "memory");
+}
+
+static inline void fastmem_st16(u32 mem, u16 val)
+{
+	__asm__ __volatile__("movw %w0, (%1,%2)"
+	                     : : "r" (val), "r" (fastmem_base), "r" ((uptr)mem) : "memory");
+}
+
+static inline void fastmem_st32(u32 mem, u32 val)
+{
+	__asm__ __volatile__("movl %0, (%1,%2)"
+	                     : : "r" (val), "r" (fastmem_base), "r" ((uptr)mem) : "memory");
+}
+
+/* Is 'mem' in the 8KB HW I/O region (any segment)? These are left to the
+ *  C functions up front: going through the SIGSEGV handler would work, but
+ *  is far too slow for something games do thousands of times per frame.
+ */
+#define FASTMEM_IS_HW(mem) ((((mem) & 0x1fffffff) - 0x1f801000) < 0x2000)
+
+/* Does a store to 'mem' need code invalidation (PSX RAM, any segment)? */
+#define FASTMEM_IS_RAM(mem) (((mem) & 0x1fffffff) < 0x800000)
+
+#endif // USE_FASTMEM
+
+/* Loads/stores used by the interpreters: fastmem if it's available, else
+ *  the regular psxMemRead*()/psxMemWrite*() functions.
+ */
+static inline u8 psxFastRead8(u32 mem)
+{
+#ifdef USE_FASTMEM
+	if (fastmem_base && !FASTMEM_IS_HW(mem))
+		return fastmem_ld8(mem);
+#endif
+	return psxMemRead8(mem);
+}
+
+static inline u16 psxFastRead16(u32 mem)
+{
+#ifdef USE_FASTMEM
+	if (fastmem_base && !FASTMEM_IS_HW(mem))
+		return fastmem_ld16(mem);
+#endif
+	return psxMemRead16(mem);
+}
+
+static inline u32 psxFastRead32(u32 mem)
+{
+#ifdef USE_FASTMEM
+	if (fastmem_base && !FASTMEM_IS_HW(mem))
+		return fastmem_ld32(mem);
+#endif
+	return psxMemRead32(mem);
+}
+
+static inline void psxFastWrite8(u32 mem, u8 value)
+{
+#ifdef USE_FASTMEM
+	if (fastmem_base && !FASTMEM_IS_HW(mem)) {
+		fastmem_st8(mem, value);
+		if (FASTMEM_IS_RAM(mem))
+			psxCpu->Clear((mem & (~3)), 1);
+		return;
+	}
+#endif
+	psxMemWrite8(mem, value);
+}
+
+static inline void psxFastWrite16(u32 mem, u16 value)
+{
+#ifdef USE_FASTMEM
+	if (fastmem_base && !FASTMEM_IS_HW(mem)) {
+		fastmem_st16(mem, value);
+		if (FASTMEM_IS_RAM(mem))
+			psxCpu->Clear((mem & (~3)), 1);
+		return;
+	}
+#endif
+	psxMemWrite16(mem, value);
+}
+
+static inline void psxFastWrite32(u32 mem, u32 value)
+{
+#ifdef USE_FASTMEM
+	if (fastmem_base && !FASTMEM_IS_HW(mem)) {
+		fastmem_st32(mem, value);
+		if (FASTMEM_IS_RAM(mem))
+			psxCpu->Clear(mem, 1);
+		return;
+	}
+#endif
+	psxMemWrite32(mem, value);
+}
+
+#endif // FASTMEM_H
@@ -22,6 +22,13 @@
 #include "gte.h"
 #include "psxmem.h"
 
+// x86-64 builds carry AVX2 versions of NCT/NCCT/NCDT, used if the host
+//  CPU supports it, see gteSimdInit() and gte_simd.cpp.h
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define GTE_USE_SIMD
+#include <immintrin.h>
+#endif
+
 // MIPS platforms have hardware divider, faster than 64KB LUT + UNR algo
 #if defined(__mips__)
 #define GTE_USE_NATIVE_DIVIDE
@@ -348,6 +355,9 @@ void gtecalcMTC2(u32 value, int reg) {
 }
 
 void gtecalcCTC2(u32 value, int reg) {
+	// A pending FLAG depends on control regs, compute it before one changes
+	gte_flag_update();
+
 	switch (reg) {
 		case 4:
 		case 12:
@@ -375,6 +385,7 @@ void gteMFC2(void) {
 
 void gteCFC2(void) {
 	if (!_Rt_) return;
+	if (_Rd_ == 31) gte_flag_update();
 	psxRegs.GPR.r[_Rt_] = psxRegs.CP2C.r[_Rd_];
 }
 
@@ -396,573 +407,260 @@ void gteSWC2(void) {
 	psxMemWrite32(_oB_, gtecalcMFC2(_Rt_));
 }
 
-void gteRTPS(void) {
-	int quotient;
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE RTPS\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = A1((((s64)gteTRX << 12) + (gteR11 * gteVX0) + (gteR12 * gteVY0) + (gteR13 * gteVZ0)) >> 12);
-	gteMAC2 = A2((((s64)gteTRY << 12) + (gteR21 * gteVX0) + (gteR22 * gteVY0) + (gteR23 * gteVZ0)) >> 12);
-	gteMAC3 = A3((((s64)gteTRZ << 12) + (gteR31 * gteVX0) + (gteR32 * gteVY0) + (gteR33 * gteVZ0)) >> 12);
-	gteIR1 = limB1(gteMAC1, 0);
-	gteIR2 = limB2(gteMAC2, 0);
-	gteIR3 = limB3(gteMAC3, 0);
-	gteSZ0 = gteSZ1;
-	gteSZ1 = gteSZ2;
-	gteSZ2 = gteSZ3;
-	gteSZ3 = limD(gteMAC3);
-	quotient = limE(DIVIDE(gteH, gteSZ3));
-	gteSXY0 = gteSXY1;
-	gteSXY1 = gteSXY2;
-	gteSX2 = limG1(F((s64)gteOFX + ((s64)gteIR1 * quotient)) >> 16);
-	gteSY2 = limG2(F((s64)gteOFY + ((s64)gteIR2 * quotient)) >> 16);
-
-	//senquack - Fix glitched drawing of road surface in 'Burning Road'..
-	// behavior now matches Mednafen. This also preserves the fix by Shalma
-	// from prior commit f916013 for missing elements in 'Legacy of Kain:
-	// Soul Reaver' (missing green plasma balls in first level).
-	s64 tmp = (s64)gteDQB + ((s64)gteDQA * quotient);
-	gteMAC0 = F(tmp);
-	gteIR0 = limH(tmp >> 12);
-}
-
-void gteRTPT(void) {
-	int quotient;
-	int v;
-	s32 vx, vy, vz;
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE RTPT\n");
-#endif
-	gteFLAG = 0;
-
-	gteSZ0 = gteSZ3;
-	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = A1((((s64)gteTRX << 12) + (gteR11 * vx) + (gteR12 * vy) + (gteR13 * vz)) >> 12);
-		gteMAC2 = A2((((s64)gteTRY << 12) + (gteR21 * vx) + (gteR22 * vy) + (gteR23 * vz)) >> 12);
-		gteMAC3 = A3((((s64)gteTRZ << 12) + (gteR31 * vx) + (gteR32 * vy) + (gteR33 * vz)) >> 12);
-		gteIR1 = limB1(gteMAC1, 0);
-		gteIR2 = limB2(gteMAC2, 0);
-		gteIR3 = limB3(gteMAC3, 0);
-		fSZ(v) = limD(gteMAC3);
-		quotient = limE(DIVIDE(gteH, fSZ(v)));
-		fSX(v) = limG1(F((s64)gteOFX + ((s64)gteIR1 * quotient)) >> 16);
-		fSY(v) = limG2(F((s64)gteOFY + ((s64)gteIR2 * quotient)) >> 16);
-	}
+#include "gte_ops.cpp.h"
 
-	// See note in gteRTPS()
-	s64 tmp = (s64)gteDQB + ((s64)gteDQA * quotient);
-	gteMAC0 = F(tmp);
-	gteIR0 = limH(tmp >> 12);
-}
+/* Tables of ops taking 'gteop', one version per combination of the fields
+ *  they use, so none are decoded and branched on at runtime. Indexed by
+ *  GTE_XXX_INDEX(gteop), see gte.h.
+ */
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteMVMVA(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
-	int mx = GTE_MX(gteop);
-	int v = GTE_V(gteop);
-	int cv = GTE_CV(gteop);
-	int lm = GTE_LM(gteop);
-	s32 vx = VX(v);
-	s32 vy = VY(v);
-	s32 vz = VZ(v);
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE MVMVA\n");
-#endif
-	gteFLAG = 0;
+// Template instantiation helper macros
+#define TI4(i)  TI(i), TI((i) + 1), TI((i) + 2), TI((i) + 3)
+#define TI16(i) TI4(i), TI4((i) + 4), TI4((i) + 8), TI4((i) + 12)
+#define TI64(i) TI16(i), TI16((i) + 16), TI16((i) + 32), TI16((i) + 48)
 
-	gteMAC1 = A1((((s64)CV1(cv) << 12) + (MX11(mx) * vx) + (MX12(mx) * vy) + (MX13(mx) * vz)) >> shift);
-	gteMAC2 = A2((((s64)CV2(cv) << 12) + (MX21(mx) * vx) + (MX22(mx) * vy) + (MX23(mx) * vz)) >> shift);
-	gteMAC3 = A3((((s64)CV3(cv) << 12) + (MX31(mx) * vx) + (MX32(mx) * vy) + (MX33(mx) * vz)) >> shift);
+#define TI(i) gteMVMVAFn<(((i) & 0xfe) << 2) | ((i) & 1)>
+const gteOpFn gteMVMVAFns[256] = {
+	TI64(0), TI64(64), TI64(128), TI64(192)
+};
+#undef TI
 
-	gteIR1 = limB1(gteMAC1, lm);
-	gteIR2 = limB2(gteMAC2, lm);
-	gteIR3 = limB3(gteMAC3, lm);
-}
+#define TI(i) gteSQRFn<(((i) & 2) << 8) | ((i) & 1)>
+const gteOpFn gteSQRFns[4] = { TI4(0) };
+#undef TI
 
-void gteNCLIP(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCLIP\n");
-#endif
-	gteFLAG = 0;
+#define TI(i) gteOPFn<(((i) & 2) << 8) | ((i) & 1)>
+const gteOpFn gteOPFns[4] = { TI4(0) };
+#undef TI
 
-	gteMAC0 = F((s64)gteSX0 * (gteSY1 - gteSY2) +
-				gteSX1 * (gteSY2 - gteSY0) +
-				gteSX2 * (gteSY0 - gteSY1));
-}
+const gteOpFn gteGPFFns[2] = { gteGPFFn<0>, gteGPFFn<1 << 9> };
+const gteOpFn gteGPLFns[2] = { gteGPLFn<0>, gteGPLFn<1 << 9> };
 
-void gteAVSZ3(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE AVSZ3\n");
-#endif
-	gteFLAG = 0;
+#undef TI4
+#undef TI16
+#undef TI64
 
-	gteMAC0 = F((s64)gteZSF3 * (gteSZ1 + gteSZ2 + gteSZ3));
-	gteOTZ = limD(gteMAC0 >> 12);
-}
-
-void gteAVSZ4(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE AVSZ4\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC0 = F((s64)gteZSF4 * (gteSZ0 + gteSZ1 + gteSZ2 + gteSZ3));
-	gteOTZ = limD(gteMAC0 >> 12);
+void gteMVMVA(u32 gteop) {
+	gteMVMVAFns[GTE_MVMVA_INDEX(gteop)]();
 }
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
 void gteSQR(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
-	int lm = GTE_LM(gteop);
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE SQR\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = (gteIR1 * gteIR1) >> shift;
-	gteMAC2 = (gteIR2 * gteIR2) >> shift;
-	gteMAC3 = (gteIR3 * gteIR3) >> shift;
-	gteIR1 = limB1(gteMAC1, lm);
-	gteIR2 = limB2(gteMAC2, lm);
-	gteIR3 = limB3(gteMAC3, lm);
-}
-
-void gteNCCS(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCCS\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = ((s64)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
-	gteMAC2 = ((s64)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
-	gteMAC3 = ((s64)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = ((s32)gteR * gteIR1) >> 8;
-	gteMAC2 = ((s32)gteG * gteIR2) >> 8;
-	gteMAC3 = ((s32)gteB * gteIR3) >> 8;
-	gteIR1 = gteMAC1;
-	gteIR2 = gteMAC2;
-	gteIR3 = gteMAC3;
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
+	gteSQRFns[GTE_SF_LM_INDEX(gteop)]();
 }
 
-void gteNCCT(void) {
-	int v;
-	s32 vx, vy, vz;
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCCT\n");
-#endif
-	gteFLAG = 0;
-
-	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = ((s64)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
-		gteMAC2 = ((s64)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
-		gteMAC3 = ((s64)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
-		gteIR1 = limB1(gteMAC1, 1);
-		gteIR2 = limB2(gteMAC2, 1);
-		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-		gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-		gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-		gteIR1 = limB1(gteMAC1, 1);
-		gteIR2 = limB2(gteMAC2, 1);
-		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = ((s32)gteR * gteIR1) >> 8;
-		gteMAC2 = ((s32)gteG * gteIR2) >> 8;
-		gteMAC3 = ((s32)gteB * gteIR3) >> 8;
-
-		gteRGB0 = gteRGB1;
-		gteRGB1 = gteRGB2;
-		gteCODE2 = gteCODE;
-		gteR2 = limC1(gteMAC1 >> 4);
-		gteG2 = limC2(gteMAC2 >> 4);
-		gteB2 = limC3(gteMAC3 >> 4);
-	}
-	gteIR1 = gteMAC1;
-	gteIR2 = gteMAC2;
-	gteIR3 = gteMAC3;
-}
-
-void gteNCDS(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCDS\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = ((s64)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
-	gteMAC2 = ((s64)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
-	gteMAC3 = ((s64)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = (((gteR << 4) * gteIR1) + (gteIR0 * limB1(A1U((s64)gteRFC - ((gteR * gteIR1) >> 8)), 0))) >> 12;
-	gteMAC2 = (((gteG << 4) * gteIR2) + (gteIR0 * limB2(A2U((s64)gteGFC - ((gteG * gteIR2) >> 8)), 0))) >> 12;
-	gteMAC3 = (((gteB << 4) * gteIR3) + (gteIR0 * limB3(A3U((s64)gteBFC - ((gteB * gteIR3) >> 8)), 0))) >> 12;
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
+void gteOP(u32 gteop) {
+	gteOPFns[GTE_SF_LM_INDEX(gteop)]();
 }
 
-void gteNCDT(void) {
-	int v;
-	s32 vx, vy, vz;
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCDT\n");
-#endif
-	gteFLAG = 0;
-
-	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = ((s64)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
-		gteMAC2 = ((s64)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
-		gteMAC3 = ((s64)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
-		gteIR1 = limB1(gteMAC1, 1);
-		gteIR2 = limB2(gteMAC2, 1);
-		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-		gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-		gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-		gteIR1 = limB1(gteMAC1, 1);
-		gteIR2 = limB2(gteMAC2, 1);
-		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = (((gteR << 4) * gteIR1) + (gteIR0 * limB1(A1U((s64)gteRFC - ((gteR * gteIR1) >> 8)), 0))) >> 12;
-		gteMAC2 = (((gteG << 4) * gteIR2) + (gteIR0 * limB2(A2U((s64)gteGFC - ((gteG * gteIR2) >> 8)), 0))) >> 12;
-		gteMAC3 = (((gteB << 4) * gteIR3) + (gteIR0 * limB3(A3U((s64)gteBFC - ((gteB * gteIR3) >> 8)), 0))) >> 12;
-
-		gteRGB0 = gteRGB1;
-		gteRGB1 = gteRGB2;
-		gteCODE2 = gteCODE;
-		gteR2 = limC1(gteMAC1 >> 4);
-		gteG2 = limC2(gteMAC2 >> 4);
-		gteB2 = limC3(gteMAC3 >> 4);
-	}
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
+void gteGPF(u32 gteop) {
+	gteGPFFns[GTE_SF_INDEX(gteop)]();
 }
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteOP(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
-	int lm = GTE_LM(gteop);
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE OP\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = ((gteR22 * gteIR3) - (gteR33 * gteIR2)) >> shift;
-	gteMAC2 = ((gteR33 * gteIR1) - (gteR11 * gteIR3)) >> shift;
-	gteMAC3 = ((gteR11 * gteIR2) - (gteR22 * gteIR1)) >> shift;
-	gteIR1 = limB1(gteMAC1, lm);
-	gteIR2 = limB2(gteMAC2, lm);
-	gteIR3 = limB3(gteMAC3, lm);
+void gteGPL(u32 gteop) {
+	gteGPLFns[GTE_SF_INDEX(gteop)]();
 }
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteDCPL(u32 gteop) {
-	int lm = GTE_LM(gteop);
-
-	s32 RIR1 = ((s32)gteR * gteIR1) >> 8;
-	s32 GIR2 = ((s32)gteG * gteIR2) >> 8;
-	s32 BIR3 = ((s32)gteB * gteIR3) >> 8;
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE DCPL\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = RIR1 + ((gteIR0 * limB1(A1U((s64)gteRFC - RIR1), 0)) >> 12);
-	gteMAC2 = GIR2 + ((gteIR0 * limB1(A2U((s64)gteGFC - GIR2), 0)) >> 12);
-	gteMAC3 = BIR3 + ((gteIR0 * limB1(A3U((s64)gteBFC - BIR3), 0)) >> 12);
-
-	gteIR1 = limB1(gteMAC1, lm);
-	gteIR2 = limB2(gteMAC2, lm);
-	gteIR3 = limB3(gteMAC3, lm);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
+#ifdef GTE_USE_SIMD
+#pragma GCC push_options
+#pragma GCC target("avx2")
+namespace gte_avx2 {
+#include "gte_simd.cpp.h"
 }
+#pragma GCC pop_options
+#endif // GTE_USE_SIMD
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteGPF(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
+extern void (*psxCP2[64])(void);
 
-#ifdef GTE_LOG
-	GTE_LOG("GTE GPF\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = (gteIR0 * gteIR1) >> shift;
-	gteMAC2 = (gteIR0 * gteIR2) >> shift;
-	gteMAC3 = (gteIR0 * gteIR3) >> shift;
-	gteIR1 = limB1(gteMAC1, 0);
-	gteIR2 = limB2(gteMAC2, 0);
-	gteIR3 = limB3(gteMAC3, 0);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
-}
-
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteGPL(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
+bool gte_simd_ops;
 
-#ifdef GTE_LOG
-	GTE_LOG("GTE GPL\n");
+static void gteSimdInit(void) {
+	gte_simd_ops = false;
+#ifdef GTE_USE_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		psxCP2[0x16] = gte_avx2::ncdt;
+		psxCP2[0x20] = gte_avx2::nct;
+		psxCP2[0x3f] = gte_avx2::ncct;
+		gte_simd_ops = true;
+		printf("GTE: using AVX2 for NCT/NCCT/NCDT\n");
+	}
 #endif
-	gteFLAG = 0;
-
-	gteMAC1 = A1((((s64)gteMAC1 << shift) + (gteIR0 * gteIR1)) >> shift);
-	gteMAC2 = A2((((s64)gteMAC2 << shift) + (gteIR0 * gteIR2)) >> shift);
-	gteMAC3 = A3((((s64)gteMAC3 << shift) + (gteIR0 * gteIR3)) >> shift);
-	gteIR1 = limB1(gteMAC1, 0);
-	gteIR2 = limB2(gteMAC2, 0);
-	gteIR3 = limB3(gteMAC3, 0);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
 }
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteDPCS(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
 
-#ifdef GTE_LOG
-	GTE_LOG("GTE DPCS\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = ((gteR << 16) + (gteIR0 * limB1(A1U(((s64)gteRFC - (gteR << 4)) << (12 - shift)), 0))) >> 12;
-	gteMAC2 = ((gteG << 16) + (gteIR0 * limB2(A2U(((s64)gteGFC - (gteG << 4)) << (12 - shift)), 0))) >> 12;
-	gteMAC3 = ((gteB << 16) + (gteIR0 * limB3(A3U(((s64)gteBFC - (gteB << 4)) << (12 - shift)), 0))) >> 12;
-
-	gteIR1 = limB1(gteMAC1, 0);
-	gteIR2 = limB2(gteMAC2, 0);
-	gteIR3 = limB3(gteMAC3, 0);
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
-}
+/* Lazy FLAG (-gtelazyflag option)
+ *
+ *  Every GTE op clears FLAG before setting bits in it, so FLAG after an op
+ * depends only on the op and the registers it started with. In lazy mode,
+ * ops run without FLAG bookkeeping, as the gte_noflag versions of them,
+ * and record the opcode and the data registers they read instead. Control registers
+ * aren't recorded: ops never write them, and CTC2 brings FLAG up to date
+ * before it writes one. When FLAG is read, gteFlagFlush() runs the op
+ * again, with FLAG bookkeeping, on the recorded data registers, and puts
+ * back the current ones afterwards.
+ *
+ *  Anything reading or writing FLAG (CP2C reg 31) other than by CFC2/CTC2
+ * must call gte_flag_update() first: savestates, reset, psxverify.cpp.
+ */
 
-void gteDPCT(void) {
-	int v;
+namespace gte_noflag {
 
-#ifdef GTE_LOG
-	GTE_LOG("GTE DPCT\n");
-#endif
-	gteFLAG = 0;
-
-	for (v = 0; v < 3; v++) {
-		gteMAC1 = ((gteR0 << 16) + (gteIR0 * limB1(A1U((s64)gteRFC - (gteR0 << 4)), 0))) >> 12;
-		gteMAC2 = ((gteG0 << 16) + (gteIR0 * limB1(A2U((s64)gteGFC - (gteG0 << 4)), 0))) >> 12;
-		gteMAC3 = ((gteB0 << 16) + (gteIR0 * limB1(A3U((s64)gteBFC - (gteB0 << 4)), 0))) >> 12;
-
-		gteRGB0 = gteRGB1;
-		gteRGB1 = gteRGB2;
-		gteCODE2 = gteCODE;
-		gteR2 = limC1(gteMAC1 >> 4);
-		gteG2 = limC2(gteMAC2 >> 4);
-		gteB2 = limC3(gteMAC3 >> 4);
-	}
-	gteIR1 = limB1(gteMAC1, 0);
-	gteIR2 = limB2(gteMAC2, 0);
-	gteIR3 = limB3(gteMAC3, 0);
-}
+// Assignments to FLAG compile to nothing
+struct NoFlag {
+	void operator=(u32) {}
+};
+#undef gteFLAG
+#define gteFLAG NoFlag()
 
-void gteNCS(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCS\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = ((s64)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
-	gteMAC2 = ((s64)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
-	gteMAC3 = ((s64)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
+INLINE s64 BOUNDS(s64 n_value, s64, int, s64, int) {
+	return n_value;
 }
 
-void gteNCT(void) {
-	int v;
-	s32 vx, vy, vz;
-
-#ifdef GTE_LOG
-	GTE_LOG("GTE NCT\n");
-#endif
-	gteFLAG = 0;
-
-	for (v = 0; v < 3; v++) {
-		vx = VX(v);
-		vy = VY(v);
-		vz = VZ(v);
-		gteMAC1 = ((s64)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
-		gteMAC2 = ((s64)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
-		gteMAC3 = ((s64)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
-		gteIR1 = limB1(gteMAC1, 1);
-		gteIR2 = limB2(gteMAC2, 1);
-		gteIR3 = limB3(gteMAC3, 1);
-		gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-		gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-		gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-		gteRGB0 = gteRGB1;
-		gteRGB1 = gteRGB2;
-		gteCODE2 = gteCODE;
-		gteR2 = limC1(gteMAC1 >> 4);
-		gteG2 = limC2(gteMAC2 >> 4);
-		gteB2 = limC3(gteMAC3 >> 4);
-	}
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
+INLINE s32 LIM(s32 value, s32 max, s32 min, u32) {
+	return (value > max) ? max : ((value < min) ? min : value);
 }
 
-void gteCC(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE CC\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = ((s32)gteR * gteIR1) >> 8;
-	gteMAC2 = ((s32)gteG * gteIR2) >> 8;
-	gteMAC3 = ((s32)gteB * gteIR3) >> 8;
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
+INLINE u32 limE(u32 result) {
+	return (result > 0x1ffff) ? 0x1ffff : result;
 }
 
-// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
-void gteINTPL(u32 gteop) {
-	int shift = 12 * GTE_SF(gteop);
-	int lm = GTE_LM(gteop);
+#include "gte_ops.cpp.h"
 
-#ifdef GTE_LOG
-	GTE_LOG("GTE INTPL\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = ((gteIR1 << 12) + (gteIR0 * limB1(A1U((s64)gteRFC - gteIR1), 0))) >> shift;
-	gteMAC2 = ((gteIR2 << 12) + (gteIR0 * limB2(A2U((s64)gteGFC - gteIR2), 0))) >> shift;
-	gteMAC3 = ((gteIR3 << 12) + (gteIR0 * limB3(A3U((s64)gteBFC - gteIR3), 0))) >> shift;
-	gteIR1 = limB1(gteMAC1, lm);
-	gteIR2 = limB2(gteMAC2, lm);
-	gteIR3 = limB3(gteMAC3, lm);
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
-}
+#undef gteFLAG
+#define gteFLAG (psxRegs.CP2C.r[31])
 
-void gteCDP(void) {
-#ifdef GTE_LOG
-	GTE_LOG("GTE CDP\n");
-#endif
-	gteFLAG = 0;
-
-	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
-	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
-	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-	gteMAC1 = (((gteR << 4) * gteIR1) + (gteIR0 * limB1(A1U((s64)gteRFC - ((gteR * gteIR1) >> 8)), 0))) >> 12;
-	gteMAC2 = (((gteG << 4) * gteIR2) + (gteIR0 * limB2(A2U((s64)gteGFC - ((gteG * gteIR2) >> 8)), 0))) >> 12;
-	gteMAC3 = (((gteB << 4) * gteIR3) + (gteIR0 * limB3(A3U((s64)gteBFC - ((gteB * gteIR3) >> 8)), 0))) >> 12;
-	gteIR1 = limB1(gteMAC1, 1);
-	gteIR2 = limB2(gteMAC2, 1);
-	gteIR3 = limB3(gteMAC3, 1);
-
-	gteRGB0 = gteRGB1;
-	gteRGB1 = gteRGB2;
-	gteCODE2 = gteCODE;
-	gteR2 = limC1(gteMAC1 >> 4);
-	gteG2 = limC2(gteMAC2 >> 4);
-	gteB2 = limC3(gteMAC3 >> 4);
+} // namespace gte_noflag
+
+bool gte_flag_pending;
+bool gte_lazy_flag;
+static u32  flag_code;          // Opcode of op FLAG is pending for
+static u32  flag_cp2d[32];      // Data regs it read, as they were
+static void (*flag_ops[64])(void);  // psxCP2[] before lazy ops went in
+
+// Record op 'code', which reads data regs 'first'..'last'
+#define flag_record(code, first, last) \
+do { \
+	flag_code = (code); \
+	memcpy(&flag_cp2d[first], &psxRegs.CP2D.r[first], ((last) - (first) + 1) * 4); \
+	gte_flag_pending = true; \
+} while (0)
+
+void gteFlagFlush(void) {
+	if (!gte_flag_pending)
+		return;
+	gte_flag_pending = false;
+
+	// Regs the op doesn't read are stale in flag_cp2d[], which is harmless
+	u32 cp2d[32];
+	const u32 code = psxRegs.code;
+	memcpy(cp2d, psxRegs.CP2D.r, sizeof(cp2d));
+	memcpy(psxRegs.CP2D.r, flag_cp2d, sizeof(flag_cp2d));
+	psxRegs.code = flag_code;
+	flag_ops[flag_code & 0x3f]();
+	psxRegs.code = code;
+	memcpy(psxRegs.CP2D.r, cp2d, sizeof(cp2d));
+}
+
+/* Lazy versions of ops, with the same arguments, recording the data regs
+ *  'first'..'last' the op reads. Those taking 'gteop' get a wrapper for
+ *  psxCP2[], like the interpreter's own, and record it in an opcode with
+ *  the same bits as the real one where the op looks.
+ */
+#define LAZY_OP_0(f, funct, first, last) \
+void gteLazy##f(void) { \
+	flag_record(funct, first, last); \
+	gte_noflag::gte##f(); \
+}
+#define LAZY_OP_1(f, funct, first, last) \
+void gteLazy##f(u32 gteop) { \
+	flag_record((gteop << 10) | funct, first, last); \
+	gte_noflag::gte##f(gteop); \
+} \
+static void w_gteLazy##f(void) { \
+	gteLazy##f(psxRegs.code >> 10); \
+}
+
+/* Ops where recording inputs measured slower than keeping FLAG up to date:
+ *  they're short, or read IR1..IR3 right after an op wrote their low
+ *  halves (which stalls copying them as words), or have AVX2 versions.
+ *  They compute FLAG as usual, cancelling any pending one. In psxCP2[],
+ *  eager_op() does this for the versions gteSimdInit() put there.
+ */
+#define EAGER_OP_0(f) \
+void gteLazy##f(void) { \
+	gte_flag_pending = false; \
+	gte##f(); \
+}
+#define EAGER_OP_1(f) \
+void gteLazy##f(u32 gteop) { \
+	gte_flag_pending = false; \
+	gte##f(gteop); \
+}
+
+static void eager_op(void) {
+	gte_flag_pending = false;
+	flag_ops[psxRegs.code & 0x3f]();
+}
+
+// Data regs: 0-5 V0..V2, 6 RGB, 8-11 IR0..IR3, 12-14 SXY0..SXY2,
+//  16-19 SZ0..SZ3, 20-22 RGB0..RGB2
+LAZY_OP_0(RTPS,  0x01,  0,  1)
+LAZY_OP_0(NCLIP, 0x06, 12, 14)
+LAZY_OP_1(DPCS,  0x10,  6,  8)
+LAZY_OP_1(INTPL, 0x11,  8, 11)
+LAZY_OP_0(NCDS,  0x13,  0,  8)
+LAZY_OP_0(NCDT,  0x16,  0,  8)
+LAZY_OP_1(DCPL,  0x29,  6, 11)
+LAZY_OP_0(AVSZ3, 0x2d, 17, 19)
+LAZY_OP_0(AVSZ4, 0x2e, 16, 19)
+LAZY_OP_0(RTPT,  0x30,  0,  5)
+EAGER_OP_1(OP)
+EAGER_OP_1(MVMVA)
+EAGER_OP_0(CDP)
+EAGER_OP_0(NCCS)
+EAGER_OP_0(CC)
+EAGER_OP_0(NCS)
+EAGER_OP_0(NCT)
+EAGER_OP_1(SQR)
+EAGER_OP_0(DPCT)
+EAGER_OP_1(GPF)
+EAGER_OP_1(GPL)
+EAGER_OP_0(NCCT)
+
+static const struct {
+	u8 funct;
+	void (*op)(void);
+} lazy_ops[] = {
+	{ 0x01, gteLazyRTPS },    { 0x06, gteLazyNCLIP },   { 0x0c, eager_op },
+	{ 0x10, w_gteLazyDPCS },  { 0x11, w_gteLazyINTPL }, { 0x12, eager_op },
+	{ 0x13, gteLazyNCDS },    { 0x14, eager_op },       { 0x16, gteLazyNCDT },
+	{ 0x1b, eager_op },       { 0x1c, eager_op },       { 0x1e, eager_op },
+	{ 0x20, eager_op },       { 0x28, eager_op },       { 0x29, w_gteLazyDCPL },
+	{ 0x2a, eager_op },       { 0x2d, gteLazyAVSZ3 },   { 0x2e, gteLazyAVSZ4 },
+	{ 0x30, gteLazyRTPT },    { 0x3d, eager_op },       { 0x3e, eager_op },
+	{ 0x3f, eager_op },
+};
+
+static void gteFlagInit(void) {
+	gte_flag_pending = false;
+	gte_lazy_flag = Config.GteLazyFlag;
+	if (!gte_lazy_flag)
+		return;
+
+	memcpy(flag_ops, psxCP2, sizeof(flag_ops));
+	for (unsigned i = 0; i < sizeof(lazy_ops) / sizeof(lazy_ops[0]); i++)
+		psxCP2[lazy_ops[i].funct] = lazy_ops[i].op;
+	printf("GTE: computing FLAG only when it's read\n");
+}
+
+// psxCP2[] as it was before gteInit() first changed it
+static void (*gte_c_ops[64])(void);
+
+void gteInit(void) {
+	if (!gte_c_ops[0])
+		memcpy(gte_c_ops, psxCP2, sizeof(gte_c_ops));
+	memcpy(psxCP2, gte_c_ops, sizeof(psxCP2));
+
+	gteSimdInit();
+	gteFlagInit();
 }
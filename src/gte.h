@@ -54,6 +54,48 @@ void gteGPF(u32 gteop);
 void gteGPL(u32 gteop);
 void gteNCCT(void);
 
+/* Versions of gteMVMVA(), gteSQR(), gteOP(), gteGPF() and gteGPL() with the
+ *  'gteop' fields they use fixed at compile time. Callers knowing the
+ *  opcode can call the one it needs directly, with no argument:
+ *   MVMVA:    sf, mx, v, cv, lm   (opcode bits 19, 18-17, 16-15, 14-13, 10)
+ *   SQR, OP:  sf, lm
+ *   GPF, GPL: sf
+ */
+typedef void (*gteOpFn)(void);
+#define GTE_MVMVA_INDEX(gteop) ((((gteop) >> 2) & 0xfe) | ((gteop) & 1))
+#define GTE_SF_LM_INDEX(gteop) ((((gteop) >> 8) & 2) | ((gteop) & 1))
+#define GTE_SF_INDEX(gteop)    (((gteop) >> 9) & 1)
+extern const gteOpFn gteMVMVAFns[256];
+extern const gteOpFn gteSQRFns[4];
+extern const gteOpFn gteOPFns[4];
+extern const gteOpFn gteGPFFns[2];
+extern const gteOpFn gteGPLFns[2];
+
+// Install versions of GTE ops in the interpreter's psxCP2[] table (which
+//  x86_64 recompiler also calls through): the fastest the host CPU
+//  supports, and with Config.GteLazyFlag, ones that leave FLAG to be
+//  computed when it's read. Call before CPU init.
+void gteInit(void);
+
+// gteInit() put AVX2 versions of NCT/NCCT/NCDT in psxCP2[]
+extern bool gte_simd_ops;
+
+// Lazy FLAG: set when FLAG (CP2C reg 31) is out of date
+extern bool gte_flag_pending;
+// Lazy FLAG mode is on: recompilers calling ops directly must call the
+//  gteLazyXXX() versions, and gteFlagFlush() before reading or writing
+//  control regs
+extern bool gte_lazy_flag;
+
+// Bring FLAG up to date, if it's pending
+void gteFlagFlush(void);
+
+static inline void gte_flag_update(void)
+{
+	if (__builtin_expect(gte_flag_pending, 0))
+		gteFlagFlush();
+}
+
 // for the recompiler
 u32 gtecalcMFC2(int reg);
 void gtecalcMTC2(u32 value, int reg);
@@ -0,0 +1,586 @@
+/*
+ * GTE operations, included by gte.cpp twice: once as the gteXXX() functions
+ *  everything calls, and once inside namespace gte_noflag, with BOUNDS(),
+ *  LIM() and limE() that only clamp and FLAG writes that do nothing, for
+ *  lazy FLAG mode (see gteFlagFlush() in gte.cpp).
+ */
+void gteRTPS(void) {
+	int quotient;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE RTPS\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = A1((((s64)gteTRX << 12) + (gteR11 * gteVX0) + (gteR12 * gteVY0) + (gteR13 * gteVZ0)) >> 12);
+	gteMAC2 = A2((((s64)gteTRY << 12) + (gteR21 * gteVX0) + (gteR22 * gteVY0) + (gteR23 * gteVZ0)) >> 12);
+	gteMAC3 = A3((((s64)gteTRZ << 12) + (gteR31 * gteVX0) + (gteR32 * gteVY0) + (gteR33 * gteVZ0)) >> 12);
+	gteIR1 = limB1(gteMAC1, 0);
+	gteIR2 = limB2(gteMAC2, 0);
+	gteIR3 = limB3(gteMAC3, 0);
+	gteSZ0 = gteSZ1;
+	gteSZ1 = gteSZ2;
+	gteSZ2 = gteSZ3;
+	gteSZ3 = limD(gteMAC3);
+	quotient = limE(DIVIDE(gteH, gteSZ3));
+	gteSXY0 = gteSXY1;
+	gteSXY1 = gteSXY2;
+	gteSX2 = limG1(F((s64)gteOFX + ((s64)gteIR1 * quotient)) >> 16);
+	gteSY2 = limG2(F((s64)gteOFY + ((s64)gteIR2 * quotient)) >> 16);
+
+	//senquack - Fix glitched drawing of road surface in 'Burning Road'..
+	// behavior now matches Mednafen. This also preserves the fix by Shalma
+	// from prior commit f916013 for missing elements in 'Legacy of Kain:
+	// Soul Reaver' (missing green plasma balls in first level).
+	s64 tmp = (s64)gteDQB + ((s64)gteDQA * quotient);
+	gteMAC0 = F(tmp);
+	gteIR0 = limH(tmp >> 12);
+}
+
+void gteRTPT(void) {
+	int quotient;
+	int v;
+	s32 vx, vy, vz;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE RTPT\n");
+#endif
+	gteFLAG = 0;
+
+	gteSZ0 = gteSZ3;
+	for (v = 0; v < 3; v++) {
+		vx = VX(v);
+		vy = VY(v);
+		vz = VZ(v);
+		gteMAC1 = A1((((s64)gteTRX << 12) + (gteR11 * vx) + (gteR12 * vy) + (gteR13 * vz)) >> 12);
+		gteMAC2 = A2((((s64)gteTRY << 12) + (gteR21 * vx) + (gteR22 * vy) + (gteR23 * vz)) >> 12);
+		gteMAC3 = A3((((s64)gteTRZ << 12) + (gteR31 * vx) + (gteR32 * vy) + (gteR33 * vz)) >> 12);
+		gteIR1 = limB1(gteMAC1, 0);
+		gteIR2 = limB2(gteMAC2, 0);
+		gteIR3 = limB3(gteMAC3, 0);
+		fSZ(v) = limD(gteMAC3);
+		quotient = limE(DIVIDE(gteH, fSZ(v)));
+		fSX(v) = limG1(F((s64)gteOFX + ((s64)gteIR1 * quotient)) >> 16);
+		fSY(v) = limG2(F((s64)gteOFY + ((s64)gteIR2 * quotient)) >> 16);
+	}
+
+	// See note in gteRTPS()
+	s64 tmp = (s64)gteDQB + ((s64)gteDQA * quotient);
+	gteMAC0 = F(tmp);
+	gteIR0 = limH(tmp >> 12);
+}
+
+// NOTE: 'gteop' is instruction opcode shifted right 10 places. Instantiated
+//  for every combination of the fields it uses, see gteMVMVA() in gte.cpp.
+template<u32 gteop>
+static void gteMVMVAFn(void) {
+	int shift = 12 * GTE_SF(gteop);
+	int mx = GTE_MX(gteop);
+	int v = GTE_V(gteop);
+	int cv = GTE_CV(gteop);
+	int lm = GTE_LM(gteop);
+	s32 vx = VX(v);
+	s32 vy = VY(v);
+	s32 vz = VZ(v);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE MVMVA\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = A1((((s64)CV1(cv) << 12) + (MX11(mx) * vx) + (MX12(mx) * vy) + (MX13(mx) * vz)) >> shift);
+	gteMAC2 = A2((((s64)CV2(cv) << 12) + (MX21(mx) * vx) + (MX22(mx) * vy) + (MX23(mx) * vz)) >> shift);
+	gteMAC3 = A3((((s64)CV3(cv) << 12) + (MX31(mx) * vx) + (MX32(mx) * vy) + (MX33(mx) * vz)) >> shift);
+
+	gteIR1 = limB1(gteMAC1, lm);
+	gteIR2 = limB2(gteMAC2, lm);
+	gteIR3 = limB3(gteMAC3, lm);
+}
+
+void gteNCLIP(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCLIP\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC0 = F((s64)gteSX0 * (gteSY1 - gteSY2) +
+				gteSX1 * (gteSY2 - gteSY0) +
+				gteSX2 * (gteSY0 - gteSY1));
+}
+
+void gteAVSZ3(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE AVSZ3\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC0 = F((s64)gteZSF3 * (gteSZ1 + gteSZ2 + gteSZ3));
+	gteOTZ = limD(gteMAC0 >> 12);
+}
+
+void gteAVSZ4(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE AVSZ4\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC0 = F((s64)gteZSF4 * (gteSZ0 + gteSZ1 + gteSZ2 + gteSZ3));
+	gteOTZ = limD(gteMAC0 >> 12);
+}
+
+// NOTE: 'gteop' is instruction opcode shifted right 10 places. Instantiated
+//  for every combination of the fields it uses, see gteSQR() in gte.cpp.
+template<u32 gteop>
+static void gteSQRFn(void) {
+	int shift = 12 * GTE_SF(gteop);
+	int lm = GTE_LM(gteop);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE SQR\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = (gteIR1 * gteIR1) >> shift;
+	gteMAC2 = (gteIR2 * gteIR2) >> shift;
+	gteMAC3 = (gteIR3 * gteIR3) >> shift;
+	gteIR1 = limB1(gteMAC1, lm);
+	gteIR2 = limB2(gteMAC2, lm);
+	gteIR3 = limB3(gteMAC3, lm);
+}
+
+void gteNCCS(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCCS\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = ((s64)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
+	gteMAC2 = ((s64)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
+	gteMAC3 = ((s64)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = ((s32)gteR * gteIR1) >> 8;
+	gteMAC2 = ((s32)gteG * gteIR2) >> 8;
+	gteMAC3 = ((s32)gteB * gteIR3) >> 8;
+	gteIR1 = gteMAC1;
+	gteIR2 = gteMAC2;
+	gteIR3 = gteMAC3;
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+void gteNCCT(void) {
+	int v;
+	s32 vx, vy, vz;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCCT\n");
+#endif
+	gteFLAG = 0;
+
+	for (v = 0; v < 3; v++) {
+		vx = VX(v);
+		vy = VY(v);
+		vz = VZ(v);
+		gteMAC1 = ((s64)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
+		gteMAC2 = ((s64)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
+		gteMAC3 = ((s64)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
+		gteIR1 = limB1(gteMAC1, 1);
+		gteIR2 = limB2(gteMAC2, 1);
+		gteIR3 = limB3(gteMAC3, 1);
+		gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+		gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+		gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+		gteIR1 = limB1(gteMAC1, 1);
+		gteIR2 = limB2(gteMAC2, 1);
+		gteIR3 = limB3(gteMAC3, 1);
+		gteMAC1 = ((s32)gteR * gteIR1) >> 8;
+		gteMAC2 = ((s32)gteG * gteIR2) >> 8;
+		gteMAC3 = ((s32)gteB * gteIR3) >> 8;
+
+		gteRGB0 = gteRGB1;
+		gteRGB1 = gteRGB2;
+		gteCODE2 = gteCODE;
+		gteR2 = limC1(gteMAC1 >> 4);
+		gteG2 = limC2(gteMAC2 >> 4);
+		gteB2 = limC3(gteMAC3 >> 4);
+	}
+	gteIR1 = gteMAC1;
+	gteIR2 = gteMAC2;
+	gteIR3 = gteMAC3;
+}
+
+void gteNCDS(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCDS\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = ((s64)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
+	gteMAC2 = ((s64)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
+	gteMAC3 = ((s64)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = (((gteR << 4) * gteIR1) + (gteIR0 * limB1(A1U((s64)gteRFC - ((gteR * gteIR1) >> 8)), 0))) >> 12;
+	gteMAC2 = (((gteG << 4) * gteIR2) + (gteIR0 * limB2(A2U((s64)gteGFC - ((gteG * gteIR2) >> 8)), 0))) >> 12;
+	gteMAC3 = (((gteB << 4) * gteIR3) + (gteIR0 * limB3(A3U((s64)gteBFC - ((gteB * gteIR3) >> 8)), 0))) >> 12;
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+void gteNCDT(void) {
+	int v;
+	s32 vx, vy, vz;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCDT\n");
+#endif
+	gteFLAG = 0;
+
+	for (v = 0; v < 3; v++) {
+		vx = VX(v);
+		vy = VY(v);
+		vz = VZ(v);
+		gteMAC1 = ((s64)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
+		gteMAC2 = ((s64)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
+		gteMAC3 = ((s64)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
+		gteIR1 = limB1(gteMAC1, 1);
+		gteIR2 = limB2(gteMAC2, 1);
+		gteIR3 = limB3(gteMAC3, 1);
+		gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+		gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+		gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+		gteIR1 = limB1(gteMAC1, 1);
+		gteIR2 = limB2(gteMAC2, 1);
+		gteIR3 = limB3(gteMAC3, 1);
+		gteMAC1 = (((gteR << 4) * gteIR1) + (gteIR0 * limB1(A1U((s64)gteRFC - ((gteR * gteIR1) >> 8)), 0))) >> 12;
+		gteMAC2 = (((gteG << 4) * gteIR2) + (gteIR0 * limB2(A2U((s64)gteGFC - ((gteG * gteIR2) >> 8)), 0))) >> 12;
+		gteMAC3 = (((gteB << 4) * gteIR3) + (gteIR0 * limB3(A3U((s64)gteBFC - ((gteB * gteIR3) >> 8)), 0))) >> 12;
+
+		gteRGB0 = gteRGB1;
+		gteRGB1 = gteRGB2;
+		gteCODE2 = gteCODE;
+		gteR2 = limC1(gteMAC1 >> 4);
+		gteG2 = limC2(gteMAC2 >> 4);
+		gteB2 = limC3(gteMAC3 >> 4);
+	}
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+}
+
+// NOTE: 'gteop' is instruction opcode shifted right 10 places. Instantiated
+//  for every combination of the fields it uses, see gteOP() in gte.cpp.
+template<u32 gteop>
+static void gteOPFn(void) {
+	int shift = 12 * GTE_SF(gteop);
+	int lm = GTE_LM(gteop);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE OP\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = ((gteR22 * gteIR3) - (gteR33 * gteIR2)) >> shift;
+	gteMAC2 = ((gteR33 * gteIR1) - (gteR11 * gteIR3)) >> shift;
+	gteMAC3 = ((gteR11 * gteIR2) - (gteR22 * gteIR1)) >> shift;
+	gteIR1 = limB1(gteMAC1, lm);
+	gteIR2 = limB2(gteMAC2, lm);
+	gteIR3 = limB3(gteMAC3, lm);
+}
+
+// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
+void gteDCPL(u32 gteop) {
+	int lm = GTE_LM(gteop);
+
+	s32 RIR1 = ((s32)gteR * gteIR1) >> 8;
+	s32 GIR2 = ((s32)gteG * gteIR2) >> 8;
+	s32 BIR3 = ((s32)gteB * gteIR3) >> 8;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE DCPL\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = RIR1 + ((gteIR0 * limB1(A1U((s64)gteRFC - RIR1), 0)) >> 12);
+	gteMAC2 = GIR2 + ((gteIR0 * limB1(A2U((s64)gteGFC - GIR2), 0)) >> 12);
+	gteMAC3 = BIR3 + ((gteIR0 * limB1(A3U((s64)gteBFC - BIR3), 0)) >> 12);
+
+	gteIR1 = limB1(gteMAC1, lm);
+	gteIR2 = limB2(gteMAC2, lm);
+	gteIR3 = limB3(gteMAC3, lm);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+// NOTE: 'gteop' is instruction opcode shifted right 10 places. Instantiated
+//  for every combination of the fields it uses, see gteGPF() in gte.cpp.
+template<u32 gteop>
+static void gteGPFFn(void) {
+	int shift = 12 * GTE_SF(gteop);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE GPF\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = (gteIR0 * gteIR1) >> shift;
+	gteMAC2 = (gteIR0 * gteIR2) >> shift;
+	gteMAC3 = (gteIR0 * gteIR3) >> shift;
+	gteIR1 = limB1(gteMAC1, 0);
+	gteIR2 = limB2(gteMAC2, 0);
+	gteIR3 = limB3(gteMAC3, 0);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+// NOTE: 'gteop' is instruction opcode shifted right 10 places. Instantiated
+//  for every combination of the fields it uses, see gteGPL() in gte.cpp.
+template<u32 gteop>
+static void gteGPLFn(void) {
+	int shift = 12 * GTE_SF(gteop);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE GPL\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = A1((((s64)gteMAC1 << shift) + (gteIR0 * gteIR1)) >> shift);
+	gteMAC2 = A2((((s64)gteMAC2 << shift) + (gteIR0 * gteIR2)) >> shift);
+	gteMAC3 = A3((((s64)gteMAC3 << shift) + (gteIR0 * gteIR3)) >> shift);
+	gteIR1 = limB1(gteMAC1, 0);
+	gteIR2 = limB2(gteMAC2, 0);
+	gteIR3 = limB3(gteMAC3, 0);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
+void gteDPCS(u32 gteop) {
+	int shift = 12 * GTE_SF(gteop);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE DPCS\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = ((gteR << 16) + (gteIR0 * limB1(A1U(((s64)gteRFC - (gteR << 4)) << (12 - shift)), 0))) >> 12;
+	gteMAC2 = ((gteG << 16) + (gteIR0 * limB2(A2U(((s64)gteGFC - (gteG << 4)) << (12 - shift)), 0))) >> 12;
+	gteMAC3 = ((gteB << 16) + (gteIR0 * limB3(A3U(((s64)gteBFC - (gteB << 4)) << (12 - shift)), 0))) >> 12;
+
+	gteIR1 = limB1(gteMAC1, 0);
+	gteIR2 = limB2(gteMAC2, 0);
+	gteIR3 = limB3(gteMAC3, 0);
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+void gteDPCT(void) {
+	int v;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE DPCT\n");
+#endif
+	gteFLAG = 0;
+
+	for (v = 0; v < 3; v++) {
+		gteMAC1 = ((gteR0 << 16) + (gteIR0 * limB1(A1U((s64)gteRFC - (gteR0 << 4)), 0))) >> 12;
+		gteMAC2 = ((gteG0 << 16) + (gteIR0 * limB1(A2U((s64)gteGFC - (gteG0 << 4)), 0))) >> 12;
+		gteMAC3 = ((gteB0 << 16) + (gteIR0 * limB1(A3U((s64)gteBFC - (gteB0 << 4)), 0))) >> 12;
+
+		gteRGB0 = gteRGB1;
+		gteRGB1 = gteRGB2;
+		gteCODE2 = gteCODE;
+		gteR2 = limC1(gteMAC1 >> 4);
+		gteG2 = limC2(gteMAC2 >> 4);
+		gteB2 = limC3(gteMAC3 >> 4);
+	}
+	gteIR1 = limB1(gteMAC1, 0);
+	gteIR2 = limB2(gteMAC2, 0);
+	gteIR3 = limB3(gteMAC3, 0);
+}
+
+void gteNCS(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCS\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = ((s64)(gteL11 * gteVX0) + (gteL12 * gteVY0) + (gteL13 * gteVZ0)) >> 12;
+	gteMAC2 = ((s64)(gteL21 * gteVX0) + (gteL22 * gteVY0) + (gteL23 * gteVZ0)) >> 12;
+	gteMAC3 = ((s64)(gteL31 * gteVX0) + (gteL32 * gteVY0) + (gteL33 * gteVZ0)) >> 12;
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+void gteNCT(void) {
+	int v;
+	s32 vx, vy, vz;
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE NCT\n");
+#endif
+	gteFLAG = 0;
+
+	for (v = 0; v < 3; v++) {
+		vx = VX(v);
+		vy = VY(v);
+		vz = VZ(v);
+		gteMAC1 = ((s64)(gteL11 * vx) + (gteL12 * vy) + (gteL13 * vz)) >> 12;
+		gteMAC2 = ((s64)(gteL21 * vx) + (gteL22 * vy) + (gteL23 * vz)) >> 12;
+		gteMAC3 = ((s64)(gteL31 * vx) + (gteL32 * vy) + (gteL33 * vz)) >> 12;
+		gteIR1 = limB1(gteMAC1, 1);
+		gteIR2 = limB2(gteMAC2, 1);
+		gteIR3 = limB3(gteMAC3, 1);
+		gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+		gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+		gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+		gteRGB0 = gteRGB1;
+		gteRGB1 = gteRGB2;
+		gteCODE2 = gteCODE;
+		gteR2 = limC1(gteMAC1 >> 4);
+		gteG2 = limC2(gteMAC2 >> 4);
+		gteB2 = limC3(gteMAC3 >> 4);
+	}
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+}
+
+void gteCC(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE CC\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = ((s32)gteR * gteIR1) >> 8;
+	gteMAC2 = ((s32)gteG * gteIR2) >> 8;
+	gteMAC3 = ((s32)gteB * gteIR3) >> 8;
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+// NOTE: 'gteop' parameter is instruction opcode shifted right 10 places.
+void gteINTPL(u32 gteop) {
+	int shift = 12 * GTE_SF(gteop);
+	int lm = GTE_LM(gteop);
+
+#ifdef GTE_LOG
+	GTE_LOG("GTE INTPL\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = ((gteIR1 << 12) + (gteIR0 * limB1(A1U((s64)gteRFC - gteIR1), 0))) >> shift;
+	gteMAC2 = ((gteIR2 << 12) + (gteIR0 * limB2(A2U((s64)gteGFC - gteIR2), 0))) >> shift;
+	gteMAC3 = ((gteIR3 << 12) + (gteIR0 * limB3(A3U((s64)gteBFC - gteIR3), 0))) >> shift;
+	gteIR1 = limB1(gteMAC1, lm);
+	gteIR2 = limB2(gteMAC2, lm);
+	gteIR3 = limB3(gteMAC3, lm);
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
+
+void gteCDP(void) {
+#ifdef GTE_LOG
+	GTE_LOG("GTE CDP\n");
+#endif
+	gteFLAG = 0;
+
+	gteMAC1 = A1((((s64)gteRBK << 12) + (gteLR1 * gteIR1) + (gteLR2 * gteIR2) + (gteLR3 * gteIR3)) >> 12);
+	gteMAC2 = A2((((s64)gteGBK << 12) + (gteLG1 * gteIR1) + (gteLG2 * gteIR2) + (gteLG3 * gteIR3)) >> 12);
+	gteMAC3 = A3((((s64)gteBBK << 12) + (gteLB1 * gteIR1) + (gteLB2 * gteIR2) + (gteLB3 * gteIR3)) >> 12);
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+	gteMAC1 = (((gteR << 4) * gteIR1) + (gteIR0 * limB1(A1U((s64)gteRFC - ((gteR * gteIR1) >> 8)), 0))) >> 12;
+	gteMAC2 = (((gteG << 4) * gteIR2) + (gteIR0 * limB2(A2U((s64)gteGFC - ((gteG * gteIR2) >> 8)), 0))) >> 12;
+	gteMAC3 = (((gteB << 4) * gteIR3) + (gteIR0 * limB3(A3U((s64)gteBFC - ((gteB * gteIR3) >> 8)), 0))) >> 12;
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+
+	gteRGB0 = gteRGB1;
+	gteRGB1 = gteRGB2;
+	gteCODE2 = gteCODE;
+	gteR2 = limC1(gteMAC1 >> 4);
+	gteG2 = limC2(gteMAC2 >> 4);
+	gteB2 = limC3(gteMAC3 >> 4);
+}
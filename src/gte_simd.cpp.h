@@ -0,0 +1,220 @@
+/*
+ * AVX2 GTE kernels for the three-vertex lighting commands NCT, NCCT and
+ *  NCDT, included by gte.cpp inside a '#pragma GCC target("avx2")' region.
+ *
+ * Each vertex is computed in its own 64-bit lane, with lane 3 a copy of
+ *  lane 2 so it can't contribute FLAG bits of its own. Lanes hold values
+ *  sign-extended to 64 bits; where the C code stores a result to an s32
+ *  (gteMACn, or a LIM() argument) it's truncated with v_sext32(), so
+ *  results, including wraparound, are the same bit for bit. FLAG bits set
+ *  in any lane are OR'd together, which gives the same FLAG as processing
+ *  vertices one after another. Checks that the C code applies only to the
+ *  last vertex, after its loop, are done the same way, on lane 2.
+ *
+ * RTPT and DPCT aren't done here: RTPT's division is a per-vertex table
+ *  lookup and DPCT has little arithmetic per vertex, so moving lanes in
+ *  and out of vector registers made both slower than the C versions.
+ *  SSE4.1 versions (two registers per value) were slower for all five.
+ */
+
+// Everything is inlined into the kernels, so lanes stay in registers
+#define V_INLINE static inline __attribute__((always_inline))
+
+typedef __m256i vec;
+
+V_INLINE vec v_set(s64 a, s64 b, s64 c) { return _mm256_set_epi64x(c, c, b, a); }
+V_INLINE vec v_set1(s64 a)          { return _mm256_set1_epi64x(a); }
+V_INLINE vec v_add(vec a, vec b)    { return _mm256_add_epi64(a, b); }
+V_INLINE vec v_sub(vec a, vec b)    { return _mm256_sub_epi64(a, b); }
+V_INLINE vec v_and(vec a, vec b)    { return _mm256_and_si256(a, b); }
+V_INLINE vec v_andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+V_INLINE vec v_or(vec a, vec b)     { return _mm256_or_si256(a, b); }
+V_INLINE vec v_shl(vec a, int n)    { return _mm256_slli_epi64(a, n); }
+V_INLINE vec v_shr(vec a, int n)    { return _mm256_srli_epi64(a, n); }
+V_INLINE vec v_eq(vec a, vec b)     { return _mm256_cmpeq_epi64(a, b); }
+// Product of low 32 bits of lanes, as signed values
+V_INLINE vec v_mul(vec a, vec b)    { return _mm256_mul_epi32(a, b); }
+// Min/max of low 32 bits of lanes, as signed values. Also correct for the
+//  high 32 bits when lanes hold sign-extended 32-bit values.
+V_INLINE vec v_min32(vec a, vec b)  { return _mm256_min_epi32(a, b); }
+V_INLINE vec v_max32(vec a, vec b)  { return _mm256_max_epi32(a, b); }
+// Sign of 32-bit halves of lanes
+V_INLINE vec v_sign32(vec a)        { return _mm256_srai_epi32(a, 31); }
+// High half of lanes from 'b', low half from 'a'
+V_INLINE vec v_hi_lo(vec b, vec a)  { return _mm256_blend_epi32(a, b, 0xaa); }
+// Low/high half of lanes copied to the other half
+V_INLINE vec v_dup_lo(vec a)        { return _mm256_shuffle_epi32(a, 0xa0); }
+V_INLINE vec v_dup_hi(vec a)        { return _mm256_shuffle_epi32(a, 0xf5); }
+// Lanes of 'a' where 'mask' is set, 'b' elsewhere
+V_INLINE vec v_sel(vec mask, vec a, vec b) { return _mm256_blendv_epi8(b, a, mask); }
+V_INLINE void v_store(vec a, s64 *out) { _mm256_storeu_si256((__m256i *)out, a); }
+
+// Neither SSE4.1 nor AVX2 has a 64-bit arithmetic shift. Lane values stay
+//  within +/-2^50, so bias them to be positive and use a logical shift.
+V_INLINE vec v_sar(vec a, int n)
+{
+	const s64 bias = (s64)1 << 60;
+	return v_sub(v_shr(v_add(a, v_set1(bias)), n), v_set1(bias >> n));
+}
+
+// Low 32 bits of lanes, sign-extended (what storing to an s32 keeps)
+V_INLINE vec v_sext32(vec a)      { return v_hi_lo(v_dup_lo(v_sign32(a)), a); }
+
+// BOUNDS() against s32 range: OR flags into 'flags' for lanes out of it
+V_INLINE void v_bounds32(vec a, u32 maxflag, u32 minflag, vec &flags)
+{
+	const vec over = v_andnot(v_eq(a, v_sext32(a)), v_set1(-1));
+	const vec neg = v_dup_hi(v_sign32(a));
+	flags = v_or(flags, v_and(over, v_sel(neg, v_set1(minflag), v_set1(maxflag))));
+}
+
+// LIM(): clamp lanes holding sign-extended 32-bit values, OR flag into
+//  'flags' for lanes clamped
+V_INLINE vec v_lim(vec a, s32 max, s32 min, u32 flag, vec &flags)
+{
+	const vec r = v_min32(v_max32(a, v_set1(min)), v_set1(max));
+	flags = v_or(flags, v_andnot(v_eq(r, a), v_set1(flag)));
+	return r;
+}
+
+// Sum of matrix row 'm1,m2,m3' times lanes 'x,y,z', plus 'c' << 12
+V_INLINE vec v_mac(s32 c, s32 m1, s32 m2, s32 m3, vec x, vec y, vec z)
+{
+	return v_add(v_add(v_shl(v_set1(c), 12), v_mul(v_set1(m1), x)),
+	             v_add(v_mul(v_set1(m2), y), v_mul(v_set1(m3), z)));
+}
+
+V_INLINE u32 v_flags(vec flags)
+{
+	s64 f[4];
+	v_store(flags, f);
+	return (u32)(f[0] | f[1] | f[2]);
+}
+
+// Push lanes of R,G,B to RGB FIFO, with gteCODE
+V_INLINE void v_push_rgb(vec r, vec g, vec b)
+{
+	s64 c[4];
+	v_store(v_or(v_or(r, v_shl(g, 8)), v_shl(b, 16)), c);
+	const u32 code = (u32)gteCODE << 24;
+	gteRGB0 = (u32)c[0] | code;
+	gteRGB1 = (u32)c[1] | code;
+	gteRGB2 = (u32)c[2] | code;
+}
+
+/* Light matrix and light color stages common to NCT, NCCT and NCDT.
+ *  Returns MAC1..3 after the light color stage, and with 'lim_ir', IR1..3
+ *  limited from them as NCCT and NCDT do within their loops.
+ */
+V_INLINE void nc_light(vec &mac1, vec &mac2, vec &mac3, vec &ir1, vec &ir2, vec &ir3,
+                            bool lim_ir, vec &flags)
+{
+	const vec vx = v_set(VX(0), VX(1), VX(2));
+	const vec vy = v_set(VY(0), VY(1), VY(2));
+	const vec vz = v_set(VZ(0), VZ(1), VZ(2));
+
+	mac1 = v_sext32(v_sar(v_mac(0, gteL11, gteL12, gteL13, vx, vy, vz), 12));
+	mac2 = v_sext32(v_sar(v_mac(0, gteL21, gteL22, gteL23, vx, vy, vz), 12));
+	mac3 = v_sext32(v_sar(v_mac(0, gteL31, gteL32, gteL33, vx, vy, vz), 12));
+	ir1 = v_lim(mac1, 0x7fff, 0, (1 << 31) | (1 << 24), flags);
+	ir2 = v_lim(mac2, 0x7fff, 0, (1 << 31) | (1 << 23), flags);
+	ir3 = v_lim(mac3, 0x7fff, 0, (1 << 22), flags);
+
+	mac1 = v_sar(v_mac(gteRBK, gteLR1, gteLR2, gteLR3, ir1, ir2, ir3), 12);
+	mac2 = v_sar(v_mac(gteGBK, gteLG1, gteLG2, gteLG3, ir1, ir2, ir3), 12);
+	mac3 = v_sar(v_mac(gteBBK, gteLB1, gteLB2, gteLB3, ir1, ir2, ir3), 12);
+	v_bounds32(mac1, (1 << 30), (1 << 31) | (1 << 27), flags);
+	v_bounds32(mac2, (1 << 29), (1 << 31) | (1 << 26), flags);
+	v_bounds32(mac3, (1 << 28), (1 << 31) | (1 << 25), flags);
+	mac1 = v_sext32(mac1);
+	mac2 = v_sext32(mac2);
+	mac3 = v_sext32(mac3);
+
+	if (lim_ir) {
+		ir1 = v_lim(mac1, 0x7fff, 0, (1 << 31) | (1 << 24), flags);
+		ir2 = v_lim(mac2, 0x7fff, 0, (1 << 31) | (1 << 23), flags);
+		ir3 = v_lim(mac3, 0x7fff, 0, (1 << 22), flags);
+	}
+}
+
+// limC1..3 of MACs >> 4, pushed to RGB FIFO. Stores lane 2 to MAC1..3.
+V_INLINE void nc_color(vec mac1, vec mac2, vec mac3, vec &flags)
+{
+	const vec r = v_lim(v_sar(mac1, 4), 0x00ff, 0x0000, (1 << 21), flags);
+	const vec g = v_lim(v_sar(mac2, 4), 0x00ff, 0x0000, (1 << 20), flags);
+	const vec b = v_lim(v_sar(mac3, 4), 0x00ff, 0x0000, (1 << 19), flags);
+	v_push_rgb(r, g, b);
+
+	s64 l_mac[4];
+	v_store(mac1, l_mac); gteMAC1 = l_mac[2];
+	v_store(mac2, l_mac); gteMAC2 = l_mac[2];
+	v_store(mac3, l_mac); gteMAC3 = l_mac[2];
+}
+
+static void nct(void)
+{
+	vec flags = v_set1(0);
+	vec mac1, mac2, mac3, ir1, ir2, ir3;
+
+	nc_light(mac1, mac2, mac3, ir1, ir2, ir3, false, flags);
+	nc_color(mac1, mac2, mac3, flags);
+	gteFLAG = v_flags(flags);
+
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+}
+
+static void ncct(void)
+{
+	vec flags = v_set1(0);
+	vec mac1, mac2, mac3, ir1, ir2, ir3;
+
+	nc_light(mac1, mac2, mac3, ir1, ir2, ir3, true, flags);
+	mac1 = v_sar(v_mul(v_set1(gteR), ir1), 8);
+	mac2 = v_sar(v_mul(v_set1(gteG), ir2), 8);
+	mac3 = v_sar(v_mul(v_set1(gteB), ir3), 8);
+	nc_color(mac1, mac2, mac3, flags);
+	gteFLAG = v_flags(flags);
+
+	gteIR1 = gteMAC1;
+	gteIR2 = gteMAC2;
+	gteIR3 = gteMAC3;
+}
+
+/* Depth cue toward far color 'fc', for NCDT: lanes of
+ *  (base + IR0 * limBn(An(fc - c))) >> 12, with 'flag_a_max','flag_a_min'
+ *  the An() flags and 'flag_b' the limBn() one.
+ */
+V_INLINE vec depth_cue(vec base, vec c, s32 fc, u32 flag_a_max, u32 flag_a_min,
+                            u32 flag_b, vec &flags)
+{
+	vec d = v_sub(v_set1(fc), c);
+#ifdef PARANOID_OVERFLOW_CHECKING
+	v_bounds32(d, flag_a_max, flag_a_min, flags);
+#endif
+	d = v_lim(v_sext32(d), 0x7fff, -0x8000, flag_b, flags);
+	return v_sar(v_add(base, v_mul(v_set1(gteIR0), d)), 12);
+}
+
+static void ncdt(void)
+{
+	vec flags = v_set1(0);
+	vec mac1, mac2, mac3, ir1, ir2, ir3;
+
+	nc_light(mac1, mac2, mac3, ir1, ir2, ir3, true, flags);
+	mac1 = depth_cue(v_mul(v_set1(gteR << 4), ir1), v_sar(v_mul(v_set1(gteR), ir1), 8), gteRFC,
+	                 (1 << 30), (1 << 31) | (1 << 27), (1 << 31) | (1 << 24), flags);
+	mac2 = depth_cue(v_mul(v_set1(gteG << 4), ir2), v_sar(v_mul(v_set1(gteG), ir2), 8), gteGFC,
+	                 (1 << 29), (1 << 31) | (1 << 26), (1 << 31) | (1 << 23), flags);
+	mac3 = depth_cue(v_mul(v_set1(gteB << 4), ir3), v_sar(v_mul(v_set1(gteB), ir3), 8), gteBFC,
+	                 (1 << 28), (1 << 31) | (1 << 25), (1 << 22), flags);
+	nc_color(mac1, mac2, mac3, flags);
+	gteFLAG = v_flags(flags);
+
+	gteIR1 = limB1(gteMAC1, 1);
+	gteIR2 = limB2(gteMAC2, 1);
+	gteIR3 = limB3(gteMAC3, 1);
+}
+
+#undef V_INLINE
@@ -32,6 +32,7 @@
 #include "plugin_lib.h"
 #include "ppf.h"
 #include "psxevents.h"
+#include "psxsmc.h"
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -262,9 +263,7 @@ int LoadCdrom() {
 	tmpHead.t_size = SWAP32(tmpHead.t_size);
 	tmpHead.t_addr = SWAP32(tmpHead.t_addr);
 
-#ifdef PSXREC
 	psxCpu->Clear(tmpHead.t_addr, tmpHead.t_size / 4);
-#endif
 
 	// Read the rest of the main executable
 	while (tmpHead.t_size & ~2047) {
@@ -311,9 +310,7 @@ int LoadCdromFile(const char *filename, EXE_HEADER *head) {
 	size = head->t_size;
 	addr = head->t_addr;
 
-#ifdef PSXREC
 	psxCpu->Clear(addr, size / 4);
-#endif
 
 	while (size & ~2047) {
 		incTime();
@@ -480,15 +477,15 @@ int Load(const char *ExePath) {
 				section_size = SWAP32(tmpHead.t_size);
 				mem = PSXM(section_address);
 				if (mem != NULL) {
+					// fread() can have the kernel write to RAM directly
+					psxSmcUnprotect(section_address, section_size);
 					if (fseek(tmpFile, 0x800, SEEK_SET) == -1 ||
 					    fread(mem, section_size, 1, tmpFile) != 1) {
 						printf("Error reading PSX_EXE executable file\n");
 						retval = -1;
 						break;
 					}
-#ifdef PSXREC
 					psxCpu->Clear(section_address, section_size / 4);
-#endif
 				}
 				psxRegs.pc = SWAP32(tmpHead.pc0);
 				psxRegs.GPR.n.gp = SWAP32(tmpHead.gp0);
@@ -528,14 +525,13 @@ int Load(const char *ExePath) {
 #endif
 							mem = PSXM(section_address);
 							if (mem != NULL) {
+								psxSmcUnprotect(section_address, section_size);
 								if (fread(mem, section_size, 1, tmpFile) != 1) {
 									printf("Error reading CPE_EXE executable file\n");
 									retval = -1;
 									break;
 								}
-#ifdef PSXREC
 								psxCpu->Clear(section_address, section_size / 4);
-#endif
 							}
 							break;
 						case 3: /* register loading (PC only?) */
@@ -688,7 +684,7 @@ static const char PcsxHeader[32] = "STv4 PCSX v" PACKAGE_VERSION;
 
 // Savestate Versioning!
 // If you make changes to the savestate version, please increment value below.
-static const u32 SaveVersion = 0x8b410006;
+static const u32 SaveVersion = 0x8b410007;
 static const u32 SaveVersionEarliestSupported = 0x8b410004;
 // Versions supported: (NOTE: this only includes versions after 2016
 //  adoption of PCSX4ALL 2.3 codebase by MIPS / GCW Zero port team)
@@ -712,6 +708,11 @@ static const u32 SaveVersionEarliestSupported = 0x8b410004;
 //                 DATA LAYOUT CHANGE:
 //                 * Embedded screenshot data area is expanded a bit and now
 //                   used for rgb565 160x120x2 image (38400 bytes)
+// 0x8b410007    - Oct 2026
+//                 DATA LAYOUT CHANGE:
+//                 * psxRegs is saved field by field with psxRegsFreeze(),
+//                   instead of as a raw copy of the psxRegisters struct.
+//                   Its layout can now change without breaking savestates.
 
 int SaveState(const char *file) {
 	void* f;
@@ -748,7 +749,7 @@ int SaveState(const char *file) {
 	if ( freeze_rw(f, FREEZE_SAVE, psxM, 0x00200000)  ||
 	     freeze_rw(f, FREEZE_SAVE, psxR, 0x00080000)  ||
 	     freeze_rw(f, FREEZE_SAVE, psxH, 0x00010000)  ||
-	     freeze_rw(f, FREEZE_SAVE, (void*)&psxRegs, sizeof(psxRegs)) )
+	     psxRegsFreeze(f, FREEZE_SAVE) )
 		goto error;
 
 	// gpu
@@ -843,8 +844,12 @@ int LoadState(const char *file) {
 	     freeze_rw(f, FREEZE_LOAD, psxH, 0x00010000) )
 		goto error;
 
-	if (freeze_rw(f, FREEZE_LOAD, (void*)&psxRegs, sizeof(psxRegs)))
+	if (version <= 0x8b410006) {
+		if (psxRegsFreezeLegacy(f))
+			goto error;
+	} else if (psxRegsFreeze(f, FREEZE_LOAD)) {
 		goto error;
+	}
 	psxRegs.psxM=psxM;
 	psxRegs.psxP=psxP;
 	psxRegs.psxR=psxR;
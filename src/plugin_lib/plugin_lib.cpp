@@ -157,6 +157,29 @@ void pl_frame_limit(void)
 		pl_data.dynarec_active_vsyncs = 0;
 	}
 	pl_data.dynarec_compiled = false;
+
+	// Account for time spent recompiling during the frame just finished
+	if (pl_data.dynarec_stall_blocks) {
+		pl_data.dynarec_stall_frames++;
+		pl_data.dynarec_stall_total_usec += pl_data.dynarec_stall_usec;
+		if (pl_data.dynarec_stall_usec > pl_data.dynarec_stall_max_usec)
+			pl_data.dynarec_stall_max_usec = pl_data.dynarec_stall_usec;
+		if (Config.PerfmonConsoleOutput &&
+		    pl_data.dynarec_stall_usec > (unsigned int)pl_data.frame_interval / 4)
+			printf("Dynarec stall: %u blocks recompiled in %u usec this frame\n",
+			       pl_data.dynarec_stall_blocks, pl_data.dynarec_stall_usec);
+		pl_data.dynarec_stall_usec = pl_data.dynarec_stall_blocks = 0;
+	}
+}
+
+void pl_dynarec_print_stats(void)
+{
+	if (pl_data.dynarec_stall_frames == 0)
+		return;
+
+	printf("Dynarec stalls: %u frames recompiled code, %llu usec total, %u usec max in one frame\n",
+	       pl_data.dynarec_stall_frames, pl_data.dynarec_stall_total_usec,
+	       pl_data.dynarec_stall_max_usec);
 }
 
 void pl_init(void)
@@ -174,6 +197,9 @@ void pl_reset(void)
 	pl_data.fps_cur = pl_data.cpu_cur = 0;
 	pl_data.dynarec_compiled = false;
 	pl_data.dynarec_active_vsyncs = 0;
+	pl_data.dynarec_stall_usec = pl_data.dynarec_stall_blocks = 0;
+	pl_data.dynarec_stall_frames = pl_data.dynarec_stall_max_usec = 0;
+	pl_data.dynarec_stall_total_usec = 0;
 	pl_frameskip_prepare();
 	sprintf(pl_data.stats_msg, "000x000x00 CPU=000%% FPS=000/00");
 	pmonReset(); // Reset performance monitor (FPS,CPU usage,etc)
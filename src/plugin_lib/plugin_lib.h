@@ -39,6 +39,11 @@ struct pl_data_t {
 	int frame_interval, frame_interval1024;
 	int vsync_usec_time;
 	unsigned int dynarec_active_vsyncs;
+
+	// Time spent recompiling: this frame, and totals since last pl_reset()
+	unsigned int dynarec_stall_usec, dynarec_stall_blocks;
+	unsigned int dynarec_stall_frames, dynarec_stall_max_usec;
+	unsigned long long dynarec_stall_total_usec;
 	float fps_cur, cpu_cur;
 	struct timeval tv_expect;
 
@@ -71,6 +76,16 @@ static inline void pl_dynarec_notify(void)
 	pl_data.dynarec_compiled = true;
 }
 
+// Dynamic recompilers call this after recompiling a block, with time it took
+static inline void pl_dynarec_stall(unsigned int usec)
+{
+	pl_data.dynarec_stall_usec += usec;
+	pl_data.dynarec_stall_blocks++;
+}
+
+// Output recompilation stall totals to console
+void pl_dynarec_print_stats(void);
+
 // In pl_sshot.cpp
 void pl_screenshot_160x120_rgb565(u16 *dst);
 
@@ -1056,12 +1056,19 @@ static MENUITEM gui_GameMenuItems[] = {
 static MENU gui_GameMenu = { GMENU_SIZE, 0, 112, 120, (MENUITEM *)&gui_GameMenuItems };
 
 #ifdef PSXREC
+#define CPU_FIRST CPU_DYNAREC
+#define CPU_LAST  CPU_DYNAREC_TIERED
+#else
+#define CPU_FIRST CPU_INTERPRETER
+#define CPU_LAST  CPU_INTERPRETER_THREADED
+#endif
+
 static int emu_alter(u32 keys)
 {
 	if (keys & KEY_RIGHT) {
-		if (Config.Cpu == 1) Config.Cpu = 0;
+		if (Config.Cpu > CPU_FIRST) Config.Cpu--;
 	} else if (keys & KEY_LEFT) {
-		if (Config.Cpu == 0) Config.Cpu = 1;
+		if (Config.Cpu < CPU_LAST) Config.Cpu++;
 	}
 
 	return 0;
@@ -1070,10 +1077,17 @@ static int emu_alter(u32 keys)
 static char *emu_show()
 {
 	static char buf[16] = "\0";
-	sprintf(buf, "%s", Config.Cpu ? "int" : "rec");
+	switch (Config.Cpu) {
+		case CPU_DYNAREC:           sprintf(buf, "rec"); break;
+		case CPU_INTERPRETER_BLOCK: sprintf(buf, "int-block"); break;
+		case CPU_INTERPRETER_THREADED: sprintf(buf, "int-threaded"); break;
+		case CPU_DYNAREC_TIERED:    sprintf(buf, "rec-tiered"); break;
+		default:                    sprintf(buf, "int"); break;
+	}
 	return buf;
 }
 
+#ifdef PSXREC
 extern u32 cycle_multiplier; // in mips/recompiler.cpp
 
 static int cycle_alter(u32 keys)
@@ -1222,8 +1236,8 @@ static int settings_defaults()
 }
 
 static MENUITEM gui_SettingsItems[] = {
-#ifdef PSXREC
 	{(char *)"Emulation core       ", NULL, &emu_alter, &emu_show, NULL},
+#ifdef PSXREC
 	{(char *)"Cycle multiplier     ", NULL, &cycle_alter, &cycle_show, NULL},
 #endif
 	{(char *)"HLE emulated BIOS    ", NULL, &bios_alter, &bios_show, NULL},
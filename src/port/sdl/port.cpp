@@ -79,6 +79,7 @@ static char homedir[PATH_MAX] =		"./.pcsx4all";
 static char memcardsdir[PATH_MAX] =	"./.pcsx4all/memcards";
 static char biosdir[PATH_MAX] =		"./.pcsx4all/bios";
 static char patchesdir[PATH_MAX] =	"./.pcsx4all/patches";
+static char reccachedir[PATH_MAX] =	"./.pcsx4all/reccache";
 char sstatesdir[PATH_MAX] = "./.pcsx4all/sstates";
 
 #ifdef __WIN32__
@@ -101,6 +102,7 @@ static void setup_paths()
 		sprintf(memcardsdir, "%s/memcards", homedir);
 		sprintf(biosdir, "%s/bios", homedir);
 		sprintf(patchesdir, "%s/patches", homedir);
+		sprintf(reccachedir, "%s/reccache", homedir);
 	}
 
 	MKDIR(homedir);
@@ -108,6 +110,7 @@ static void setup_paths()
 	MKDIR(memcardsdir);
 	MKDIR(biosdir);
 	MKDIR(patchesdir);
+	MKDIR(reccachedir);
 }
 
 void probe_lastdir()
@@ -208,7 +211,8 @@ void config_load()
 			Config.VSyncWA = value;
 		} else if (!strcmp(line, "Cpu")) {
 			sscanf(arg, "%d", &value);
-			Config.Cpu = value;
+			if (value >= CPU_DYNAREC && value <= CPU_DYNAREC_TIERED)
+				Config.Cpu = value;
 		} else if (!strcmp(line, "PsxType")) {
 			sscanf(arg, "%d", &value);
 			Config.PsxType = value;
@@ -653,6 +657,20 @@ int main (int argc, char **argv)
 	Config.FrameLimit = true;
 	Config.FrameSkip = FRAMESKIP_OFF;
 
+	Config.MemStats = false;
+	Config.MemStatsInterval = 3000;  // ~1 minute of NTSC frames
+	Config.MemStatsFile[0] = '\0';
+	Config.RecCacheDir[0] = '\0';
+	Config.RecVerify = false;
+	Config.RecStats = false;
+	Config.RecProfile = 0;
+	Config.RecPerfMap = 0;
+	Config.RecTierThreshold = 8;
+	Config.GteLazyFlag = 0;
+	Config.BiosHooks = 0;
+	Config.ProfileInterval = 0;
+	Config.ProfileFile[0] = '\0';
+
 	//zear - Added option to store the last visited directory.
 	strncpy(Config.LastDir, home, MAXPATHLEN); /* Defaults to home directory. */
 	Config.LastDir[MAXPATHLEN-1] = '\0';
@@ -776,9 +794,29 @@ int main (int argc, char **argv)
 		if (strcmp(argv[i],"-bios") == 0)
 			Config.HLE = 0;
 
+		// BIOS memcpy, strlen etc. run natively (applies to BIOS only)
+		if (strcmp(argv[i],"-bioshooks") == 0)
+			Config.BiosHooks = 1;
+
 		// Interpreter enabled
 		if (strcmp(argv[i],"-interpreter") == 0)
-			Config.Cpu = 1;
+			Config.Cpu = CPU_INTERPRETER;
+
+		// Block-caching interpreter enabled
+		if (strcmp(argv[i],"-interpreter_block") == 0)
+			Config.Cpu = CPU_INTERPRETER_BLOCK;
+
+		// Threaded (computed-goto) interpreter enabled
+		if (strcmp(argv[i],"-interpreter_threaded") == 0)
+			Config.Cpu = CPU_INTERPRETER_THREADED;
+
+		// Tiered recompiler enabled: code is interpreted until it's hot
+		if (strcmp(argv[i],"-rectiered") == 0)
+			Config.Cpu = CPU_DYNAREC_TIERED;
+
+		// GTE FLAG register computed only when games read it
+		if (strcmp(argv[i],"-gtelazyflag") == 0)
+			Config.GteLazyFlag = 1;
 
 		// Show BIOS logo sequence at BIOS startup (doesn't apply to HLE)
 		if (strcmp(argv[i],"-slowboot") == 0)
@@ -861,6 +899,138 @@ int main (int argc, char **argv)
 			Config.PerfmonDetailedStats = true;
 		}
 
+		// Memory access statistics, dumped to a CSV or .json file
+		if (strcmp(argv[i],"-memstats") == 0) {
+			Config.MemStats = true;
+			if (++i < argc) {
+				strncpy(Config.MemStatsFile, argv[i], MAXPATHLEN);
+				Config.MemStatsFile[MAXPATHLEN-1] = '\0';
+			} else {
+				printf("ERROR: missing filename for -memstats\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+
+		// Frames between memory stats dumps (0: only at exit)
+		if (strcmp(argv[i],"-memstatsinterval") == 0) {
+			int val = -1;
+			if (++i < argc) {
+				val = atoi(argv[i]);
+				if (val >= 0 && val <= 0xffff) {
+					Config.MemStatsInterval = val;
+				} else val = -1;
+			} else {
+				printf("ERROR: missing value for -memstatsinterval\n");
+			}
+
+			if (val == -1) {
+				printf("ERROR: -memstatsinterval value must be between 0..65535\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+
+		// Save recompiled code to disk, reuse it in later runs
+		if (strcmp(argv[i],"-reccache") == 0) {
+			if (snprintf(Config.RecCacheDir, MAXPATHLEN, "%s", reccachedir) >= MAXPATHLEN) {
+				printf("ERROR: -reccache dir path %s is too long\n", reccachedir);
+				Config.RecCacheDir[0] = '\0';
+				param_parse_error = true;
+				break;
+			}
+		}
+
+		// Check each recompiled block against the interpreter (slow)
+		if (strcmp(argv[i],"-recverify") == 0) {
+			Config.RecVerify = true;
+		}
+
+		// Recompiler statistics, printed at exit
+		if (strcmp(argv[i],"-recstats") == 0) {
+			Config.RecStats = true;
+		}
+
+		// Profile recompiled block executions, print this many hottest at exit
+		if (strcmp(argv[i],"-recprofile") == 0) {
+			int val = -1;
+			if (++i < argc) {
+				val = atoi(argv[i]);
+				if (val >= 1 && val <= 0xffff) {
+					Config.RecProfile = val;
+				} else val = -1;
+			} else {
+				printf("ERROR: missing value for -recprofile\n");
+			}
+
+			if (val == -1) {
+				printf("ERROR: -recprofile value must be between 1..65535\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+
+		// Times code is interpreted before tiered recompiler compiles it
+		if (strcmp(argv[i],"-rectierthreshold") == 0) {
+			int val = -1;
+			if (++i < argc) {
+				val = atoi(argv[i]);
+				if (val >= 1 && val <= 255) {
+					Config.RecTierThreshold = val;
+				} else val = -1;
+			} else {
+				printf("ERROR: missing value for -rectierthreshold\n");
+			}
+
+			if (val == -1) {
+				printf("ERROR: -rectierthreshold value must be between 1..255\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+
+		// Name recompiled blocks for Linux 'perf' profiler
+		if (strcmp(argv[i],"-recperfmap") == 0) {
+			if (Config.RecPerfMap < 1)
+				Config.RecPerfMap = 1;
+		}
+
+		// Same, also writing jitdump file for 'perf inject --jit'
+		if (strcmp(argv[i],"-recjitdump") == 0) {
+			Config.RecPerfMap = 2;
+		}
+
+		// Sample guest PC every N cycles, report hottest guest functions
+		if (strcmp(argv[i],"-profile") == 0) {
+			int val = -1;
+			if (++i < argc) {
+				val = atoi(argv[i]);
+				if (val >= 100 && val <= 100000000) {
+					Config.ProfileInterval = val;
+				} else val = -1;
+			} else {
+				printf("ERROR: missing value for -profile\n");
+			}
+
+			if (val == -1) {
+				printf("ERROR: -profile value must be between 100..100000000\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+
+		// File guest profile reports are appended to
+		if (strcmp(argv[i],"-profilefile") == 0) {
+			if (++i < argc) {
+				strncpy(Config.ProfileFile, argv[i], MAXPATHLEN);
+				Config.ProfileFile[MAXPATHLEN-1] = '\0';
+			} else {
+				printf("ERROR: missing filename for -profilefile\n");
+				param_parse_error = true;
+				break;
+			}
+		}
+
 		// GPU
 		// show FPS
 		if (strcmp(argv[i],"-showfps") == 0) {
@@ -30,9 +30,9 @@
 //We try to emulate bios :) HELP US :P
 
 //#define PSXBIOS_LOG printf
-#ifdef PSXBIOS_LOG
 
-char *biosA0n[256] = {
+// Function names, used by logging and recompiler/rec_perf.cpp
+const char *biosA0n[256] = {
 // 0x00
 	"open",		"lseek",	"read",		"write",
 	"close",	"ioctl",	"exit",		"sys_a0_07",
@@ -93,7 +93,7 @@ char *biosA0n[256] = {
 	"?? sub_function",
 };
 
-char *biosB0n[256] = {
+const char *biosB0n[256] = {
 // 0x00
 	"SysMalloc",		"sys_b0_01",	"sys_b0_02",	"sys_b0_03",
 	"sys_b0_04",		"sys_b0_05",	"sys_b0_06",	"DeliverEvent",
@@ -126,7 +126,7 @@ char *biosB0n[256] = {
 	"_card_status",		"_card_wait",
 };
 
-char *biosC0n[256] = {
+const char *biosC0n[256] = {
 // 0x00
 	"InitRCnt",			  "InitException",		"SysEnqIntRP",		"SysDeqIntRP",
 	"get_free_EvCB_slot", "get_free_TCB_slot",	"ExceptionHandler",	"InstallExeptionHandler",
@@ -139,8 +139,6 @@ char *biosC0n[256] = {
 	"PatchAOTable",
 };
 
-#endif
-
 //#define r0 (psxRegs.GPR.n.r0)
 #define at (psxRegs.GPR.n.at)
 #define v0 (psxRegs.GPR.n.v0)
@@ -2753,6 +2751,46 @@ void psxBiosInit(void) {
 void psxBiosShutdown() {
 }
 
+/* Kernel function tables, which the BIOS copies to RAM at boot */
+static const struct {
+	u32 addr;
+	u32 num;
+	const char **names;
+	const char *prefix;
+} biosTables[] = {
+	{ 0x0200, 0xb5, biosA0n, "A0" },
+	{ 0x0874, 0x5e, biosB0n, "B0" },
+	{ 0x0674, 0x1e, biosC0n, "C0" }
+};
+
+// Get name of BIOS function whose entry point is 'addr', as "A0:memcpy"
+//  (or "A0:2a" if unnamed), or of the A0/B0/C0 dispatcher itself as "A0".
+//  Returns false if 'addr' isn't in any table.
+bool psxBiosFunctionName(u32 addr, char *buf, int size)
+{
+	const u32 phys = addr & 0x1fffffff;
+
+	if (phys == 0xa0 || phys == 0xb0 || phys == 0xc0) {
+		snprintf(buf, size, "%X0", phys >> 4);
+		return true;
+	}
+
+	for (u32 t = 0; t < sizeof(biosTables) / sizeof(biosTables[0]); t++) {
+		for (u32 i = 0; i < biosTables[t].num; i++) {
+			const u32 entry = psxMu32(biosTables[t].addr + i*4);
+			if (entry == 0 || (entry & 0x1fffffff) != phys)
+				continue;
+			if (biosTables[t].names[i])
+				snprintf(buf, size, "%s:%s", biosTables[t].prefix, biosTables[t].names[i]);
+			else
+				snprintf(buf, size, "%s:%02x", biosTables[t].prefix, i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 
 #define psxBios_PADpoll(pad) { \
 	PAD##pad##_startPoll(); \
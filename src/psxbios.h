@@ -27,16 +27,15 @@
 #include "misc.h"
 #include "sio.h"
 
-#ifdef PSXBIOS_LOG
-extern char *biosA0n[256];
-extern char *biosB0n[256];
-extern char *biosC0n[256];
-#endif
+extern const char *biosA0n[256];
+extern const char *biosB0n[256];
+extern const char *biosC0n[256];
 
 void psxBiosInit(void);
 void psxBiosShutdown(void);
 void psxBiosException(void);
 void psxBiosFreeze(int Mode);
+bool psxBiosFunctionName(u32 addr, char *buf, int size);
 
 extern void (*biosA0[256])(void);
 extern void (*biosB0[256])(void);
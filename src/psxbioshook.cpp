@@ -0,0 +1,310 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Native BIOS memory and string routines with a real BIOS
+ *
+ *  A call is run natively only when:
+ *   - It comes through the A0h vector, and the A0h table entry in kernel
+ *     RAM for the function in $t1 still points into BIOS ROM: functions a
+ *     game or a patch has replaced are left alone. The B0h and C0h tables
+ *     have no routines that only touch memory, so their calls always run
+ *     in the BIOS.
+ *   - All bytes it reads are in RAM, scratchpad or BIOS ROM, and all bytes
+ *     it writes are in RAM above the kernel area, or scratchpad. Strings
+ *     must be NUL-terminated within their region. NULL pointers and zero
+ *     or negative lengths are left to the BIOS, with its error handling.
+ *   - The cache isn't isolated (psxRegs.writeok).
+ *
+ *  Copies go a byte at a time in ascending order, like the BIOS loops, so
+ * overlapping copies give the same result. Only $v0 and PC are set: the
+ * scratch registers the BIOS code would have left modified aren't, as
+ * callers can't rely on them anyway.
+ *
+ *  Cycle costs are the opcodes run by the vector, the A0h dispatcher and
+ * the BIOS loop, at BIAS cycles per opcode like the interpreter.
+ */
+
+#include "psxbioshook.h"
+#include "psxmem.h"
+
+bool bios_hooks_active;
+
+// Kernel RAM table of A0h function addresses, and its number of entries
+#define A0_TABLE        0x200
+#define A0_TABLE_SIZE   0xb5
+
+// Opcodes run by the A0h vector and dispatcher, before the function itself
+#define DISPATCH_OPS    8
+
+// Writes to RAM below this are left to the BIOS: kernel vectors, tables
+//  and the recompiled block at the vector itself are there.
+#define KERNEL_RAM_END  0x10000
+
+static struct {
+	u64 calls;          // Calls run natively
+	u64 bytes;          // Bytes they read or wrote
+	u64 declined;       // Calls to hooked functions left to the BIOS
+} hook_stats;
+
+void psxBiosHookReset(void)
+{
+	memset(&hook_stats, 0, sizeof(hook_stats));
+	bios_hooks_active = Config.BiosHooks && !Config.HLE;
+}
+
+void psxBiosHookPrintStats(void)
+{
+	if (hook_stats.calls == 0 && hook_stats.declined == 0)
+		return;
+
+	printf("BIOS hooks: %llu calls run natively (%llu bytes), %llu left to BIOS\n",
+	       (unsigned long long)hook_stats.calls,
+	       (unsigned long long)hook_stats.bytes,
+	       (unsigned long long)hook_stats.declined);
+}
+
+// Host pointer to guest memory at 'addr', or NULL if it can't be accessed
+//  natively. '*avail' is set to the number of bytes from 'addr' to the end
+//  of its region.
+static u8 *hookRegion(u32 addr, bool write, u32 *avail)
+{
+	const u32 seg = addr >> 29;
+	const u32 phys = addr & 0x1fffffff;
+
+	// KUSEG, KSEG0 and KSEG1 only
+	if (seg != 0 && seg != 4 && seg != 5)
+		return NULL;
+
+	if (phys < 0x800000) {
+		const u32 ofs = phys & 0x1fffff;
+		if (write && (ofs < KERNEL_RAM_END || psxMemWLUTEntry(addr >> 16) == NULL))
+			return NULL;
+		*avail = 0x200000 - ofs;
+		return (u8 *)psxM + ofs;
+	}
+
+	if (phys >= 0x1f800000 && phys < 0x1f800400) {
+		*avail = 0x1f800400 - phys;
+		return (u8 *)psxH + (phys - 0x1f800000);
+	}
+
+	if (!write && phys >= 0x1fc00000 && phys < 0x1fc80000) {
+		*avail = 0x1fc80000 - phys;
+		return (u8 *)psxR + (phys - 0x1fc00000);
+	}
+
+	return NULL;
+}
+
+// Host pointer to 'len' bytes at 'addr', or NULL
+static u8 *hookPtr(u32 addr, s32 len, bool write)
+{
+	u32 avail;
+	u8 *p;
+
+	if (addr == 0 || len <= 0)
+		return NULL;
+	p = hookRegion(addr, write, &avail);
+	return (p && (u32)len <= avail) ? p : NULL;
+}
+
+// Host pointer to the string at 'addr', setting '*len' to its length
+//  without the NUL, or NULL if it isn't terminated within its region
+static const u8 *hookStr(u32 addr, u32 *len)
+{
+	u32 avail;
+	const u8 *p, *end;
+
+	if (addr == 0)
+		return NULL;
+	p = hookRegion(addr, false, &avail);
+	if (!p)
+		return NULL;
+	end = (const u8 *)memchr(p, 0, avail);
+	if (!end)
+		return NULL;
+	*len = end - p;
+	return p;
+}
+
+// Invalidate recompiled code in RAM written by a native routine
+static void hookWritten(u32 addr, u32 len)
+{
+	if ((addr & 0x1fffffff) < 0x800000)
+		psxCpu->Clear(addr & ~3, ((addr & 3) + len + 3) / 4);
+}
+
+static inline void copyBytes(u8 *dst, const u8 *src, u32 len)
+{
+	while (len--)
+		*dst++ = *src++;
+}
+
+// Native routines: return true and set '*v0' and '*ops' (BIOS opcodes
+//  saved) if they ran, false if the call is left to the BIOS.
+
+static bool hookMemcpy(u32 dst, u32 src, s32 len, u32 *v0, u32 *ops)
+{
+	u8 *d = hookPtr(dst, len, true);
+	const u8 *s = hookPtr(src, len, false);
+	if (!d || !s)
+		return false;
+	copyBytes(d, s, len);
+	hookWritten(dst, len);
+	hook_stats.bytes += len;
+	*v0 = dst;
+	*ops = 8 + 6 * len;
+	return true;
+}
+
+// A(2Ah) memcpy(dst, src, len)
+static bool hook_memcpy(u32 *v0, u32 *ops)
+{
+	return hookMemcpy(psxRegs.GPR.n.a0, psxRegs.GPR.n.a1, psxRegs.GPR.n.a2, v0, ops);
+}
+
+// A(27h) bcopy(src, dst, len)
+static bool hook_bcopy(u32 *v0, u32 *ops)
+{
+	return hookMemcpy(psxRegs.GPR.n.a1, psxRegs.GPR.n.a0, psxRegs.GPR.n.a2, v0, ops);
+}
+
+static bool hookMemset(u32 dst, u8 c, s32 len, u32 *v0, u32 *ops)
+{
+	u8 *d = hookPtr(dst, len, true);
+	if (!d)
+		return false;
+	memset(d, c, len);
+	hookWritten(dst, len);
+	hook_stats.bytes += len;
+	*v0 = dst;
+	*ops = 8 + 4 * len;
+	return true;
+}
+
+// A(2Bh) memset(dst, c, len)
+static bool hook_memset(u32 *v0, u32 *ops)
+{
+	return hookMemset(psxRegs.GPR.n.a0, psxRegs.GPR.n.a1, psxRegs.GPR.n.a2, v0, ops);
+}
+
+// A(28h) bzero(dst, len)
+static bool hook_bzero(u32 *v0, u32 *ops)
+{
+	return hookMemset(psxRegs.GPR.n.a0, 0, psxRegs.GPR.n.a1, v0, ops);
+}
+
+// A(1Bh) strlen(s)
+static bool hook_strlen(u32 *v0, u32 *ops)
+{
+	u32 len;
+	if (!hookStr(psxRegs.GPR.n.a0, &len))
+		return false;
+	hook_stats.bytes += len + 1;
+	*v0 = len;
+	*ops = 6 + 4 * (len + 1);
+	return true;
+}
+
+// A(19h) strcpy(dst, src)
+static bool hook_strcpy(u32 *v0, u32 *ops)
+{
+	const u32 dst = psxRegs.GPR.n.a0;
+	u32 len;
+	const u8 *s = hookStr(psxRegs.GPR.n.a1, &len);
+	u8 *d = s ? hookPtr(dst, len + 1, true) : NULL;
+	const u32 n = len + 1;
+
+	// Overlapping strings can make the BIOS loop overwrite the NUL it
+	//  looks for: leave them to it.
+	if (!d || (d < s + n && s < d + n))
+		return false;
+
+	copyBytes(d, s, n);
+	hookWritten(dst, n);
+	hook_stats.bytes += n;
+	*v0 = dst;
+	*ops = 8 + 6 * n;
+	return true;
+}
+
+// A(17h) strcmp(s1, s2)
+static bool hook_strcmp(u32 *v0, u32 *ops)
+{
+	u32 len1, len2;
+	const u8 *s1 = hookStr(psxRegs.GPR.n.a0, &len1);
+	const u8 *s2 = hookStr(psxRegs.GPR.n.a1, &len2);
+	if (!s1 || !s2)
+		return false;
+
+	u32 n = 0;
+	while (s1[n] == s2[n] && s1[n] != 0)
+		n++;
+
+	// Whether the BIOS sign-extends chars past 7Fh isn't known: leave
+	//  mismatches on those to it.
+	if ((s1[n] | s2[n]) & 0x80)
+		return false;
+
+	hook_stats.bytes += 2 * (n + 1);
+	*v0 = (s32)s1[n] - (s32)s2[n];
+	*ops = 8 + 8 * (n + 1);
+	return true;
+}
+
+typedef bool (*hookFn)(u32 *v0, u32 *ops);
+
+static hookFn hookA0(u32 call)
+{
+	switch (call) {
+		case 0x17: return hook_strcmp;
+		case 0x19: return hook_strcpy;
+		case 0x1b: return hook_strlen;
+		case 0x27: return hook_bcopy;
+		case 0x28: return hook_bzero;
+		case 0x2a: return hook_memcpy;
+		case 0x2b: return hook_memset;
+	}
+	return NULL;
+}
+
+u32 psxBiosHookCall(u32 pc)
+{
+	const u32 call = psxRegs.GPR.n.t1;
+	u32 v0, ops;
+
+	if (!bios_hooks_active || (pc & 0x1fffffff) != 0xa0 || call >= A0_TABLE_SIZE)
+		return 0;
+
+	const hookFn fn = hookA0(call);
+	if (!fn)
+		return 0;
+
+	// Function must still be the BIOS's own
+	const u32 entry = SWAP32(*(u32 *)(psxM + A0_TABLE + call * 4)) & 0x1fffffff;
+	if (entry < 0x1fc00000 || entry >= 0x1fc80000 || !psxRegs.writeok || !fn(&v0, &ops)) {
+		hook_stats.declined++;
+		return 0;
+	}
+
+	psxRegs.GPR.n.v0 = v0;
+	psxRegs.pc = psxRegs.GPR.n.ra;
+	psxRegs.cycle += (DISPATCH_OPS + ops) * BIAS;
+	hook_stats.calls++;
+	return 1;
+}
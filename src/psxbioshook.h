@@ -0,0 +1,56 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Native BIOS memory and string routines with a real BIOS
+ *
+ *  With Config.BiosHooks (-bioshooks command line option) and a real BIOS
+ * (Config.HLE off), calls through the A0h/B0h/C0h vectors to routines that
+ * only read and write guest memory (memcpy, memset, strlen, strcmp..) are
+ * run natively instead of as guest MIPS loops in BIOS ROM. Everything
+ * else, including any call whose arguments the native version can't handle
+ * exactly like the BIOS would, still runs the real BIOS code.
+ *
+ *  psxRegs.cycle is advanced by what the BIOS loop would have taken, so
+ * timing stays close to the real BIOS.
+ */
+
+#ifndef PSXBIOSHOOK_H
+#define PSXBIOSHOOK_H
+
+#include "r3000a.h"
+
+extern bool bios_hooks_active;
+
+void psxBiosHookReset(void);
+void psxBiosHookPrintStats(void);
+
+// Is 'pc' one of the BIOS function call vectors? Used by recompilers, to
+//  emit a call to psxBiosHookCall() on entry to a block at one.
+static inline bool psxBiosHookIsVector(u32 pc)
+{
+	const u32 addr = pc & 0x1fffffff;
+	return addr == 0xa0 || addr == 0xb0 || addr == 0xc0;
+}
+
+// Called on entry to vector 'pc', with the function number in $t1. If the
+//  function has a native version that can handle its arguments, runs it,
+//  sets $v0, psxRegs.pc to $ra, advances psxRegs.cycle and returns 1.
+//  Otherwise, returns 0 and changes nothing.
+u32 psxBiosHookCall(u32 pc);
+
+#endif //PSXBIOSHOOK_H
@@ -20,9 +20,20 @@
 
 #include "psxcommon.h"
 #include "plugin_lib/plugin_lib.h"
+#include "psxmemstats.h"
+#include "psxprofile.h"
+#ifdef PSXREC
+#include "recompiler/rec_stats.h"
+#endif
 
 void EmuUpdate()
 {
+	psxMemStatsFrame();
+	psxProfileFrame();
+#ifdef PSXREC
+	recStatsFrame();
+#endif
+
 	pl_frame_limit();
 
 	// Update controls
@@ -163,6 +163,37 @@ typedef struct {
 	boolean PerfmonConsoleOutput;
 	boolean PerfmonDetailedStats;
 
+	// Memory access statistics (see psxmemstats.cpp)
+	boolean MemStats;          // Count accesses by region, width and I/O port
+	u16     MemStatsInterval;  // Frames between dumps to file, 0: at exit only
+	char    MemStatsFile[MAXPATHLEN];  // CSV or .json file, "": console only
+
+	// Persistent recompiler code cache (see recompiler/x86_64/rec_cache.cpp.h)
+	char    RecCacheDir[MAXPATHLEN];   // Dir of per-game cache files, "": disabled
+
+	// Re-run each recompiled block with the interpreter and compare (see psxverify.cpp)
+	boolean RecVerify;
+
+	// Recompiler statistics (see recompiler/rec_stats.cpp)
+	boolean RecStats;          // Print compile/invalidation counters at exit
+	u16     RecProfile;        // Count block executions, print N hottest at exit
+
+	// Describe recompiled blocks to Linux perf (see recompiler/rec_perf.cpp)
+	u8      RecPerfMap;        // 0: off 1: /tmp/perf-<pid>.map 2: also jitdump
+
+	// Tiered recompiler, Cpu == CPU_DYNAREC_TIERED (see recompiler/rec_tier.cpp)
+	u8      RecTierThreshold;  // Times code is interpreted before it's compiled
+
+	// Compute GTE FLAG only when it's read (see gteFlagFlush() in gte.cpp)
+	boolean GteLazyFlag;
+
+	// Run BIOS memory and string routines natively (see psxbioshook.cpp)
+	boolean BiosHooks;
+
+	// Guest PC sampling profiler (see psxprofile.cpp)
+	u32     ProfileInterval;   // Emulated cycles between samples, 0: off
+	char    ProfileFile[MAXPATHLEN];  // Report is appended here, "": console
+
 } PcsxConfig;
 
 extern PcsxConfig Config;
@@ -209,7 +240,10 @@ enum {
 
 enum {
 	CPU_DYNAREC = 0,
-	CPU_INTERPRETER
+	CPU_INTERPRETER,
+	CPU_INTERPRETER_BLOCK,  // Interpreter w/ cache of pre-decoded blocks
+	CPU_INTERPRETER_THREADED, // Interpreter w/ computed-goto dispatch
+	CPU_DYNAREC_TIERED      // Recompiler, interpreting code until it's hot
 }; // CPU Types
 
 void EmuUpdate();
@@ -52,809 +52,625 @@
 #include "mdec.h"
 #include "cdrom.h"
 #include "gpu.h"
+#include "psxmemstats.h"
 
-void psxHwReset() {
-	//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
-	if (Config.SpuIrq) psxHu32ref(0x1070) |= SWAP32(0x200);
+/*
+ * I/O port dispatch
+ *
+ *  Each access width has a table with one handler pointer per port in the
+ * 8KB I/O region 0x1f80_1000..0x1f80_2fff (in any segment), indexed by
+ * offset into it >> 0, 1 or 2. Tables are built once in psxHwReset(). A
+ * NULL entry means the port is plain memory: reads and writes just access
+ * psxH[]. Misaligned accesses always do, like they did when these were
+ * switch statements matching exact port addresses.
+ */
+typedef u8   (*HwRead8Func)  (u32 add);
+typedef u16  (*HwRead16Func) (u32 add);
+typedef u32  (*HwRead32Func) (u32 add);
+typedef void (*HwWrite8Func) (u32 add, u8  value);
+typedef void (*HwWrite16Func)(u32 add, u16 value);
+typedef void (*HwWrite32Func)(u32 add, u32 value);
+
+#define HW_PORTS_START 0x1000
+#define HW_PORTS_SIZE  0x2000
+
+static HwRead8Func   hw_read8  [HW_PORTS_SIZE];
+static HwRead16Func  hw_read16 [HW_PORTS_SIZE/2];
+static HwRead32Func  hw_read32 [HW_PORTS_SIZE/4];
+static HwWrite8Func  hw_write8 [HW_PORTS_SIZE];
+static HwWrite16Func hw_write16[HW_PORTS_SIZE/2];
+static HwWrite32Func hw_write32[HW_PORTS_SIZE/4];
+
+/* Offset of 'add' into I/O port region, or a value that fails the range
+ *  and alignment test in hw_port_ok() if it lies in 0x1f80_0000 region but
+ *  outside of it.
+ */
+static inline u32 hw_port_off(u32 add)
+{
+	if ((add & 0x0fff0000) != 0x0f800000)
+		return 0xffffffff;
+	return (add & 0xffff) - HW_PORTS_START;
+}
 
-	memset(psxH, 0, 0x10000);
+// In range and aligned to 'size' bytes
+#define hw_port_ok(off, size) (((off) & ~(HW_PORTS_SIZE - (size))) == 0)
 
-	mdecInit(); //intialize mdec decoder
-	sioInit(); //initialize sio
-	cdrReset();
-	psxRcntInit();
-	HW_GPU_STATUS = 0x14802000;
-}
 
-u8 psxHwRead8(u32 add)
-{
-	u8 hard = 0;
-
-	if ((add & 0x0ff00000) == 0x0f800000)
-	{
-		switch (add) {
-		case 0x1f801040: hard = sioRead8();break; 
-		//  case 0x1f801050: hard = serial_read8(); break;//for use of serial port ignore for now
-		case 0x1f801800: hard = cdrRead0(); break;
-		case 0x1f801801: hard = cdrRead1(); break;
-		case 0x1f801802: hard = cdrRead2(); break;
-		case 0x1f801803: hard = cdrRead3(); break;
-		default:
-			hard = psxHu8(add); 
-#ifdef PSXHW_LOG
-			PSXHW_LOG("*Unkwnown 8bit read at address %x\n", add);
-#endif
-		}
-		return hard;
-	}
+/*********************************************************
+* SIO                                                    *
+*********************************************************/
+static u8 hwRead8_Sio(u32 add) { return sioRead8(); }
+static void hwWrite8_Sio(u32 add, u8 value) { sioWrite8(value); }
 
-#ifdef PSXREC
-	// See note at top of file regarding dynarecs needing added functionality.
-	if ((add & 0x0ff00000) == 0x0fc00000) {
-		// ROM access
-		return psxRu8(add);
-	} else {
-		// A non-32-bit read from cache control port and probably never encountered
-		return 0;
+static u16 hwRead16_Sio(u32 add)
+{
+	u16 hard;
+	switch (add & 0xf) {
+		case 0x0: hard = sioRead16();      break;
+		case 0x4: hard = sioReadStat16();  break;
+		case 0x8: hard = sioReadMode16();  break;
+		case 0xa: hard = sioReadCtrl16();  break;
+		default:  hard = sioReadBaud16();  break;
 	}
-#endif //PSXREC
-
+#ifdef PAD_LOG
+	PAD_LOG("sio read16 %x; ret = %x\n", add&0xf, hard);
+#endif
 	return hard;
 }
 
-u16 psxHwRead16(u32 add)
+static void hwWrite16_Sio(u32 add, u16 value)
 {
-	u16 hard = 0;
-
-	if ((add & 0x0ff00000) == 0x0f800000)
-	{
-		switch (add) {
-#ifdef PSXHW_LOG
-		case 0x1f801070: PSXHW_LOG("IREG 16bit read %x\n", psxHu16(0x1070));
-			return psxHu16(0x1070);
-#endif
-#ifdef PSXHW_LOG
-		case 0x1f801074: PSXHW_LOG("IMASK 16bit read %x\n", psxHu16(0x1074));
-			return psxHu16(0x1074);
-#endif
-
-		case 0x1f801040:
-			hard = sioRead16();
-#ifdef PAD_LOG
-			PAD_LOG("sio read16 %x; ret = %x\n", add&0xf, hard);
-#endif
-			return hard;
-		case 0x1f801044:
-			hard = sioReadStat16();
-#ifdef PAD_LOG
-			PAD_LOG("sio read16 %x; ret = %x\n", add&0xf, hard);
-#endif
-			return hard;
-		case 0x1f801048:
-			hard = sioReadMode16();
+	switch (add & 0xf) {
+		case 0x0: sioWrite16(value);      break;
+		case 0x4: /* sioWriteStat16() is empty, disabled -senquack */ break;
+		case 0x8: sioWriteMode16(value);  break;
+		case 0xa: sioWriteCtrl16(value);  break;  // control register
+		default:  sioWriteBaud16(value);  break;  // baudrate register
+	}
 #ifdef PAD_LOG
-			PAD_LOG("sio read16 %x; ret = %x\n", add&0xf, hard);
+	PAD_LOG ("sio write16 %x, %x\n", add&0xf, value);
 #endif
-			return hard;
-		case 0x1f80104a:
-			hard = sioReadCtrl16();
+}
+
+static u32 hwRead32_Sio(u32 add)
+{
+	u32 hard = sioRead32();
 #ifdef PAD_LOG
-			PAD_LOG("sio read16 %x; ret = %x\n", add&0xf, hard);
+	PAD_LOG("sio read32 ;ret = %x\n", hard);
 #endif
-			return hard;
-		case 0x1f80104e:
-			hard = sioReadBaud16();
+	return hard;
+}
+
+static void hwWrite32_Sio(u32 add, u32 value)
+{
+	sioWrite32(value);
 #ifdef PAD_LOG
-			PAD_LOG("sio read16 %x; ret = %x\n", add&0xf, hard);
+	PAD_LOG("sio write32 %x\n", value);
 #endif
-			return hard;
+}
 
-		//Serial port stuff not support now ;P
-	 // case 0x1f801050: hard = serial_read16(); break;
-	 //	case 0x1f801054: hard = serial_status_read(); break;
-	 //	case 0x1f80105a: hard = serial_control_read(); break;
-	 //	case 0x1f80105e: hard = serial_baud_read(); break;
 
-		case 0x1f801100:
-			hard = psxRcntRcount(0);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T0 count read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801104:
-			hard = psxRcntRmode(0);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T0 mode read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801108:
-			hard = psxRcntRtarget(0);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T0 target read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801110:
-			hard = psxRcntRcount(1);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T1 count read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801114:
-			hard = psxRcntRmode(1);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T1 mode read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801118:
-			hard = psxRcntRtarget(1);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T1 target read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801120:
-			hard = psxRcntRcount(2);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T2 count read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801124:
-			hard = psxRcntRmode(2);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T2 mode read16: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801128:
-			hard = psxRcntRtarget(2);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T2 target read16: %x\n", hard);
-#endif
-			return hard;
+/*********************************************************
+* CD-ROM                                                 *
+*********************************************************/
+static u8 hwRead8_Cdr(u32 add)
+{
+	switch (add & 3) {
+		case 0:  return cdrRead0();
+		case 1:  return cdrRead1();
+		case 2:  return cdrRead2();
+		default: return cdrRead3();
+	}
+}
+
+static void hwWrite8_Cdr(u32 add, u8 value)
+{
+	switch (add & 3) {
+		case 0:  cdrWrite0(value); break;
+		case 1:  cdrWrite1(value); break;
+		case 2:  cdrWrite2(value); break;
+		default: cdrWrite3(value); break;
+	}
+}
 
-		//case 0x1f802030: hard =   //int_2000????
-		//case 0x1f802040: hard =//dip switches...??
 
-		default:
-			if (add >= 0x1f801c00 && add < 0x1f801e00) {
-				hard = SPU_readRegister(add);
-			} else {
-				hard = psxHu16(add); 
+/*********************************************************
+* Interrupt controller                                   *
+*********************************************************/
+static void hwWrite16_IReg(u32 add, u16 value)
+{
 #ifdef PSXHW_LOG
-				PSXHW_LOG("*Unkwnown 16bit read at address %x\n", add);
+	PSXHW_LOG("IREG 16bit write %x\n", value);
 #endif
-			}
-			return hard;
-		}
-	}
+	//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
+	value &= 0x7ff;
 
-#ifdef PSXREC
-	// See note at top of file regarding dynarecs needing added functionality.
-	if ((add & 0x0ff00000) == 0x0fc00000) {
-		// ROM access
-		return psxRu16(add);
-	} else {
-		// A non-32-bit read from cache control port and probably never encountered
-		return 0;
-	}
-#endif //PSXREC
+	//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
+	if (Config.SpuIrq) psxHu16ref(0x1070) |= SWAPu16(0x200);
 
-	return hard;
+	psxHu16ref(0x1070) &= SWAPu16(value);
+
+	//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
+	// gets called as soon as possible, so HW IRQ exception gets handled
+	if (psxHu16(0x1070) & psxHu16(0x1074))
+		ResetIoCycle();
 }
 
-u32 psxHwRead32(u32 add)
+static void hwWrite16_IMask(u32 add, u16 value)
 {
-	u32 hard = 0;
-
-	if ((add & 0x0ff00000) == 0x0f800000)
-	{
-		switch (add) {
-		case 0x1f801040:
-			hard = sioRead32();
-#ifdef PAD_LOG
-			PAD_LOG("sio read32 ;ret = %x\n", hard);
-#endif
-			return hard;
-			
-	//	case 0x1f801050: hard = serial_read32(); break;//serial port
 #ifdef PSXHW_LOG
-		case 0x1f801060:
-			PSXHW_LOG("RAM size read %x\n", psxHu32(0x1060));
-			return psxHu32(0x1060);
-#endif
-#ifdef PSXHW_LOG
-		case 0x1f801070: PSXHW_LOG("IREG 32bit read %x\n", psxHu32(0x1070));
-			return psxHu32(0x1070);
-#endif
-#ifdef PSXHW_LOG
-		case 0x1f801074: PSXHW_LOG("IMASK 32bit read %x\n", psxHu32(0x1074));
-			return psxHu32(0x1074);
+	PSXHW_LOG("IMASK 16bit write %x\n", value);
 #endif
+	//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
+	value &= 0x7ff;
 
-		case 0x1f801810:
-			hard = GPU_readData();
-#ifdef PSXHW_LOG
-			PSXHW_LOG("GPU DATA 32bit read %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801814:
-			//senquack - updated to PCSX Rearmed:
-			gpuSyncPluginSR();
-			hard = HW_GPU_STATUS;
-			if (hSyncCount < 240 && (HW_GPU_STATUS & PSXGPU_ILACE_BITS) != PSXGPU_ILACE_BITS)
-				hard |= PSXGPU_LCF & (psxRegs.cycle << 20);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("GPU STATUS 32bit read %x\n", hard);
-#endif
-			return hard;
+	psxHu16ref(0x1074) = SWAPu16(value);
 
-		case 0x1f801820:
-			return mdecRead0();
-		case 0x1f801824:
-			return mdecRead1();
+	//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
+	// gets called as soon as possible, so HW IRQ exception gets handled
+	if (psxHu16(0x1070) & psxHu16(0x1074))
+		ResetIoCycle();
+}
 
+static void hwWrite32_IReg(u32 add, u32 value)
+{
 #ifdef PSXHW_LOG
-		case 0x1f8010a0:
-			PSXHW_LOG("DMA2 MADR 32bit read %x\n", psxHu32(0x10a0));
-			return SWAPu32(HW_DMA2_MADR);
-		case 0x1f8010a4:
-			PSXHW_LOG("DMA2 BCR 32bit read %x\n", psxHu32(0x10a4));
-			return SWAPu32(HW_DMA2_BCR);
-		case 0x1f8010a8:
-			PSXHW_LOG("DMA2 CHCR 32bit read %x\n", psxHu32(0x10a8));
-			return SWAPu32(HW_DMA2_CHCR);
+	PSXHW_LOG("IREG 32bit write %x\n", value);
 #endif
+	//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
+	value &= 0x7ff;
 
-#ifdef PSXHW_LOG
-		case 0x1f8010b0:
-			PSXHW_LOG("DMA3 MADR 32bit read %x\n", psxHu32(0x10b0));
-			return SWAPu32(HW_DMA3_MADR);
-		case 0x1f8010b4:
-			PSXHW_LOG("DMA3 BCR 32bit read %x\n", psxHu32(0x10b4));
-			return SWAPu32(HW_DMA3_BCR);
-		case 0x1f8010b8:
-			PSXHW_LOG("DMA3 CHCR 32bit read %x\n", psxHu32(0x10b8));
-			return SWAPu32(HW_DMA3_CHCR);
-#endif
+	//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
+	if (Config.SpuIrq) psxHu32ref(0x1070) |= SWAPu32(0x200);
 
-		// time for rootcounters :)
-		case 0x1f801100:
-			hard = psxRcntRcount(0);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T0 count read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801104:
-			hard = psxRcntRmode(0);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T0 mode read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801108:
-			hard = psxRcntRtarget(0);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T0 target read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801110:
-			hard = psxRcntRcount(1);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T1 count read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801114:
-			hard = psxRcntRmode(1);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T1 mode read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801118:
-			hard = psxRcntRtarget(1);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T1 target read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801120:
-			hard = psxRcntRcount(2);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("T2 count read32: %x\n", hard);
-#endif
-			return hard;
-		case 0x1f801124:
-			hard = psxRcntRmode(2);
+	psxHu32ref(0x1070) &= SWAPu32(value);
+
+	//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
+	// gets called as soon as possible, so HW IRQ exception gets handled
+	if (psxHu32(0x1070) & psxHu32(0x1074))
+		ResetIoCycle();
+}
+
+static void hwWrite32_IMask(u32 add, u32 value)
+{
 #ifdef PSXHW_LOG
-			PSXHW_LOG("T2 mode read32: %x\n", hard);
+	PSXHW_LOG("IMASK 32bit write %x\n", value);
 #endif
-			return hard;
-		case 0x1f801128:
-			hard = psxRcntRtarget(2);
+	//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
+	value &= 0x7ff;
+
+	psxHu32ref(0x1074) = SWAPu32(value);
+
+	//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
+	// gets called as soon as possible, so HW IRQ exception gets handled
+	if (psxHu32(0x1070) & psxHu32(0x1074))
+		ResetIoCycle();
+}
+
+
+/*********************************************************
+* DMA                                                    *
+*********************************************************/
+static void (* const hw_dma_funcs[7])(u32 madr, u32 bcr, u32 chcr) = {
+	psxDma0,  // MDEC in DMA
+	psxDma1,  // MDEC out DMA
+	psxDma2,  // GPU DMA
+	psxDma3,  // CDROM DMA
+	psxDma4,  // SPU DMA
+	NULL,     // PIO, not handled
+	psxDma6   // GPU DMA (OT clear)
+};
+
+// Write to DMA channel CHCR port, starting transfer if enabled
+static void hwWrite32_DmaChcr(u32 add, u32 value)
+{
+	const u32 n = (add >> 4) & 7;
 #ifdef PSXHW_LOG
-			PSXHW_LOG("T2 target read32: %x\n", hard);
+	PSXHW_LOG("DMA%u CHCR 32bit write %x\n", n, value);
 #endif
-			return hard;
+	psxHu32ref(add) = SWAPu32(value);
 
-		default:
-			hard = psxHu32(add); 
+	if (value & 0x01000000 && SWAPu32(HW_DMA_PCR) & (8 << (n * 4))) {
+		hw_dma_funcs[n](SWAPu32(psxHu32ref(0x1080 + n * 0x10)),
+		                SWAPu32(psxHu32ref(0x1084 + n * 0x10)), value);
+	}
+}
+
+static void hwWrite32_DmaIcr(u32 add, u32 value)
+{
 #ifdef PSXHW_LOG
-			PSXHW_LOG("*Unkwnown 32bit read at address %x\n", add);
+	PSXHW_LOG("DMA ICR 32bit write %x\n", value);
 #endif
-			return hard;
-		}
+	u32 tmp = value & 0x00ff803f;
+	tmp |= (SWAPu32(HW_DMA_ICR) & ~value) & 0x7f000000;
+	if ((tmp & HW_DMA_ICR_GLOBAL_ENABLE && tmp & 0x7f000000)
+	    || tmp & HW_DMA_ICR_BUS_ERROR) {
+		if (!(SWAPu32(HW_DMA_ICR) & HW_DMA_ICR_IRQ_SENT))
+			psxHu32ref(0x1070) |= SWAP32(8);
+		tmp |= HW_DMA_ICR_IRQ_SENT;
 	}
+	HW_DMA_ICR = SWAPu32(tmp);
+}
 
-#ifdef PSXREC
-	// See note at top of file regarding dynarecs needing added functionality.
-	if ((add & 0x0ff00000) == 0x0fc00000) {
-		// ROM access
-		return psxRu32(add);
-	} else {
-		// Cache control port read - mimic original psxmem.cpp behavior and return 0
-		return 0;
-	}
-#endif //PSXREC
 
+/*********************************************************
+* GPU, MDEC                                              *
+*********************************************************/
+static u32 hwRead32_GpuData(u32 add)
+{
+	u32 hard = GPU_readData();
+#ifdef PSXHW_LOG
+	PSXHW_LOG("GPU DATA 32bit read %x\n", hard);
+#endif
 	return hard;
 }
 
-void psxHwWrite8(u32 add, u8 value)
+static u32 hwRead32_GpuStatus(u32 add)
 {
-	if ((add & 0x0ff00000) == 0x0f800000)
-	{
-		switch (add) {
-		case 0x1f801040: sioWrite8(value); break;
-	//	case 0x1f801050: serial_write8(value); break;//serial port
-		case 0x1f801800: cdrWrite0(value); break;
-		case 0x1f801801: cdrWrite1(value); break;
-		case 0x1f801802: cdrWrite2(value); break;
-		case 0x1f801803: cdrWrite3(value); break;
-
-		default:
-			psxHu8(add) = value;
+	//senquack - updated to PCSX Rearmed:
+	gpuSyncPluginSR();
+	u32 hard = HW_GPU_STATUS;
+	if (hSyncCount < 240 && (HW_GPU_STATUS & PSXGPU_ILACE_BITS) != PSXGPU_ILACE_BITS)
+		hard |= PSXGPU_LCF & (psxRegs.cycle << 20);
 #ifdef PSXHW_LOG
-			PSXHW_LOG("*Unknown 8bit write at address %x value %x\n", add, value);
+	PSXHW_LOG("GPU STATUS 32bit read %x\n", hard);
 #endif
-			return;
-		}
-
-		// NOTE: Yes, the messy and uncommented original code writes to psxH[]
-		//       even when the port address is known. I won't change this behavior
-		//       because it's unknown what original intent was. -senquack Aug 2017
+	return hard;
+}
 
-		psxHu8(add) = value;
-	}
+static void hwWrite32_GpuData(u32 add, u32 value)
+{
 #ifdef PSXHW_LOG
-	PSXHW_LOG("*Known 8bit write at address %x value %x\n", add, value);
+	PSXHW_LOG("GPU DATA 32bit write %x\n", value);
 #endif
+	GPU_writeData(value);
 }
 
-void psxHwWrite16(u32 add, u16 value)
+static void hwWrite32_GpuStatus(u32 add, u32 value)
 {
-	if ((add & 0x0ff00000) == 0x0f800000)
-	{
-		switch (add) {
-		case 0x1f801040:
-			sioWrite16(value);
-#ifdef PAD_LOG
-			PAD_LOG ("sio write16 %x, %x\n", add&0xf, value);
-#endif
-			return;
-		case 0x1f801044:
-			// Function is empty, disabled -senquack
-			//sioWriteStat16(value);
-#ifdef PAD_LOG
-			PAD_LOG ("sio write16 %x, %x\n", add&0xf, value);
-#endif
-			return;
-		case 0x1f801048:
-			sioWriteMode16(value);
-#ifdef PAD_LOG
-			PAD_LOG ("sio write16 %x, %x\n", add&0xf, value);
-#endif
-			return;
-		case 0x1f80104a: // control register
-			sioWriteCtrl16(value);
-#ifdef PAD_LOG
-			PAD_LOG ("sio write16 %x, %x\n", add&0xf, value);
-#endif
-			return;
-		case 0x1f80104e: // baudrate register
-			sioWriteBaud16(value);
-#ifdef PAD_LOG
-			PAD_LOG ("sio write16 %x, %x\n", add&0xf, value);
+	//senquack - updated to PCSX Rearmed:
+#ifdef PSXHW_LOG
+	PSXHW_LOG("GPU STATUS 32bit write %x\n", value);
 #endif
-			return;
+	GPU_writeStatus(value);
+	gpuSyncPluginSR();
+}
 
-		//serial port ;P
-	//  case 0x1f801050: serial_write16(value); break;
-	//	case 0x1f80105a: serial_control_write(value);break;
-	//	case 0x1f80105e: serial_baud_write(value); break;
-	//	case 0x1f801054: serial_status_write(value); break;
+static u32 hwRead32_Mdec0(u32 add) { return mdecRead0(); }
+static u32 hwRead32_Mdec1(u32 add) { return mdecRead1(); }
+static void hwWrite32_Mdec0(u32 add, u32 value) { mdecWrite0(value); }
+static void hwWrite32_Mdec1(u32 add, u32 value) { mdecWrite1(value); }
 
-		case 0x1f801070: 
+
+/*********************************************************
+* Root counters                                          *
+*  Counter index is bits 4,5 of port address            *
+*********************************************************/
+#define RCNT_INDEX(add) (((add) >> 4) & 3)
+
+static u32 hwReadRcnt(u32 add)
+{
+	const u32 index = RCNT_INDEX(add);
+	u32 hard;
+	switch (add & 0xf) {
+		case 0x0: hard = psxRcntRcount(index);   break;
+		case 0x4: hard = psxRcntRmode(index);    break;
+		default:  hard = psxRcntRtarget(index);  break;
+	}
 #ifdef PSXHW_LOG
-			PSXHW_LOG("IREG 16bit write %x\n", value);
+	PSXHW_LOG("T%u port %x read: %x\n", index, add & 0xf, hard);
 #endif
-			//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
-			value &= 0x7ff;
+	return hard;
+}
 
-			//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
-			if (Config.SpuIrq) psxHu16ref(0x1070) |= SWAPu16(0x200);
+static u16 hwRead16_Rcnt(u32 add) { return hwReadRcnt(add); }
+static u32 hwRead32_Rcnt(u32 add) { return hwReadRcnt(add); }
 
-			psxHu16ref(0x1070) &= SWAPu16(value);
+// Count and target are 16 bits wide, mode gets full value like before
+static void hwWriteRcnt(u32 add, u32 value)
+{
+	const u32 index = RCNT_INDEX(add);
+#ifdef PSXHW_LOG
+	PSXHW_LOG("COUNTER %u port %x write %x\n", index, add & 0xf, value);
+#endif
+	switch (add & 0xf) {
+		case 0x0: psxRcntWcount(index, value & 0xffff);   break;
+		case 0x4: psxRcntWmode(index, value);             break;
+		default:  psxRcntWtarget(index, value & 0xffff);  break;
+	}
+}
 
-			//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
-			// gets called as soon as possible, so HW IRQ exception gets handled
-			if (psxHu16(0x1070) & psxHu16(0x1074))
-				ResetIoCycle();
+static void hwWrite16_Rcnt(u32 add, u16 value) { hwWriteRcnt(add, value); }
+static void hwWrite32_Rcnt(u32 add, u32 value) { hwWriteRcnt(add, value); }
 
-			return;
 
-		case 0x1f801074:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("IMASK 16bit write %x\n", value);
-#endif
-			//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
-			value &= 0x7ff;
+/*********************************************************
+* SPU                                                    *
+*********************************************************/
+static u16 hwRead16_Spu(u32 add) { return SPU_readRegister(add); }
 
-			psxHu16ref(0x1074) = SWAPu16(value);
+static void hwWrite16_Spu(u32 add, u16 value)
+{
+	SPU_writeRegister(add, value, psxRegs.cycle);
+}
 
-			//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
-			// gets called as soon as possible, so HW IRQ exception gets handled
-			if (psxHu16(0x1070) & psxHu16(0x1074))
-				ResetIoCycle();
+// Dukes of Hazard 2 - car engine noise
+static void hwWrite32_Spu(u32 add, u32 value)
+{
+	SPU_writeRegister(add, value&0xffff, psxRegs.cycle);
+	SPU_writeRegister(add + 2, value>>16, psxRegs.cycle);
+}
 
-			return;
 
-		case 0x1f801100:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 0 COUNT 16bit write %x\n", value);
-#endif
-			psxRcntWcount(0, value);
-			return;
-		case 0x1f801104:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 0 MODE 16bit write %x\n", value);
-#endif
-			psxRcntWmode(0, value);
-			return;
-		case 0x1f801108:
 #ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 0 TARGET 16bit write %x\n", value);
-#endif
-			psxRcntWtarget(0, value);
-			return;
+/* Ports that are plain memory, but whose accesses are worth logging */
+static u16 hwRead16_Log(u32 add)
+{
+	PSXHW_LOG("Port %x 16bit read %x\n", add, psxHu16(add));
+	return psxHu16(add);
+}
 
-		case 0x1f801110:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 1 COUNT 16bit write %x\n", value);
-#endif
-			psxRcntWcount(1, value);
-			return;
-		case 0x1f801114:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 1 MODE 16bit write %x\n", value);
-#endif
-			psxRcntWmode(1, value);
-			return;
-		case 0x1f801118:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 1 TARGET 16bit write %x\n", value);
-#endif
-			psxRcntWtarget(1, value);
-			return;
+static u32 hwRead32_Log(u32 add)
+{
+	PSXHW_LOG("Port %x 32bit read %x\n", add, psxHu32(add));
+	return psxHu32(add);
+}
 
-		case 0x1f801120:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 2 COUNT 16bit write %x\n", value);
-#endif
-			psxRcntWcount(2, value);
-			return;
-		case 0x1f801124:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 2 MODE 16bit write %x\n", value);
-#endif
-			psxRcntWmode(2, value);
-			return;
-		case 0x1f801128:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 2 TARGET 16bit write %x\n", value);
+static void hwWrite32_Log(u32 add, u32 value)
+{
+	PSXHW_LOG("Port %x 32bit write %x\n", add, value);
+	psxHu32ref(add) = SWAPu32(value);
+}
 #endif
-			psxRcntWtarget(2, value); 
-			return;
 
-		default:
-			if (add>=0x1f801c00 && add<0x1f801e00) {
-				SPU_writeRegister(add, value, psxRegs.cycle);
-				return;
-			}
 
-			psxHu16ref(add) = SWAPu16(value);
-#ifdef PSXHW_LOG
-			PSXHW_LOG("*Unknown 16bit write at address %x value %x\n", add, value);
-#endif
-			return;
+/*********************************************************
+* Handler tables                                         *
+*********************************************************/
+#define HW_SET_R8(port, f)   hw_read8  [((port) - HW_PORTS_START)]      = (f)
+#define HW_SET_R16(port, f)  hw_read16 [((port) - HW_PORTS_START) >> 1] = (f)
+#define HW_SET_R32(port, f)  hw_read32 [((port) - HW_PORTS_START) >> 2] = (f)
+#define HW_SET_W8(port, f)   hw_write8 [((port) - HW_PORTS_START)]      = (f)
+#define HW_SET_W16(port, f)  hw_write16[((port) - HW_PORTS_START) >> 1] = (f)
+#define HW_SET_W32(port, f)  hw_write32[((port) - HW_PORTS_START) >> 2] = (f)
+
+static void psxHwInitTables(void)
+{
+	memset(hw_read8,   0, sizeof(hw_read8));
+	memset(hw_read16,  0, sizeof(hw_read16));
+	memset(hw_read32,  0, sizeof(hw_read32));
+	memset(hw_write8,  0, sizeof(hw_write8));
+	memset(hw_write16, 0, sizeof(hw_write16));
+	memset(hw_write32, 0, sizeof(hw_write32));
+
+	// SIO
+	HW_SET_R8 (0x1040, hwRead8_Sio);
+	HW_SET_W8 (0x1040, hwWrite8_Sio);
+	HW_SET_R32(0x1040, hwRead32_Sio);
+	HW_SET_W32(0x1040, hwWrite32_Sio);
+	static const u16 sio_ports16[] = { 0x1040, 0x1044, 0x1048, 0x104a, 0x104e };
+	for (size_t i = 0; i < sizeof(sio_ports16)/sizeof(sio_ports16[0]); i++) {
+		HW_SET_R16(sio_ports16[i], hwRead16_Sio);
+		HW_SET_W16(sio_ports16[i], hwWrite16_Sio);
+	}
+	//Serial port stuff not supported now ;P  (0x1f801050..0x1f80105e)
+
+	// Interrupt controller
+	HW_SET_W16(0x1070, hwWrite16_IReg);
+	HW_SET_W16(0x1074, hwWrite16_IMask);
+	HW_SET_W32(0x1070, hwWrite32_IReg);
+	HW_SET_W32(0x1074, hwWrite32_IMask);
+
+	// DMA: MADR,BCR are plain memory, CHCR starts transfers
+	for (u32 n = 0; n < 7; n++)
+		if (hw_dma_funcs[n])
+			HW_SET_W32(0x1088 + n * 0x10, hwWrite32_DmaChcr);
+	HW_SET_W32(0x10f4, hwWrite32_DmaIcr);
+
+	// Root counters
+	for (u32 port = 0x1100; port <= 0x1120; port += 0x10) {
+		for (u32 reg = 0; reg <= 8; reg += 4) {
+			HW_SET_R16(port + reg, hwRead16_Rcnt);
+			HW_SET_R32(port + reg, hwRead32_Rcnt);
+			HW_SET_W16(port + reg, hwWrite16_Rcnt);
+			HW_SET_W32(port + reg, hwWrite32_Rcnt);
 		}
 	}
-}
 
-#define DmaExec(n) { \
-	HW_DMA##n##_CHCR = SWAPu32(value); \
-\
-	if (SWAPu32(HW_DMA##n##_CHCR) & 0x01000000 && SWAPu32(HW_DMA_PCR) & (8 << (n * 4))) { \
-		psxDma##n(SWAPu32(HW_DMA##n##_MADR), SWAPu32(HW_DMA##n##_BCR), SWAPu32(HW_DMA##n##_CHCR)); \
-	} \
-}
+	// CD-ROM
+	for (u32 port = 0x1800; port <= 0x1803; port++) {
+		HW_SET_R8(port, hwRead8_Cdr);
+		HW_SET_W8(port, hwWrite8_Cdr);
+	}
 
-void psxHwWrite32(u32 add, u32 value)
-{
-	if ((add & 0x0ff00000) == 0x0f800000)
-	{
-		switch (add) {
-		case 0x1f801040:
-			sioWrite32(value);
-#ifdef PAD_LOG
-			PAD_LOG("sio write32 %x\n", value);
-#endif
-			return;
-	//	case 0x1f801050: serial_write32(value); break;//serial port
-#ifdef PSXHW_LOG
-		case 0x1f801060:
-			PSXHW_LOG("RAM size write %x\n", value);
-			psxHu32ref(add) = SWAPu32(value);
-			return; // Ram size
-#endif
+	// GPU, MDEC
+	HW_SET_R32(0x1810, hwRead32_GpuData);
+	HW_SET_R32(0x1814, hwRead32_GpuStatus);
+	HW_SET_W32(0x1810, hwWrite32_GpuData);
+	HW_SET_W32(0x1814, hwWrite32_GpuStatus);
+	HW_SET_R32(0x1820, hwRead32_Mdec0);
+	HW_SET_R32(0x1824, hwRead32_Mdec1);
+	HW_SET_W32(0x1820, hwWrite32_Mdec0);
+	HW_SET_W32(0x1824, hwWrite32_Mdec1);
+
+	// SPU: 16-bit reads and writes, 32-bit writes (not reads)
+	for (u32 port = 0x1c00; port < 0x1e00; port += 2) {
+		HW_SET_R16(port, hwRead16_Spu);
+		HW_SET_W16(port, hwWrite16_Spu);
+		if ((port & 3) == 0)
+			HW_SET_W32(port, hwWrite32_Spu);
+	}
 
-		case 0x1f801070: 
 #ifdef PSXHW_LOG
-			PSXHW_LOG("IREG 32bit write %x\n", value);
+	HW_SET_R16(0x1070, hwRead16_Log);   // IREG
+	HW_SET_R16(0x1074, hwRead16_Log);   // IMASK
+	HW_SET_R32(0x1060, hwRead32_Log);   // RAM size
+	HW_SET_R32(0x1070, hwRead32_Log);
+	HW_SET_R32(0x1074, hwRead32_Log);
+	HW_SET_W32(0x1060, hwWrite32_Log);
+	for (u32 n = 0; n < 7; n++) {
+		HW_SET_W32(0x1080 + n * 0x10, hwWrite32_Log);  // DMA MADR
+		HW_SET_W32(0x1084 + n * 0x10, hwWrite32_Log);  // DMA BCR
+	}
+	HW_SET_W32(0x10f0, hwWrite32_Log);  // DMA PCR
+	for (u32 n = 2; n <= 3; n++) {
+		HW_SET_R32(0x1080 + n * 0x10, hwRead32_Log);
+		HW_SET_R32(0x1084 + n * 0x10, hwRead32_Log);
+		HW_SET_R32(0x1088 + n * 0x10, hwRead32_Log);
+	}
 #endif
-			//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
-			value &= 0x7ff;
+}
+
 
-			//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
-			if (Config.SpuIrq) psxHu32ref(0x1070) |= SWAPu32(0x200);
+void psxHwReset() {
+	//senquack - added Config.SpuIrq option from PCSX Rearmed/Reloaded:
+	if (Config.SpuIrq) psxHu32ref(0x1070) |= SWAP32(0x200);
 
-			psxHu32ref(0x1070) &= SWAPu32(value);
+	memset(psxH, 0, 0x10000);
 
-			//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
-			// gets called as soon as possible, so HW IRQ exception gets handled
-			if (psxHu32(0x1070) & psxHu32(0x1074))
-				ResetIoCycle();
+	psxHwInitTables();
 
-			return;
-		case 0x1f801074:
+	mdecInit(); //intialize mdec decoder
+	sioInit(); //initialize sio
+	cdrReset();
+	psxRcntInit();
+	HW_GPU_STATUS = 0x14802000;
+}
+
+u8 psxHwRead8(u32 add)
+{
+	memstats_add_hw_read(add, MEMSTAT_WIDTH_8);
+	const u32 off = hw_port_off(add);
+	if (hw_port_ok(off, 1) && hw_read8[off])
+		return hw_read8[off](add);
+
+	if ((add & 0x0ff00000) == 0x0f800000) {
 #ifdef PSXHW_LOG
-			PSXHW_LOG("IMASK 32bit write %x\n", value);
+		PSXHW_LOG("*Unkwnown 8bit read at address %x\n", add);
 #endif
-			//senquack - Strip all but bits 0:10, rest are 0 or garbage in docs
-			value &= 0x7ff;
+		return psxHu8(add);
+	}
 
-			psxHu32ref(0x1074) = SWAPu32(value);
+#ifdef PSXREC
+	// See note at top of file regarding dynarecs needing added functionality.
+	if ((add & 0x0ff00000) == 0x0fc00000) {
+		// ROM access
+		return psxRu8(add);
+	}
+	// A non-32-bit read from cache control port and probably never encountered
+#endif //PSXREC
 
-			//senquack - When IRQ is pending and unmasked, ensure psxBranchTest()
-			// gets called as soon as possible, so HW IRQ exception gets handled
-			if (psxHu32(0x1070) & psxHu32(0x1074))
-				ResetIoCycle();
+	return 0;
+}
 
-			return;
+u16 psxHwRead16(u32 add)
+{
+	memstats_add_hw_read(add, MEMSTAT_WIDTH_16);
+	const u32 off = hw_port_off(add);
+	if (hw_port_ok(off, 2) && hw_read16[off >> 1])
+		return hw_read16[off >> 1](add);
 
+	if ((add & 0x0ff00000) == 0x0f800000) {
 #ifdef PSXHW_LOG
-		case 0x1f801080:
-			PSXHW_LOG("DMA0 MADR 32bit write %x\n", value);
-			HW_DMA0_MADR = SWAPu32(value); // DMA0 madr
-			return;
-		case 0x1f801084:
-			PSXHW_LOG("DMA0 BCR 32bit write %x\n", value);
-			HW_DMA0_BCR  = SWAPu32(value); // DMA0 bcr
-			return;
-#endif
-		case 0x1f801088:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA0 CHCR 32bit write %x\n", value);
+		PSXHW_LOG("*Unkwnown 16bit read at address %x\n", add);
 #endif
-			DmaExec(0);	                 // DMA0 chcr (MDEC in DMA)
-			return;
+		return psxHu16(add);
+	}
 
-#ifdef PSXHW_LOG
-		case 0x1f801090:
-			PSXHW_LOG("DMA1 MADR 32bit write %x\n", value);
-			HW_DMA1_MADR = SWAPu32(value); // DMA1 madr
-			return;
-		case 0x1f801094:
-			PSXHW_LOG("DMA1 BCR 32bit write %x\n", value);
-			HW_DMA1_BCR  = SWAPu32(value); // DMA1 bcr
-			return;
-#endif
-		case 0x1f801098:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA1 CHCR 32bit write %x\n", value);
-#endif
-			DmaExec(1);                  // DMA1 chcr (MDEC out DMA)
-			return;
+#ifdef PSXREC
+	// See note at top of file regarding dynarecs needing added functionality.
+	if ((add & 0x0ff00000) == 0x0fc00000) {
+		// ROM access
+		return psxRu16(add);
+	}
+	// A non-32-bit read from cache control port and probably never encountered
+#endif //PSXREC
 
-#ifdef PSXHW_LOG
-		case 0x1f8010a0:
-			PSXHW_LOG("DMA2 MADR 32bit write %x\n", value);
-			HW_DMA2_MADR = SWAPu32(value); // DMA2 madr
-			return;
-		case 0x1f8010a4:
-			PSXHW_LOG("DMA2 BCR 32bit write %x\n", value);
-			HW_DMA2_BCR  = SWAPu32(value); // DMA2 bcr
-			return;
-#endif
-		case 0x1f8010a8:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA2 CHCR 32bit write %x\n", value);
-#endif
-			DmaExec(2);                  // DMA2 chcr (GPU DMA)
-			return;
+	return 0;
+}
 
-#ifdef PSXHW_LOG
-		case 0x1f8010b0:
-			PSXHW_LOG("DMA3 MADR 32bit write %x\n", value);
-			HW_DMA3_MADR = SWAPu32(value); // DMA3 madr
-			return;
-		case 0x1f8010b4:
-			PSXHW_LOG("DMA3 BCR 32bit write %x\n", value);
-			HW_DMA3_BCR  = SWAPu32(value); // DMA3 bcr
-			return;
-#endif
-		case 0x1f8010b8:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA3 CHCR 32bit write %x\n", value);
-#endif
-			DmaExec(3);                  // DMA3 chcr (CDROM DMA)
-			
-			return;
+u32 psxHwRead32(u32 add)
+{
+	memstats_add_hw_read(add, MEMSTAT_WIDTH_32);
+	const u32 off = hw_port_off(add);
+	if (hw_port_ok(off, 4) && hw_read32[off >> 2])
+		return hw_read32[off >> 2](add);
 
+	if ((add & 0x0ff00000) == 0x0f800000) {
 #ifdef PSXHW_LOG
-		case 0x1f8010c0:
-			PSXHW_LOG("DMA4 MADR 32bit write %x\n", value);
-			HW_DMA4_MADR = SWAPu32(value); // DMA4 madr
-			return;
-		case 0x1f8010c4:
-			PSXHW_LOG("DMA4 BCR 32bit write %x\n", value);
-			HW_DMA4_BCR  = SWAPu32(value); // DMA4 bcr
-			return;
-#endif
-		case 0x1f8010c8:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA4 CHCR 32bit write %x\n", value);
+		PSXHW_LOG("*Unkwnown 32bit read at address %x\n", add);
 #endif
-			DmaExec(4);                  // DMA4 chcr (SPU DMA)
-			return;
+		return psxHu32(add);
+	}
 
-#ifdef PSXHW_LOG
-		case 0x1f8010e0:
-			PSXHW_LOG("DMA6 MADR 32bit write %x\n", value);
-			HW_DMA6_MADR = SWAPu32(value); // DMA6 bcr
-			return;
-		case 0x1f8010e4:
-			PSXHW_LOG("DMA6 BCR 32bit write %x\n", value);
-			HW_DMA6_BCR  = SWAPu32(value); // DMA6 bcr
-			return;
-#endif
-		case 0x1f8010e8:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA6 CHCR 32bit write %x\n", value);
-#endif
-			DmaExec(6);                   // DMA6 chcr (OT clear)
-			return;
+#ifdef PSXREC
+	// See note at top of file regarding dynarecs needing added functionality.
+	if ((add & 0x0ff00000) == 0x0fc00000) {
+		// ROM access
+		return psxRu32(add);
+	}
+	// Cache control port read - mimic original psxmem.cpp behavior and return 0
+#endif //PSXREC
 
-#ifdef PSXHW_LOG
-		case 0x1f8010f0:
-			PSXHW_LOG("DMA PCR 32bit write %x\n", value);
-			HW_DMA_PCR = SWAPu32(value);
-			return;
-#endif
+	return 0;
+}
 
-		case 0x1f8010f4:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("DMA ICR 32bit write %x\n", value);
-#endif
-		{
-			u32 tmp = value & 0x00ff803f;
-			tmp |= (SWAPu32(HW_DMA_ICR) & ~value) & 0x7f000000;
-			if ((tmp & HW_DMA_ICR_GLOBAL_ENABLE && tmp & 0x7f000000)
-			    || tmp & HW_DMA_ICR_BUS_ERROR) {
-				if (!(SWAPu32(HW_DMA_ICR) & HW_DMA_ICR_IRQ_SENT))
-					psxHu32ref(0x1070) |= SWAP32(8);
-				tmp |= HW_DMA_ICR_IRQ_SENT;
-			}
-			HW_DMA_ICR = SWAPu32(tmp);
-			return;
-		}
+void psxHwWrite8(u32 add, u8 value)
+{
+	memstats_add_hw_write(add, MEMSTAT_WIDTH_8);
+	if ((add & 0x0ff00000) != 0x0f800000)
+		return;
 
-		case 0x1f801810:
+	const u32 off = hw_port_off(add);
+	if (hw_port_ok(off, 1) && hw_write8[off]) {
+		hw_write8[off](add, value);
 #ifdef PSXHW_LOG
-			PSXHW_LOG("GPU DATA 32bit write %x\n", value);
+		PSXHW_LOG("*Known 8bit write at address %x value %x\n", add, value);
 #endif
-			GPU_writeData(value);
-			return;
-		case 0x1f801814:
-			//senquack - updated to PCSX Rearmed:
+	} else {
 #ifdef PSXHW_LOG
-			PSXHW_LOG("GPU STATUS 32bit write %x\n", value);
+		PSXHW_LOG("*Unknown 8bit write at address %x value %x\n", add, value);
 #endif
-			GPU_writeStatus(value);
-			gpuSyncPluginSR();
+	}
 
-			return;
+	// NOTE: Yes, the messy and uncommented original code writes to psxH[]
+	//       even when the port address is known. I won't change this behavior
+	//       because it's unknown what original intent was. -senquack Aug 2017
+	psxHu8(add) = value;
+}
 
-		case 0x1f801820:
-			mdecWrite0(value); break;
-		case 0x1f801824:
-			mdecWrite1(value); break;
+void psxHwWrite16(u32 add, u16 value)
+{
+	memstats_add_hw_write(add, MEMSTAT_WIDTH_16);
+	const u32 off = hw_port_off(add);
+	if (hw_port_ok(off, 2) && hw_write16[off >> 1]) {
+		hw_write16[off >> 1](add, value);
+		return;
+	}
 
-		case 0x1f801100:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 0 COUNT 32bit write %x\n", value);
-#endif
-			psxRcntWcount(0, value & 0xffff);
-			return;
-		case 0x1f801104:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 0 MODE 32bit write %x\n", value);
-#endif
-			psxRcntWmode(0, value);
-			return;
-		case 0x1f801108:
+	if ((add & 0x0ff00000) == 0x0f800000) {
+		psxHu16ref(add) = SWAPu16(value);
 #ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 0 TARGET 32bit write %x\n", value);
+		PSXHW_LOG("*Unknown 16bit write at address %x value %x\n", add, value);
 #endif
-			psxRcntWtarget(0, value & 0xffff); //  HW_DMA_ICR&= SWAP32((~value)&0xff000000);
-			return;
+	}
+}
 
-		case 0x1f801110:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 1 COUNT 32bit write %x\n", value);
-#endif
-			psxRcntWcount(1, value & 0xffff);
-			return;
-		case 0x1f801114:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 1 MODE 32bit write %x\n", value);
-#endif
-			psxRcntWmode(1, value);
-			return;
-		case 0x1f801118:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 1 TARGET 32bit write %x\n", value);
-#endif
-			psxRcntWtarget(1, value & 0xffff);
-			return;
+void psxHwWrite32(u32 add, u32 value)
+{
+	memstats_add_hw_write(add, MEMSTAT_WIDTH_32);
+	const u32 off = hw_port_off(add);
+	if (hw_port_ok(off, 4) && hw_write32[off >> 2]) {
+		hw_write32[off >> 2](add, value);
+		return;
+	}
 
-		case 0x1f801120:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 2 COUNT 32bit write %x\n", value);
-#endif
-			psxRcntWcount(2, value & 0xffff);
-			return;
-		case 0x1f801124:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 2 MODE 32bit write %x\n", value);
-#endif
-			psxRcntWmode(2, value);
-			return;
-		case 0x1f801128:
-#ifdef PSXHW_LOG
-			PSXHW_LOG("COUNTER 2 TARGET 32bit write %x\n", value);
-#endif
-			psxRcntWtarget(2, value & 0xffff);
-			return;
-
-		default:
-			// Dukes of Hazard 2 - car engine noise
-			if (add>=0x1f801c00 && add<0x1f801e00) {
-				SPU_writeRegister(add, value&0xffff, psxRegs.cycle);
-				SPU_writeRegister(add + 2, value>>16, psxRegs.cycle);
-				return;
-			}
-
-			psxHu32ref(add) = SWAPu32(value);
+	if ((add & 0x0ff00000) == 0x0f800000) {
+		psxHu32ref(add) = SWAPu32(value);
 #ifdef PSXHW_LOG
-			PSXHW_LOG("*Unknown 32bit write at address %x value %x\n", add, value);
+		PSXHW_LOG("*Unknown 32bit write at address %x value %x\n", add, value);
 #endif
-			return;
-		}
+		return;
 	}
 
 #ifdef PSXREC
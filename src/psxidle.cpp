@@ -0,0 +1,444 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Idle-loop detection and cycle fast-forward
+ *
+ *  A loop qualifies when:
+ *   - It is at most IDLE_LOOP_MAX_INSNS long (including BD slot), closed by
+ *     a BEQ/BNE/BLEZ/BGTZ/BLTZ/BGEZ/J back to its first instruction, with
+ *     no other branches or jumps inside it.
+ *   - It only contains ALU ops, MFHI/MFLO, MFC0 and LB/LBU/LH/LHU/LW loads:
+ *     no stores, no MULT/DIV, no GTE, no syscalls.
+ *   - It is idempotent: no reg read before being written in the loop body
+ *     is written anywhere in it (no counters or induction vars).
+ *   - No instruction reads the target of the load right before it, so the
+ *     result never depends on load-delay behaviour.
+ *   - At runtime, all loads hit RAM, scratchpad, BIOS ROM or one of the
+ *     few HW regs that can only change when an event is dispatched: I_STAT,
+ *     I_MASK, DMA regs and (with gpulib) GPUSTAT.
+ *
+ *  Such a loop does the exact same thing on every iteration until the next
+ * event is dispatched by psxBranchTest(), so the cycles in between can be
+ * skipped without changing emulated behaviour.
+ */
+
+#include "psxidle.h"
+#include "psxmem.h"
+#include "psxevents.h"
+#include "psxcounters.h"
+#include "gpu.h"
+
+psxIdleStats_t psxIdleStats;
+
+#define IDLE_LOOP_MAX_INSNS 16
+
+// Last loop checked, to avoid decoding it again on every iteration
+static struct {
+	u32 loop_pc, branch_pc;
+	bool idle;
+} idle_cache;
+
+// Recompilers: state seen on last entry to an idle-loop block
+static struct {
+	u32 pc, cycle, next_event;
+} idle_last_entry;
+
+void psxIdleReset(void)
+{
+	memset(&psxIdleStats, 0, sizeof(psxIdleStats));
+	memset(&idle_cache, 0, sizeof(idle_cache));
+	memset(&idle_last_entry, 0, sizeof(idle_last_entry));
+}
+
+void psxIdlePrintStats(void)
+{
+	if (psxIdleStats.skips == 0)
+		return;
+
+	printf("Idle loops: %llu skips, %llu cycles skipped\n",
+	       (unsigned long long)psxIdleStats.skips,
+	       (unsigned long long)psxIdleStats.skipped_cycles);
+}
+
+static bool fetchOpcode(u32 pc, u32 *code)
+{
+	if (psxMemRLUTEntry(pc >> 16) == NULL)
+		return false;
+	*code = PSXMu32(pc);
+	return true;
+}
+
+static bool opcodeIsBranchOrJump(u32 code)
+{
+	switch (_fOp_(code)) {
+		case 0x00: // SPECIAL
+			return _fFunct_(code) == 0x08 || _fFunct_(code) == 0x09; // JR,JALR
+		case 0x01: // REGIMM
+		case 0x02: case 0x03: // J,JAL
+		case 0x04: case 0x05: case 0x06: case 0x07: // BEQ,BNE,BLEZ,BGTZ
+			return true;
+	}
+	return false;
+}
+
+/* Is opcode at 'branch_pc' a branch that can close a loop back to 'loop_pc'?
+ *  Sets 'reads' to mask of GPRs it reads. Linking branches are rejected.
+ */
+static bool idleLoopBranch(u32 code, u32 loop_pc, u32 branch_pc, u32 *reads)
+{
+	const u32 rs = _fRs_(code), rt = _fRt_(code);
+
+	switch (_fOp_(code)) {
+		case 0x01: // REGIMM
+			if (rt != 0x00 && rt != 0x01) // BLTZ,BGEZ
+				return false;
+			*reads = 1 << rs;
+			break;
+		case 0x02: // J
+			*reads = 0;
+			return (_fTarget_(code) * 4 + ((branch_pc + 4) & 0xf0000000)) == loop_pc;
+		case 0x04: case 0x05: // BEQ,BNE
+			*reads = (1 << rs) | (1 << rt);
+			break;
+		case 0x06: case 0x07: // BLEZ,BGTZ
+			*reads = 1 << rs;
+			break;
+		default:
+			return false;
+	}
+
+	return (branch_pc + 4 + _fImm_(code) * 4) == loop_pc;
+}
+
+/* Is opcode allowed inside an idle loop? Sets 'reads','writes' to masks of
+ *  GPRs read and written, and 'load' to whether it is a load.
+ */
+static bool idleLoopOp(u32 code, u32 *reads, u32 *writes, bool *load)
+{
+	const u32 rs = _fRs_(code), rt = _fRt_(code), rd = _fRd_(code);
+
+	*load = false;
+
+	switch (_fOp_(code)) {
+		case 0x00: // SPECIAL
+			switch (_fFunct_(code)) {
+				case 0x00: case 0x02: case 0x03: // SLL,SRL,SRA
+					*reads = 1 << rt;
+					*writes = 1 << rd;
+					return true;
+				case 0x04: case 0x06: case 0x07: // SLLV,SRLV,SRAV
+				case 0x20: case 0x21: case 0x22: case 0x23: // ADD,ADDU,SUB,SUBU
+				case 0x24: case 0x25: case 0x26: case 0x27: // AND,OR,XOR,NOR
+				case 0x2a: case 0x2b: // SLT,SLTU
+					*reads = (1 << rs) | (1 << rt);
+					*writes = 1 << rd;
+					return true;
+				case 0x10: case 0x12: // MFHI,MFLO (Hi/Lo can't be written)
+					*reads = 0;
+					*writes = 1 << rd;
+					return true;
+			}
+			return false;
+		case 0x08: case 0x09: case 0x0a: case 0x0b: // ADDI,ADDIU,SLTI,SLTIU
+		case 0x0c: case 0x0d: case 0x0e:            // ANDI,ORI,XORI
+			*reads = 1 << rs;
+			*writes = 1 << rt;
+			return true;
+		case 0x0f: // LUI
+			*reads = 0;
+			*writes = 1 << rt;
+			return true;
+		case 0x10: // COP0
+			if (rs != 0x00) // MFC0
+				return false;
+			*reads = 0;
+			*writes = 1 << rt;
+			*load = true;   // Has a load delay, too
+			return true;
+		case 0x20: case 0x21: case 0x23: // LB,LH,LW
+		case 0x24: case 0x25:            // LBU,LHU
+			*reads = 1 << rs;
+			*writes = 1 << rt;
+			*load = true;
+			return true;
+	}
+	return false;
+}
+
+bool psxIdleLoopTest(u32 loop_pc, u32 branch_pc)
+{
+	u32 code, reads, writes;
+	u32 live_in = 0, written = 0, load_target = 0, first_reads = 0;
+	bool load;
+
+	if (branch_pc < loop_pc ||
+	    (branch_pc - loop_pc)/4 + 2 > IDLE_LOOP_MAX_INSNS)
+		return false;
+
+	if (!fetchOpcode(branch_pc, &code) ||
+	    !idleLoopBranch(code, loop_pc, branch_pc, &reads))
+		return false;
+	const u32 branch_reads = reads;
+
+	// Walk loop body and BD slot in execution order. The branch reads its
+	//  operands after the body and before the BD slot.
+	for (u32 pc = loop_pc; pc <= branch_pc + 4; pc += 4) {
+		if (pc == branch_pc) {
+			reads = branch_reads;
+			writes = 0;
+			load = false;
+		} else if (!fetchOpcode(pc, &code) || opcodeIsBranchOrJump(code) ||
+		           !idleLoopOp(code, &reads, &writes, &load)) {
+			return false;
+		}
+
+		reads &= ~1;
+		writes &= ~1;
+
+		if (pc == loop_pc)
+			first_reads = reads;
+
+		if (reads & load_target)
+			return false;
+		load_target = load ? writes : 0;
+
+		live_in |= reads & ~written;
+		written |= writes;
+	}
+
+	// BD slot load feeding the first opcode of the next iteration
+	if (first_reads & load_target)
+		return false;
+
+	return (live_in & written) == 0;
+}
+
+u32 psxIdleLoopFind(u32 loop_pc)
+{
+	u32 code;
+
+	for (u32 pc = loop_pc; pc < loop_pc + IDLE_LOOP_MAX_INSNS*4; pc += 4) {
+		if (!fetchOpcode(pc, &code))
+			return 0;
+		if (opcodeIsBranchOrJump(code))
+			return psxIdleLoopTest(loop_pc, pc) ? pc : 0;
+	}
+	return 0;
+}
+
+/* Can a load from 'addr' only return something different once the next
+ *  event is dispatched? Sets 'max_cycle' lower if it can change sooner.
+ */
+static bool idleLoopAddressOk(u32 addr, u32 *max_cycle)
+{
+	addr &= 0x1fffffff;
+
+	if (addr < 0x00800000 ||                            // RAM, mirrored
+	    (addr >= 0x1f800000 && addr < 0x1f800400) ||    // Scratchpad
+	    (addr >= 0x1fc00000 && addr < 0x1fc80000))      // BIOS ROM
+		return true;
+
+	switch (addr & ~3) {
+		case 0x1f801070: // I_STAT
+		case 0x1f801074: // I_MASK
+			return true;
+#ifdef USE_GPULIB
+		case 0x1f801814: // GPUSTAT
+			// gpulib's status reg only changes on GPU writes and DMA, but
+			//  psxHwRead32() derives the LCF bit from psxRegs.cycle, which
+			//  toggles every 2048 cycles. Don't skip past a toggle.
+			if (hSyncCount < 240 &&
+			    (HW_GPU_STATUS & PSXGPU_ILACE_BITS) != PSXGPU_ILACE_BITS) {
+				const u32 toggle_cycle = (psxRegs.cycle | 0x7ff) + 1;
+				if ((s32)(toggle_cycle - *max_cycle) < 0)
+					*max_cycle = toggle_cycle;
+			}
+			return true;
+#endif
+	}
+
+	// DMA channel and control regs
+	return addr >= 0x1f801080 && addr < 0x1f801100;
+}
+
+/* Run through one iteration of loop using current GPR values, checking the
+ *  address of each load. Base regs of loads must be either loop-invariant or
+ *  computed by ALU ops in the loop, not loaded by it.
+ */
+static bool idleLoopAddressesOk(u32 loop_pc, u32 branch_pc, u32 *max_cycle)
+{
+	u32 r[32];
+	u32 known = ~0;
+
+	memcpy(r, psxRegs.GPR.r, sizeof(r));
+
+	for (u32 pc = loop_pc; pc <= branch_pc + 4; pc += 4) {
+		if (pc == branch_pc)
+			continue;
+
+		const u32 code = PSXMu32(pc);
+		const u32 rs = _fRs_(code), rt = _fRt_(code), rd = _fRd_(code);
+		const u32 sa = _fSa_(code);
+		u32 dst = 0, val = 0, srcs = 0;
+
+		switch (_fOp_(code)) {
+			case 0x00: // SPECIAL
+				dst = rd;
+				srcs = (1 << rs) | (1 << rt);
+				switch (_fFunct_(code)) {
+					case 0x00: val = r[rt] << sa;                  srcs = 1 << rt; break;
+					case 0x02: val = r[rt] >> sa;                  srcs = 1 << rt; break;
+					case 0x03: val = (s32)r[rt] >> sa;             srcs = 1 << rt; break;
+					case 0x04: val = r[rt] << (r[rs] & 31);        break;
+					case 0x06: val = r[rt] >> (r[rs] & 31);        break;
+					case 0x07: val = (s32)r[rt] >> (r[rs] & 31);   break;
+					case 0x20: case 0x21: val = r[rs] + r[rt];     break;
+					case 0x22: case 0x23: val = r[rs] - r[rt];     break;
+					case 0x24: val = r[rs] & r[rt];                break;
+					case 0x25: val = r[rs] | r[rt];                break;
+					case 0x26: val = r[rs] ^ r[rt];                break;
+					case 0x27: val = ~(r[rs] | r[rt]);             break;
+					case 0x2a: val = (s32)r[rs] < (s32)r[rt];      break;
+					case 0x2b: val = r[rs] < r[rt];                break;
+					case 0x10: val = psxRegs.GPR.n.hi;             srcs = 0; break;
+					case 0x12: val = psxRegs.GPR.n.lo;             srcs = 0; break;
+				}
+				break;
+			case 0x08: case 0x09: val = r[rs] + _fImm_(code);        break;
+			case 0x0a: val = (s32)r[rs] < _fImm_(code);             break;
+			case 0x0b: val = r[rs] < (u32)_fImm_(code);             break;
+			case 0x0c: val = r[rs] & _fImmU_(code);                 break;
+			case 0x0d: val = r[rs] | _fImmU_(code);                 break;
+			case 0x0e: val = r[rs] ^ _fImmU_(code);                 break;
+			case 0x0f: val = code << 16;                            break;
+			case 0x10: // MFC0
+				dst = rt;
+				known &= ~(1 << dst);
+				continue;
+			case 0x20: case 0x21: case 0x23: // Loads
+			case 0x24: case 0x25:
+				if (!(known & (1 << rs)) ||
+				    !idleLoopAddressOk(r[rs] + _fImm_(code), max_cycle))
+					return false;
+				dst = rt;
+				known &= ~(1 << dst);
+				continue;
+			default: // Code was modified since psxIdleLoopTest()
+				return false;
+		}
+
+		if (_fOp_(code) != 0x00) {
+			dst = rt;
+			srcs = (_fOp_(code) == 0x0f) ? 0 : (1 << rs);
+		}
+
+		if (dst == 0)
+			continue;
+		if ((known & srcs) == srcs)
+			known |= 1 << dst;
+		else
+			known &= ~(1 << dst);
+		r[dst] = val;
+	}
+
+	return true;
+}
+
+/* Is loop idle, given current state? */
+static bool idleLoopCheck(u32 loop_pc, u32 branch_pc, u32 *max_cycle)
+{
+	if (loop_pc != idle_cache.loop_pc || branch_pc != idle_cache.branch_pc) {
+		idle_cache.loop_pc = loop_pc;
+		idle_cache.branch_pc = branch_pc;
+		idle_cache.idle = psxIdleLoopTest(loop_pc, branch_pc);
+	}
+
+	if (!idle_cache.idle)
+		return false;
+
+	// Pending HW IRQ about to be taken: loop is not going to run again
+	if ((psxHu32(0x1070) & psxHu32(0x1074)) &&
+	    (psxRegs.CP0.n.Status & 0x401) == 0x401)
+		return false;
+
+	// Addresses that aren't OK now are very unlikely to be OK on the next
+	//  iteration. Remember, so loops polling root counters etc. don't
+	//  have their code decoded again on every iteration.
+	if (!idleLoopAddressesOk(loop_pc, branch_pc, max_cycle)) {
+		idle_cache.idle = false;
+		return false;
+	}
+
+	return true;
+}
+
+/* Advance psxRegs.cycle to next event, or to 'max_cycle' if that's sooner */
+static void idleLoopSkip(u32 max_cycle)
+{
+	const u32 next_event = psxRegs.intCycle[PSXINT_NEXT_EVENT].sCycle +
+	                       psxRegs.intCycle[PSXINT_NEXT_EVENT].cycle;
+	u32 target = next_event;
+
+	if ((s32)(max_cycle - target) < 0)
+		target = max_cycle;
+
+	const s32 skip = (s32)(target - psxRegs.cycle);
+	if (skip <= 0)
+		return;
+
+	psxRegs.cycle = target;
+	psxIdleStats.skips++;
+	psxIdleStats.skipped_cycles += skip;
+}
+
+void psxIdleLoopBranch(u32 loop_pc, u32 branch_pc)
+{
+	// Recompiler verification compares cycle counts after each block,
+	//  which fast-forwarding at different points would throw off
+	if (branch_pc - loop_pc >= IDLE_LOOP_MAX_INSNS*4 || Config.RecVerify)
+		return;
+
+	u32 max_cycle = psxRegs.cycle + 0x7fffffff;
+	if (idleLoopCheck(loop_pc, branch_pc, &max_cycle))
+		idleLoopSkip(max_cycle);
+}
+
+void psxIdleLoopBlockEntry(u32 branch_pc, u32 block_cycles)
+{
+	// The block is known to be an idle loop, but is this entry really the
+	//  loop branching back to itself? It is if no other guest code ran since
+	//  last entry (cycles advanced by exactly one pass through the block) and
+	//  no event was dispatched since then (next event is unchanged).
+	const u32 pc = psxRegs.pc;
+	const u32 next_event = psxRegs.intCycle[PSXINT_NEXT_EVENT].sCycle +
+	                       psxRegs.intCycle[PSXINT_NEXT_EVENT].cycle;
+	const bool looped = (!Config.RecVerify &&
+	                     pc == idle_last_entry.pc &&
+	                     psxRegs.cycle - idle_last_entry.cycle == block_cycles &&
+	                     next_event == idle_last_entry.next_event);
+
+	if (looped) {
+		u32 max_cycle = psxRegs.cycle + 0x7fffffff;
+		if (idleLoopCheck(pc, branch_pc, &max_cycle))
+			idleLoopSkip(max_cycle);
+	}
+
+	idle_last_entry.pc = pc;
+	idle_last_entry.cycle = psxRegs.cycle;
+	idle_last_entry.next_event = next_event;
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Idle-loop detection and cycle fast-forward
+ *
+ *  Games often spin in a tiny loop polling I_STAT, GPUSTAT or a RAM flag
+ * that only changes when the next event (VBlank, CD IRQ, DMA completion..)
+ * is dispatched. When such a loop is found to be side-effect free, each
+ * further iteration would be identical until then, so psxRegs.cycle is
+ * advanced straight to the next pending event instead.
+ */
+
+#ifndef PSXIDLE_H
+#define PSXIDLE_H
+
+#include "r3000a.h"
+
+struct psxIdleStats_t {
+	u64 skips;          // Number of times an idle loop was fast-forwarded
+	u64 skipped_cycles; // Total PSX cycles fast-forwarded
+};
+
+extern psxIdleStats_t psxIdleStats;
+
+void psxIdleReset(void);
+void psxIdlePrintStats(void);
+
+// Returns true if loop from 'loop_pc' to the branch at 'branch_pc' (and
+//  its BD slot) is a side-effect free polling loop. Looks at code only.
+bool psxIdleLoopTest(u32 loop_pc, u32 branch_pc);
+
+// Returns PC of the branch closing an idle loop that begins at 'loop_pc'
+//  and branches back to it, or 0 if there's none. Used by recompilers.
+u32 psxIdleLoopFind(u32 loop_pc);
+
+// Interpreter: called when the branch at 'branch_pc' is taken backwards
+//  to 'loop_pc', before its BD slot is executed.
+void psxIdleLoopBranch(u32 loop_pc, u32 branch_pc);
+
+// Recompilers: called on entry to a block that psxIdleLoopFind() found to
+//  be an idle loop closed by the branch at 'branch_pc'. 'block_cycles' is
+//  the number of cycles the block adds to psxRegs.cycle per iteration.
+void psxIdleLoopBlockEntry(u32 branch_pc, u32 block_cycles);
+
+#endif //PSXIDLE_H
@@ -25,6 +25,9 @@
 #include "r3000a.h"
 #include "gte.h"
 #include "psxhle.h"
+#include "psxidle.h"
+#include "psxbioshook.h"
+#include "fastmem.h"
 
 static int branch = 0;
 static int branch2 = 0;
@@ -57,6 +60,9 @@ static void psxJumpTest(void) {
 					biosC0[call]();
 				break;
 		}
+
+		if (bios_hooks_active && psxBiosHookIsVector(psxRegs.pc))
+			psxBiosHookCall(psxRegs.pc);
 	}
 }
 
@@ -431,6 +437,10 @@ static void doBranch(u32 tar) {
 	u32 *code;
 	u32 tmp;
 
+	// Backwards branch: fast-forward if it closes an idle loop
+	if (tar <= psxRegs.pc - 4)
+		psxIdleLoopBranch(tar, psxRegs.pc - 4);
+
 	branch2 = branch = 1;
 	branchPC = tar;
 
@@ -653,6 +663,8 @@ void psxJALR(void) {
 	u32 temp = _u32(_rRs_);
 	if (_Rd_) { _SetLink(_Rd_); }
 	doBranch(temp);
+	if (bios_hooks_active && psxBiosHookIsVector(psxRegs.pc))
+		psxBiosHookCall(psxRegs.pc);
 }
 
 /*********************************************************
@@ -664,41 +676,41 @@ void psxJALR(void) {
 
 void psxLB(void) {
 	if (_Rt_) {
-		_i32(_rRt_) = (signed char)psxMemRead8(_oB_);
+		_i32(_rRt_) = (signed char)psxFastRead8(_oB_);
 	} else {
-		psxMemRead8(_oB_);
+		psxFastRead8(_oB_);
 	}
 }
 
 void psxLBU(void) {
 	if (_Rt_) {
-		_u32(_rRt_) = psxMemRead8(_oB_);
+		_u32(_rRt_) = psxFastRead8(_oB_);
 	} else {
-		psxMemRead8(_oB_);
+		psxFastRead8(_oB_);
 	}
 }
 
 void psxLH(void) {
 	if (_Rt_) {
-		_i32(_rRt_) = (short)psxMemRead16(_oB_);
+		_i32(_rRt_) = (short)psxFastRead16(_oB_);
 	} else {
-		psxMemRead16(_oB_);
+		psxFastRead16(_oB_);
 	}
 }
 
 void psxLHU(void) {
 	if (_Rt_) {
-		_u32(_rRt_) = psxMemRead16(_oB_);
+		_u32(_rRt_) = psxFastRead16(_oB_);
 	} else {
-		psxMemRead16(_oB_);
+		psxFastRead16(_oB_);
 	}
 }
 
 void psxLW(void) {
 	if (_Rt_) {
-		_u32(_rRt_) = psxMemRead32(_oB_);
+		_u32(_rRt_) = psxFastRead32(_oB_);
 	} else {
-		psxMemRead32(_oB_);
+		psxFastRead32(_oB_);
 	}
 }
 
@@ -708,7 +720,7 @@ u32 LWL_SHIFT[4] = { 24, 16, 8, 0 };
 void psxLWL(void) {
 	u32 addr = _oB_;
 	u32 shift = addr & 3;
-	u32 mem = psxMemRead32(addr & ~3);
+	u32 mem = psxFastRead32(addr & ~3);
 
 	if (!_Rt_) return;
 	_u32(_rRt_) =	( _u32(_rRt_) & LWL_MASK[shift]) |
@@ -730,7 +742,7 @@ u32 LWR_SHIFT[4] = { 0, 8, 16, 24 };
 void psxLWR(void) {
 	u32 addr = _oB_;
 	u32 shift = addr & 3;
-	u32 mem = psxMemRead32(addr & ~3);
+	u32 mem = psxFastRead32(addr & ~3);
 
 	if (!_Rt_) return;
 	_u32(_rRt_) =	( _u32(_rRt_) & LWR_MASK[shift]) |
@@ -746,9 +758,9 @@ void psxLWR(void) {
 	*/
 }
 
-void psxSB(void) { psxMemWrite8 (_oB_, _rRt_ &   0xff); }
-void psxSH(void) { psxMemWrite16(_oB_, _rRt_ & 0xffff); }
-void psxSW(void) { psxMemWrite32(_oB_, _rRt_); }
+void psxSB(void) { psxFastWrite8 (_oB_, _rRt_ &   0xff); }
+void psxSH(void) { psxFastWrite16(_oB_, _rRt_ & 0xffff); }
+void psxSW(void) { psxFastWrite32(_oB_, _rRt_); }
 
 u32 SWL_MASK[4] = { 0xffffff00, 0xffff0000, 0xff000000, 0 };
 u32 SWL_SHIFT[4] = { 24, 16, 8, 0 };
@@ -756,9 +768,9 @@ u32 SWL_SHIFT[4] = { 24, 16, 8, 0 };
 void psxSWL(void) {
 	u32 addr = _oB_;
 	u32 shift = addr & 3;
-	u32 mem = psxMemRead32(addr & ~3);
+	u32 mem = psxFastRead32(addr & ~3);
 
-	psxMemWrite32(addr & ~3,  (_u32(_rRt_) >> SWL_SHIFT[shift]) |
+	psxFastWrite32(addr & ~3,  (_u32(_rRt_) >> SWL_SHIFT[shift]) |
 			     (  mem & SWL_MASK[shift]) );
 	/*
 	Mem = 1234.  Reg = abcd
@@ -776,9 +788,9 @@ u32 SWR_SHIFT[4] = { 0, 8, 16, 24 };
 void psxSWR(void) {
 	u32 addr = _oB_;
 	u32 shift = addr & 3;
-	u32 mem = psxMemRead32(addr & ~3);
+	u32 mem = psxFastRead32(addr & ~3);
 
-	psxMemWrite32(addr & ~3,  (_u32(_rRt_) << SWR_SHIFT[shift]) |
+	psxFastWrite32(addr & ~3,  (_u32(_rRt_) << SWR_SHIFT[shift]) |
 			     (  mem & SWR_MASK[shift]) );
 
 	/*
@@ -911,14 +923,23 @@ static void w_##gf()               \
 {                                  \
     gf(psxRegs.code >> 10);        \
 }
-GTE_FUNC_1_ARG_WRAPPER(gteOP)
 GTE_FUNC_1_ARG_WRAPPER(gteDPCS)
 GTE_FUNC_1_ARG_WRAPPER(gteINTPL)
-GTE_FUNC_1_ARG_WRAPPER(gteMVMVA)
-GTE_FUNC_1_ARG_WRAPPER(gteSQR)
 GTE_FUNC_1_ARG_WRAPPER(gteDCPL)
-GTE_FUNC_1_ARG_WRAPPER(gteGPF)
-GTE_FUNC_1_ARG_WRAPPER(gteGPL)
+
+/* Those with a table of versions specialized for each combination of
+ *  parameters (see gte.h) call the right one directly.
+ */
+#define GTE_FUNC_TABLE_WRAPPER(gf, index) \
+static void w_##gf()                      \
+{                                         \
+    gf##Fns[index(psxRegs.code >> 10)](); \
+}
+GTE_FUNC_TABLE_WRAPPER(gteOP, GTE_SF_LM_INDEX)
+GTE_FUNC_TABLE_WRAPPER(gteMVMVA, GTE_MVMVA_INDEX)
+GTE_FUNC_TABLE_WRAPPER(gteSQR, GTE_SF_LM_INDEX)
+GTE_FUNC_TABLE_WRAPPER(gteGPF, GTE_SF_INDEX)
+GTE_FUNC_TABLE_WRAPPER(gteGPL, GTE_SF_INDEX)
 
 /* Anything beginning with 'w_' is a local wrapper func, see note above. */
 void (*psxCP2[64])(void) = {
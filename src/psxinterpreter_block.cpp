@@ -0,0 +1,477 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * PSX assembly interpreter, block-caching variant.
+ *
+ *  Each guest basic block is decoded once into a compact array of
+ * pre-decoded ops and cached by PC. Executing a cached block then skips the
+ * per-instruction fetch through PSXM(), the nested psxBSC[]/psxSPC[]/etc.
+ * table walks and the per-instruction cycle update done by execI().
+ *
+ *  Common ALU/load/store instructions get dedicated handlers that use
+ * pre-extracted register fields. Everything else (branches, jumps, COP0,
+ * GTE, HLE) is run through its regular interpreter handler, so all the
+ * branch-delay and load-delay logic in psxinterpreter.cpp is shared.
+ *
+ *  A block ends after any instruction that can redirect execution: branches,
+ * jumps, SYSCALL/BREAK, COP0 ops and HLE ops. Only that last op of a block
+ * ever reads psxRegs.pc, which lets psxRegs.pc and psxRegs.cycle be set
+ * once per block instead of once per instruction.
+ *
+ *  Blocks are invalidated through the R3000Acpu Clear() hook, using a
+ * code-page bitmap the same way the dynarecs do.
+ */
+
+#include "psxcommon.h"
+#include "r3000a.h"
+#include "psxmem.h"
+#include "fastmem.h"
+#include "psxsmc.h"
+
+/* Uncomment for debug logging to console */
+//#define BLK_LOG printf
+
+#ifndef BLK_LOG
+#define BLK_LOG(...)
+#endif
+
+// Subsets (psxinterpreter.cpp)
+extern void (*psxBSC[64])(void);
+extern void (*psxSPC[64])(void);
+extern void (*psxREG[32])(void);
+extern void (*psxCP0[32])(void);
+extern void (*psxCP2[64])(void);
+extern void (*psxCP2BSC[32])(void);
+
+void execI(void);
+
+/* Max # of instructions decoded into a single block */
+#define BLK_MAX_INSNS   64
+
+/* Size of buffer holding all decoded blocks. When full, it gets flushed. */
+#define BLK_CACHE_SIZE  (4 * 1024 * 1024)
+
+struct IntOp;
+typedef void (*IntOpFunc)(const IntOp *op);
+
+struct IntOp {
+	IntOpFunc func;           // Handler
+	u32       code;           // Raw instruction word
+	union {
+		struct {
+			s16 imm;          // Sign-extended immediate (zero-extend with (u16) cast)
+			u8  rs, rt, rd, sa;
+		} f;                  // Pre-extracted fields, used by fast handlers
+		void (*legacy)(void); // Leaf interpreter handler, used by blkLegacy()
+	};
+};
+
+struct IntBlock {
+	u32   pc;                 // Guest PC of first instruction
+	u32   end_pc;             // Guest PC following last instruction
+	u32   cycles;             // Cycle cost of entire block
+	u32   n_ops;              // # of entries in ops[] (NOPs are not included)
+	IntOp ops[];
+};
+
+/* Pointers to decoded blocks, indexed by word offset into psxM / psxR */
+static IntBlock **blk_ram;
+static IntBlock **blk_rom;
+
+/* Bit vector indicating which PS1 RAM pages contain decoded code.
+ *  Used to determine when invalidation in blkClear() can be skipped.
+ */
+static u8 code_pages[0x200000/4096/8];
+
+static u8  *blk_cache;
+static u32  blk_cache_used;
+
+
+/*********************************************************
+* Fast handlers using pre-extracted fields               *
+*********************************************************/
+#define oRs     psxRegs.GPR.r[op->f.rs]
+#define oRt     psxRegs.GPR.r[op->f.rt]
+#define oRd     psxRegs.GPR.r[op->f.rd]
+#define oImm    ((s32)op->f.imm)
+#define oImmU   ((u32)(u16)op->f.imm)
+#define oAddr   (oRs + oImm)
+
+// NOTE: ALU ops writing to $r0 are never decoded (see blkDecode()),
+//       so these need no '$r0 is destination' checks.
+static void blkADDIU(const IntOp *op) { oRt = oRs + oImm; }
+static void blkANDI(const IntOp *op)  { oRt = oRs & oImmU; }
+static void blkORI(const IntOp *op)   { oRt = oRs | oImmU; }
+static void blkXORI(const IntOp *op)  { oRt = oRs ^ oImmU; }
+static void blkSLTI(const IntOp *op)  { oRt = (s32)oRs < oImm; }
+static void blkSLTIU(const IntOp *op) { oRt = oRs < (u32)oImm; }
+static void blkLUI(const IntOp *op)   { oRt = op->code << 16; }
+
+static void blkADDU(const IntOp *op)  { oRd = oRs + oRt; }
+static void blkSUBU(const IntOp *op)  { oRd = oRs - oRt; }
+static void blkAND(const IntOp *op)   { oRd = oRs & oRt; }
+static void blkOR(const IntOp *op)    { oRd = oRs | oRt; }
+static void blkXOR(const IntOp *op)   { oRd = oRs ^ oRt; }
+static void blkNOR(const IntOp *op)   { oRd = ~(oRs | oRt); }
+static void blkSLT(const IntOp *op)   { oRd = (s32)oRs < (s32)oRt; }
+static void blkSLTU(const IntOp *op)  { oRd = oRs < oRt; }
+
+static void blkSLL(const IntOp *op)   { oRd = oRt << op->f.sa; }
+static void blkSRL(const IntOp *op)   { oRd = oRt >> op->f.sa; }
+static void blkSRA(const IntOp *op)   { oRd = (s32)oRt >> op->f.sa; }
+static void blkSLLV(const IntOp *op)  { oRd = oRt << (oRs & 0x1f); }
+static void blkSRLV(const IntOp *op)  { oRd = oRt >> (oRs & 0x1f); }
+static void blkSRAV(const IntOp *op)  { oRd = (s32)oRt >> (oRs & 0x1f); }
+
+static void blkMFHI(const IntOp *op)  { oRd = psxRegs.GPR.n.hi; }
+static void blkMFLO(const IntOp *op)  { oRd = psxRegs.GPR.n.lo; }
+
+// NOTE: Loads to $r0 are left to the regular handlers, which still do the
+//       read for the sake of any I/O side-effects.
+static void blkLB(const IntOp *op)    { oRt = (s8)psxFastRead8(oAddr); }
+static void blkLBU(const IntOp *op)   { oRt = psxFastRead8(oAddr); }
+static void blkLH(const IntOp *op)    { oRt = (s16)psxFastRead16(oAddr); }
+static void blkLHU(const IntOp *op)   { oRt = psxFastRead16(oAddr); }
+static void blkLW(const IntOp *op)    { oRt = psxFastRead32(oAddr); }
+
+static void blkSB(const IntOp *op)    { psxFastWrite8(oAddr, oRt & 0xff); }
+static void blkSH(const IntOp *op)    { psxFastWrite16(oAddr, oRt & 0xffff); }
+static void blkSW(const IntOp *op)    { psxFastWrite32(oAddr, oRt); }
+
+/* Any other instruction is run by its regular interpreter handler */
+static void blkLegacy(const IntOp *op)
+{
+	psxRegs.code = op->code;
+	op->legacy();
+}
+
+
+/*********************************************************
+* Decoding                                               *
+*********************************************************/
+
+/* Returns the leaf interpreter handler for an instruction */
+static void (*blkLegacyHandler(u32 code))(void)
+{
+	switch (_fOp_(code)) {
+		case 0x00: return psxSPC[_fFunct_(code)];
+		case 0x01: return psxREG[_fRt_(code)];
+		case 0x10: return psxCP0[_fRs_(code)];
+		case 0x12: return _fFunct_(code) ? psxCP2[_fFunct_(code)]
+		                                 : psxCP2BSC[_fRs_(code)];
+		default:   return psxBSC[_fOp_(code)];
+	}
+}
+
+/* Returns true if instruction can redirect execution, ending a block */
+static bool blkEndsBlock(u32 code)
+{
+	switch (_fOp_(code)) {
+		case 0x00: // SPECIAL
+			switch (_fFunct_(code)) {
+				case 0x08: case 0x09: // JR/JALR
+				case 0x0c: case 0x0d: // SYSCALL/BREAK
+					return true;
+			}
+			return false;
+		case 0x01:                     // REGIMM
+		case 0x02: case 0x03:          // J/JAL
+		case 0x04: case 0x05:          // BEQ/BNE
+		case 0x06: case 0x07:          // BLEZ/BGTZ
+		case 0x10:                     // COP0 (MTC0 can raise exceptions)
+		case 0x3b:                     // HLE
+			return true;
+	}
+	return false;
+}
+
+/* Returns fast handler for instruction, or NULL if there is none.
+ *  Sets '*is_nop' if instruction has no effect and can be skipped.
+ */
+static IntOpFunc blkFastHandler(u32 code, bool *is_nop)
+{
+	const u32 rt = _fRt_(code), rd = _fRd_(code);
+	*is_nop = false;
+
+	switch (_fOp_(code)) {
+		case 0x00: // SPECIAL
+			switch (_fFunct_(code)) {
+				case 0x00: *is_nop = (rd == 0); return blkSLL;
+				case 0x02: *is_nop = (rd == 0); return blkSRL;
+				case 0x03: *is_nop = (rd == 0); return blkSRA;
+				case 0x04: *is_nop = (rd == 0); return blkSLLV;
+				case 0x06: *is_nop = (rd == 0); return blkSRLV;
+				case 0x07: *is_nop = (rd == 0); return blkSRAV;
+				case 0x10: *is_nop = (rd == 0); return blkMFHI;
+				case 0x12: *is_nop = (rd == 0); return blkMFLO;
+				case 0x20: case 0x21: *is_nop = (rd == 0); return blkADDU; // ADD/ADDU
+				case 0x22: case 0x23: *is_nop = (rd == 0); return blkSUBU; // SUB/SUBU
+				case 0x24: *is_nop = (rd == 0); return blkAND;
+				case 0x25: *is_nop = (rd == 0); return blkOR;
+				case 0x26: *is_nop = (rd == 0); return blkXOR;
+				case 0x27: *is_nop = (rd == 0); return blkNOR;
+				case 0x2a: *is_nop = (rd == 0); return blkSLT;
+				case 0x2b: *is_nop = (rd == 0); return blkSLTU;
+			}
+			return NULL;
+		case 0x08: case 0x09: *is_nop = (rt == 0); return blkADDIU; // ADDI/ADDIU
+		case 0x0a: *is_nop = (rt == 0); return blkSLTI;
+		case 0x0b: *is_nop = (rt == 0); return blkSLTIU;
+		case 0x0c: *is_nop = (rt == 0); return blkANDI;
+		case 0x0d: *is_nop = (rt == 0); return blkORI;
+		case 0x0e: *is_nop = (rt == 0); return blkXORI;
+		case 0x0f: *is_nop = (rt == 0); return blkLUI;
+		case 0x20: return rt ? blkLB  : NULL;
+		case 0x21: return rt ? blkLH  : NULL;
+		case 0x23: return rt ? blkLW  : NULL;
+		case 0x24: return rt ? blkLBU : NULL;
+		case 0x25: return rt ? blkLHU : NULL;
+		case 0x28: return blkSB;
+		case 0x29: return blkSH;
+		case 0x2b: return blkSW;
+	}
+	return NULL;
+}
+
+/* Returns pointer to block-ptr slot for 'pc', or NULL if 'pc' doesn't lie
+ *  in RAM or ROM. Lookup goes through psxMemRLUT[], so mirrors are handled.
+ */
+static inline IntBlock **blkSlot(u32 pc)
+{
+	const u8 *p = PSXM(pc);
+	uptr ram_off = (uptr)p - (uptr)psxM;
+	uptr rom_off = (uptr)p - (uptr)psxR;
+	if (ram_off < 0x200000)
+		return &blk_ram[ram_off / 4];
+	if (rom_off < 0x80000)
+		return &blk_rom[rom_off / 4];
+	return NULL;
+}
+
+static void blkFlush()
+{
+	memset(blk_ram, 0, (0x200000/4) * sizeof(IntBlock *));
+	memset(blk_rom, 0, (0x80000/4) * sizeof(IntBlock *));
+	memset(code_pages, 0, sizeof(code_pages));
+	blk_cache_used = 0;
+	psxSmcReset();
+}
+
+static IntBlock *blkDecode(u32 start_pc, IntBlock **slot)
+{
+	const u32 max_size = sizeof(IntBlock) + BLK_MAX_INSNS * sizeof(IntOp);
+	if (blk_cache_used + max_size > BLK_CACHE_SIZE) {
+		BLK_LOG("Block cache full: flushing.\n");
+		blkFlush();
+	}
+
+	IntBlock *blk = (IntBlock *)(blk_cache + blk_cache_used);
+	u32 pc = start_pc;
+	u32 n_insns = 0, n_ops = 0;
+	bool end_block;
+
+	do {
+		const u32 code = PSXMu32(pc);
+		IntOp *op = &blk->ops[n_ops];
+		bool is_nop;
+
+		pc += 4;
+		n_insns++;
+		end_block = blkEndsBlock(code);
+
+		IntOpFunc fast = end_block ? NULL : blkFastHandler(code, &is_nop);
+		if (fast && is_nop)
+			continue;
+
+		op->code = code;
+		if (fast) {
+			op->func = fast;
+			op->f.imm = _fImm_(code);
+			op->f.rs  = _fRs_(code);
+			op->f.rt  = _fRt_(code);
+			op->f.rd  = _fRd_(code);
+			op->f.sa  = _fSa_(code);
+		} else {
+			op->func = blkLegacy;
+			op->legacy = blkLegacyHandler(code);
+		}
+		n_ops++;
+
+		// Stop at 64KB boundaries, which psxMemRLUT[] mirroring is based on
+		if ((pc & 0xffff) == 0)
+			end_block = true;
+	} while (!end_block && n_insns < BLK_MAX_INSNS);
+
+	blk->pc = start_pc;
+	blk->end_pc = pc;
+	blk->cycles = n_insns * BIAS;
+	blk->n_ops = n_ops;
+	blk_cache_used += (sizeof(IntBlock) + n_ops * sizeof(IntOp) + 7) & ~7;
+
+	// If block lies in RAM, mark the pages it covers as containing code
+	if (slot >= blk_ram && slot < blk_ram + 0x200000/4) {
+		u32 first_page = (slot - blk_ram) * 4 / 4096;
+		u32 last_page = ((slot - blk_ram) * 4 + n_insns * 4 - 1) / 4096;
+		for (u32 page = first_page; page <= last_page; ++page)
+			code_pages[page/8] |= 1 << (page & 7);
+		psxSmcProtect(start_pc, pc);
+	}
+
+	*slot = blk;
+	return blk;
+}
+
+
+/*********************************************************
+* Execution                                              *
+*********************************************************/
+static inline void blkRun(const IntBlock *blk)
+{
+	const IntOp *op = blk->ops;
+	const IntOp *end = op + blk->n_ops;
+
+	// Only the last op in a block can read psxRegs.pc, so set it once here.
+	psxRegs.pc = blk->end_pc;
+	psxRegs.cycle += blk->cycles;
+
+	// NOTE: Last op might reenter the CPU core (HLE BIOS softcalls) and cause
+	//       a cache flush. Don't touch 'blk' after running ops.
+	for (; op != end; ++op)
+		op->func(op);
+}
+
+static inline const IntBlock *blkLookup(u32 pc)
+{
+	IntBlock **slot = blkSlot(pc);
+	if (!slot)
+		return NULL;
+	IntBlock *blk = *slot;
+	if (!blk)
+		blk = blkDecode(pc, slot);
+	return blk;
+}
+
+static int blkInit(void)
+{
+	blk_ram = (IntBlock **)calloc(0x200000/4, sizeof(IntBlock *));
+	blk_rom = (IntBlock **)calloc(0x80000/4, sizeof(IntBlock *));
+	blk_cache = (u8 *)malloc(BLK_CACHE_SIZE);
+	if (!blk_ram || !blk_rom || !blk_cache) {
+		printf("Error allocating memory for block interpreter\n");
+		return -1;
+	}
+	blkFlush();
+	return 0;
+}
+
+static void blkReset(void)
+{
+	blkFlush();
+}
+
+static void blkExecute(void)
+{
+	for (;;) {
+		const IntBlock *blk = blkLookup(psxRegs.pc);
+		if (blk)
+			blkRun(blk);
+		else
+			execI();
+	}
+}
+
+static void blkExecuteBlock(unsigned target_pc)
+{
+	do {
+		const IntBlock *blk = blkLookup(psxRegs.pc);
+
+		// If 'target_pc' lies past the start of the block, step through it
+		//  using the regular interpreter so we stop exactly at 'target_pc'.
+		if (blk && !(target_pc > blk->pc && target_pc < blk->end_pc))
+			blkRun(blk);
+		else
+			execI();
+	} while (psxRegs.pc != target_pc);
+}
+
+/* Invalidate decoded blocks overlapping 'Size' words at address 'Addr'. */
+static void blkClear(u32 Addr, u32 Size)
+{
+	const u32 masked_ram_addr = Addr & 0x1ffffc;
+
+	if (Size == 0)
+		return;
+
+	// Check if the page(s) of PS1 RAM that 'Addr','Size' target contain
+	//  any decoded code. If not, invalidation can be skipped.
+	u32 page = masked_ram_addr/4096;
+	u32 end_page = ((masked_ram_addr + (Size-1)*4)/4096) + 1;
+	bool has_code = false;
+	do {
+		u32 pflag = 1 << (page & 7);  // Each byte in code_pages[] represents 8 pages
+		has_code = code_pages[page/8] & pflag;
+	} while ((++page != end_page) && !has_code);
+
+	if (!has_code)
+		return;
+
+	u32 start = masked_ram_addr / 4;
+	u32 end = start + Size;
+	if (end > 0x200000/4)
+		end = 0x200000/4;
+
+	// Blocks starting up to BLK_MAX_INSNS-1 words before 'Addr' can overlap
+	u32 i = (start >= BLK_MAX_INSNS-1) ? start - (BLK_MAX_INSNS-1) : 0;
+	for (; i < start; ++i) {
+		IntBlock *blk = blk_ram[i];
+		if (blk && (i + (blk->end_pc - blk->pc) / 4) > start)
+			blk_ram[i] = NULL;
+	}
+
+	memset(&blk_ram[start], 0, (end - start) * sizeof(IntBlock *));
+}
+
+static void blkNotify(int note, void *data)
+{
+	switch (note)
+	{
+		case R3000ACPU_NOTIFY_CACHE_UNISOLATED:
+			// Game or BIOS has finished invalidating Icache lines
+			blkClear(0, 0x200000/4);
+			break;
+		default:
+			break;
+	}
+}
+
+static void blkShutdown(void)
+{
+	free(blk_ram);    blk_ram = NULL;
+	free(blk_rom);    blk_rom = NULL;
+	free(blk_cache);  blk_cache = NULL;
+}
+
+R3000Acpu psxIntBlock = {
+	blkInit,
+	blkReset,
+	blkExecute,
+	blkExecuteBlock,
+	blkClear,
+	blkNotify,
+	blkShutdown
+};
@@ -0,0 +1,252 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * PSX assembly interpreter, threaded-dispatch variant.
+ *
+ *  Instead of calling through psxBSC[]/psxSPC[] for every instruction, the
+ * whole fetch/decode/execute loop lives in one function and each opcode
+ * handler ends by fetching the next instruction and jumping straight to its
+ * handler through a table of label addresses (GCC 'computed goto'). This
+ * gives every handler its own indirect jump, which the host's branch
+ * predictor handles much better than the single shared indirect call in
+ * execI(), and removes call/return overhead. Makefiles build this file with
+ * -fno-crossjumping, without which GCC merges the per-handler dispatch
+ * jumps back into a single one.
+ *
+ *  Common ALU, shift, mult/div, load and store instructions are handled
+ * inline. Branches, jumps, COP0, GTE, HLE and the unaligned loads/stores go
+ * through the regular handlers in psxinterpreter.cpp, so branch-delay and
+ * load-delay behavior is shared with psxInt.
+ */
+
+#include "psxcommon.h"
+#include "r3000a.h"
+#include "psxmem.h"
+#include "fastmem.h"
+
+// Subsets (psxinterpreter.cpp)
+extern void (*psxBSC[64])(void);
+extern void (*psxSPC[64])(void);
+
+/* Never a valid (word-aligned) PC, used as 'target_pc' to run forever */
+#define THR_NO_TARGET 0xffffffff
+
+#define tRs     psxRegs.GPR.r[_fRs_(code)]
+#define tRt     psxRegs.GPR.r[_fRt_(code)]
+#define tRd     psxRegs.GPR.r[_fRd_(code)]
+#define tImm    ((s32)_fImm_(code))
+#define tImmU   ((u32)_fImmU_(code))
+#define tAddr   (tRs + tImm)
+
+static void thrRun(u32 target_pc)
+{
+	static const void *const bsc[64] = {
+		&&SPECIAL, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY,
+		&&ADDIU,   &&ADDIU,      &&SLTI,       &&SLTIU,      &&ANDI,       &&ORI,        &&XORI,       &&LUI,
+		&&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY,
+		&&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY,
+		&&LB,      &&LH,         &&BSC_LEGACY, &&LW,         &&LBU,        &&LHU,        &&BSC_LEGACY, &&BSC_LEGACY,
+		&&SB,      &&SH,         &&BSC_LEGACY, &&SW,         &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY,
+		&&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY,
+		&&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY, &&BSC_LEGACY
+	};
+
+	static const void *const spc[64] = {
+		&&SLL,     &&SPC_LEGACY, &&SRL,        &&SRA,        &&SLLV,       &&SPC_LEGACY, &&SRLV,       &&SRAV,
+		&&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY,
+		&&MFHI,    &&MTHI,       &&MFLO,       &&MTLO,       &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY,
+		&&MULT,    &&MULTU,      &&DIV,        &&DIVU,       &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY,
+		&&ADDU,    &&ADDU,       &&SUBU,       &&SUBU,       &&AND,        &&OR,         &&XOR,        &&NOR,
+		&&SPC_LEGACY, &&SPC_LEGACY, &&SLT,     &&SLTU,       &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY,
+		&&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY,
+		&&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY, &&SPC_LEGACY
+	};
+
+	// PC is kept in a local and only written back to psxRegs.pc around
+	//  regular handler calls, which are the only code that reads it.
+	//  Likewise, psxRegs.code is only set for their sake.
+	u32 pc = psxRegs.pc;
+	u32 code;
+
+// Fetch next instruction and jump to its handler
+#define FETCH() \
+	do { \
+		code = PSXMu32(pc); \
+		pc += 4; \
+		psxRegs.cycle += BIAS; \
+		goto *bsc[code >> 26]; \
+	} while (0)
+
+// Same, unless 'target_pc' is reached. Writes to $r0 are allowed by
+//  handlers and undone here.
+#define DISPATCH() \
+	do { \
+		psxRegs.GPR.r[0] = 0; \
+		if (pc == target_pc) { psxRegs.pc = pc; return; } \
+		FETCH(); \
+	} while (0)
+
+// Call regular interpreter handler
+#define CALL_LEGACY(func) \
+	do { \
+		psxRegs.code = code; \
+		psxRegs.pc = pc; \
+		func(); \
+		pc = psxRegs.pc; \
+	} while (0)
+
+	// NOTE: psxExecuteBios() and HLE softcalls expect at least one
+	//       instruction to be run, even if PC starts at 'target_pc'.
+	FETCH();
+
+SPECIAL:    goto *spc[_fFunct_(code)];
+
+	// Anything not handled inline: branches, jumps, COP0/COP2, HLE, etc.
+BSC_LEGACY: CALL_LEGACY(psxBSC[code >> 26]);       DISPATCH();
+SPC_LEGACY: CALL_LEGACY(psxSPC[_fFunct_(code)]);   DISPATCH();
+
+	// Arithmetic with immediate operand
+ADDIU:      tRt = tRs + tImm;             DISPATCH();
+SLTI:       tRt = (s32)tRs < tImm;        DISPATCH();
+SLTIU:      tRt = tRs < (u32)tImm;        DISPATCH();
+ANDI:       tRt = tRs & tImmU;            DISPATCH();
+ORI:        tRt = tRs | tImmU;            DISPATCH();
+XORI:       tRt = tRs ^ tImmU;            DISPATCH();
+LUI:        tRt = code << 16;             DISPATCH();
+
+	// Register arithmetic
+ADDU:       tRd = tRs + tRt;              DISPATCH();
+SUBU:       tRd = tRs - tRt;              DISPATCH();
+AND:        tRd = tRs & tRt;              DISPATCH();
+OR:         tRd = tRs | tRt;              DISPATCH();
+XOR:        tRd = tRs ^ tRt;              DISPATCH();
+NOR:        tRd = ~(tRs | tRt);           DISPATCH();
+SLT:        tRd = (s32)tRs < (s32)tRt;    DISPATCH();
+SLTU:       tRd = tRs < tRt;              DISPATCH();
+
+	// Shifts
+SLL:        tRd = tRt << _fSa_(code);             DISPATCH();
+SRL:        tRd = tRt >> _fSa_(code);             DISPATCH();
+SRA:        tRd = (s32)tRt >> _fSa_(code);        DISPATCH();
+SLLV:       tRd = tRt << (tRs & 0x1f);            DISPATCH();
+SRLV:       tRd = tRt >> (tRs & 0x1f);            DISPATCH();
+SRAV:       tRd = (s32)tRt >> (tRs & 0x1f);       DISPATCH();
+
+	// Moves from/to HI/LO
+MFHI:       tRd = psxRegs.GPR.n.hi;       DISPATCH();
+MFLO:       tRd = psxRegs.GPR.n.lo;       DISPATCH();
+MTHI:       psxRegs.GPR.n.hi = tRs;       DISPATCH();
+MTLO:       psxRegs.GPR.n.lo = tRs;       DISPATCH();
+
+	// Multiply and divide
+MULT:
+	{
+		u64 res = (s64)(s32)tRs * (s64)(s32)tRt;
+		psxRegs.GPR.n.lo = (u32)res;
+		psxRegs.GPR.n.hi = (u32)(res >> 32);
+	}
+	DISPATCH();
+
+MULTU:
+	{
+		u64 res = (u64)tRs * (u64)tRt;
+		psxRegs.GPR.n.lo = (u32)res;
+		psxRegs.GPR.n.hi = (u32)(res >> 32);
+	}
+	DISPATCH();
+
+DIV:
+	{
+		s32 rs = tRs, rt = tRt;
+		if (rt == 0) {
+			psxRegs.GPR.n.lo = rs >= 0 ? 0xffffffff : 1;
+			psxRegs.GPR.n.hi = rs;
+		} else if (rt == -1 && (u32)rs == 0x80000000) {
+			// Would trap on some hosts
+			psxRegs.GPR.n.lo = 0x80000000;
+			psxRegs.GPR.n.hi = 0;
+		} else {
+			psxRegs.GPR.n.lo = rs / rt;
+			psxRegs.GPR.n.hi = rs % rt;
+		}
+	}
+	DISPATCH();
+
+DIVU:
+	{
+		u32 rs = tRs, rt = tRt;
+		if (rt == 0) {
+			psxRegs.GPR.n.lo = 0xffffffff;
+			psxRegs.GPR.n.hi = rs;
+		} else {
+			psxRegs.GPR.n.lo = rs / rt;
+			psxRegs.GPR.n.hi = rs % rt;
+		}
+	}
+	DISPATCH();
+
+	// Loads and stores
+	// NOTE: A load into $r0 still does the read (I/O side-effects), and
+	//       the result is discarded by DISPATCH().
+LB:         tRt = (s8)psxFastRead8(tAddr);         DISPATCH();
+LBU:        tRt = psxFastRead8(tAddr);             DISPATCH();
+LH:         tRt = (s16)psxFastRead16(tAddr);       DISPATCH();
+LHU:        tRt = psxFastRead16(tAddr);            DISPATCH();
+LW:         tRt = psxFastRead32(tAddr);            DISPATCH();
+SB:         psxFastWrite8(tAddr, tRt & 0xff);      DISPATCH();
+SH:         psxFastWrite16(tAddr, tRt & 0xffff);   DISPATCH();
+SW:         psxFastWrite32(tAddr, tRt);            DISPATCH();
+
+#undef CALL_LEGACY
+#undef DISPATCH
+#undef FETCH
+}
+
+static int thrInit(void) {
+	return 0;
+}
+
+static void thrReset(void) {
+}
+
+static void thrExecute(void) {
+	thrRun(THR_NO_TARGET);
+}
+
+static void thrExecuteBlock(unsigned target_pc) {
+	thrRun(target_pc);
+}
+
+static void thrClear(u32 Addr, u32 Size) {
+}
+
+static void thrNotify(int note, void *data) {
+}
+
+static void thrShutdown(void) {
+}
+
+R3000Acpu psxIntThreaded = {
+	thrInit,
+	thrReset,
+	thrExecute,
+	thrExecuteBlock,
+	thrClear,
+	thrNotify,
+	thrShutdown
+};
@@ -28,9 +28,10 @@
 #include "psxmem.h"
 #include "r3000a.h"
 #include "psxhw.h"
-
-/* Uncomment for memory statistics (for development purposes) */
-//#define DEBUG_MEM_STATS
+#include "fastmem.h"
+#include "psxsmc.h"
+#include "psxmemstats.h"
+#include "psxverify.h"
 
 /* Uncomment for debug logging to console */
 //#define PSXMEM_LOG printf
@@ -39,23 +40,6 @@
 #define PSXMEM_LOG(...)
 #endif
 
-enum MemstatType   { MEMSTAT_TYPE_READ, MEMSTAT_TYPE_WRITE, MEMSTAT_TYPE_COUNT };
-enum MemstatWidth  { MEMSTAT_WIDTH_8, MEMSTAT_WIDTH_16, MEMSTAT_WIDTH_32, MEMSTAT_WIDTH_COUNT };
-enum MemstatRegion { MEMSTAT_REGION_ANY, MEMSTAT_REGION_RAM, MEMSTAT_REGION_BLOCKED,
-                     MEMSTAT_REGION_PPORT, MEMSTAT_REGION_SCRATCHPAD, MEMSTAT_REGION_HW,
-                     MEMSTAT_REGION_ROM, MEMSTAT_REGION_CACHE, MEMSTAT_REGION_COUNT };
-#ifdef DEBUG_MEM_STATS
-static void memstats_reset();
-static void memstats_print();
-static void memstats_add_read(u32 addr, MemstatWidth width);
-static void memstats_add_write(u32 addr, MemstatWidth width);
-#else
-static inline void memstats_reset() {}
-static inline void memstats_print() {}
-static inline void memstats_add_read(u32 addr, MemstatWidth width) {}
-static inline void memstats_add_write(u32 addr, MemstatWidth width) {}
-#endif // DEBUG_MEM_STATS
-
 s8 *psxM;
 s8 *psxP;
 s8 *psxR;
@@ -65,8 +49,26 @@ bool psxP_allocated;
 bool psxR_allocated;
 bool psxH_allocated;
 
+#ifdef USE_COMPACT_MEMLUT
+u8 **psxMemWLUT[0x100];
+u8 **psxMemRLUT[0x100];
+
+// Second-level LUT pages, each mapping 256 64KB chunks of a 16MB segment
+enum {
+	MEMLUT_R_NULL,  // Unmapped: reads return zeros from psxNULLread
+	MEMLUT_R_RAM,   // 0x00xx,0x80xx,0xa0xx: RAM and its mirrors
+	MEMLUT_R_1F,    // 0x1fxx: parallel port, scratchpad/HW, BIOS
+	MEMLUT_R_9F,    // 0x9fxx,0xbfxx: BIOS
+	MEMLUT_W_NULL,  // Unmapped: NULL, writes are ignored
+	MEMLUT_W_RAM,
+	MEMLUT_W_1F,
+	MEMLUT_PAGES
+};
+static u8 *memlut_pages[MEMLUT_PAGES][0x100];
+#else
 u8 **psxMemWLUT;
 u8 **psxMemRLUT;
+#endif
 
 static u8 *psxNULLread;
 
@@ -87,12 +89,46 @@ static u8 *psxNULLread;
 0xbfc0_0000-0xbfc7_ffff		BIOS (512K)
 */
 
+/* Point the 8MB of RAM mirrors in KUSEG, KSEG0 and KSEG1 at 2MB 'ram' in
+ *  the read or write LUT, or unmap them if 'ram' is NULL. */
+static void psxMemMapRAM(bool write, u8 *ram)
+{
+	static const u32 segs[] = { 0x0000, 0x8000, 0xa000 };
+	for (int i = 0; i < 0x80; i++) {
+		u8 *p = ram ? ram + ((i & 0x1f) << 16) : NULL;
+		for (int j = 0; j < 3; j++) {
+			if (write)
+				psxMemWLUTEntry(segs[j] + i) = p;
+			else
+				psxMemRLUTEntry(segs[j] + i) = p;
+		}
+	}
+}
+
 int psxMemInit()
 {
 	int i;
 
+#ifdef USE_COMPACT_MEMLUT
+	memset(memlut_pages, 0, sizeof(memlut_pages));
+	for (i = 0; i < 0x100; i++) {
+		psxMemRLUT[i] = memlut_pages[MEMLUT_R_NULL];
+		psxMemWLUT[i] = memlut_pages[MEMLUT_W_NULL];
+	}
+	psxMemRLUT[0x00] = psxMemRLUT[0x80] = psxMemRLUT[0xa0] = memlut_pages[MEMLUT_R_RAM];
+	psxMemWLUT[0x00] = psxMemWLUT[0x80] = psxMemWLUT[0xa0] = memlut_pages[MEMLUT_W_RAM];
+	psxMemRLUT[0x1f] = memlut_pages[MEMLUT_R_1F];
+	psxMemWLUT[0x1f] = memlut_pages[MEMLUT_W_1F];
+	psxMemRLUT[0x9f] = psxMemRLUT[0xbf] = memlut_pages[MEMLUT_R_9F];
+#else
 	if (psxMemRLUT == NULL) { psxMemRLUT = (u8 **)calloc(0x10000, sizeof(void *)); }
 	if (psxMemWLUT == NULL) { psxMemWLUT = (u8 **)calloc(0x10000, sizeof(void *)); }
+
+	if (psxMemRLUT == NULL || psxMemWLUT == NULL) {
+		printf("Error allocating memory!");
+		return -1;
+	}
+#endif
 	if (psxNULLread == NULL) { psxNULLread = (u8*)calloc(0x10000, 1); }
 
 	// If a dynarec hasn't already mmap'd any of psxM,psxP,psxH,psxR, allocate
@@ -100,6 +136,20 @@ int psxMemInit()
 	//  status: Dynarecs could choose to mmap 'psxM' pointer to address 0,
 	//  making a standard pointer NULLness check inappropriate.
 
+#ifdef USE_FASTMEM
+	// Map psxM,psxH,psxR into the fastmem guest address space, unless a
+	//  dynarec has already mapped them itself. Not when collecting memory
+	//  stats: interpreter accesses must go through psxMemRead*() etc.
+	if (!psxM_allocated && !psxH_allocated && !psxR_allocated && !Config.MemStats)
+		fastmem_init();
+#endif
+
+#ifdef USE_SMC_PROTECT
+	// Code pages of RAM get write-protected, so it must be page-aligned
+	if (!psxM_allocated && posix_memalign((void **)&psxM, 4096, 0x200000) == 0)
+		psxM_allocated = true;
+#endif
+
 	// Allocate 2MB for PSX RAM
 	if (!psxM_allocated) { psxM = (s8*)malloc(0x200000);  psxM_allocated = psxM != NULL; }
 
@@ -112,7 +162,7 @@ int psxMemInit()
 	// Allocate 512KB for PSX ROM 0xbfc0_0000 region
 	if (!psxR_allocated) { psxR = (s8*)malloc(0x80000);   psxR_allocated = psxR != NULL; }
 
-	if (psxMemRLUT == NULL || psxMemWLUT == NULL || psxNULLread == NULL ||
+	if (psxNULLread == NULL ||
 	    !psxM_allocated || !psxP_allocated || !psxR_allocated || !psxH_allocated)
 	{
 		printf("Error allocating memory!");
@@ -120,27 +170,29 @@ int psxMemInit()
 	}
 
 // MemR
-	for (i = 0; i< 0x10000; i++) psxMemRLUT[i]=psxNULLread;
-	for (i = 0; i < 0x80; i++) psxMemRLUT[i + 0x0000] = (u8 *)&psxM[(i & 0x1f) << 16];
+	for (i = 0; i < 0x10000; i++) psxMemRLUTEntry(i) = psxNULLread;
+	psxMemMapRAM(false, (u8 *)psxM);
 
-	memcpy(psxMemRLUT + 0x8000, psxMemRLUT, 0x80 * sizeof(void *));
-	memcpy(psxMemRLUT + 0xa000, psxMemRLUT, 0x80 * sizeof(void *));
+	psxMemRLUTEntry(0x1f00) = (u8 *)psxP;
+	psxMemRLUTEntry(0x1f80) = (u8 *)psxH;
 
-	psxMemRLUT[0x1f00] = (u8 *)psxP;
-	psxMemRLUT[0x1f80] = (u8 *)psxH;
+	for (i = 0; i < 0x08; i++) {
+		psxMemRLUTEntry(i + 0x1fc0) = (u8 *)&psxR[i << 16];
+		psxMemRLUTEntry(i + 0x9fc0) = (u8 *)&psxR[i << 16];
+		psxMemRLUTEntry(i + 0xbfc0) = (u8 *)&psxR[i << 16];
+	}
 
-	for (i = 0; i < 0x08; i++) psxMemRLUT[i + 0x1fc0] = (u8 *)&psxR[i << 16];
+// MemW
+	psxMemMapRAM(true, (u8 *)psxM);
 
-	memcpy(psxMemRLUT + 0x9fc0, psxMemRLUT + 0x1fc0, 0x08 * sizeof(void *));
-	memcpy(psxMemRLUT + 0xbfc0, psxMemRLUT + 0x1fc0, 0x08 * sizeof(void *));
+	psxMemWLUTEntry(0x1f00) = (u8 *)psxP;
+	psxMemWLUTEntry(0x1f80) = (u8 *)psxH;
 
-// MemW
-	for (i = 0; i < 0x80; i++) psxMemWLUT[i + 0x0000] = (u8 *)&psxM[(i & 0x1f) << 16];
-	memcpy(psxMemWLUT + 0x8000, psxMemWLUT, 0x80 * sizeof(void *));
-	memcpy(psxMemWLUT + 0xa000, psxMemWLUT, 0x80 * sizeof(void *));
+	// Detect writes to RAM holding code with page protection, if possible
+	psxSmcInit();
 
-	psxMemWLUT[0x1f00] = (u8 *)psxP;
-	psxMemWLUT[0x1f80] = (u8 *)psxH;
+	// Runtime memory access statistics, if enabled in Config
+	psxMemStatsInit();
 
 	return 0;
 }
@@ -153,7 +205,7 @@ void psxMemReset()
 	FILE *f = NULL;
 	char bios[MAXPATHLEN];
 
-	memstats_reset();
+	psxMemStatsReset();
 
 	memset(psxM, 0, 0x200000);
 	memset(psxP, 0, 0x10000);
@@ -211,16 +263,24 @@ void psxMemReset()
 
 void psxMemShutdown()
 {
+	psxSmcShutdown();
+
+#ifdef USE_FASTMEM
+	fastmem_shutdown();
+#endif
+
 	if (psxM_allocated) { free(psxM);  psxM = NULL;  psxM_allocated = false; }
 	if (psxP_allocated) { free(psxP);  psxP = NULL;  psxP_allocated = false; }
 	if (psxH_allocated) { free(psxH);  psxH = NULL;  psxH_allocated = false; }
 	if (psxR_allocated) { free(psxR);  psxR = NULL;  psxR_allocated = false; }
 
+#ifndef USE_COMPACT_MEMLUT
 	free(psxMemRLUT);   psxMemRLUT = NULL;
 	free(psxMemWLUT);   psxMemWLUT = NULL;
+#endif
 	free(psxNULLread);  psxNULLread = NULL;
 
-	memstats_print();
+	psxMemStatsShutdown();
 }
 
 u8 psxMemRead8(u32 mem)
@@ -232,10 +292,12 @@ u8 psxMemRead8(u32 mem)
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if (m < 0x400)
 			ret = psxHu8(mem);
-		else
+		else if (!verify_hw_active)
 			ret = psxHwRead8(mem);
+		else
+			ret = psxVerifyHwRead(mem, 1);
 	} else {
-		u8 *p = (u8*)(psxMemRLUT[t]);
+		u8 *p = (u8*)(psxMemRLUTEntry(t));
 		if (p != NULL) {
 			return *(u8*)(p + m);
 		} else {
@@ -256,10 +318,12 @@ u16 psxMemRead16(u32 mem)
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if (m < 0x400)
 			ret = psxHu16(mem);
-		else
+		else if (!verify_hw_active)
 			ret = psxHwRead16(mem);
+		else
+			ret = psxVerifyHwRead(mem, 2);
 	} else {
-		u8 *p = (u8*)(psxMemRLUT[t]);
+		u8 *p = (u8*)(psxMemRLUTEntry(t));
 		if (p != NULL) {
 			ret = SWAPu16(*(u16*)(p + m));
 		} else {
@@ -280,10 +344,12 @@ u32 psxMemRead32(u32 mem)
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if (m < 0x400)
 			ret = psxHu32(mem);
-		else
+		else if (!verify_hw_active)
 			ret = psxHwRead32(mem);
+		else
+			ret = psxVerifyHwRead(mem, 4);
 	} else {
-		u8 *p = (u8*)(psxMemRLUT[t]);
+		u8 *p = (u8*)(psxMemRLUTEntry(t));
 		if (p != NULL) {
 			ret = SWAPu32(*(u32*)(p + m));
 		} else {
@@ -303,15 +369,15 @@ void psxMemWrite8(u32 mem, u8 value)
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if (m < 0x400)
 			psxHu8(mem) = value;
-		else
+		else if (!verify_hw_active)
 			psxHwWrite8(mem, value);
+		else
+			psxVerifyHwWrite(mem, value, 1);
 	} else {
-		u8 *p = (u8*)(psxMemWLUT[t]);
+		u8 *p = (u8*)(psxMemWLUTEntry(t));
 		if (p != NULL) {
 			*(u8*)(p + m) = value;
-#ifdef PSXREC
 			psxCpu->Clear((mem & (~3)), 1);
-#endif
 		} else {
 			PSXMEM_LOG("%s(): err sb 0x%08x\n", __func__, mem);
 		}
@@ -326,15 +392,15 @@ void psxMemWrite16(u32 mem, u16 value)
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if (m < 0x400)
 			psxHu16ref(mem) = SWAPu16(value);
-		else
+		else if (!verify_hw_active)
 			psxHwWrite16(mem, value);
+		else
+			psxVerifyHwWrite(mem, value, 2);
 	} else {
-		u8 *p = (u8*)(psxMemWLUT[t]);
+		u8 *p = (u8*)(psxMemWLUTEntry(t));
 		if (p != NULL) {
 			*(u16*)(p + m) = SWAPu16(value);
-#ifdef PSXREC
 			psxCpu->Clear((mem & (~3)), 1);
-#endif
 		} else {
 			PSXMEM_LOG("%s(): err sh 0x%08x\n", __func__, mem);
 		}
@@ -349,24 +415,25 @@ void psxMemWrite32(u32 mem, u32 value)
 	if (t == 0x1f80 || t == 0x9f80 || t == 0xbf80) {
 		if (m < 0x400)
 			psxHu32ref(mem) = SWAPu32(value);
-		else
+		else if (!verify_hw_active)
 			psxHwWrite32(mem, value);
+		else
+			psxVerifyHwWrite(mem, value, 4);
 	} else {
-		u8 *p = (u8*)(psxMemWLUT[t]);
+		u8 *p = (u8*)(psxMemWLUTEntry(t));
 		if (p != NULL) {
 			*(u32*)(p + m) = SWAPu32(value);
-#ifdef PSXREC
 			psxCpu->Clear(mem, 1);
-#endif
 		} else {
 			if (mem != 0xfffe0130) {
-#ifdef PSXREC
 				if (!psxRegs.writeok) psxCpu->Clear(mem, 1);
-#endif
 				if (psxRegs.writeok) { PSXMEM_LOG("%s(): err sw 0x%08x\n", __func__, mem); }
 			} else {
 				// Write to cache control port 0xfffe0130
-				psxMemWrite32_CacheCtrlPort(value);
+				if (!verify_hw_active)
+					psxMemWrite32_CacheCtrlPort(value);
+				else
+					psxVerifyHwWrite(mem, value, 4);
 			}
 		}
 	}
@@ -410,18 +477,20 @@ void psxMemWrite32_CacheCtrlPort(u32 value)
 			psxRegs.writeok = 0;
 			PSXMEM_LOG("%s(): Icache is isolated.\n", __func__);
 
-			memset(psxMemWLUT + 0x0000, 0, 0x80 * sizeof(void *));
-			memset(psxMemWLUT + 0x8000, 0, 0x80 * sizeof(void *));
-			memset(psxMemWLUT + 0xa000, 0, 0x80 * sizeof(void *));
+			psxMemMapRAM(true, NULL);
+
+#ifdef USE_FASTMEM
+			fastmem_set_ram_writable(false);
+#endif
 
 #ifdef PSXREC
 			/* Cache is now isolated, pending cache-flush sequence:
 			 *  Backup lower 64KB of PS1 RAM, adjust psxMemRLUT[].
 			 */
 			memcpy((void*)mem_bak, (void*)psxM, sizeof(mem_bak));
-			psxMemRLUT[0x0000] = psxMemRLUT[0x0020] = psxMemRLUT[0x0040] = psxMemRLUT[0x0060] = (u8 *)mem_bak;
-			psxMemRLUT[0x8000] = psxMemRLUT[0x8020] = psxMemRLUT[0x8040] = psxMemRLUT[0x8060] = (u8 *)mem_bak;
-			psxMemRLUT[0xa000] = psxMemRLUT[0xa020] = psxMemRLUT[0xa040] = psxMemRLUT[0xa060] = (u8 *)mem_bak;
+			psxMemRLUTEntry(0x0000) = psxMemRLUTEntry(0x0020) = psxMemRLUTEntry(0x0040) = psxMemRLUTEntry(0x0060) = (u8 *)mem_bak;
+			psxMemRLUTEntry(0x8000) = psxMemRLUTEntry(0x8020) = psxMemRLUTEntry(0x8040) = psxMemRLUTEntry(0x8060) = (u8 *)mem_bak;
+			psxMemRLUTEntry(0xa000) = psxMemRLUTEntry(0xa020) = psxMemRLUTEntry(0xa040) = psxMemRLUTEntry(0xa060) = (u8 *)mem_bak;
 #endif
 
 			psxCpu->Notify(R3000ACPU_NOTIFY_CACHE_ISOLATED, NULL);
@@ -431,19 +500,20 @@ void psxMemWrite32_CacheCtrlPort(u32 value)
 			psxRegs.writeok = 1;
 			PSXMEM_LOG("%s(): Icache is unisolated.\n", __func__);
 
-			for (int i = 0; i < 0x80; i++)
-				psxMemWLUT[i + 0x0000] = (u8*)&psxM[(i & 0x1f) << 16];
-			memcpy(psxMemWLUT + 0x8000, psxMemWLUT, 0x80 * sizeof(void *));
-			memcpy(psxMemWLUT + 0xa000, psxMemWLUT, 0x80 * sizeof(void *));
+#ifdef USE_FASTMEM
+			fastmem_set_ram_writable(true);
+#endif
+
+			psxMemMapRAM(true, (u8 *)psxM);
 
 #ifdef PSXREC
 			/* Cache is now unisolated:
 			 * Restore lower 64KB RAM contents and psxMemRLUT[].
 			 */
 			memcpy((void*)psxM, (void*)mem_bak, sizeof(mem_bak));
-			psxMemRLUT[0x0000] = psxMemRLUT[0x0020] = psxMemRLUT[0x0040] = psxMemRLUT[0x0060] = (u8 *)psxM;
-			psxMemRLUT[0x8000] = psxMemRLUT[0x8020] = psxMemRLUT[0x8040] = psxMemRLUT[0x8060] = (u8 *)psxM;
-			psxMemRLUT[0xa000] = psxMemRLUT[0xa020] = psxMemRLUT[0xa040] = psxMemRLUT[0xa060] = (u8 *)psxM;
+			psxMemRLUTEntry(0x0000) = psxMemRLUTEntry(0x0020) = psxMemRLUTEntry(0x0040) = psxMemRLUTEntry(0x0060) = (u8 *)psxM;
+			psxMemRLUTEntry(0x8000) = psxMemRLUTEntry(0x8020) = psxMemRLUTEntry(0x8040) = psxMemRLUTEntry(0x8060) = (u8 *)psxM;
+			psxMemRLUTEntry(0xa000) = psxMemRLUTEntry(0xa020) = psxMemRLUTEntry(0xa040) = psxMemRLUTEntry(0xa060) = (u8 *)psxM;
 #endif
 
 			/* Dynarecs might take this opportunity to flush their code cache */
@@ -546,112 +616,3 @@ void psxMemWrite32_direct(u32 mem, u32 value,void *_regs) {
 			*((u32 *)&regs->psxP[m]) = value;
 	}
 }
-
-
-#ifdef DEBUG_MEM_STATS
-///////////////////////////////////////////////////////////////////////////////
-// -BEGIN- Memory statistics (for development purposes)
-///////////////////////////////////////////////////////////////////////////////
-long long unsigned int memstats[MEMSTAT_TYPE_COUNT][MEMSTAT_REGION_COUNT][MEMSTAT_WIDTH_COUNT];
-
-static void memstats_reset()
-{
-	memset((void*)memstats, 0, sizeof(memstats));
-}
-
-static void memstats_region_print(const char *region_description, MemstatRegion region)
-{
-	char separator_line[81];
-	strncpy(separator_line, region_description, 80);
-	separator_line[80] = '\0';
-	int i = strlen(separator_line);
-	if (i < (sizeof(separator_line)-1))
-		memset(separator_line+i, '-', sizeof(separator_line)-1-i);
-
-	printf("%s\n"
-	       "  reads:%23llu %23llu %23llu\n"
-	       " writes:%23llu %23llu %23llu\n",
-	       separator_line,
-	       memstats[MEMSTAT_TYPE_READ][region][MEMSTAT_WIDTH_8],
-	       memstats[MEMSTAT_TYPE_READ][region][MEMSTAT_WIDTH_16],
-	       memstats[MEMSTAT_TYPE_READ][region][MEMSTAT_WIDTH_32],
-	       memstats[MEMSTAT_TYPE_WRITE][region][MEMSTAT_WIDTH_8],
-	       memstats[MEMSTAT_TYPE_WRITE][region][MEMSTAT_WIDTH_16],
-	       memstats[MEMSTAT_TYPE_WRITE][region][MEMSTAT_WIDTH_32]);
-}
-
-static void memstats_print()
-{
-	printf("MEMORY STATS:              byte                   short                    word\n");
-	memstats_region_print("BLOCKED RAM (ISOLATED CACHE)", MEMSTAT_REGION_BLOCKED);
-	memstats_region_print("PPORT (ROM EXPANSION)",        MEMSTAT_REGION_PPORT);
-	memstats_region_print("ROM",                          MEMSTAT_REGION_ROM);
-	memstats_region_print("CACHE CTRL PORT",              MEMSTAT_REGION_CACHE);
-	memstats_region_print("RAM",                          MEMSTAT_REGION_RAM);
-	memstats_region_print("SCRATCHPAD",                   MEMSTAT_REGION_SCRATCHPAD);
-	memstats_region_print("HW I/O",                       MEMSTAT_REGION_HW);
-	memstats_region_print("TOTAL",                        MEMSTAT_REGION_ANY);
-}
-
-static inline void memstats_add_read(u32 addr, MemstatWidth width)
-{
-	MemstatRegion region;
-	addr &= 0xfffffff;
-	switch (addr >> 16) {
-		case 0x0000 ... 0x007f:
-			region = MEMSTAT_REGION_RAM;
-			break;
-		case 0x0f00 ... 0x0f7f:
-			region = MEMSTAT_REGION_PPORT;
-			break;
-		case 0x0f80:
-			if ((addr & 0xffff) < 0x0400)
-				region = MEMSTAT_REGION_SCRATCHPAD;
-			else
-				region = MEMSTAT_REGION_HW;
-			break;
-		case 0x0ffe:
-			region = MEMSTAT_REGION_CACHE;
-			break;
-		default:
-			region = MEMSTAT_REGION_ROM;
-			break;
-	}
-	memstats[MEMSTAT_TYPE_READ][region][width]++;
-	memstats[MEMSTAT_TYPE_READ][MEMSTAT_REGION_ANY][width]++;
-}
-
-static inline void memstats_add_write(u32 addr, MemstatWidth width)
-{
-	MemstatRegion region;
-	addr &= 0xfffffff;
-	switch (addr >> 16) {
-		case 0x0000 ... 0x007f:
-			if (psxRegs.writeok)
-				region = MEMSTAT_REGION_RAM;
-			else
-				region = MEMSTAT_REGION_BLOCKED;
-			break;
-		case 0x0f00 ... 0x0f7f:
-			region = MEMSTAT_REGION_PPORT;
-			break;
-		case 0x0f80:
-			if ((addr & 0xffff) < 0x0400)
-				region = MEMSTAT_REGION_SCRATCHPAD;
-			else
-				region = MEMSTAT_REGION_HW;
-			break;
-		case 0x0ffe:
-			region = MEMSTAT_REGION_CACHE;
-			break;
-		default:
-			region = MEMSTAT_REGION_ROM;
-			break;
-	}
-	memstats[MEMSTAT_TYPE_WRITE][region][width]++;
-	memstats[MEMSTAT_TYPE_WRITE][MEMSTAT_REGION_ANY][width]++;
-}
-///////////////////////////////////////////////////////////////////////////////
-// -END- Memory statistics (for development purposes)
-///////////////////////////////////////////////////////////////////////////////
-#endif // DEBUG_MEM_STATS
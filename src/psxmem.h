@@ -58,8 +58,25 @@ extern bool psxP_allocated;
 extern bool psxR_allocated;
 extern bool psxH_allocated;
 
+#ifdef USE_COMPACT_MEMLUT
+/* Two-level LUTs: first level is indexed by the upper 8 bits of address,
+ *  second by the next 8 bits. Only the handful of 16MB segments holding
+ *  anything (RAM mirrors in KUSEG/KSEG0/KSEG1, parallel port, scratchpad,
+ *  BIOS) have second-level pages of their own; the mirrored RAM segments
+ *  share one. All others share an unmapped page. First-level entries never
+ *  change after psxMemInit(), second-level entries do (cache isolation).
+ *  See psxmem.cpp.
+ */
+extern u8 **psxMemWLUT[0x100];
+extern u8 **psxMemRLUT[0x100];
+#define psxMemRLUTEntry(t)	psxMemRLUT[(t) >> 8][(t) & 0xff]
+#define psxMemWLUTEntry(t)	psxMemWLUT[(t) >> 8][(t) & 0xff]
+#else
 extern u8 **psxMemWLUT;
 extern u8 **psxMemRLUT;
+#define psxMemRLUTEntry(t)	psxMemRLUT[t]
+#define psxMemWLUTEntry(t)	psxMemWLUT[t]
+#endif
 
 #define psxMs8(mem)		psxM[(mem) & 0x1fffff]
 #define psxMs16(mem)	(SWAP16(*(s16*)&psxM[(mem) & 0x1fffff]))
@@ -117,7 +134,7 @@ extern u8 **psxMemRLUT;
 #define psxHu16ref(mem)	(*(u16*)&psxH[(mem) & 0xffff])
 #define psxHu32ref(mem)	(*(u32*)&psxH[(mem) & 0xffff])
 
-#define PSXM(mem)		(u8*)(psxMemRLUT[(mem) >> 16] + ((mem) & 0xffff))
+#define PSXM(mem)		(u8*)(psxMemRLUTEntry((u32)(mem) >> 16) + ((mem) & 0xffff))
 #define PSXMs8(mem)		(*(s8 *)PSXM(mem))
 #define PSXMs16(mem)	(SWAP16(*(s16*)PSXM(mem)))
 #define PSXMs32(mem)	(SWAP32(*(s32*)PSXM(mem)))
@@ -0,0 +1,384 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Memory access statistics
+ *
+ *  Region counters see only accesses made through psxMemRead*() and
+ * psxMemWrite*(): all interpreter accesses (fastmem isn't set up while
+ * stats are collected), but only those dynarec accesses that weren't
+ * resolved at compile time or by inline RAM/scratchpad checks. The I/O
+ * port histogram is counted in psxHwRead*()/psxHwWrite*(), which every CPU
+ * core ends up calling for hardware registers.
+ *
+ *  Each dump holds counts accumulated since the last psxMemReset(), along
+ * with the number of frames emulated since then. Consecutive dumps can be
+ * subtracted to get per-interval figures.
+ *
+ *  CSV format, one row per region, I/O port group and I/O port accessed:
+ *    frame,section,name,address,read8,read16,read32,write8,write16,write32
+ *  where 'section' is "region", "hw_group" or "hw_port". For ports, 'name'
+ *  is the group the port belongs to.
+ *
+ *  JSON format, one object per dump and line:
+ *    {"frame":N,"regions":{"RAM":{"r8":..,"r16":..,"r32":..,"w8":..,..},..},
+ *     "hw_groups":{"GPU":{..},..},"hw_ports":{"0x1f801810":{..},..}}
+ */
+
+#include "psxmemstats.h"
+#include "r3000a.h"
+
+bool memstats_active;
+
+// I/O ports at 0x1f801000..0x1f802fff, counted per byte address
+#define HW_STATS_START  0x1000
+#define HW_STATS_SIZE   0x2000
+
+typedef u64 MemstatCounts[MEMSTAT_TYPE_COUNT][MEMSTAT_WIDTH_COUNT];
+
+static MemstatCounts  memstats[MEMSTAT_REGION_COUNT];
+static MemstatCounts *memstats_hw;   // [HW_STATS_SIZE], allocated when active
+static u32   memstats_frames;        // Frames emulated since reset
+static u32   memstats_frames_to_dump;
+static FILE *memstats_file;
+static bool  memstats_json;
+
+static const char * const region_names[MEMSTAT_REGION_COUNT] = {
+	"TOTAL", "RAM", "BLOCKED", "PPORT", "SCRATCHPAD", "HW", "ROM", "CACHE"
+};
+
+struct HwGroup {
+	u16 start, end;    // Offsets into psxH, inclusive
+	const char *name;
+};
+
+static const HwGroup hw_groups[] = {
+	{ 0x1000, 0x103f, "MEMCTRL" },
+	{ 0x1040, 0x105f, "SIO"     },
+	{ 0x1060, 0x106f, "MEMCTRL" },
+	{ 0x1070, 0x107f, "IRQ"     },
+	{ 0x1080, 0x10ff, "DMA"     },
+	{ 0x1100, 0x112f, "RCNT"    },
+	{ 0x1800, 0x1803, "CDROM"   },
+	{ 0x1810, 0x1817, "GPU"     },
+	{ 0x1820, 0x1827, "MDEC"    },
+	{ 0x1c00, 0x1fff, "SPU"     },
+	{ 0x2000, 0x2fff, "EXP2"    },
+};
+#define HW_GROUP_COUNT (sizeof(hw_groups) / sizeof(hw_groups[0]))
+
+static const char *hw_group_name(u32 port)
+{
+	for (unsigned i = 0; i < HW_GROUP_COUNT; i++)
+		if (port >= hw_groups[i].start && port <= hw_groups[i].end)
+			return hw_groups[i].name;
+	return "OTHER";
+}
+
+static bool counts_zero(const MemstatCounts &c)
+{
+	for (int t = 0; t < MEMSTAT_TYPE_COUNT; t++)
+		for (int w = 0; w < MEMSTAT_WIDTH_COUNT; w++)
+			if (c[t][w])
+				return false;
+	return true;
+}
+
+static void counts_add(MemstatCounts &dst, const MemstatCounts &src)
+{
+	for (int t = 0; t < MEMSTAT_TYPE_COUNT; t++)
+		for (int w = 0; w < MEMSTAT_WIDTH_COUNT; w++)
+			dst[t][w] += src[t][w];
+}
+
+// Per-group totals, in hw_groups[] order. Groups sharing a name are merged
+//  into the first entry with that name, entry HW_GROUP_COUNT is "OTHER".
+static void hw_group_totals(MemstatCounts *totals)
+{
+	memset(totals, 0, sizeof(MemstatCounts) * (HW_GROUP_COUNT + 1));
+	for (u32 off = 0; off < HW_STATS_SIZE; off++) {
+		if (counts_zero(memstats_hw[off]))
+			continue;
+		const char *name = hw_group_name(off + HW_STATS_START);
+		unsigned g = 0;
+		while (g < HW_GROUP_COUNT && strcmp(hw_groups[g].name, name) != 0)
+			g++;
+		counts_add(totals[g], memstats_hw[off]);
+	}
+}
+
+static bool hw_group_is_first(unsigned g)
+{
+	if (g == HW_GROUP_COUNT)
+		return true;
+	for (unsigned i = 0; i < g; i++)
+		if (strcmp(hw_groups[i].name, hw_groups[g].name) == 0)
+			return false;
+	return true;
+}
+
+static const char *hw_group_index_name(unsigned g)
+{
+	return (g < HW_GROUP_COUNT) ? hw_groups[g].name : "OTHER";
+}
+
+static void csv_row(const char *section, const char *name, u32 addr,
+                    const MemstatCounts &c)
+{
+	fprintf(memstats_file, "%u,%s,%s,", memstats_frames, section, name);
+	if (addr)
+		fprintf(memstats_file, "0x%08x", addr);
+	fprintf(memstats_file, ",%llu,%llu,%llu,%llu,%llu,%llu\n",
+	        (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_8],
+	        (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_16],
+	        (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_32],
+	        (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_8],
+	        (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_16],
+	        (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_32]);
+}
+
+static void json_counts(const char *key, const MemstatCounts &c, bool first)
+{
+	fprintf(memstats_file,
+	        "%s\"%s\":{\"r8\":%llu,\"r16\":%llu,\"r32\":%llu,"
+	        "\"w8\":%llu,\"w16\":%llu,\"w32\":%llu}",
+	        first ? "" : ",", key,
+	        (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_8],
+	        (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_16],
+	        (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_32],
+	        (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_8],
+	        (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_16],
+	        (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_32]);
+}
+
+void psxMemStatsDump(void)
+{
+	if (!memstats_active || !memstats_file)
+		return;
+
+	MemstatCounts groups[HW_GROUP_COUNT + 1];
+	hw_group_totals(groups);
+
+	if (memstats_json) {
+		bool first = true;
+		fprintf(memstats_file, "{\"frame\":%u,\"regions\":{", memstats_frames);
+		for (int r = 0; r < MEMSTAT_REGION_COUNT; r++, first = false)
+			json_counts(region_names[r], memstats[r], first);
+
+		fprintf(memstats_file, "},\"hw_groups\":{");
+		first = true;
+		for (unsigned g = 0; g <= HW_GROUP_COUNT; g++) {
+			if (!hw_group_is_first(g) || counts_zero(groups[g]))
+				continue;
+			json_counts(hw_group_index_name(g), groups[g], first);
+			first = false;
+		}
+
+		fprintf(memstats_file, "},\"hw_ports\":{");
+		first = true;
+		for (u32 off = 0; off < HW_STATS_SIZE; off++) {
+			if (counts_zero(memstats_hw[off]))
+				continue;
+			char key[16];
+			sprintf(key, "0x%08x", 0x1f800000 + HW_STATS_START + off);
+			json_counts(key, memstats_hw[off], first);
+			first = false;
+		}
+		fprintf(memstats_file, "}}\n");
+	} else {
+		for (int r = 0; r < MEMSTAT_REGION_COUNT; r++)
+			csv_row("region", region_names[r], 0, memstats[r]);
+
+		for (unsigned g = 0; g <= HW_GROUP_COUNT; g++) {
+			if (hw_group_is_first(g) && !counts_zero(groups[g]))
+				csv_row("hw_group", hw_group_index_name(g), 0, groups[g]);
+		}
+
+		for (u32 off = 0; off < HW_STATS_SIZE; off++) {
+			if (!counts_zero(memstats_hw[off]))
+				csv_row("hw_port", hw_group_name(off + HW_STATS_START),
+				        0x1f800000 + HW_STATS_START + off, memstats_hw[off]);
+		}
+	}
+
+	fflush(memstats_file);
+}
+
+static void memstats_print_counts(const char *description, const MemstatCounts &c)
+{
+	char separator_line[81];
+	strncpy(separator_line, description, 80);
+	separator_line[80] = '\0';
+	size_t i = strlen(separator_line);
+	if (i < (sizeof(separator_line)-1))
+		memset(separator_line+i, '-', sizeof(separator_line)-1-i);
+
+	printf("%s\n"
+	       "  reads:%23llu %23llu %23llu\n"
+	       " writes:%23llu %23llu %23llu\n",
+	       separator_line,
+	       (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_8],
+	       (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_16],
+	       (unsigned long long)c[MEMSTAT_TYPE_READ][MEMSTAT_WIDTH_32],
+	       (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_8],
+	       (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_16],
+	       (unsigned long long)c[MEMSTAT_TYPE_WRITE][MEMSTAT_WIDTH_32]);
+}
+
+static void memstats_print(void)
+{
+	printf("MEMORY STATS:              byte                   short                    word\n");
+	memstats_print_counts("BLOCKED RAM (ISOLATED CACHE)", memstats[MEMSTAT_REGION_BLOCKED]);
+	memstats_print_counts("PPORT (ROM EXPANSION)",        memstats[MEMSTAT_REGION_PPORT]);
+	memstats_print_counts("ROM",                          memstats[MEMSTAT_REGION_ROM]);
+	memstats_print_counts("CACHE CTRL PORT",              memstats[MEMSTAT_REGION_CACHE]);
+	memstats_print_counts("RAM",                          memstats[MEMSTAT_REGION_RAM]);
+	memstats_print_counts("SCRATCHPAD",                   memstats[MEMSTAT_REGION_SCRATCHPAD]);
+	memstats_print_counts("HW I/O",                       memstats[MEMSTAT_REGION_HW]);
+	memstats_print_counts("TOTAL",                        memstats[MEMSTAT_REGION_ANY]);
+
+	MemstatCounts groups[HW_GROUP_COUNT + 1];
+	hw_group_totals(groups);
+	printf("HW I/O PORTS, ALL CPU PATHS:\n");
+	for (unsigned g = 0; g <= HW_GROUP_COUNT; g++) {
+		if (hw_group_is_first(g) && !counts_zero(groups[g]))
+			memstats_print_counts(hw_group_index_name(g), groups[g]);
+	}
+}
+
+void psxMemStatsInit(void)
+{
+	if (!Config.MemStats || memstats_active)
+		return;
+
+	memstats_hw = (MemstatCounts *)calloc(HW_STATS_SIZE, sizeof(MemstatCounts));
+	if (!memstats_hw) {
+		printf("Error allocating memory stats, disabling them\n");
+		return;
+	}
+
+	if (Config.MemStatsFile[0] != '\0') {
+		const char *ext = strrchr(Config.MemStatsFile, '.');
+		memstats_json = ext && strcasecmp(ext, ".json") == 0;
+		memstats_file = fopen(Config.MemStatsFile, "w");
+		if (!memstats_file) {
+			printf("Error opening memory stats file %s\n", Config.MemStatsFile);
+		} else if (!memstats_json) {
+			fprintf(memstats_file, "frame,section,name,address,"
+			        "read8,read16,read32,write8,write16,write32\n");
+		}
+	}
+
+	memstats_active = true;
+	psxMemStatsReset();
+	printf("Collecting memory access statistics\n");
+}
+
+void psxMemStatsShutdown(void)
+{
+	if (!memstats_active)
+		return;
+
+	psxMemStatsDump();
+	memstats_print();
+
+	if (memstats_file) {
+		fclose(memstats_file);
+		memstats_file = NULL;
+	}
+	free(memstats_hw);
+	memstats_hw = NULL;
+	memstats_active = false;
+}
+
+void psxMemStatsReset(void)
+{
+	if (!memstats_active)
+		return;
+
+	memset(memstats, 0, sizeof(memstats));
+	memset(memstats_hw, 0, sizeof(MemstatCounts) * HW_STATS_SIZE);
+	memstats_frames = 0;
+	memstats_frames_to_dump = Config.MemStatsInterval;
+}
+
+void psxMemStatsFrame(void)
+{
+	if (!memstats_active)
+		return;
+
+	memstats_frames++;
+	if (memstats_frames_to_dump && --memstats_frames_to_dump == 0) {
+		psxMemStatsDump();
+		memstats_frames_to_dump = Config.MemStatsInterval;
+	}
+}
+
+static inline MemstatRegion memstats_region(u32 addr)
+{
+	addr &= 0xfffffff;
+	switch (addr >> 16) {
+		case 0x0000 ... 0x007f:
+			return MEMSTAT_REGION_RAM;
+		case 0x0f00 ... 0x0f7f:
+			return MEMSTAT_REGION_PPORT;
+		case 0x0f80:
+			if ((addr & 0xffff) < 0x0400)
+				return MEMSTAT_REGION_SCRATCHPAD;
+			else
+				return MEMSTAT_REGION_HW;
+		case 0x0ffe:
+			return MEMSTAT_REGION_CACHE;
+		default:
+			return MEMSTAT_REGION_ROM;
+	}
+}
+
+void psxMemStatsAddRead(u32 addr, MemstatWidth width)
+{
+	MemstatRegion region = memstats_region(addr);
+	memstats[region][MEMSTAT_TYPE_READ][width]++;
+	memstats[MEMSTAT_REGION_ANY][MEMSTAT_TYPE_READ][width]++;
+}
+
+void psxMemStatsAddWrite(u32 addr, MemstatWidth width)
+{
+	MemstatRegion region = memstats_region(addr);
+	if (region == MEMSTAT_REGION_RAM && !psxRegs.writeok)
+		region = MEMSTAT_REGION_BLOCKED;
+	memstats[region][MEMSTAT_TYPE_WRITE][width]++;
+	memstats[MEMSTAT_REGION_ANY][MEMSTAT_TYPE_WRITE][width]++;
+}
+
+static inline void memstats_add_hw(u32 addr, MemstatType type, MemstatWidth width)
+{
+	if ((addr & 0x0fff0000) != 0x0f800000)
+		return;
+	const u32 off = (addr & 0xffff) - HW_STATS_START;
+	if (off < HW_STATS_SIZE)
+		memstats_hw[off][type][width]++;
+}
+
+void psxMemStatsAddHwRead(u32 addr, MemstatWidth width)
+{
+	memstats_add_hw(addr, MEMSTAT_TYPE_READ, width);
+}
+
+void psxMemStatsAddHwWrite(u32 addr, MemstatWidth width)
+{
+	memstats_add_hw(addr, MEMSTAT_TYPE_WRITE, width);
+}
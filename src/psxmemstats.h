@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Memory access statistics
+ *
+ *  Counts reads and writes by memory region and access width, plus a
+ * histogram of accesses to each hardware I/O port (SPU, GPU, CDROM, DMA,
+ * root counters..). Enabled at runtime with Config.MemStats (-memstats
+ * command line option). When disabled, the only cost is a test of
+ * 'memstats_active' on each counted access.
+ *
+ *  Counters are dumped every Config.MemStatsInterval frames and at
+ * shutdown to Config.MemStatsFile, as CSV or, if the filename ends in
+ * ".json", as one JSON object per line. A summary is printed to console
+ * at shutdown.
+ */
+
+#ifndef PSXMEMSTATS_H
+#define PSXMEMSTATS_H
+
+#include "psxcommon.h"
+
+enum MemstatType   { MEMSTAT_TYPE_READ, MEMSTAT_TYPE_WRITE, MEMSTAT_TYPE_COUNT };
+enum MemstatWidth  { MEMSTAT_WIDTH_8, MEMSTAT_WIDTH_16, MEMSTAT_WIDTH_32, MEMSTAT_WIDTH_COUNT };
+enum MemstatRegion { MEMSTAT_REGION_ANY, MEMSTAT_REGION_RAM, MEMSTAT_REGION_BLOCKED,
+                     MEMSTAT_REGION_PPORT, MEMSTAT_REGION_SCRATCHPAD, MEMSTAT_REGION_HW,
+                     MEMSTAT_REGION_ROM, MEMSTAT_REGION_CACHE, MEMSTAT_REGION_COUNT };
+
+extern bool memstats_active;
+
+void psxMemStatsInit(void);
+void psxMemStatsShutdown(void);
+void psxMemStatsReset(void);
+
+// Called once per emulated frame, dumps to file when interval has elapsed
+void psxMemStatsFrame(void);
+
+// Write current counters to Config.MemStatsFile
+void psxMemStatsDump(void);
+
+void psxMemStatsAddRead(u32 addr, MemstatWidth width);
+void psxMemStatsAddWrite(u32 addr, MemstatWidth width);
+void psxMemStatsAddHwRead(u32 addr, MemstatWidth width);
+void psxMemStatsAddHwWrite(u32 addr, MemstatWidth width);
+
+// Region counters: called at top of psxMemRead*(), psxMemWrite*()
+static inline void memstats_add_read(u32 addr, MemstatWidth width)
+{
+	if (__builtin_expect(memstats_active, 0))
+		psxMemStatsAddRead(addr, width);
+}
+
+static inline void memstats_add_write(u32 addr, MemstatWidth width)
+{
+	if (__builtin_expect(memstats_active, 0))
+		psxMemStatsAddWrite(addr, width);
+}
+
+// I/O port histogram: called at top of psxHwRead*(), psxHwWrite*()
+static inline void memstats_add_hw_read(u32 addr, MemstatWidth width)
+{
+	if (__builtin_expect(memstats_active, 0))
+		psxMemStatsAddHwRead(addr, width);
+}
+
+static inline void memstats_add_hw_write(u32 addr, MemstatWidth width)
+{
+	if (__builtin_expect(memstats_active, 0))
+		psxMemStatsAddHwWrite(addr, width);
+}
+
+#endif //PSXMEMSTATS_H
@@ -0,0 +1,368 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Guest PC sampling profiler
+ *
+ *  psxBranchTest() runs whenever an event is due, which every CPU core
+ * checks at least at the end of each block or branch. While profiling,
+ * psxRegs.io_cycle_counter is also lowered so it runs once the sampling
+ * interval has elapsed. A sample is weighted by how many intervals
+ * elapsed since the last one, so time skipped ahead by idle-loop
+ * detection is still accounted for. Samples are kept in a hash table
+ * of (PC,$ra) pairs; a pair that finds no free slot is counted as
+ * dropped.
+ *
+ *  Guest code has no symbols, so at report time each sampled PC is
+ * assigned to the function found by scanning back from it for:
+ *   - a known entry point: the target of the JAL before any sampled $ra,
+ *     or the BIOS A0/B0/C0 dispatchers,
+ *   - an 'addiu sp,sp,-N' stack frame setup,
+ *   - the instruction following the delay slot of a 'jr ra', or
+ *   - the first instruction after two or more NOPs (alignment padding).
+ *  This is a heuristic: functions with several 'jr ra' returns and no
+ * stack frame can be split in two, and leaf functions sharing no
+ * boundary with others can be merged with the one before.
+ *
+ *  The caller listed for a function is the function holding the JAL most
+ * of its samples' $ra returns to. Samples taken while $ra pointed into
+ * the function itself (after it made calls of its own) have no caller.
+ */
+
+#include <signal.h>
+#include "psxprofile.h"
+#include "psxmem.h"
+#include "psxbios.h"
+#include "r3000a.h"
+
+bool profile_active;
+
+#define PROFILE_HASH_SIZE   (64 * 1024)  // Distinct (PC,$ra) pairs, power of two
+#define PROFILE_HASH_PROBES 16
+#define PROFILE_SCAN_LIMIT  (4 * 1024)   // Bytes to scan back for function entry
+#define PROFILE_REPORT_MAX  50           // Functions listed in report
+
+#define NO_CALLER  0xffffffff
+
+struct ProfileSample {
+	u32 pc;
+	u32 ra;
+	u32 count;
+};
+
+static ProfileSample *profile_samples;  // Allocated when active
+static u64 profile_total;
+static u64 profile_dropped;
+static u32 profile_frames;
+static u32 profile_last_cycle;
+static volatile sig_atomic_t profile_report_requested;
+
+#ifdef SIGUSR1
+static void profile_sigusr1(int sig __attribute__((unused)))
+{
+	profile_report_requested = 1;
+}
+#endif
+
+void psxProfileInit(void)
+{
+	profile_total = profile_dropped = 0;
+	profile_frames = 0;
+	profile_last_cycle = psxRegs.cycle;
+
+	if (Config.ProfileInterval && !profile_samples) {
+		profile_samples = (ProfileSample *)calloc(PROFILE_HASH_SIZE, sizeof(ProfileSample));
+		if (!profile_samples)
+			printf("Error allocating memory for guest profiler\n");
+	}
+
+	profile_active = (profile_samples != NULL);
+
+#ifdef SIGUSR1
+	if (profile_active)
+		signal(SIGUSR1, profile_sigusr1);
+#endif
+}
+
+void psxProfileShutdown(void)
+{
+	if (!profile_active)
+		return;
+
+	psxProfileReport();
+
+#ifdef SIGUSR1
+	signal(SIGUSR1, SIG_DFL);
+#endif
+	free(profile_samples);
+	profile_samples = NULL;
+	profile_active = false;
+}
+
+void psxProfileFrame(void)
+{
+	if (!profile_active)
+		return;
+
+	profile_frames++;
+	if (profile_report_requested) {
+		profile_report_requested = 0;
+		psxProfileReport();
+	}
+}
+
+static void profile_add(u32 pc, u32 ra, u32 weight)
+{
+	u32 h = ((pc * 0x9e3779b1) ^ (ra * 0x85ebca6b)) >> 8;
+
+	profile_total += weight;
+	for (int i = 0; i < PROFILE_HASH_PROBES; i++, h++) {
+		ProfileSample *s = &profile_samples[h & (PROFILE_HASH_SIZE-1)];
+		if (s->count == 0) {
+			s->pc = pc;
+			s->ra = ra;
+		} else if (s->pc != pc || s->ra != ra) {
+			continue;
+		}
+		s->count += weight;
+		return;
+	}
+	profile_dropped += weight;
+}
+
+void psxProfileSample(void)
+{
+	const u32 interval = Config.ProfileInterval;
+	const u32 elapsed = psxRegs.cycle - profile_last_cycle;
+
+	if ((s32)elapsed < 0) {
+		// psxRegs.cycle was reset (PSXINT_RESET_CYCLE_VAL)
+		profile_last_cycle = psxRegs.cycle;
+	} else if (elapsed >= interval) {
+		profile_last_cycle = psxRegs.cycle;
+		profile_add(psxRegs.pc, psxRegs.GPR.n.ra, elapsed / interval);
+	}
+
+	// Make sure psxBranchTest() is called again in time for next sample
+	const u32 next = profile_last_cycle + interval;
+	if ((s32)(next - psxRegs.io_cycle_counter) < 0)
+		psxRegs.io_cycle_counter = next;
+}
+
+/* Report */
+
+static bool read_code(u32 addr, u32 *code)
+{
+	const u32 *p = (const u32 *)PSXM(addr);
+	if (p == NULL)
+		return false;
+	*code = SWAP32(*p);
+	return true;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	const u32 x = *(const u32 *)a;
+	const u32 y = *(const u32 *)b;
+	return (x < y) ? -1 : (x > y);
+}
+
+static u32 *known_entries;
+static u32  num_known_entries;
+
+static bool is_known_entry(u32 addr)
+{
+	return bsearch(&addr, known_entries, num_known_entries, sizeof(u32), cmp_u32) != NULL;
+}
+
+// Entry point of function holding 'pc', see top of file
+static u32 find_function(u32 pc)
+{
+	u32 addr = pc & ~3;
+
+	for (u32 scanned = 0; scanned < PROFILE_SCAN_LIMIT; scanned += 4, addr -= 4) {
+		u32 code, prev, prev2;
+
+		if (is_known_entry(addr))
+			return addr;
+		if (!read_code(addr, &code) || !read_code(addr - 4, &prev) ||
+		    !read_code(addr - 8, &prev2))
+			break;
+		if ((code >> 16) == 0x27bd && (s16)code < 0)  // addiu sp,sp,-N
+			return addr;
+		if (prev2 == 0x03e00008)                      // jr ra
+			return addr;
+		if (code != 0 && prev == 0 && prev2 == 0)     // Padding before function
+			return addr;
+	}
+
+	return pc;
+}
+
+struct ProfileFunc {
+	u32 entry;
+	u32 caller;
+	u64 count;
+};
+
+static int cmp_func_caller(const void *a, const void *b)
+{
+	const ProfileFunc *x = (const ProfileFunc *)a;
+	const ProfileFunc *y = (const ProfileFunc *)b;
+	if (x->entry != y->entry)
+		return (x->entry < y->entry) ? -1 : 1;
+	return (x->caller < y->caller) ? -1 : (x->caller > y->caller);
+}
+
+static int cmp_func_count(const void *a, const void *b)
+{
+	const ProfileFunc *x = (const ProfileFunc *)a;
+	const ProfileFunc *y = (const ProfileFunc *)b;
+	if (x->count != y->count)
+		return (x->count > y->count) ? -1 : 1;
+	return (x->entry < y->entry) ? -1 : 1;
+}
+
+// Find the JAL/JALR that returns to 'ra', if there is one, and its
+//  target (NO_CALLER for JALR)
+static bool jal_before(u32 ra, u32 *jal_pc, u32 *target)
+{
+	u32 code;
+
+	if ((ra & 3) || ra < 8 || !read_code(ra - 8, &code))
+		return false;
+
+	if ((code >> 26) == 3)                               // JAL
+		*target = ((ra - 4) & 0xf0000000) | ((code & 0x03ffffff) << 2);
+	else if ((code >> 26) == 0 && (code & 0x3f) == 9)    // JALR
+		*target = NO_CALLER;
+	else
+		return false;
+
+	*jal_pc = ra - 8;
+	return true;
+}
+
+void psxProfileReport(void)
+{
+	if (!profile_active)
+		return;
+
+	FILE *f = stdout;
+	if (Config.ProfileFile[0]) {
+		f = fopen(Config.ProfileFile, "a");
+		if (!f) {
+			printf("Error opening %s\n", Config.ProfileFile);
+			return;
+		}
+	}
+
+	u32 num = 0;
+	for (u32 i = 0; i < PROFILE_HASH_SIZE; i++)
+		if (profile_samples[i].count)
+			num++;
+
+	ProfileFunc *funcs = (ProfileFunc *)malloc((num + 1) * sizeof(ProfileFunc));
+	known_entries = (u32 *)malloc((num + 3) * sizeof(u32));
+	if (!funcs || !known_entries)
+		goto out;
+
+	// Known function entries: BIOS dispatchers and targets of JALs
+	num_known_entries = 0;
+	known_entries[num_known_entries++] = 0xa0;
+	known_entries[num_known_entries++] = 0xb0;
+	known_entries[num_known_entries++] = 0xc0;
+	for (u32 i = 0; i < PROFILE_HASH_SIZE; i++) {
+		const ProfileSample *s = &profile_samples[i];
+		u32 jal_pc, target;
+		if (s->count && jal_before(s->ra, &jal_pc, &target) && target != NO_CALLER)
+			known_entries[num_known_entries++] = target;
+	}
+	qsort(known_entries, num_known_entries, sizeof(u32), cmp_u32);
+
+	// Assign samples to functions
+	{
+		u32 n = 0;
+		for (u32 i = 0; i < PROFILE_HASH_SIZE; i++) {
+			const ProfileSample *s = &profile_samples[i];
+			u32 jal_pc, target;
+			if (s->count == 0)
+				continue;
+			funcs[n].entry = find_function(s->pc);
+			funcs[n].caller = NO_CALLER;
+			funcs[n].count = s->count;
+			if (jal_before(s->ra, &jal_pc, &target)) {
+				const u32 caller = find_function(jal_pc);
+				if (caller != funcs[n].entry)
+					funcs[n].caller = caller;
+			}
+			n++;
+		}
+	}
+
+	// Merge by function, keeping the caller with most samples
+	qsort(funcs, num, sizeof(ProfileFunc), cmp_func_caller);
+	{
+		u32 num_funcs = 0;
+		for (u32 i = 0; i < num; ) {
+			const u32 entry = funcs[i].entry;
+			u64 total = 0, best = 0;
+			u32 best_caller = NO_CALLER;
+			while (i < num && funcs[i].entry == entry) {
+				const u32 caller = funcs[i].caller;
+				u64 sum = 0;
+				while (i < num && funcs[i].entry == entry && funcs[i].caller == caller)
+					sum += funcs[i++].count;
+				total += sum;
+				if (caller != NO_CALLER && sum > best) {
+					best = sum;
+					best_caller = caller;
+				}
+			}
+			funcs[num_funcs].entry = entry;
+			funcs[num_funcs].caller = best_caller;
+			funcs[num_funcs].count = total;
+			num_funcs++;
+		}
+		num = num_funcs;
+	}
+	qsort(funcs, num, sizeof(ProfileFunc), cmp_func_count);
+
+	fprintf(f, "Guest profile at frame %u: %llu samples every %u cycles (%llu dropped), %u functions\n",
+	        profile_frames, (unsigned long long)profile_total, Config.ProfileInterval,
+	        (unsigned long long)profile_dropped, num);
+	fprintf(f, "  rank  function     samples       %%  caller    name\n");
+	for (u32 i = 0; i < num && i < PROFILE_REPORT_MAX; i++) {
+		const ProfileFunc *fn = &funcs[i];
+		char name[64] = "";
+		char caller[16] = "-";
+		psxBiosFunctionName(fn->entry, name, sizeof(name));
+		if (fn->caller != NO_CALLER)
+			sprintf(caller, "%08x", fn->caller);
+		fprintf(f, "  %4u  %08x  %10llu  %6.2f  %-8s  %s\n",
+		        i + 1, fn->entry, (unsigned long long)fn->count,
+		        profile_total ? 100.0 * fn->count / profile_total : 0.0,
+		        caller, name);
+	}
+
+out:
+	free(funcs);
+	free(known_entries);
+	known_entries = NULL;
+	if (f != stdout)
+		fclose(f);
+}
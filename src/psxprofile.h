@@ -0,0 +1,57 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Guest PC sampling profiler
+ *
+ *  Every Config.ProfileInterval emulated cycles (-profile command line
+ * option), psxBranchTest() records the guest PC and $ra. Samples are
+ * grouped into guest functions, and a report of the hottest ones, with
+ * their most frequent caller and BIOS A0/B0/C0 names where known, is
+ * written to Config.ProfileFile (or console) at shutdown, and whenever
+ * the process receives SIGUSR1.
+ *
+ *  When disabled, the only cost is a test of 'profile_active' on each
+ * psxBranchTest() call.
+ */
+
+#ifndef PSXPROFILE_H
+#define PSXPROFILE_H
+
+#include "psxcommon.h"
+
+extern bool profile_active;
+
+void psxProfileInit(void);
+void psxProfileShutdown(void);
+
+// Called once per emulated frame, writes report if one was requested
+void psxProfileFrame(void);
+
+// Write report of samples so far
+void psxProfileReport(void);
+
+void psxProfileSample(void);
+
+// Called from psxBranchTest(), after it has set psxRegs.io_cycle_counter
+static inline void profile_sample(void)
+{
+	if (__builtin_expect(profile_active, 0))
+		psxProfileSample();
+}
+
+#endif //PSXPROFILE_H
@@ -0,0 +1,302 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Self-modifying code detection using page protection
+ *
+ *  The CPU cores call psxSmcProtect() for every block they compile or
+ * decode. Each 4KB page of RAM the block covers is made read-only in psxM
+ * and in the mirrors registered with psxSmcAddMirror() (the MIPS dynarec's).
+ * Whatever then writes to such a page through one of them, be it a store
+ * in emitted code, psxMemWrite*(), a DMA memcpy() or the HLE BIOS, raises
+ * SIGSEGV. The handler makes the page writable again and calls
+ * psxCpu->Clear() on the range from the lowest start address of any block
+ * covering the page up to the end of the page, so blocks beginning in an
+ * earlier page but running into this one are invalidated too. The faulting write is then
+ * restarted. Until new code is compiled there, writes to the page cost
+ * nothing extra.
+ *
+ *  A page that keeps faulting (data sharing a page with code that's
+ * recompiled each time it's written) is left writable until the next code
+ * flush. Writes to it are then caught only by the CPU's usual Clear()
+ * calls, the same as without page protection.
+ *
+ *  The 12 RAM mappings fastmem.cpp makes in the PSX address space are not
+ * registered, and SMC_MAX_VIEWS has no room for them: for cache isolation,
+ * fastmem_set_ram_writable() sets their protection wholesale, which would
+ * undo per-page protection. Interpreter stores through psxFastWrite*()
+ * therefore bypass page protection. They are caught only by the
+ * psxCpu->Clear() call psxFastWrite*() makes, as without page protection.
+ *
+ *  The kernel can't write to a protected page: syscalls return EFAULT
+ * instead of faulting. Code that reads files straight into PSX RAM must
+ * call psxSmcUnprotect() first.
+ */
+
+#include "psxsmc.h"
+#include "psxmem.h"
+#include "r3000a.h"
+
+#ifdef USE_SMC_PROTECT
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* Uncomment for debug logging to console */
+//#define SMC_LOG printf
+
+#ifndef SMC_LOG
+#define SMC_LOG(...)
+#endif
+
+#define SMC_PAGE_SIZE  4096
+#define SMC_PAGES      (0x200000/SMC_PAGE_SIZE)
+
+// Faults after which a page stays writable until the next code flush
+#define SMC_HOT_PAGE_FAULTS 16
+
+// psxM plus up to 3 mirrors made by a dynarec, with room to spare
+#define SMC_MAX_VIEWS  8
+
+static bool smc_active;
+static struct sigaction smc_old_sigsegv;
+
+// Host mappings of the 2MB of PSX RAM
+static u8  *smc_views[SMC_MAX_VIEWS];
+static int  smc_num_views;
+
+static u8   smc_protected[SMC_PAGES/8];   // Bit set: page is read-only
+static u32  smc_first_block[SMC_PAGES];   // Lowest RAM offset of a block covering page
+static u8   smc_faults[SMC_PAGES];        // Faults since last code flush
+static bool smc_any_protected;
+
+static struct {
+	u64 faults;         // Write faults on protected pages
+	u64 protects;       // Pages made read-only
+	u64 hot_pages;      // Pages left writable because they faulted too often
+} smc_stats;
+
+static void smc_add_view(void *host_addr)
+{
+	for (int i = 0; i < smc_num_views; i++)
+		if (smc_views[i] == host_addr)
+			return;
+	if (smc_num_views < SMC_MAX_VIEWS)
+		smc_views[smc_num_views++] = (u8 *)host_addr;
+}
+
+static void smc_set_page_prot(u32 page, int prot)
+{
+	for (int i = 0; i < smc_num_views; i++)
+		mprotect(smc_views[i] + page * SMC_PAGE_SIZE, SMC_PAGE_SIZE, prot);
+}
+
+/* Make protected 'page' writable and invalidate all code overlapping it */
+static void smc_release_page(u32 page)
+{
+	const u32 page_end = (page + 1) * SMC_PAGE_SIZE;
+	const u32 first = smc_first_block[page];
+
+	smc_set_page_prot(page, PROT_READ|PROT_WRITE);
+	smc_protected[page/8] &= ~(1 << (page & 7));
+	smc_first_block[page] = 0xffffffff;
+
+	SMC_LOG("SMC: invalidating 0x%06x..0x%06x\n", first, page_end);
+	if (first < page_end)
+		psxCpu->Clear(first, (page_end - first) / 4);
+}
+
+static inline bool smc_page_is_protected(u32 page)
+{
+	return smc_protected[page/8] & (1 << (page & 7));
+}
+
+static void smc_sigsegv(int sig, siginfo_t *si, void *ctx)
+{
+	const u8 *addr = (const u8 *)si->si_addr;
+
+	if (smc_active && si->si_code == SEGV_ACCERR) {
+		for (int i = 0; i < smc_num_views; i++) {
+			if (addr < smc_views[i] || addr >= smc_views[i] + 0x200000)
+				continue;
+			const u32 page = (addr - smc_views[i]) / SMC_PAGE_SIZE;
+			if (!smc_page_is_protected(page))
+				break;
+			smc_stats.faults++;
+			if (smc_faults[page] < 0xff && ++smc_faults[page] == SMC_HOT_PAGE_FAULTS)
+				smc_stats.hot_pages++;
+			smc_release_page(page);
+			return;
+		}
+	}
+
+	// Not ours: pass it on to whoever had SIGSEGV before us
+	if (smc_old_sigsegv.sa_flags & SA_SIGINFO) {
+		smc_old_sigsegv.sa_sigaction(sig, si, ctx);
+	} else if (smc_old_sigsegv.sa_handler != SIG_DFL &&
+	           smc_old_sigsegv.sa_handler != SIG_IGN) {
+		smc_old_sigsegv.sa_handler(sig);
+	} else {
+		// Restore default action, fault happens again on return
+		sigaction(SIGSEGV, &smc_old_sigsegv, NULL);
+	}
+}
+
+int psxSmcInit(void)
+{
+	struct sigaction sa;
+
+	if (smc_active)
+		return 0;
+
+	if (sysconf(_SC_PAGESIZE) != SMC_PAGE_SIZE) {
+		printf("SMC page protection disabled: expects a system page size of %d bytes\n",
+		       SMC_PAGE_SIZE);
+		return -1;
+	}
+
+	if (!psxM_allocated || ((uptr)psxM & (SMC_PAGE_SIZE-1))) {
+		printf("SMC page protection disabled: PSX RAM isn't page-aligned\n");
+		return -1;
+	}
+
+	smc_add_view(psxM);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = smc_sigsegv;
+	// Faulting writes can nest, i.e. a fastmem access emulated with
+	//  psxMemWrite*() that then writes to a protected page of psxM
+	sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGSEGV, &sa, &smc_old_sigsegv) < 0) {
+		printf("Error installing SIGSEGV handler, SMC page protection disabled\n");
+		return -1;
+	}
+
+	memset(smc_protected, 0, sizeof(smc_protected));
+	memset(smc_first_block, 0xff, sizeof(smc_first_block));
+	memset(smc_faults, 0, sizeof(smc_faults));
+	memset(&smc_stats, 0, sizeof(smc_stats));
+	smc_any_protected = false;
+
+	smc_active = true;
+	printf("Using page protection to detect self-modifying code\n");
+	return 0;
+}
+
+void psxSmcShutdown(void)
+{
+	if (smc_active) {
+		psxSmcReset();
+		sigaction(SIGSEGV, &smc_old_sigsegv, NULL);
+		smc_active = false;
+	}
+
+	// Mirrors are registered again by whoever recreates them
+	smc_num_views = 0;
+}
+
+void psxSmcPrintStats(void)
+{
+	if (smc_stats.faults == 0)
+		return;
+
+	printf("SMC page protection: %llu pages protected, %llu write faults, %llu hot pages\n",
+	       (unsigned long long)smc_stats.protects,
+	       (unsigned long long)smc_stats.faults,
+	       (unsigned long long)smc_stats.hot_pages);
+}
+
+bool psxSmcActive(void)
+{
+	return smc_active;
+}
+
+void psxSmcAddMirror(void *host_addr)
+{
+	smc_add_view(host_addr);
+}
+
+void psxSmcProtect(u32 start_pc, u32 end_pc)
+{
+	if (!smc_active || end_pc <= start_pc || (start_pc & 0x1fffffff) >= 0x800000)
+		return;
+
+	const u32 first = start_pc & 0x1ffffc;
+	u32 last = first + (end_pc - start_pc) - 1;
+	if (last > 0x1fffff)
+		last = 0x1fffff;
+
+	for (u32 page = first / SMC_PAGE_SIZE; page <= last / SMC_PAGE_SIZE; ++page) {
+		if (smc_first_block[page] > first)
+			smc_first_block[page] = first;
+
+		if (smc_page_is_protected(page) || smc_faults[page] >= SMC_HOT_PAGE_FAULTS)
+			continue;
+
+		smc_set_page_prot(page, PROT_READ);
+		smc_protected[page/8] |= 1 << (page & 7);
+		smc_any_protected = true;
+		smc_stats.protects++;
+	}
+}
+
+void psxSmcReset(void)
+{
+	if (!smc_active)
+		return;
+
+	if (smc_any_protected) {
+		for (int i = 0; i < smc_num_views; i++)
+			mprotect(smc_views[i], 0x200000, PROT_READ|PROT_WRITE);
+	}
+
+	memset(smc_protected, 0, sizeof(smc_protected));
+	memset(smc_first_block, 0xff, sizeof(smc_first_block));
+	memset(smc_faults, 0, sizeof(smc_faults));
+	smc_any_protected = false;
+}
+
+void psxSmcUnprotect(u32 addr, u32 size)
+{
+	if (!smc_active || size == 0 || (addr & 0x1fffffff) >= 0x800000)
+		return;
+
+	const u32 first = addr & 0x1fffff;
+	u32 last = first + size - 1;
+	if (last > 0x1fffff)
+		last = 0x1fffff;
+
+	for (u32 page = first / SMC_PAGE_SIZE; page <= last / SMC_PAGE_SIZE; ++page) {
+		if (smc_page_is_protected(page))
+			smc_release_page(page);
+	}
+}
+
+#else
+
+int  psxSmcInit(void) { return -1; }
+void psxSmcShutdown(void) { }
+void psxSmcPrintStats(void) { }
+bool psxSmcActive(void) { return false; }
+void psxSmcAddMirror(void *host_addr) { }
+void psxSmcProtect(u32 start_pc, u32 end_pc) { }
+void psxSmcReset(void) { }
+void psxSmcUnprotect(u32 addr, u32 size) { }
+
+#endif // USE_SMC_PROTECT
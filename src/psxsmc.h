@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Self-modifying code detection using page protection
+ *
+ *  Host pages of psxM that hold recompiled or pre-decoded code are made
+ * read-only. The first write to one through psxM or a registered mirror
+ * (psxMemWrite*(), DMA, HLE BIOS, stores in emitted code..) faults: the
+ * page is made writable again and every block overlapping it is
+ * invalidated with psxCpu->Clear(). Interpreter stores through fastmem's
+ * mappings aren't caught, see psxsmc.cpp.
+ *
+ *  Enabled by USE_SMC_PROTECT (Linux hosts). When it's not built in, or
+ * can't be used at runtime, all functions here do nothing and
+ * psxSmcActive() returns false.
+ */
+
+#ifndef PSXSMC_H
+#define PSXSMC_H
+
+#include "psxcommon.h"
+
+int  psxSmcInit(void);
+void psxSmcShutdown(void);
+void psxSmcPrintStats(void);
+
+// True if writes to code pages are being tracked
+bool psxSmcActive(void);
+
+// Register an additional host mapping of the 2MB of PSX RAM (a mirror
+//  made by a dynarec). Can be called before psxSmcInit().
+void psxSmcAddMirror(void *host_addr);
+
+// CPU has compiled/decoded a block spanning PSX addresses [start_pc,end_pc)
+void psxSmcProtect(u32 start_pc, u32 end_pc);
+
+// CPU has flushed all code: make all of RAM writable again
+void psxSmcReset(void);
+
+// Make 'size' bytes at 'addr' writable, invalidating code there first.
+//  For writes the fault handler never sees, like file reads by the kernel.
+void psxSmcUnprotect(u32 addr, u32 size);
+
+#endif //PSXSMC_H
@@ -0,0 +1,495 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Lock-step verification of a recompiler against the interpreter
+ *
+ *  For each block, psxVerifyBlock():
+ *   1) Saves psxRegs, RAM and psxH (scratchpad + I/O ports).
+ *   2) Runs the recompiled block, logging every HW I/O access it makes.
+ *   3) Saves psxRegs, psxH and the RAM pages the block changed, then puts
+ *      back the state of 1).
+ *   4) Steps the interpreter with execI() until it reaches the PC and
+ *      cycle count the block ended at, or takes a branch the block didn't.
+ *      HW I/O accesses aren't performed again: reads return the values
+ *      logged in 2), writes are only checked against the log.
+ *   5) Compares, reports the first block that differs, then puts back the
+ *      state of 3) so emulation goes on exactly as if only the recompiled
+ *      block had run.
+ *
+ *  While the interpreter runs, events can't be dispatched and HW IRQs
+ * can't be taken (I_MASK is cleared): neither could happen inside a block.
+ * Idle-loop fast-forwarding is disabled in verify mode (see psxidle.cpp),
+ * as the interpreter and recompilers do it at different points.
+ *
+ *  Not verified (counted as skipped):
+ *   - Blocks containing SYSCALL, BREAK or HLE BIOS ops: the interpreter
+ *     would run the handlers, which can themselves run guest code.
+ *   - Blocks that write to the cache control port.
+ *   - Blocks run from inside another block (HLE softCall() etc.)
+ *  RAM isn't compared for blocks that wrote to HW I/O ports, as a DMA they
+ * started may have changed it. The interpreter emulates load delay slots
+ * in a few cases where recompilers don't; such code shows up as a
+ * divergence that isn't a recompiler bug.
+ *
+ *  It's slow: each block costs a few passes over the 2MB of RAM.
+ */
+
+#include "psxverify.h"
+#include "psxmem.h"
+#include "psxhw.h"
+#include "psxevents.h"
+#include "r3000a.h"
+#include "gte.h"
+#ifdef PSXREC
+#include "recompiler/mips/disasm.h"
+#endif
+
+/* Uncomment for debug logging to console */
+//#define VERIFY_LOG printf
+
+#ifndef VERIFY_LOG
+#define VERIFY_LOG(...)
+#endif
+
+extern void execI();
+
+bool verify_hw_active;
+
+#define VERIFY_RAM_SIZE   0x200000
+#define VERIFY_HW_SIZE    0x10000
+#define VERIFY_PAGE_SIZE  4096
+#define VERIFY_NUM_PAGES  (VERIFY_RAM_SIZE / VERIFY_PAGE_SIZE)
+
+// Max opcodes the interpreter runs for one block (not counting BD slots)
+#define VERIFY_MAX_INSNS  1024
+
+// Max HW I/O accesses logged per block
+#define VERIFY_MAX_HW     256
+
+enum { VERIFY_HW_RECORD, VERIFY_HW_REPLAY };
+
+struct VerifyHwAccess {
+	u32 addr;
+	u32 value;
+	u8  width;
+	u8  write;
+};
+
+static VerifyHwAccess verify_hw_log[VERIFY_MAX_HW];
+static int  verify_hw_mode;
+static int  verify_hw_num;      // Accesses logged
+static int  verify_hw_pos;      // Next access expected when replaying
+static bool verify_hw_writes;   // Block wrote to a HW I/O port
+static bool verify_hw_mismatch; // Replay didn't match the log
+static bool verify_unverifiable;
+
+static u8 *verify_ram;          // RAM when block started
+static u8 *verify_ram_rec;      // Pages recompiled block changed
+static u8 *verify_hw;           // psxH when block started
+static u8 *verify_hw_rec;       // psxH after recompiled block
+static bool verify_page_rec[VERIFY_NUM_PAGES];
+static u32  verify_ram_diff;      // First RAM address that differs, 0: none
+static u8   verify_ram_diff_rec;
+static u8   verify_ram_diff_int;
+
+static psxRegisters verify_regs;      // psxRegs when block started
+static psxRegisters verify_regs_rec;  // psxRegs after recompiled block
+
+static u32  verify_trace[VERIFY_MAX_INSNS];
+static int  verify_trace_len;
+static bool verify_busy;
+
+static struct {
+	u64 verified;
+	u64 skipped;
+	u64 divergent;
+} verify_stats;
+
+int psxVerifyInit(void)
+{
+	if (!Config.RecVerify)
+		return 0;
+
+	verify_ram     = (u8 *)malloc(VERIFY_RAM_SIZE);
+	verify_ram_rec = (u8 *)malloc(VERIFY_RAM_SIZE);
+	verify_hw      = (u8 *)malloc(VERIFY_HW_SIZE);
+	verify_hw_rec  = (u8 *)malloc(VERIFY_HW_SIZE);
+
+	if (!verify_ram || !verify_ram_rec || !verify_hw || !verify_hw_rec) {
+		printf("Error allocating memory for recompiler verification\n");
+		psxVerifyShutdown();
+		Config.RecVerify = false;
+		return -1;
+	}
+
+	memset(&verify_stats, 0, sizeof(verify_stats));
+	printf("Recompiler verification enabled: every block is re-run by the interpreter\n");
+	return 0;
+}
+
+void psxVerifyShutdown(void)
+{
+	if (verify_ram)
+		psxVerifyPrintStats();
+
+	free(verify_ram);      verify_ram = NULL;
+	free(verify_ram_rec);  verify_ram_rec = NULL;
+	free(verify_hw);       verify_hw = NULL;
+	free(verify_hw_rec);   verify_hw_rec = NULL;
+}
+
+void psxVerifyPrintStats(void)
+{
+	printf("Recompiler verification: %llu blocks verified, %llu skipped, %llu divergent\n",
+	       (unsigned long long)verify_stats.verified,
+	       (unsigned long long)verify_stats.skipped,
+	       (unsigned long long)verify_stats.divergent);
+}
+
+/* HW I/O access logging */
+
+static void verifyHwLog(u32 addr, u32 value, int width, bool write)
+{
+	if (verify_hw_num == VERIFY_MAX_HW) {
+		verify_unverifiable = true;
+		return;
+	}
+
+	VerifyHwAccess *a = &verify_hw_log[verify_hw_num++];
+	a->addr = addr;
+	a->value = value;
+	a->width = width;
+	a->write = write;
+}
+
+// Next logged access, if it matches. Sets 'verify_hw_mismatch' if not.
+static const VerifyHwAccess *verifyHwNext(u32 addr, int width, bool write)
+{
+	if (verify_hw_pos < verify_hw_num) {
+		const VerifyHwAccess *a = &verify_hw_log[verify_hw_pos];
+		if (a->addr == addr && a->width == width && a->write == write) {
+			verify_hw_pos++;
+			return a;
+		}
+	}
+
+	if (!verify_hw_mismatch) {
+		VERIFY_LOG("psxverify: unexpected HW %s%d 0x%08x\n", write ? "write" : "read", width*8, addr);
+	}
+	verify_hw_mismatch = true;
+	return NULL;
+}
+
+u32 psxVerifyHwRead(u32 addr, int width)
+{
+	if (verify_hw_mode == VERIFY_HW_REPLAY) {
+		const VerifyHwAccess *a = verifyHwNext(addr, width, false);
+		return a ? a->value : 0;
+	}
+
+	u32 value;
+	switch (width) {
+		case 1:  value = psxHwRead8(addr);  break;
+		case 2:  value = psxHwRead16(addr); break;
+		default: value = psxHwRead32(addr); break;
+	}
+
+	verifyHwLog(addr, value, width, false);
+	return value;
+}
+
+void psxVerifyHwWrite(u32 addr, u32 value, int width)
+{
+	if (verify_hw_mode == VERIFY_HW_REPLAY) {
+		const VerifyHwAccess *a = verifyHwNext(addr, width, true);
+		if (a && a->value != value)
+			verify_hw_mismatch = true;
+		return;
+	}
+
+	verifyHwLog(addr, value, width, true);
+	verify_hw_writes = true;
+
+	if (addr == 0xfffe0130) {
+		// Remaps RAM and may flush recompiled code: can't be replayed
+		verify_unverifiable = true;
+		psxMemWrite32_CacheCtrlPort(value);
+		return;
+	}
+
+	switch (width) {
+		case 1:  psxHwWrite8(addr, value);  break;
+		case 2:  psxHwWrite16(addr, value); break;
+		default: psxHwWrite32(addr, value); break;
+	}
+}
+
+/* Interpreter run */
+
+// Would the interpreter run an exception or HLE handler for this opcode?
+static bool verifyOpcodeIsBarrier(u32 code)
+{
+	const u32 op = code >> 26;
+	if (op == 0x3b)  // HLE
+		return true;
+	return (op == 0 && ((code & 0x3f) == 0x0c || (code & 0x3f) == 0x0d));  // SYSCALL, BREAK
+}
+
+static bool verifyOpcodeIsBranch(u32 code)
+{
+	const u32 op = code >> 26;
+	if (op == 0)
+		return ((code & 0x3f) == 0x08 || (code & 0x3f) == 0x09);  // JR, JALR
+	return (op >= 0x01 && op <= 0x07);
+}
+
+static bool verifyFetch(u32 pc, u32 *code)
+{
+	const u32 *p = (const u32 *)PSXM(pc);
+	if (p == NULL)
+		return false;
+	*code = SWAP32(*p);
+	return true;
+}
+
+/* Run interpreter until it reaches the PC and cycle the recompiled block
+ *  ended at, or leaves the block's path. Returns false if the block can't
+ *  be verified.
+ */
+static bool verifyRunInterpreter(const psxRegisters *rec)
+{
+	// No events or HW IRQs: restored from 'verify_regs_rec' afterwards
+	psxRegs.intCycle[PSXINT_NEXT_EVENT].sCycle = psxRegs.cycle;
+	psxRegs.intCycle[PSXINT_NEXT_EVENT].cycle = 0x7fffffff;
+	psxHu32ref(0x1074) = 0;
+
+	verify_trace_len = 0;
+	while (verify_trace_len < VERIFY_MAX_INSNS) {
+		const u32 pc = psxRegs.pc;
+		u32 code, bd_code;
+
+		if (!verifyFetch(pc, &code) || verifyOpcodeIsBarrier(code))
+			return false;
+		if (verifyOpcodeIsBranch(code) &&
+		    (!verifyFetch(pc + 4, &bd_code) || verifyOpcodeIsBarrier(bd_code)))
+			return false;
+
+		verify_trace[verify_trace_len++] = pc;
+		execI();
+
+		if (psxRegs.pc == rec->pc && (s32)(psxRegs.cycle - rec->cycle) >= 0)
+			break;
+
+		// Taken branch, jump or exception: a block never goes on past one
+		if (psxRegs.pc != pc + 4 && psxRegs.pc != pc + 8)
+			break;
+	}
+
+	return true;
+}
+
+/* Comparison and report */
+
+static bool verify_reported;
+
+static void verifyPrintOpcode(u32 pc, const char *indent)
+{
+	u32 code;
+	if (!verifyFetch(pc, &code))
+		return;
+#ifdef PSXREC
+	char buf[256];
+	disasm_mips_instruction(code, buf, pc, NULL, 0);
+	printf("  %08x: %08x  %s%s\n", pc, code, indent, buf);
+#else
+	printf("  %08x: %08x\n", pc, code);
+#endif
+}
+
+// Print opcodes interpreter ran, BD slots indented
+static void verifyDisasm(void)
+{
+	for (int i = 0; i < verify_trace_len; i++) {
+		const u32 pc = verify_trace[i];
+		u32 code;
+		verifyPrintOpcode(pc, "");
+		if (verifyFetch(pc, &code) && verifyOpcodeIsBranch(code))
+			verifyPrintOpcode(pc + 4, " ");
+	}
+}
+
+static void verifyCompareRegs(const char *name, const u32 *rec, const u32 *in, int num,
+                              int *diffs, bool print)
+{
+	for (int i = 0; i < num; i++) {
+		if (rec[i] == in[i])
+			continue;
+		if (print)
+			printf("  %s%-2d  rec %08x  int %08x\n", name, i, rec[i], in[i]);
+		(*diffs)++;
+	}
+}
+
+/* Compare interpreter's state to recompiler's, returns number of differences.
+ *  If 'print' is set, each is printed.
+ */
+static int verifyCompare(bool compare_ram, bool print)
+{
+	const psxRegisters *rec = &verify_regs_rec;
+	int diffs = 0;
+
+	if (rec->pc != psxRegs.pc || rec->cycle != psxRegs.cycle) {
+		if (print)
+			printf("  pc %08x cycle %u  rec\n  pc %08x cycle %u  int\n",
+			       rec->pc, rec->cycle, psxRegs.pc, psxRegs.cycle);
+		diffs++;
+	}
+
+	verifyCompareRegs("r",    rec->GPR.r,  psxRegs.GPR.r,  34, &diffs, print);
+	verifyCompareRegs("cp0r", rec->CP0.r,  psxRegs.CP0.r,  32, &diffs, print);
+	verifyCompareRegs("cp2d", rec->CP2D.r, psxRegs.CP2D.r, 32, &diffs, print);
+	verifyCompareRegs("cp2c", rec->CP2C.r, psxRegs.CP2C.r, 32, &diffs, print);
+
+	if (memcmp(verify_hw_rec, psxH, 0x400) != 0) {
+		for (u32 i = 0; i < 0x400; i++) {
+			if (verify_hw_rec[i] != (u8)psxH[i]) {
+				if (print)
+					printf("  scratchpad %08x  rec %02x  int %02x\n",
+					       0x1f800000 + i, verify_hw_rec[i], (u8)psxH[i]);
+				break;
+			}
+		}
+		diffs++;
+	}
+
+	if (verify_hw_mismatch) {
+		if (print)
+			printf("  HW I/O accesses differ\n");
+		diffs++;
+	}
+
+	if (compare_ram && verify_ram_diff) {
+		if (print)
+			printf("  RAM %08x  rec %02x  int %02x\n", verify_ram_diff, verify_ram_diff_rec,
+			       verify_ram_diff_int);
+		diffs++;
+	}
+
+	return diffs;
+}
+
+void psxVerifyBlock(void (*block)(void))
+{
+	if (verify_busy || !verify_ram) {
+		block();
+		return;
+	}
+
+	verify_busy = true;
+
+	const u32 start_pc = psxRegs.pc;
+	u8 *ram = (u8 *)psxM;
+
+	// 1) Save starting state. GTE FLAG is brought up to date wherever
+	//  psxRegs is saved or compared.
+	gte_flag_update();
+	verify_regs = psxRegs;
+	memcpy(verify_ram, ram, VERIFY_RAM_SIZE);
+	memcpy(verify_hw, psxH, VERIFY_HW_SIZE);
+
+	// 2) Run recompiled block
+	verify_hw_num = 0;
+	verify_hw_writes = false;
+	verify_unverifiable = false;
+	verify_hw_mode = VERIFY_HW_RECORD;
+	verify_hw_active = true;
+	block();
+	verify_hw_active = false;
+
+	if (verify_unverifiable) {
+		verify_stats.skipped++;
+		verify_busy = false;
+		return;
+	}
+
+	// 3) Save its results, put back starting state. Only pages it changed
+	//  are written to, so no more code pages than needed lose SMC protection.
+	gte_flag_update();
+	verify_regs_rec = psxRegs;
+	memcpy(verify_hw_rec, psxH, VERIFY_HW_SIZE);
+	for (int page = 0; page < VERIFY_NUM_PAGES; page++) {
+		const u32 offs = page * VERIFY_PAGE_SIZE;
+		verify_page_rec[page] = (memcmp(ram + offs, verify_ram + offs, VERIFY_PAGE_SIZE) != 0);
+		if (verify_page_rec[page]) {
+			memcpy(verify_ram_rec + offs, ram + offs, VERIFY_PAGE_SIZE);
+			memcpy(ram + offs, verify_ram + offs, VERIFY_PAGE_SIZE);
+		}
+	}
+	psxRegs = verify_regs;
+	memcpy(psxH, verify_hw, VERIFY_HW_SIZE);
+
+	// 4) Run interpreter
+	verify_hw_pos = 0;
+	verify_hw_mismatch = false;
+	verify_hw_mode = VERIFY_HW_REPLAY;
+	verify_hw_active = true;
+	const bool ran = verifyRunInterpreter(&verify_regs_rec);
+	verify_hw_active = false;
+	gte_flag_update();
+
+	if (ran && verify_hw_pos != verify_hw_num)
+		verify_hw_mismatch = true;
+
+	// 5) Put back RAM pages the interpreter made differ from the recompiler's,
+	//  noting the first differing byte. Compare, put back the rest.
+	verify_ram_diff = 0;
+	for (int page = 0; page < VERIFY_NUM_PAGES; page++) {
+		const u32 offs = page * VERIFY_PAGE_SIZE;
+		const u8 *src = (verify_page_rec[page] ? verify_ram_rec : verify_ram) + offs;
+		if (memcmp(ram + offs, src, VERIFY_PAGE_SIZE) == 0)
+			continue;
+		for (u32 i = 0; i < VERIFY_PAGE_SIZE && !verify_ram_diff; i++) {
+			if (ram[offs + i] != src[i]) {
+				verify_ram_diff = 0x80000000 + offs + i;
+				verify_ram_diff_rec = src[i];
+				verify_ram_diff_int = ram[offs + i];
+			}
+		}
+		memcpy(ram + offs, src, VERIFY_PAGE_SIZE);
+	}
+
+	if (!ran) {
+		verify_stats.skipped++;
+	} else if (verifyCompare(!verify_hw_writes, false) == 0) {
+		verify_stats.verified++;
+	} else {
+		if (!verify_reported) {
+			printf("Recompiler verification: block at %08x differs from interpreter:\n", start_pc);
+			verifyCompare(!verify_hw_writes, true);
+			printf("  interpreter ran:\n");
+			verifyDisasm();
+			verify_reported = true;
+		}
+		verify_stats.divergent++;
+	}
+
+	psxRegs = verify_regs_rec;
+	memcpy(psxH, verify_hw_rec, VERIFY_HW_SIZE);
+
+	verify_busy = false;
+}
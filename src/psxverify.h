@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Lock-step verification of a recompiler against the interpreter
+ *
+ *  Each recompiled block is run as usual, then the interpreter runs the
+ * same guest code again from the state the block started in. Their final
+ * GPRs, HI/LO, COP0, GTE registers, PC, cycle count, RAM and scratchpad
+ * are compared and the first block that differs is reported with a
+ * disassembly. Emulation then goes on from the recompiler's state.
+ *
+ *  Enabled at runtime with Config.RecVerify (-recverify command line
+ * option). When disabled, the only cost is a test of 'verify_hw_active'
+ * on each HW I/O access. See psxverify.cpp for what isn't verified.
+ */
+
+#ifndef PSXVERIFY_H
+#define PSXVERIFY_H
+
+#include "psxcommon.h"
+
+extern bool verify_hw_active;
+
+int  psxVerifyInit(void);
+void psxVerifyShutdown(void);
+void psxVerifyPrintStats(void);
+
+// Run recompiled 'block' for code at psxRegs.pc, then verify it
+void psxVerifyBlock(void (*block)(void));
+
+// HW I/O accesses (anything psxMemRead*()/psxMemWrite*() would pass to
+//  psxHwRead*()/psxHwWrite*() or the cache control port) made while a
+//  block is verified. 'width' is 1, 2 or 4.
+u32  psxVerifyHwRead(u32 addr, int width);
+void psxVerifyHwWrite(u32 addr, u32 value, int width);
+
+#endif //PSXVERIFY_H
@@ -31,10 +31,14 @@
 #include "mdec.h"
 #include "gte.h"
 #include "psxevents.h"
+#include "psxidle.h"
+#include "psxbioshook.h"
+#include "psxsmc.h"
+#include "psxprofile.h"
 
 PcsxConfig Config;
 R3000Acpu *psxCpu=NULL;
-psxRegisters psxRegs;
+psxRegisters psxRegs __attribute__((aligned(64)));
 
 int psxInit() {
 	printf("Running PCSX Version %s (%s).\n", PACKAGE_VERSION, __DATE__);
@@ -43,17 +47,29 @@ int psxInit() {
 	#ifndef interpreter_none
 	if (Config.Cpu == CPU_INTERPRETER) {
 		psxCpu = &psxInt;
+	} else if (Config.Cpu == CPU_INTERPRETER_BLOCK) {
+		psxCpu = &psxIntBlock;
+	} else if (Config.Cpu == CPU_INTERPRETER_THREADED) {
+		psxCpu = &psxIntThreaded;
 	} else
 	#endif
 	psxCpu = &psxRec;
 #else
-	psxCpu = &psxInt;
+	if (Config.Cpu == CPU_INTERPRETER_BLOCK)
+		psxCpu = &psxIntBlock;
+	else if (Config.Cpu == CPU_INTERPRETER_THREADED)
+		psxCpu = &psxIntThreaded;
+	else
+		psxCpu = &psxInt;
 #endif
 
+	gteInit();
+
 	// Initialize CPU *before* calling psxMemInit(), so it can make any
 	//  memory mappings it needs for psxM,psxH etc.
 	if (psxCpu->Init() < 0)
 		return -1;
+	psxProfileInit();
 	return psxMemInit();
 }
 
@@ -63,6 +79,7 @@ void psxReset() {
 
 	psxMemReset();
 
+	gte_flag_update();
 	memset(&psxRegs, 0, sizeof(psxRegs));
 
 	psxRegs.writeok = 1;
@@ -78,6 +95,8 @@ void psxReset() {
 	psxRegs.CP0.r[15] = 0x00000002; // PRevID = Revision ID, same as R3000A
 
 	psxEvqueueInit();  // Event scheduler queue
+	psxIdleReset();
+	psxBiosHookReset();
 	psxHwReset();
 	psxBiosInit();
 
@@ -90,6 +109,13 @@ void psxShutdown() {
 	//  psxM,psxH etc, if it has done so.
 	psxCpu->Shutdown();
 
+	// Needs guest RAM to find functions
+	psxProfileShutdown();
+
+	psxIdlePrintStats();
+	psxBiosHookPrintStats();
+	psxSmcPrintStats();
+
 	psxMemShutdown();
 	psxBiosShutdown();
 
@@ -144,6 +170,8 @@ void psxBranchTest()
 	psxRegs.io_cycle_counter = psxRegs.intCycle[PSXINT_NEXT_EVENT].sCycle +
 	                           psxRegs.intCycle[PSXINT_NEXT_EVENT].cycle;
 
+	profile_sample();
+
 	// Are one or more HW IRQ bits set in both their status and mask registers?
 	if (psxHu32(0x1070) & psxHu32(0x1074)) {
 		// Are both HW IRQ mask bit and IRQ master-enable bit set in CP0 status reg?
@@ -164,3 +192,107 @@ void psxExecuteBios() {
 	while (psxRegs.pc != 0x80030000)
 		psxCpu->ExecuteBlock(0x80030000);
 }
+
+/* Savestate format of psxRegs: a u32 version and a u32 payload size,
+ * followed by the fields listed in psxRegsFreezeFields(). Loading skips
+ * any payload past the fields it knows, so fields can be appended without
+ * breaking older emulator builds. If existing fields change, bump
+ * PSXREGS_FREEZE_VERSION and keep loading the older versions.
+ */
+#define PSXREGS_FREEZE_VERSION 1
+
+#define PSXREGS_FREEZE_SIZE \
+	(sizeof(psxRegs.GPR.r) + sizeof(psxRegs.CP0.r) + \
+	 sizeof(psxRegs.CP2D.r) + sizeof(psxRegs.CP2C.r) + 4 * sizeof(u32) + \
+	 sizeof(psxRegs.intCycle) + sizeof(u32))
+
+// Same order as the first fields of old raw psxRegisters dumps
+static int psxRegsFreezeFields(void *f, FreezeMode mode)
+{
+	u32 writeok = psxRegs.writeok;
+
+	gte_flag_update();
+
+	if (    freeze_rw(f, mode, psxRegs.GPR.r, sizeof(psxRegs.GPR.r))
+	     || freeze_rw(f, mode, psxRegs.CP0.r, sizeof(psxRegs.CP0.r))
+	     || freeze_rw(f, mode, psxRegs.CP2D.r, sizeof(psxRegs.CP2D.r))
+	     || freeze_rw(f, mode, psxRegs.CP2C.r, sizeof(psxRegs.CP2C.r))
+	     || freeze_rw(f, mode, &psxRegs.pc, sizeof(u32))
+	     || freeze_rw(f, mode, &psxRegs.code, sizeof(u32))
+	     || freeze_rw(f, mode, &psxRegs.cycle, sizeof(u32))
+	     || freeze_rw(f, mode, &psxRegs.interrupt, sizeof(u32))
+	     || freeze_rw(f, mode, psxRegs.intCycle, sizeof(psxRegs.intCycle))
+	     || freeze_rw(f, mode, &writeok, sizeof(u32)) )
+		return -1;
+
+	psxRegs.writeok = writeok;
+	return 0;
+}
+
+int psxRegsFreeze(void *f, FreezeMode mode)
+{
+	u32 version = PSXREGS_FREEZE_VERSION;
+	u32 size = PSXREGS_FREEZE_SIZE;
+
+	if (    freeze_rw(f, mode, &version, sizeof(version))
+	     || freeze_rw(f, mode, &size, sizeof(size)) )
+		return -1;
+
+	if (mode == FREEZE_LOAD &&
+	    (version > PSXREGS_FREEZE_VERSION || size < PSXREGS_FREEZE_SIZE)) {
+		printf("Error: unsupported CPU register savestate data, version %u size %u\n",
+		       version, size);
+		return -1;
+	}
+
+	if (psxRegsFreezeFields(f, mode))
+		return -1;
+
+	if (mode == FREEZE_LOAD && size > PSXREGS_FREEZE_SIZE) {
+		if (SaveFuncs.seek(f, size - PSXREGS_FREEZE_SIZE, SEEK_CUR) == -1)
+			return -1;
+	}
+
+	return 0;
+}
+
+int psxRegsFreezeLegacy(void *f)
+{
+	// psxRegisters as it was laid out when savestates held a raw copy of it.
+	//  It has host pointers in it, so its size depends on the host.
+	struct {
+		psxGPRRegs GPR;
+		psxCP0Regs CP0;
+		psxCP2Data CP2D;
+		psxCP2Ctrl CP2C;
+		u32 pc;
+		u32 code;
+		u32 cycle;
+		u32 interrupt;
+		intCycle_t intCycle[32];
+		u32 io_cycle_counter;
+		s8 *psxM;
+		s8 *psxP;
+		s8 *psxR;
+		s8 *psxH;
+		void *reserved;
+		int writeok;
+	} old;
+
+	if (freeze_rw(f, FREEZE_LOAD, &old, sizeof(old)))
+		return -1;
+
+	gte_flag_update();
+
+	psxRegs.GPR = old.GPR;
+	psxRegs.CP0 = old.CP0;
+	psxRegs.CP2D = old.CP2D;
+	psxRegs.CP2C = old.CP2C;
+	psxRegs.pc = old.pc;
+	psxRegs.code = old.code;
+	psxRegs.cycle = old.cycle;
+	psxRegs.interrupt = old.interrupt;
+	memcpy(psxRegs.intCycle, old.intCycle, sizeof(psxRegs.intCycle));
+	psxRegs.writeok = old.writeok;
+	return 0;
+}
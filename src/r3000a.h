@@ -45,6 +45,8 @@ typedef struct {
 
 extern R3000Acpu *psxCpu;
 extern R3000Acpu psxInt;
+extern R3000Acpu psxIntBlock;
+extern R3000Acpu psxIntThreaded;
 #ifdef PSXREC
 extern R3000Acpu psxRec;
 #endif
@@ -155,19 +157,27 @@ struct intCycle_t {
 	u32 cycle;  // Number of cycles past sCycle above when event should occur
 };
 
+/* Fields used by nearly every emulated instruction or block, by the
+ * interpreters and the dynarecs alike, come first so they share the first
+ * three cache lines (psxRegs is 64-byte aligned). Layout can be changed
+ * freely: savestates use psxRegsFreeze(), not the in-memory layout.
+ */
 typedef struct {
+	// Hot
 	psxGPRRegs GPR;		/* General Purpose Registers */
-	psxCP0Regs CP0;		/* Coprocessor0 Registers */
-	psxCP2Data CP2D; 	/* Cop2 data registers */
-	psxCP2Ctrl CP2C; 	/* Cop2 control registers */
 	u32 pc;			/* Program counter */
 	u32 code;		/* The instruction */
 	u32 cycle;
+	u32 io_cycle_counter;
 	u32 interrupt;
+	int writeok;
 
-	intCycle_t intCycle[32];
+	// Cold
+	psxCP0Regs CP0;		/* Coprocessor0 Registers */
+	psxCP2Data CP2D; 	/* Cop2 data registers */
+	psxCP2Ctrl CP2C; 	/* Cop2 control registers */
 
-	u32 io_cycle_counter;
+	intCycle_t intCycle[32];
 
 	s8 *psxM;
 	s8 *psxP;
@@ -175,11 +185,16 @@ typedef struct {
 	s8 *psxH;
 
 	void *reserved;
-	int writeok;
 } psxRegisters;
 
 extern psxRegisters psxRegs;
 
+// Savestate load/save of psxRegs. Versions before 0x8b410007 stored
+//  psxRegs as a raw copy of its old layout, load them with
+//  psxRegsFreezeLegacy() instead.
+int psxRegsFreeze(void *f, FreezeMode mode);
+int psxRegsFreezeLegacy(void *f);
+
 #if defined(__BIGENDIAN__)
 
 #define _i32(x) *(s32 *)&x
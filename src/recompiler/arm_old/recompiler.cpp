@@ -29,6 +29,10 @@
 #include "arm.h"
 #include "port.h"
 
+#ifdef USE_COMPACT_MEMLUT
+#error "arm_old dynarec emits lookups into the flat psxMemRLUT/psxMemWLUT, build without USE_COMPACT_MEMLUT"
+#endif
+
 static u32 psxRecLUT[0x010000];
 
 #undef PC_REC
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include "mem_mapping.h"
 #include "psxmem.h"
+#include "psxsmc.h"
 
 #if defined(SHMEM_MIRRORING) || defined(TMPFS_MIRRORING)
 #include <fcntl.h>
@@ -146,6 +147,12 @@ int rec_mmap_psx_mem()
 	l_psxM_mirrored = true;
 	printf(" ..mapped to %p\n", (void*)psxM);
 
+	// Emitted stores write through the mirrors, so code pages must be
+	//  write-protected in them too (see psxsmc.cpp)
+	psxSmcAddMirror((void*)(PSX_MEM_VADDR+0x200000));
+	psxSmcAddMirror((void*)(PSX_MEM_VADDR+0x400000));
+	psxSmcAddMirror((void*)(PSX_MEM_VADDR+0x600000));
+
 	printf("Mapping 8MB Expansion ROM + 64KB PSX HW I/O regions using mmap\n");
 	// Map regions to start at offset past psxM that matches PSX mapping,
 	//  i.e. if psxM starts at 0x1000_0000, expansion region will be at
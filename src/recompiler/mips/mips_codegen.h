@@ -214,6 +214,9 @@ do { \
 #define LHU(rt, rs, imm16) \
 	write32(0x94000000 | ((rs) << 21) | ((rt) << 16) | ((imm16) & 0xffff))
 
+#define SH(rd, rs, imm16) \
+	write32(0xa4000000 | ((rs) << 21) | ((rd) << 16) | ((imm16) & 0xffff))
+
 #define SW(rd, rs, imm16) \
 	write32(0xac000000 | ((rs) << 21) | ((rd) << 16) | ((imm16) & 0xffff))
 
@@ -325,6 +328,10 @@ do { \
 #define MULTU(rs, rt) \
 	write32(0x00000019 | ((rs) << 21) | ((rt) << 16))
 
+/* MADD is MIPS32r1: HI:LO += rs * rt (signed) */
+#define MADD(rs, rt) \
+	write32(0x70000000 | ((rs) << 21) | ((rt) << 16))
+
 #define DIV(rs, rt) \
 	write32(0x0000001a | ((rs) << 21) | ((rt) << 16))
 
@@ -337,6 +344,12 @@ do { \
 #define MFHI(rd) \
 	write32(0x00000010 | ((rd) << 11))
 
+#define MTLO(rs) \
+	write32(0x00000013 | ((rs) << 21))
+
+#define MTHI(rs) \
+	write32(0x00000011 | ((rs) << 21))
+
 #define SLT(rd, rs, rt) \
 	write32(0x0000002a | ((rs) << 21) | ((rt) << 16) | ((rd) << 11))
 
@@ -455,6 +468,12 @@ do {                                                                           \
 #define rec_recompile_use_fastpath_return(newpc__)                             \
     (block_fast_ret_addr && ((newpc__) == oldpc))
 
+/* Blocks returning directly can instead exit through a jump that's linked to
+ *  the block at a known-const new PC, see emitBlockLink() in rec_bcu.cpp.h
+ */
+#define rec_recompile_use_block_link(newpc__)                                  \
+    (block_ret_addr && recCanLinkBlock(newpc__))
+
 #define rec_recompile_end_part2(use_fastpath_return)                           \
 do {                                                                           \
     const u32 cycles = ADJUST_CLOCK((pc-oldpc)/4);                             \
@@ -568,9 +587,4 @@ bool opcodeIsALU(const u32 opcode, struct ALUOpInfo *info);
 u64 opcodeGetReads(const u32 op);
 u64 opcodeGetWrites(const u32 op);
 
-int rec_scan_for_div_by_zero_check_sequence(u32 code_loc);
-int rec_scan_for_MFHI_MFLO_sequence(u32 code_loc);
-int rec_discard_scan(u32 code_loc, int *discard_type);
-const char* rec_discard_type_str(int discard_type);
-
 #endif /* MIPS_CODEGEN_H */
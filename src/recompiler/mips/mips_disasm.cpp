@@ -608,7 +608,7 @@ void disasm_mips_instruction(u32 opcode, char *buffer, u32 pc,
       for(i = 0; i < num_labels; i++)
       {
         //DEBUGG("label 0x%x pcoff 0x%x\n", (u32)labels[i].address, pc_offset());
-        if((u32)labels[i].address == pc_offset())
+        if((u32)(uptr)labels[i].address == pc_offset())
         {
           sprintf(buffer, "%s %s, %s", mips_function_regimm_names[function], reg_op(reg_rs),
            labels[i].name);
@@ -801,7 +801,7 @@ void disasm_mips_instruction(u32 opcode, char *buffer, u32 pc,
       for(i = 0; i < num_labels; i++)
       {
         //DEBUGG("label 0x%x pcoff 0x%x\n", (u32)labels[i].address, offset);
-        if((u32)labels[i].address == offset)
+        if((u32)(uptr)labels[i].address == offset)
         {
           sprintf(buffer, "%s %s", mips_opcode_names[opcode_type],
            labels[i].name);
@@ -819,7 +819,7 @@ void disasm_mips_instruction(u32 opcode, char *buffer, u32 pc,
       for(i = 0; i < num_labels; i++)
       {
         //DEBUGG("label 0x%x pcoff 0x%x\n", (u32)labels[i].address, pc_offset());
-        if((u32)labels[i].address == pc_offset())
+        if((u32)(uptr)labels[i].address == pc_offset())
         {
           sprintf(buffer, "%s %s, %s", mips_opcode_names[opcode_type], reg_op(reg_rs),
            labels[i].name);
@@ -837,7 +837,7 @@ void disasm_mips_instruction(u32 opcode, char *buffer, u32 pc,
       for(i = 0; i < num_labels; i++)
       {
         //DEBUGG("label 0x%x pcoff 0x%x\n", (u32)labels[i].address, pc_offset());
-        if((u32)labels[i].address == pc_offset())
+        if((u32)(uptr)labels[i].address == pc_offset())
         {
           sprintf(buffer, "%s %s, %s, %s", mips_opcode_names[opcode_type], reg_op(reg_rs),
            reg_op(reg_rt), labels[i].name);
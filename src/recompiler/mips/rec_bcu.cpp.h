@@ -144,6 +144,52 @@ static void emitJumpAndLinkReturnAddress(const u32 reg,
 		LI32(reg, return_pc);
 }
 
+/* Emit exit code for a block leaving to known-const PC 'new_pc'. Used in place
+ *  of rec_recompile_end_part2() when rec_recompile_use_block_link() allows.
+ *  $v0 must already hold 'new_pc'.
+ *
+ *  The block adds its own cycles to psxRegs.cycle. Unless psxBranchTest()
+ *  is due, it then takes a jump that starts out going to the dispatch loop
+ *  and gets patched to go straight to the block at 'new_pc' once it's
+ *  recompiled. See block linking notes in recompiler.cpp.
+ */
+static void emitBlockLink(const u32 new_pc)
+{
+	const u32 cycles = ADJUST_CLOCK((pc-oldpc)/4);
+
+	LW(TEMP_0, PERM_REG_1, off(cycle));
+	LW(TEMP_1, PERM_REG_1, off(io_cycle_counter));
+	if (cycles <= 0x7fff) {
+		ADDIU(TEMP_0, TEMP_0, cycles);
+	} else {
+		LI32(TEMP_2, cycles);
+		ADDU(TEMP_0, TEMP_0, TEMP_2);
+	}
+	SLTU(TEMP_1, TEMP_0, TEMP_1);         // TEMP_1 = 0 if psxBranchTest() is due
+	SW(TEMP_0, PERM_REG_1, off(cycle));
+
+	if (emit_code_invalidations) {
+		// Stores in emitted code invalidate blocks by clearing their block
+		//  ptr directly, leaving jumps to them linked: check it's still set.
+		const uptr block_ptr_addr = PC_REC(new_pc);
+		LUI(TEMP_2, ADR_HI(block_ptr_addr));
+		LW(TEMP_2, TEMP_2, ADR_LO(block_ptr_addr));
+		MOVZ(TEMP_1, 0, TEMP_2);          // TEMP_1 = 0 if block needs recompiling
+	}
+
+	BEQZ(TEMP_1, 12);                     // Return to dispatch loop below..
+	LI16(MIPSREG_V1, 0);                  // <BD> ..with no cycles left to add
+
+	u32 * const link_site = recMem;
+	J(block_ret_addr);                    // Patched to jump to linked block
+	SW(MIPSREG_V0, PERM_REG_1, off(pc));  // <BD>
+
+	J(block_ret_addr);
+	NOP();                                // <BD>
+
+	recAddBlockLink(link_site, new_pc);
+}
+
 static void recSYSCALL()
 {
 	regClearJump();
@@ -278,8 +324,10 @@ static void iJumpNormal(u32 bpc)
 
 	recDelaySlot();
 
-	// Can block use 'fastpath' return? (branches backward to its beginning)
-	const bool use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	// Can block be linked to the block at 'bpc'? If not, can it use
+	//  'fastpath' return? (branches backward to its beginning)
+	const bool use_block_link = rec_recompile_use_block_link(bpc);
+	const bool use_fastpath_return = !use_block_link && rec_recompile_use_fastpath_return(bpc);
 
 	rec_recompile_end_part1();
 	regClearJump();
@@ -288,7 +336,10 @@ static void iJumpNormal(u32 bpc)
 	if (!use_fastpath_return)
 		emitBlockReturnPC(bpc, BCU_FIRST_INSTRUCTION_ALWAYS_EXECUTED);
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_block_link)
+		emitBlockLink(bpc);
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	end_block = 1;
 }
@@ -312,8 +363,10 @@ static void iJumpAL(u32 bpc, u32 nbpc)
 		recDelaySlot();
 	}
 
-	// Can block use 'fastpath' return? (branches backward to its beginning)
-	const bool use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	// Can block be linked to the block at 'bpc'? If not, can it use
+	//  'fastpath' return? (branches backward to its beginning)
+	const bool use_block_link = rec_recompile_use_block_link(bpc);
+	const bool use_fastpath_return = !use_block_link && rec_recompile_use_fastpath_return(bpc);
 
 	rec_recompile_end_part1();
 	regClearJump();
@@ -322,7 +375,10 @@ static void iJumpAL(u32 bpc, u32 nbpc)
 	if (!use_fastpath_return)
 		emitBlockReturnPC(bpc, BCU_FIRST_INSTRUCTION_ALWAYS_EXECUTED);
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_block_link)
+		emitBlockLink(bpc);
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	end_block = 1;
 }
@@ -451,8 +507,10 @@ static void emitBxxZ(int andlink, u32 bpc, u32 nbpc)
 	// IMPORTANT: Don't emit any instructions between here (BD slot) and
 	//            the call to emitBlockReturnPC(). It affects PC caching.
 
-	// Can block use 'fastpath' return? (branches backward to its beginning)
-	const bool use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	// Can block be linked to the block at the branch target? If not, can it
+	//  use 'fastpath' return? (branches backward to its beginning)
+	const bool use_block_link = rec_recompile_use_block_link(dt == 2 ? bpc + 4 : bpc);
+	const bool use_fastpath_return = !use_block_link && rec_recompile_use_fastpath_return(bpc);
 
 	regPushState();
 
@@ -483,7 +541,10 @@ static void emitBxxZ(int andlink, u32 bpc, u32 nbpc)
 	if (bd_slot_loc == (uptr)recMem)
 		NOP();  // <BD slot>
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_block_link)
+		emitBlockLink(bpc);
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	regPopState();
 
@@ -588,8 +649,10 @@ static void emitBxx(u32 bpc)
 	// IMPORTANT: Don't emit any instructions between here (BD slot) and
 	//            the call to emitBlockReturnPC(). It affects PC caching.
 
-	// Can block use 'fastpath' return? (branches backward to its beginning)
-	const bool use_fastpath_return = rec_recompile_use_fastpath_return(bpc);
+	// Can block be linked to the block at 'bpc'? If not, can it use
+	//  'fastpath' return? (branches backward to its beginning)
+	const bool use_block_link = rec_recompile_use_block_link(bpc);
+	const bool use_fastpath_return = !use_block_link && rec_recompile_use_fastpath_return(bpc);
 
 	// Only need to set $v0 to new PC when not returning to 'fastpath'.
 	if (!use_fastpath_return)
@@ -605,7 +668,10 @@ static void emitBxx(u32 bpc)
 	if (bd_slot_loc == (uptr)recMem)
 		NOP();  // <BD slot>
 
-	rec_recompile_end_part2(use_fastpath_return);
+	if (use_block_link)
+		emitBlockLink(bpc);
+	else
+		rec_recompile_end_part2(use_fastpath_return);
 
 	fixup_branch(backpatch);
 	regUnlock(br1);
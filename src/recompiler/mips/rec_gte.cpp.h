@@ -22,13 +22,26 @@
 //  creates load stalls.
 #define SKIP_MFC2_WRITEBACK
 
+// Emit native code for NCLIP, AVSZ3, AVSZ4, SQR, OP and RTPS instead of
+//  calling their C versions, when nothing reads the FLAG reg they'd set.
+//  See emitGteNative().
+#ifdef HAVE_MIPS32_3OP_MUL
+#define USE_GTE_NATIVE_OPS
+#endif
+
+
+static bool emitGteNative();
 
-/* Emit code to call a GTE func that takes no arguments */
+/* Emit code to call a GTE func that takes no arguments. In lazy FLAG mode,
+ *  ops are called through their gteLazyXXX() versions (see gte.cpp).
+ */
 #define CP2_FUNC_0(f) \
 extern void gte##f(); \
+extern void gteLazy##f(); \
 void rec##f() \
 { \
-	JAL(gte##f); \
+	if (emitGteNative()) return; \
+	JAL(gte_lazy_flag ? gteLazy##f : gte##f); \
 	NOP(); /* <BD slot> */ \
 }
 
@@ -38,12 +51,31 @@ void rec##f() \
  */
 #define CP2_FUNC_1(f) \
 extern void gte##f(u32 gteop); \
+extern void gteLazy##f(u32 gteop); \
 void rec##f() \
 { \
-	JAL(gte##f); \
+	JAL(gte_lazy_flag ? gteLazy##f : gte##f); \
 	LI16(MIPSREG_A0, (u16)(psxRegs.code >> 10)); /* <BD slot> */ \
 }
 
+/* Emit code to call the version of a one-argument GTE func specialized for
+ *  this opcode's parameters (see gte.h), which takes no argument. Lazy FLAG
+ *  mode's versions take the argument as usual.
+ */
+#define CP2_FUNC_T(f, index) \
+extern void gteLazy##f(u32 gteop); \
+void rec##f() \
+{ \
+	if (emitGteNative()) return; \
+	if (gte_lazy_flag) { \
+		JAL(gteLazy##f); \
+		LI16(MIPSREG_A0, (u16)(psxRegs.code >> 10)); /* <BD slot> */ \
+	} else { \
+		JAL(gte##f##Fns[index(psxRegs.code >> 10)]); \
+		NOP(); /* <BD slot> */ \
+	} \
+}
+
 CP2_FUNC_0(RTPS)
 CP2_FUNC_0(NCLIP)
 CP2_FUNC_0(NCDS)
@@ -58,19 +90,33 @@ CP2_FUNC_0(AVSZ3)
 CP2_FUNC_0(AVSZ4)
 CP2_FUNC_0(RTPT)
 CP2_FUNC_0(NCCT)
-CP2_FUNC_1(OP)
+CP2_FUNC_T(OP, GTE_SF_LM_INDEX)
 CP2_FUNC_1(DPCS)
 CP2_FUNC_1(INTPL)
-CP2_FUNC_1(MVMVA)
-CP2_FUNC_1(SQR)
+CP2_FUNC_T(MVMVA, GTE_MVMVA_INDEX)
+CP2_FUNC_T(SQR, GTE_SF_LM_INDEX)
 CP2_FUNC_1(DCPL)
-CP2_FUNC_1(GPF)
-CP2_FUNC_1(GPL)
+CP2_FUNC_T(GPF, GTE_SF_INDEX)
+CP2_FUNC_T(GPL, GTE_SF_INDEX)
+
+/* In lazy FLAG mode, bring FLAG up to date before it's read, and before
+ *  any control reg is written (a pending FLAG depends on them)
+ */
+static void emitFlagFlush()
+{
+	if (gte_lazy_flag) {
+		JAL(gteFlagFlush);
+		NOP(); /* <BD slot> */
+	}
+}
 
 static void recCFC2()
 {
 	if (!_Rt_) return;
 
+	if (_Rd_ == 31)
+		emitFlagFlush();
+
 	SetUndef(_Rt_);
 	u32 rt = regMipsToHost(_Rt_, REG_FIND, REG_REGISTER);
 
@@ -114,6 +160,7 @@ static void emitCTC2(u32 rt, u32 reg)
 
 static void recCTC2()
 {
+	emitFlagFlush();
 	u32 rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
 	emitCTC2(rt, _Rd_);
 	regUnlock(rt);
@@ -128,6 +175,325 @@ static void emitLIM(u32 rt, u32 min_reg, u32 max_reg, u32 tmp_reg)
 	MOVN(rt, max_reg, tmp_reg);   // if (tmp_reg) rt = max_reg
 }
 
+#ifdef USE_GTE_NATIVE_OPS
+/* Native GTE ops
+ *
+ *  These compute everything but FLAG, so they're only used when the FLAG an
+ * op sets is never read: scanning ahead in the block, another GTE op or a
+ * CTC2 to FLAG overwrites it before any CFC2 from FLAG. Near the end of a
+ * block, where code elsewhere could read it, the C versions are called.
+ *  In lazy FLAG mode, a FLAG still pending from an earlier op is left that
+ * way: the op overwriting it next computes its own one in C.
+ *
+ *  GTE regs are read once each into host regs, and results written once.
+ * Only $t0..$t3 and $a0..$a3 are used: t4..t7 aren't allocated to PSX regs
+ * across GTE opcodes (see regOpcodeClass()), but might be one day.
+ */
+
+// Most opcodes gteFlagIsDead() scans ahead
+#define GTE_FLAG_SCAN_MAX 32
+
+static void recNULL();
+
+/* Is FLAG as set by the GTE op being recompiled never read? */
+static bool gteFlagIsDead()
+{
+	// In a BD slot, the block ends right after the op
+	if (branch)
+		return false;
+
+	u32 PC = pc;
+	for (int i = 0; i < GTE_FLAG_SCAN_MAX; i++, PC += 4) {
+		// Don't read past the 64KB page, like regAnalyzeBlock()
+		if ((PC & 0xffff) == 0)
+			return false;
+
+		const u32 opcode = OPCODE_AT(PC);
+
+		if (_fOp_(opcode) == 0x12) {
+			// GTE op: sets all of FLAG
+			if (opcode & (1 << 25))
+				return _fFunct_(opcode) != 0 && recCP2[_fFunct_(opcode)] != recNULL;
+
+			if (_fRd_(opcode) == 31) {
+				if (_fRs_(opcode) == 2)  // CFC2
+					return false;
+				if (_fRs_(opcode) == 6)  // CTC2
+					return true;
+			}
+			continue;
+		}
+
+		// Code after a branch, jump or barrier opcode might not run
+		const int op_class = regOpcodeClass(opcode);
+		if (op_class != REG_OP_INLINE && op_class != REG_OP_CALLS)
+			return false;
+	}
+
+	return false;
+}
+
+/* Limit rt to [min .. max], tmp_min, tmp_max, tmp_reg are overwritten */
+static void emitClamp(u32 rt, s32 min, s32 max, u32 tmp_min, u32 tmp_max, u32 tmp_reg)
+{
+	if (min == 0)
+		tmp_min = 0;
+	else
+		LI32(tmp_min, min);
+	LI32(tmp_max, max);
+	emitLIM(rt, tmp_min, tmp_max, tmp_reg);
+}
+
+/* rd = (s32)((HI:LO) >> shift), 0 < shift < 32 (clobbers tmp_reg) */
+static void emitMFHILOShift(u32 rd, u32 shift, u32 tmp_reg)
+{
+	MFLO(rd);
+	MFHI(tmp_reg);
+	SRL(rd, rd, shift);
+	SLL(tmp_reg, tmp_reg, 32 - shift);
+	OR(rd, rd, tmp_reg);
+}
+
+/* HI:LO = (s64)rs << shift, 0 <= shift < 32 (clobbers rs, tmp_reg) */
+static void emitMTHILO(u32 rs, u32 shift, u32 tmp_reg)
+{
+	SRA(tmp_reg, rs, shift ? 32 - shift : 31);
+	if (shift)
+		SLL(rs, rs, shift);
+	MTHI(tmp_reg);
+	MTLO(rs);
+}
+
+static void emitNCLIP()
+{
+	// gteMAC0 = gteSX0 * (gteSY1 - gteSY2) + gteSX1 * (gteSY2 - gteSY0) +
+	//           gteSX2 * (gteSY0 - gteSY1);
+	// (Low 32 bits of the 64-bit sum, which is all FLAG aside is kept)
+	LH(TEMP_0, PERM_REG_1, off(CP2D.p[12].sw.l));      // gteSX0
+	LH(TEMP_1, PERM_REG_1, off(CP2D.p[12].sw.h));      // gteSY0
+	LH(TEMP_2, PERM_REG_1, off(CP2D.p[13].sw.l));      // gteSX1
+	LH(TEMP_3, PERM_REG_1, off(CP2D.p[13].sw.h));      // gteSY1
+	LH(MIPSREG_A0, PERM_REG_1, off(CP2D.p[14].sw.l));  // gteSX2
+	LH(MIPSREG_A1, PERM_REG_1, off(CP2D.p[14].sw.h));  // gteSY2
+
+	SUBU(MIPSREG_A2, TEMP_3, MIPSREG_A1);              // gteSY1 - gteSY2
+	MUL(MIPSREG_A2, TEMP_0, MIPSREG_A2);
+	SUBU(MIPSREG_A3, MIPSREG_A1, TEMP_1);              // gteSY2 - gteSY0
+	MUL(MIPSREG_A3, TEMP_2, MIPSREG_A3);
+	SUBU(TEMP_1, TEMP_1, TEMP_3);                      // gteSY0 - gteSY1
+	MUL(TEMP_1, MIPSREG_A0, TEMP_1);
+	ADDU(MIPSREG_A2, MIPSREG_A2, MIPSREG_A3);
+	ADDU(MIPSREG_A2, MIPSREG_A2, TEMP_1);
+	SW(MIPSREG_A2, PERM_REG_1, off(CP2D.r[24]));       // gteMAC0
+}
+
+/* AVSZ3 (num_sz == 3) and AVSZ4 (num_sz == 4) */
+static void emitAVSZ(int num_sz)
+{
+	// gteMAC0 = gteZSF3 * (gteSZ1 + gteSZ2 + gteSZ3);  or
+	// gteMAC0 = gteZSF4 * (gteSZ0 + gteSZ1 + gteSZ2 + gteSZ3);
+	// gteOTZ = limD(gteMAC0 >> 12);
+	const int first_sz = 4 - num_sz;
+
+	LH(TEMP_0, PERM_REG_1, offCP2C(num_sz == 3 ? 29 : 30)); // gteZSF3/4
+	LHU(TEMP_1, PERM_REG_1, off(CP2D.p[16 + first_sz].w.l));
+	for (int i = first_sz + 1; i < 4; i++) {
+		LHU(TEMP_2, PERM_REG_1, off(CP2D.p[16 + i].w.l));
+		ADDU(TEMP_1, TEMP_1, TEMP_2);
+	}
+	MUL(TEMP_1, TEMP_0, TEMP_1);
+	SW(TEMP_1, PERM_REG_1, off(CP2D.r[24]));           // gteMAC0
+
+	SRA(TEMP_1, TEMP_1, 12);
+	emitClamp(TEMP_1, 0, 0xffff, TEMP_0, TEMP_2, TEMP_3);
+	SH(TEMP_1, PERM_REG_1, off(CP2D.p[7].w.l));        // gteOTZ
+}
+
+static void emitAVSZ3() { emitAVSZ(3); }
+static void emitAVSZ4() { emitAVSZ(4); }
+
+/* Store MAC1..3 results in 'mac' regs, then IR1..3 limited per 'lm' */
+static void emitStoreMAC123(const u32 mac[3], int lm)
+{
+	for (int i = 0; i < 3; i++) {
+		SW(mac[i], PERM_REG_1, off(CP2D.r[25 + i]));    // gteMACi
+		emitClamp(mac[i], lm ? 0 : -0x8000, 0x7fff, TEMP_0, TEMP_1, TEMP_2);
+		SH(mac[i], PERM_REG_1, off(CP2D.p[9 + i].sw.l)); // gteIRi
+	}
+}
+
+static void emitSQR()
+{
+	// gteMACi = (gteIRi * gteIRi) >> shift;
+	// gteIRi = limBi(gteMACi, lm);
+	const bool sf = psxRegs.code & (1 << 19);
+	const bool lm = psxRegs.code & (1 << 10);
+	const u32 mac[3] = { MIPSREG_A0, MIPSREG_A1, MIPSREG_A2 };
+
+	for (int i = 0; i < 3; i++) {
+		LH(mac[i], PERM_REG_1, off(CP2D.p[9 + i].sw.l)); // gteIRi
+		MUL(mac[i], mac[i], mac[i]);
+		if (sf)
+			SRA(mac[i], mac[i], 12);
+	}
+
+	emitStoreMAC123(mac, lm);
+}
+
+static void emitOP()
+{
+	// gteMAC1 = ((gteR22 * gteIR3) - (gteR33 * gteIR2)) >> shift;
+	// gteMAC2 = ((gteR33 * gteIR1) - (gteR11 * gteIR3)) >> shift;
+	// gteMAC3 = ((gteR11 * gteIR2) - (gteR22 * gteIR1)) >> shift;
+	// gteIRi = limBi(gteMACi, lm);
+	const bool sf = psxRegs.code & (1 << 19);
+	const bool lm = psxRegs.code & (1 << 10);
+	const u32 mac[3] = { MIPSREG_A2, MIPSREG_A3, MIPSREG_A1 };
+
+	LH(TEMP_0, PERM_REG_1, offCP2C(0));                // gteR11
+	LH(TEMP_1, PERM_REG_1, offCP2C(2));                // gteR22
+	LH(TEMP_2, PERM_REG_1, offCP2C(4));                // gteR33
+	LH(TEMP_3, PERM_REG_1, off(CP2D.p[9].sw.l));       // gteIR1
+	LH(MIPSREG_A0, PERM_REG_1, off(CP2D.p[10].sw.l));  // gteIR2
+	LH(MIPSREG_A1, PERM_REG_1, off(CP2D.p[11].sw.l));  // gteIR3
+
+	MUL(MIPSREG_A2, TEMP_1, MIPSREG_A1);               // gteR22 * gteIR3
+	MUL(MIPSREG_A3, TEMP_2, MIPSREG_A0);               // gteR33 * gteIR2
+	SUBU(MIPSREG_A2, MIPSREG_A2, MIPSREG_A3);
+	MUL(MIPSREG_A3, TEMP_2, TEMP_3);                   // gteR33 * gteIR1
+	MUL(TEMP_2, TEMP_0, MIPSREG_A1);                   // gteR11 * gteIR3
+	SUBU(MIPSREG_A3, MIPSREG_A3, TEMP_2);
+	MUL(MIPSREG_A1, TEMP_0, MIPSREG_A0);               // gteR11 * gteIR2
+	MUL(TEMP_2, TEMP_1, TEMP_3);                       // gteR22 * gteIR1
+	SUBU(MIPSREG_A1, MIPSREG_A1, TEMP_2);
+
+	if (sf) {
+		for (int i = 0; i < 3; i++)
+			SRA(mac[i], mac[i], 12);
+	}
+
+	emitStoreMAC123(mac, lm);
+}
+
+static void emitRTPS()
+{
+	// Vector V0, kept in host regs for all three rows
+	LH(MIPSREG_A0, PERM_REG_1, off(CP2D.p[0].sw.l));   // gteVX0
+	LH(MIPSREG_A1, PERM_REG_1, off(CP2D.p[0].sw.h));   // gteVY0
+	LH(MIPSREG_A2, PERM_REG_1, off(CP2D.p[1].sw.l));   // gteVZ0
+
+	// gteMACi = A((((s64)gteTRi << 12) + (gteRi1 * gteVX0) +
+	//                (gteRi2 * gteVY0) + (gteRi3 * gteVZ0)) >> 12);
+	// gteIRi = limBi(gteMACi, 0);
+	// (The three R row elements are halfwords 3*i..3*i+2 of CP2C)
+	for (int i = 0; i < 3; i++) {
+		LW(TEMP_0, PERM_REG_1, offCP2C(5 + i));         // gteTRi
+		LH(TEMP_2, PERM_REG_1, offCP2C(0) + (3*i + 0) * 2);
+		LH(TEMP_3, PERM_REG_1, offCP2C(0) + (3*i + 1) * 2);
+		emitMTHILO(TEMP_0, 12, TEMP_1);
+		LH(TEMP_0, PERM_REG_1, offCP2C(0) + (3*i + 2) * 2);
+		MADD(TEMP_2, MIPSREG_A0);
+		MADD(TEMP_3, MIPSREG_A1);
+		MADD(TEMP_0, MIPSREG_A2);
+		emitMFHILOShift(MIPSREG_A3, 12, TEMP_1);
+		SW(MIPSREG_A3, PERM_REG_1, off(CP2D.r[25 + i])); // gteMACi
+		if (i == 2)
+			break;
+		emitClamp(MIPSREG_A3, -0x8000, 0x7fff, TEMP_0, TEMP_1, TEMP_2);
+		SH(MIPSREG_A3, PERM_REG_1, off(CP2D.p[9 + i].sw.l)); // gteIRi
+	}
+
+	// MAC3 is in $a3: IR3 and SZ3 both come from it
+	MOV(MIPSREG_A2, MIPSREG_A3);
+	emitClamp(MIPSREG_A3, -0x8000, 0x7fff, TEMP_0, TEMP_1, TEMP_2);
+	SH(MIPSREG_A3, PERM_REG_1, off(CP2D.p[11].sw.l));  // gteIR3
+
+	// gteSZ0 = gteSZ1; gteSZ1 = gteSZ2; gteSZ2 = gteSZ3;
+	// gteSZ3 = limD(gteMAC3);
+	LHU(TEMP_0, PERM_REG_1, off(CP2D.p[17].w.l));
+	LHU(TEMP_1, PERM_REG_1, off(CP2D.p[18].w.l));
+	LHU(TEMP_2, PERM_REG_1, off(CP2D.p[19].w.l));
+	SH(TEMP_0, PERM_REG_1, off(CP2D.p[16].w.l));
+	SH(TEMP_1, PERM_REG_1, off(CP2D.p[17].w.l));
+	SH(TEMP_2, PERM_REG_1, off(CP2D.p[18].w.l));
+	emitClamp(MIPSREG_A2, 0, 0xffff, TEMP_0, TEMP_1, TEMP_2);
+	SH(MIPSREG_A2, PERM_REG_1, off(CP2D.p[19].w.l));   // gteSZ3
+
+	// quotient = limE(DIVIDE(gteH, gteSZ3));
+	//  DIVIDE() returns ((u32)n << 16) / d if n < d * 2 (and then it's
+	//  below 0x20000), else 0xffffffff which limE() makes 0x1ffff. The
+	//  divide is done regardless, its result unused if d is 0.
+	LHU(TEMP_0, PERM_REG_1, offCP2C(26));              // gteH
+	SLL(TEMP_1, MIPSREG_A2, 1);
+	SLTU(TEMP_1, TEMP_0, TEMP_1);                      // n < d * 2 ?
+	SLL(TEMP_0, TEMP_0, 16);
+	DIVU(TEMP_0, MIPSREG_A2);
+	LI32(MIPSREG_A3, 0x1ffff);
+	MFLO(TEMP_0);
+	MOVN(MIPSREG_A3, TEMP_0, TEMP_1);                  // $a3 = quotient
+
+	// gteSXY0 = gteSXY1; gteSXY1 = gteSXY2;
+	LW(TEMP_0, PERM_REG_1, off(CP2D.r[13]));
+	LW(TEMP_1, PERM_REG_1, off(CP2D.r[14]));
+	SW(TEMP_0, PERM_REG_1, off(CP2D.r[12]));
+	SW(TEMP_1, PERM_REG_1, off(CP2D.r[13]));
+
+	// gteSX2 = limG1(F((s64)gteOFX + ((s64)gteIR1 * quotient)) >> 16);
+	// gteSY2 = limG2(F((s64)gteOFY + ((s64)gteIR2 * quotient)) >> 16);
+	for (int i = 0; i < 2; i++) {
+		LW(TEMP_0, PERM_REG_1, offCP2C(24 + i));         // gteOFX/Y
+		LH(TEMP_2, PERM_REG_1, off(CP2D.p[9 + i].sw.l)); // gteIR1/2
+		emitMTHILO(TEMP_0, 0, TEMP_1);
+		MADD(TEMP_2, MIPSREG_A3);
+		emitMFHILOShift(TEMP_3, 16, TEMP_1);
+		emitClamp(TEMP_3, -0x400, 0x3ff, TEMP_0, TEMP_1, TEMP_2);
+		SH(TEMP_3, PERM_REG_1, off(CP2D.r[14]) + i * 2); // gteSX2/SY2
+	}
+
+	// s64 tmp = (s64)gteDQB + ((s64)gteDQA * quotient);
+	// gteMAC0 = F(tmp);
+	// gteIR0 = limH(tmp >> 12);
+	LW(TEMP_0, PERM_REG_1, offCP2C(28));               // gteDQB
+	LH(TEMP_2, PERM_REG_1, offCP2C(27));               // gteDQA
+	emitMTHILO(TEMP_0, 0, TEMP_1);
+	MADD(TEMP_2, MIPSREG_A3);
+	MFLO(TEMP_3);
+	SW(TEMP_3, PERM_REG_1, off(CP2D.r[24]));           // gteMAC0
+	emitMFHILOShift(TEMP_3, 12, TEMP_1);
+	emitClamp(TEMP_3, 0, 0x1000, TEMP_0, TEMP_1, TEMP_2);
+	SH(TEMP_3, PERM_REG_1, off(CP2D.p[8].sw.l));       // gteIR0
+}
+
+/* Emit native code for the GTE op being recompiled, if it has a native
+ *  version and nothing reads the FLAG it sets. Returns false if its C
+ *  version must be called instead.
+ */
+static bool emitGteNative()
+{
+	void (*emitter)() = NULL;
+
+	switch (_Funct_) {
+		case 0x01: emitter = emitRTPS;  break;
+		case 0x06: emitter = emitNCLIP; break;
+		case 0x0c: emitter = emitOP;    break;
+		case 0x28: emitter = emitSQR;   break;
+		case 0x2d: emitter = emitAVSZ3; break;
+		case 0x2e: emitter = emitAVSZ4; break;
+	}
+
+	if (!emitter || !gteFlagIsDead())
+		return false;
+
+	emitter();
+	return true;
+}
+
+#else
+
+static bool emitGteNative() { return false; }
+
+#endif // USE_GTE_NATIVE_OPS
+
 /* move from cp2 reg to host rt */
 static void emitMFC2(u32 rt, u32 reg)
 {
@@ -961,10 +961,11 @@ static void general_loads_stores(const int  count,
 		const uptr *read_func  = mem_read_func;
 		const uptr *write_func = mem_write_func;
 #ifdef USE_HW_FUNCS_FOR_INDIRECT_ACCESS
-		// See notes at top of file
+		// See notes at top of file. Not with -recverify: it logs HW I/O
+		//  in psxMemRead*()/psxMemWrite*().
 		const uptr hw_read_func[]   = { (uptr)psxHwRead8,   (uptr)psxHwRead16,   (uptr)psxHwRead32   };
 		const uptr hw_write_func[]  = { (uptr)psxHwWrite8,  (uptr)psxHwWrite16,  (uptr)psxHwWrite32  };
-		if (psx_mem_mapped) {
+		if (psx_mem_mapped && !Config.RecVerify) {
 			read_func  = hw_read_func;
 			write_func = hw_write_func;
 		}
@@ -1404,7 +1405,8 @@ static void emitLoadStoreSeries()
 		{
 			bool is_hw_address = false;
 #ifdef USE_DIRECT_HW_ACCESS
-			{
+			// -recverify must see all HW I/O, see psxverify.h
+			if (!Config.RecVerify) {
 				const u16 upper = addr_max >> 16;
 				if (upper == 0x1f80 || upper == 0x9f80 || upper == 0xbf80)
 					is_hw_address = true;
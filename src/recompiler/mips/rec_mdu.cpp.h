@@ -36,6 +36,25 @@
 
 static bool convertMultiplyTo3Op();
 
+/* LO/HI are cached in host regs like GPRs, as PSX regs REG_LO/REG_HI.
+ *  These set them from host reg 'src' ($zero for a 0 result).
+ */
+static void recSetLO(u32 src)
+{
+	u32 lo = regMipsToHost(REG_LO, REG_FIND, REG_REGISTER);
+	MOV(lo, src);
+	regMipsChanged(REG_LO);
+	regUnlock(lo);
+}
+
+static void recSetHI(u32 src)
+{
+	u32 hi = regMipsToHost(REG_HI, REG_FIND, REG_REGISTER);
+	MOV(hi, src);
+	regMipsChanged(REG_HI);
+	regUnlock(hi);
+}
+
 
 static void recMULT()
 {
@@ -82,10 +101,10 @@ static void recMULT()
 				work_reg = TEMP_1;
 			}
 
-			SW(work_reg, PERM_REG_1, offGPR(32)); // LO
+			recSetLO(work_reg);
 			// Upper word is all 0s or 1s depending on sign of LO result
 			SRA(TEMP_1, work_reg, 31);
-			SW(TEMP_1, PERM_REG_1, offGPR(33));   // HI
+			recSetHI(TEMP_1);
 
 			regUnlock(ident_reg);
 
@@ -114,10 +133,10 @@ static void recMULT()
 				}
 
 				SLL(TEMP_1, work_reg, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 				// Sign-extend here when computing upper word of result
 				SRA(TEMP_1, work_reg, (32 - shift_amt));
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 
 				regUnlock(npot_reg);
 
@@ -129,16 +148,16 @@ static void recMULT()
 		if (const_res) {
 			if (lo_res) {
 				LI32(TEMP_1, (u32)lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(0);
 			}
 
 			if (hi_res) {
 				LI32(TEMP_1, (u32)hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(0);
 			}
 
 			// We're done
@@ -161,13 +180,17 @@ static void recMULT()
 	u32 rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
 
 	MULT(rs, rt);
-	MFLO(TEMP_1);
-	MFHI(TEMP_2);
-	SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-	SW(TEMP_2, PERM_REG_1, offGPR(33)); // HI
+	u32 lo = regMipsToHost(REG_LO, REG_FIND, REG_REGISTER);
+	u32 hi = regMipsToHost(REG_HI, REG_FIND, REG_REGISTER);
+	MFLO(lo);
+	MFHI(hi);
+	regMipsChanged(REG_LO);
+	regMipsChanged(REG_HI);
 
 	regUnlock(rs);
 	regUnlock(rt);
+	regUnlock(lo);
+	regUnlock(hi);
 }
 
 
@@ -206,8 +229,8 @@ static void recMULTU()
 			u32 ident_reg_psx = rs_const ? _Rt_ : _Rs_;
 			u32 ident_reg = regMipsToHost(ident_reg_psx, REG_LOAD, REG_REGISTER);
 
-			SW(0, PERM_REG_1, offGPR(33));         // HI
-			SW(ident_reg, PERM_REG_1, offGPR(32)); // LO
+			recSetHI(0);
+			recSetLO(ident_reg);
 
 			regUnlock(ident_reg);
 
@@ -229,9 +252,9 @@ static void recMULTU()
 				u32 shift_amt = __builtin_ctz(pot_val);
 
 				SLL(TEMP_1, npot_reg, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 				SRL(TEMP_1, npot_reg, (32 - shift_amt));
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 
 				regUnlock(npot_reg);
 
@@ -243,16 +266,16 @@ static void recMULTU()
 		if (const_res) {
 			if (lo_res) {
 				LI32(TEMP_1, lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(0);
 			}
 
 			if (hi_res) {
 				LI32(TEMP_1, hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(0);
 			}
 
 			// We're done
@@ -275,13 +298,17 @@ static void recMULTU()
 	u32 rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
 
 	MULTU(rs, rt);
-	MFLO(TEMP_1);
-	MFHI(TEMP_2);
-	SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-	SW(TEMP_2, PERM_REG_1, offGPR(33)); // HI
+	u32 lo = regMipsToHost(REG_LO, REG_FIND, REG_REGISTER);
+	u32 hi = regMipsToHost(REG_HI, REG_FIND, REG_REGISTER);
+	MFLO(lo);
+	MFHI(hi);
+	regMipsChanged(REG_LO);
+	regMipsChanged(REG_HI);
 
 	regUnlock(rs);
 	regUnlock(rt);
+	regUnlock(lo);
+	regUnlock(hi);
 }
 
 
@@ -310,8 +337,8 @@ static void recDIV()
 			ADDIU(TEMP_2, 0, -1);
 			SLT(TEMP_1, rs, 0);           // TEMP_1 = dividend < 0
 			MOVN(TEMP_1, TEMP_2, TEMP_1); // if (TEMP_1 != 0) TEMP_1 = TEMP_2
-			SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			SW(rs, PERM_REG_1, offGPR(33));     // HI
+			recSetLO(TEMP_1);
+			recSetHI(rs);
 
 			regUnlock(rs);
 
@@ -321,8 +348,8 @@ static void recDIV()
 			// If divisor is const-val '1', result is identity
 			u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
-			SW(0, PERM_REG_1, offGPR(33));  // HI
-			SW(rs, PERM_REG_1, offGPR(32)); // LO
+			recSetHI(0);
+			recSetLO(rs);
 
 			regUnlock(rs);
 
@@ -335,16 +362,16 @@ static void recDIV()
 
 			if (lo_res) {
 				LI32(TEMP_1, lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(0);
 			}
 
 			if (hi_res) {
 				LI32(TEMP_1, hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(0);
 			}
 
 			// We're done
@@ -369,7 +396,7 @@ static void recDIV()
 				}
 
 				SRA(TEMP_1, work_reg, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 
 				// Subtract one from pot divisor to get remainder modulo mask
 				if ((pot_val-1) > 0xffff) {
@@ -378,7 +405,7 @@ static void recDIV()
 				} else {
 					ANDI(TEMP_1, rs, (pot_val-1));
 				}
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 
 				regUnlock(rs);
 
@@ -393,6 +420,8 @@ static void recDIV()
 
 	u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 	u32 rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
+	u32 lo = regMipsToHost(REG_LO, REG_FIND, REG_REGISTER);
+	u32 hi = regMipsToHost(REG_HI, REG_FIND, REG_REGISTER);
 
 	// Test if divisor is 0, emulating correct results for PS1 CPU.
 	// NOTE: we don't bother checking for signed division overflow (the
@@ -427,31 +456,33 @@ static void recDIV()
 
 	if (omit_div_by_zero_fixup) {
 		DIV(rs, rt);
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 	} else {
 		DIV(rs, rt);
 		ADDIU(MIPSREG_A1, 0, -1);
 		SLT(TEMP_3, rs, 0);        // TEMP_3 = (rs < 0 ? 1 : 0)
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 
 		// If divisor was 0, set LO result (quotient) to 1 if dividend was < 0
 		// If divisor was 0, set LO result (quotient) to -1 if dividend was >= 0
 		MOVN(MIPSREG_A0, TEMP_3, TEMP_3);      // if (TEMP_3 != 0) then MIPSREG_A1 = TEMP_3
 		MOVZ(MIPSREG_A0, MIPSREG_A1, TEMP_3);  // if (TEMP_3 == 0) then MIPSREG_A1 = MIPSREG_A0
-		MOVZ(TEMP_1, MIPSREG_A0, rt);          // if (rt == 0) then TEMP_1 = MIPSREG_A0
+		MOVZ(lo, MIPSREG_A0, rt);              // if (rt == 0) then lo = MIPSREG_A0
 
 #ifndef OMIT_DIV_BY_ZERO_HI_FIXUP
 		// If divisor was 0, set HI result (remainder) to rs
-		MOVZ(TEMP_2, rs, rt);
+		MOVZ(hi, rs, rt);
 #endif
 	}
 
-	SW(TEMP_1, PERM_REG_1, offGPR(32));
-	SW(TEMP_2, PERM_REG_1, offGPR(33));
+	regMipsChanged(REG_LO);
+	regMipsChanged(REG_HI);
 	regUnlock(rs);
 	regUnlock(rt);
+	regUnlock(lo);
+	regUnlock(hi);
 }
 
 
@@ -478,8 +509,8 @@ static void recDIVU()
 			u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
 			ADDIU(TEMP_1, 0, -1);
-			SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
-			SW(rs, PERM_REG_1, offGPR(33));     // HI
+			recSetLO(TEMP_1);
+			recSetHI(rs);
 
 			regUnlock(rs);
 
@@ -489,8 +520,8 @@ static void recDIVU()
 			// If divisor is const-val '1', result is identity
 			u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 
-			SW(0, PERM_REG_1, offGPR(33));  // HI
-			SW(rs, PERM_REG_1, offGPR(32)); // LO
+			recSetHI(0);
+			recSetLO(rs);
 
 			regUnlock(rs);
 
@@ -503,16 +534,16 @@ static void recDIVU()
 
 			if (lo_res) {
 				LI32(TEMP_1, lo_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(0);
 			}
 
 			if (hi_res) {
 				LI32(TEMP_1, hi_res);
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 			} else {
-				SW(0, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(0);
 			}
 
 			// We're done
@@ -529,7 +560,7 @@ static void recDIVU()
 				u32 shift_amt = __builtin_ctz(pot_val);
 
 				SRL(TEMP_1, rs, shift_amt);
-				SW(TEMP_1, PERM_REG_1, offGPR(32)); // LO
+				recSetLO(TEMP_1);
 
 				// Subtract one from pot divisor to get remainder modulo mask
 				if ((pot_val-1) > 0xffff) {
@@ -538,7 +569,7 @@ static void recDIVU()
 				} else {
 					ANDI(TEMP_1, rs, (pot_val-1));
 				}
-				SW(TEMP_1, PERM_REG_1, offGPR(33)); // HI
+				recSetHI(TEMP_1);
 
 				regUnlock(rs);
 
@@ -553,6 +584,8 @@ static void recDIVU()
 
 	u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
 	u32 rt = regMipsToHost(_Rt_, REG_LOAD, REG_REGISTER);
+	u32 lo = regMipsToHost(REG_LO, REG_FIND, REG_REGISTER);
+	u32 hi = regMipsToHost(REG_HI, REG_FIND, REG_REGISTER);
 
 	// Test if divisor is 0, emulating correct results for PS1 CPU.
 	//  Rs              Rt       Hi/Remainder  Lo/Result
@@ -574,27 +607,29 @@ static void recDIVU()
 
 	if (omit_div_by_zero_fixup) {
 		DIVU(rs, rt);
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 	} else {
 		DIVU(rs, rt);
 		ADDIU(TEMP_3, 0, -1);
-		MFLO(TEMP_1);              // NOTE: Hi/Lo can't be cached for now, so spill them
-		MFHI(TEMP_2);
+		MFLO(lo);
+		MFHI(hi);
 
 		// If divisor was 0, set LO result (quotient) to 0xffff_ffff
-		MOVZ(TEMP_1, TEMP_3, rt);  // if (rt == 0) then TEMP_1 = TEMP_3
+		MOVZ(lo, TEMP_3, rt);      // if (rt == 0) then lo = TEMP_3
 
 #ifndef OMIT_DIV_BY_ZERO_HI_FIXUP
 		// If divisor was 0, set HI result (remainder) to rs
-		MOVZ(TEMP_2, rs, rt);
+		MOVZ(hi, rs, rt);
 #endif
 	}
 
-	SW(TEMP_1, PERM_REG_1, offGPR(32));
-	SW(TEMP_2, PERM_REG_1, offGPR(33));
+	regMipsChanged(REG_LO);
+	regMipsChanged(REG_HI);
 	regUnlock(rs);
 	regUnlock(rt);
+	regUnlock(lo);
+	regUnlock(hi);
 }
 
 static void recMFHI()
@@ -602,10 +637,12 @@ static void recMFHI()
 // Rd = Hi
 	if (!_Rd_) return;
 	SetUndef(_Rd_);
+	u32 rs = regMipsToHost(REG_HI, REG_LOAD, REG_REGISTER);
 	u32 rd = regMipsToHost(_Rd_, REG_FIND, REG_REGISTER);
 
-	LW(rd, PERM_REG_1, offGPR(33));
+	MOV(rd, rs);
 	regMipsChanged(_Rd_);
+	regUnlock(rs);
 	regUnlock(rd);
 }
 
@@ -613,7 +650,7 @@ static void recMTHI()
 {
 // Hi = Rs
 	u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
-	SW(rs, PERM_REG_1, offGPR(33));
+	recSetHI(rs);
 	regUnlock(rs);
 }
 
@@ -634,10 +671,12 @@ static void recMFLO()
 	if (!_Rd_) return;
 
 	SetUndef(_Rd_);
+	u32 rs = regMipsToHost(REG_LO, REG_LOAD, REG_REGISTER);
 	u32 rd = regMipsToHost(_Rd_, REG_FIND, REG_REGISTER);
 
-	LW(rd, PERM_REG_1, offGPR(32));
+	MOV(rd, rs);
 	regMipsChanged(_Rd_);
+	regUnlock(rs);
 	regUnlock(rd);
 }
 
@@ -646,7 +685,7 @@ static void recMTLO()
 {
 // Lo = Rs
 	u32 rs = regMipsToHost(_Rs_, REG_LOAD, REG_REGISTER);
-	SW(rs, PERM_REG_1, offGPR(32));
+	recSetLO(rs);
 	regUnlock(rs);
 }
 
@@ -1101,7 +1140,7 @@ static bool convertMultiplyTo3Op()
 	//  the result. Other blocks might start at or before the MFLO instruction
 	//  in the original code.
 	if (branch) {
-		SW(rd, PERM_REG_1, offGPR(32)); // LO
+		recSetLO(rd);
 	}
 
 	SetUndef(rd_of_mflo);
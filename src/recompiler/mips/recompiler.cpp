@@ -31,8 +31,16 @@
 #include "psxhle.h"
 #include "psxmem.h"
 #include "psxhw.h"
+#include "psxidle.h"
+#include "psxbioshook.h"
+#include "psxsmc.h"
+#include "psxverify.h"
 #include "r3000a.h"
 #include "gte.h"
+#include "recompiler/rec_ir.h"
+#include "recompiler/rec_stats.h"
+#include "recompiler/rec_perf.h"
+#include "recompiler/rec_tier.h"
 
 /* For direct HW I/O */
 #include "mdec.h"
@@ -51,15 +59,30 @@
 #define REC_LOG_V(...)
 #endif
 
-/* Use inlined-asm version of block dispatcher: */
+/* Use inlined-asm version of block dispatcher. Pass -DNO_ASM_EXECUTE_LOOP
+ *  (make REC_VERIFY=1) for the C versions, which -recverify needs: they
+ *  run each block through psxVerifyBlock(), see psxverify.h */
+#ifndef NO_ASM_EXECUTE_LOOP
 #define ASM_EXECUTE_LOOP
+#endif
 
 /* Scan for and skip useless code in PS1 executable: */
 #define USE_CODE_DISCARD
 
+/* Blocks that are side-effect free polling loops fast-forward to the next
+ *  event once they branch back to themselves, see psxidle.cpp */
+#define USE_IDLE_LOOP_SKIP
+
 /* If HLE emulated BIOS is not in use, blocks return to dispatch loop directly */
 #define USE_DIRECT_BLOCK_RETURN_JUMPS
 
+/* Exits to known-const PCs jump straight to the next block once it's been
+ *  recompiled, skipping the dispatch loop. See block linking notes below.
+ * NOTE: Option only has effect if USE_DIRECT_BLOCK_RETURN_JUMPS is enabled,
+ *  which itself only has effect when HLE emulated BIOS is not in use.
+ */
+#define USE_BLOCK_LINKING
+
 /* If a block jumps backwards to the top of itself, use fast dispatch path.
  *  Every block's recompiled start address is saved before entry. To
  *  return to the dispatch loop, it jumps to a shorter version of dispatch
@@ -68,8 +91,13 @@
  *  self-modifying code, but so far no issues have been found.
  * NOTE: Option only has effect if USE_DIRECT_BLOCK_RETURN_JUMPS is enabled,
  *  which itself only has effect when HLE emulated BIOS is not in use.
+ * NOTE: Not compatible with USE_BLOCK_LINKING: a block entered through a
+ *  linked jump would return to the block last entered from dispatch loop.
+ *  Linking gives such blocks a direct jump to their own top anyway.
  */
+#ifndef USE_BLOCK_LINKING
 #define USE_DIRECT_FASTPATH_BLOCK_RETURN_JUMPS
+#endif
 
 /* Const propagation is applied to addresses */
 #define USE_CONST_ADDRESSES
@@ -77,6 +105,10 @@
 /* Const propagation is extended to optimize 'fuzzy' non-const addresses */
 #define USE_CONST_FUZZY_ADDRESSES
 
+/* Lower ALU ops from the shared block IR: set consts it folded, skip ops it
+ *  found dead. Register liveness always comes from it, see regAnalyzeBlock() */
+#define USE_BLOCK_IR
+
 /* Generate inline memory access or call psxMemRead/Write C functions */
 #define USE_DIRECT_MEM_ACCESS
 
@@ -201,6 +233,37 @@ static inline bool IsFuzzyScratchpadAddr(const u32 reg)  { return iRegs[reg].is_
 #define RECMEM_SIZE_MAX     (RECMEM_SIZE-(512*1024))
 static u8 recMemBase[RECMEM_SIZE] __attribute__((aligned(4)));
 
+/* Code cache regions
+ *  Instead of flushing the whole code cache when it fills up, it is filled
+ *  in FIFO order, one region at a time. Each region remembers the PCs of the
+ *  blocks recompiled into it. Before a new region is opened, the oldest
+ *  regions overlapping the space it may use are evicted: only their blocks
+ *  are unlinked from recRAM/recROM, and the rest of the cache stays resident.
+ *  A region is closed once it holds RECMEM_REGION_SIZE bytes of code or
+ *  RECMEM_REGION_BLOCKS blocks. Like before, the last block in a region may
+ *  run up to (RECMEM_SIZE - RECMEM_SIZE_MAX) bytes past its nominal end.
+ */
+#define RECMEM_REGIONS        32
+#define RECMEM_REGION_SIZE    (1024 * 1024)
+#define RECMEM_REGION_BLOCKS  8192
+#define RECMEM_REGION_SLACK   (RECMEM_SIZE - RECMEM_SIZE_MAX)
+
+typedef struct {
+	u8  *start, *end;                      /* Code emitted into region */
+	u32 num_blocks;
+	u32 block_pc[RECMEM_REGION_BLOCKS];    /* PCs of blocks in region */
+} RecMemRegion;
+
+static RecMemRegion recmem_regions[RECMEM_REGIONS];
+static u32 recmem_oldest_region;           /* Oldest live region (FIFO head) */
+static u32 recmem_cur_region;              /* Region being filled (FIFO tail) */
+static u32 recmem_live_regions;            /* Regions holding live blocks */
+
+static struct {
+	u32 evictions;                         /* Regions evicted */
+	u32 evicted_blocks;                    /* Blocks unlinked by evictions */
+} recmem_stats;
+
 u32        *recMem;                /* Where does next emitted opcode in block go? */
 static u32 *recMemStart;           /* Where did first emitted opcode in block go? */
 static u32 pc;                     /* Recompiler pc */
@@ -222,6 +285,8 @@ static bool end_block;                     /* Has recompilation phase ended? */
 static bool skip_emitting_next_mflo;       /* Was a MULT/MULTU converted to 3-op MUL? See rec_mdu.cpp.h */
 static bool emit_code_invalidations;       /* Emit code invalidation for store instructions? */
 static bool flush_code_on_dma3_exe_load;   /* Flush code cache when psxDma3() detects EXE load? */
+static bool smc_protect_code;              /* Write-protect RAM pages holding recompiled code? */
+static RecIRBlock rec_ir;                  /* IR of block being recompiled, see regAnalyzeBlock() */
 
 /* Flags/vals used to cache common values in temp regs in emitted code */
 static bool lsu_tmp_cache_valid;           /* LSU vals are cached in $at,$v1. See rec_lsu.cpp.h */
@@ -230,6 +295,41 @@ static u32  host_v0_reg_constval;
 static bool host_ra_reg_has_block_retaddr; /* Indirect-return address is cached in $ra. */
 
 
+/* Block linking
+ *  When blocks return directly to the dispatch loop, each exit to a known-const
+ *  PC ends in a jump that can be patched to go straight to the block at that
+ *  PC (see emitBlockLink() in rec_bcu.cpp.h). Every such exit has a BlockLink
+ *  record, hashed by the address of the target's block ptr in recRAM/recROM.
+ *  Exits are linked when their target gets recompiled, and pointed back at
+ *  the dispatch loop when recClear() invalidates the target or the code
+ *  cache region holding it is evicted. Records for exits in an evicted
+ *  region are freed. If no record is free, exits return to dispatch loop.
+ */
+#define BLOCK_LINKS           32768
+#define BLOCK_LINK_HASH_SIZE  4096
+#define BLOCK_LINK_HASH(ptr)  (((uptr)(ptr) >> 2) & (BLOCK_LINK_HASH_SIZE-1))
+
+typedef struct {
+	u32 *site;                             /* Patchable J opcode in exit code */
+	u32 *block_ptr;                        /* Target's entry in recRAM/recROM */
+	u32 *target;                           /* Code it's linked to, or NULL */
+	s32  next;                             /* Next in hash chain or free list */
+} BlockLink;
+
+static BlockLink block_links[BLOCK_LINKS];
+static s32 block_link_hash[BLOCK_LINK_HASH_SIZE];
+static s32 block_link_free;                /* Free list head, -1 if none left */
+
+static inline bool recCanLinkBlock(const u32 new_pc)
+{
+#ifdef USE_BLOCK_LINKING
+	return block_link_free >= 0 && psxRecLUT[new_pc >> 16] != 0;
+#else
+	return false;
+#endif
+}
+
+
 #ifdef WITH_DISASM
 char	disasm_buffer[512];
 #endif
@@ -240,6 +340,7 @@ static void recReset();
 static void recRecompile();
 static void recClear(u32 Addr, u32 Size);
 static void recNotify(int note, void *data);
+static void recAddBlockLink(u32 *site, u32 new_pc);
 
 extern void (*recBSC[64])();
 extern void (*recSPC[64])();
@@ -295,6 +396,8 @@ disasm_label stub_labels[] =
   make_stub_label(psxHwWrite16),
   make_stub_label(psxHwWrite32),
   make_stub_label(psxException),
+  make_stub_label(psxIdleLoopBlockEntry),
+  make_stub_label(psxBiosHookCall),
   // Direct HW I/O:
   make_stub_label(cdrRead0),
   make_stub_label(cdrRead1),
@@ -372,7 +475,48 @@ do { \
 #endif
 
 
-#include "opcodes.h"
+/* Recompile opcode in psxRegs.code, at 'pc' - 4. ALU ops the block IR folded
+ *  to a const or found dead are lowered from it. Loads/stores are left to
+ *  the LSU emitters, which recompile series of them at once.
+ */
+static void recOpcode()
+{
+#ifdef USE_BLOCK_IR
+	const RecIROp *op = recIROpAt(&rec_ir, pc - 4);
+	if (op && op->kind == REC_IR_ALU) {
+		if (op->flags & REC_IR_DEAD)
+			return;
+
+		// LUI is left to recLUI(), which looks for LUI+load sequences
+		if ((op->flags & REC_IR_CONST) && _fOp_(op->code) != 0x0f) {
+			const u32 rd = op->rd;
+
+			/* Exit if const already loaded */
+			if (!rd || (IsConst(rd) && GetConst(rd) == op->value))
+				return;
+
+			u32 r1 = regMipsToHost(rd, REG_FIND, REG_REGISTER);
+			LI32(r1, op->value);
+			regMipsChanged(rd);
+			regUnlock(r1);
+			SetConst(rd, op->value);
+			return;
+		}
+	}
+#endif
+
+	recBSC[psxRegs.code>>26]();
+}
+
+
+#include "recompiler/rec_discard.cpp.h"
+#include "rec_lsu.cpp.h" // Load Store Unit
+#include "rec_gte.cpp.h" // Geometry Transformation Engine
+#include "rec_alu.cpp.h" // Arithmetic Logical Unit
+#include "rec_mdu.cpp.h" // Multiple Divide Unit
+#include "rec_cp0.cpp.h" // Coprocessor 0
+#include "rec_bcu.cpp.h" // Branch Control Unit
+#include "recompiler/opcodes.h"
 
 #ifndef HAVE_MIPS32R2_CACHE_OPS
 #include <sys/cachectl.h>
@@ -422,18 +566,239 @@ static void rec_set_options()
 		emit_code_invalidations = false;
 		flush_code_on_dma3_exe_load = true;
 	}
+
+	// Write-protect RAM pages that blocks are recompiled from, so the first
+	//  write to one invalidates all blocks overlapping it (see psxsmc.cpp).
+	//  Not with the Icache workaround above: it depends on CPU stores leaving
+	//  code alone, and a fault can't tell a CPU store from a DMA write.
+	smc_protect_code = emit_code_invalidations;
+}
+
+
+/* Point a block exit's jump at 'dest', either a block or the dispatch loop */
+static void block_link_patch(BlockLink *link, u32 *dest)
+{
+	*link->site = 0x08000000 | (((u32)dest & 0x0fffffff) >> 2);  // J dest
+	link->target = ((uptr)dest == block_ret_addr) ? NULL : dest;
+	clear_insn_cache(link->site, link->site + 1, 0);
+}
+
+static inline void block_link_unlink(BlockLink *link)
+{
+	if (link->target)
+		block_link_patch(link, (u32*)block_ret_addr);
+}
+
+static void block_link_reset()
+{
+	for (int i = 0; i < BLOCK_LINKS; ++i)
+		block_links[i].next = i + 1;
+	block_links[BLOCK_LINKS-1].next = -1;
+	block_link_free = 0;
+
+	memset(block_link_hash, 0xff, sizeof(block_link_hash));
+}
+
+/* Record exit jump at 'site' going to 'new_pc', linking it if the block
+ *  there is already recompiled. Called by emitBlockLink().
+ */
+static void recAddBlockLink(u32 *site, u32 new_pc)
+{
+	const s32 idx = block_link_free;
+	BlockLink *link = &block_links[idx];
+	block_link_free = link->next;
+
+	link->site = site;
+	link->block_ptr = (u32*)PC_REC(new_pc);
+	link->target = NULL;
+
+	const u32 h = BLOCK_LINK_HASH(link->block_ptr);
+	link->next = block_link_hash[h];
+	block_link_hash[h] = idx;
+
+	if (*link->block_ptr)
+		block_link_patch(link, (u32*)*link->block_ptr);
+}
+
+/* Link all exits going to the block whose ptr is at 'block_ptr' */
+static void block_link_resolve(u32 *block_ptr)
+{
+	u32 * const dest = (u32*)*block_ptr;
+
+	for (s32 i = block_link_hash[BLOCK_LINK_HASH(block_ptr)]; i >= 0; i = block_links[i].next) {
+		BlockLink *link = &block_links[i];
+		if (link->block_ptr == block_ptr && link->target != dest)
+			block_link_patch(link, dest);
+	}
+}
+
+/* Unlink all exits going to blocks whose ptrs lie in 'first'..'last' */
+static void block_link_unlink_range(u32 *first, u32 *last)
+{
+	if ((u32)(last - first) < BLOCK_LINK_HASH_SIZE) {
+		for (u32 *block_ptr = first; block_ptr <= last; ++block_ptr) {
+			for (s32 i = block_link_hash[BLOCK_LINK_HASH(block_ptr)]; i >= 0; i = block_links[i].next) {
+				if (block_links[i].block_ptr == block_ptr)
+					block_link_unlink(&block_links[i]);
+			}
+		}
+	} else {
+		for (int h = 0; h < BLOCK_LINK_HASH_SIZE; ++h) {
+			for (s32 i = block_link_hash[h]; i >= 0; i = block_links[i].next) {
+				if (block_links[i].block_ptr >= first && block_links[i].block_ptr <= last)
+					block_link_unlink(&block_links[i]);
+			}
+		}
+	}
+}
+
+/* Code in 'start'..'end' is being evicted: unlink exits going into it and
+ *  free the records of exits lying inside it.
+ */
+static void block_link_evict(const u8 *start, const u8 *end)
+{
+	for (int h = 0; h < BLOCK_LINK_HASH_SIZE; ++h) {
+		s32 *prev_next = &block_link_hash[h];
+		s32 i = *prev_next;
+		while (i >= 0) {
+			BlockLink *link = &block_links[i];
+			const s32 next = link->next;
+			if ((u8*)link->site >= start && (u8*)link->site < end) {
+				*prev_next = next;
+				link->next = block_link_free;
+				block_link_free = i;
+			} else {
+				if ((u8*)link->target >= start && (u8*)link->target < end)
+					block_link_unlink(link);
+				prev_next = &link->next;
+			}
+			i = next;
+		}
+	}
+}
+
+/* Unlink the blocks in the oldest code cache region and free it */
+static void recmem_evict_oldest_region()
+{
+	RecMemRegion *reg = &recmem_regions[recmem_oldest_region];
+
+	for (u32 i = 0; i < reg->num_blocks; ++i) {
+		const u32 block_pc = reg->block_pc[i];
+		// Block might have been invalidated and recompiled elsewhere since
+		const u32 block_ptr = PC_REC32(block_pc);
+		if (block_ptr >= (u32)reg->start && block_ptr < (u32)reg->end)
+			PC_REC32(block_pc) = 0;
+	}
+
+	block_link_evict(reg->start, reg->end);
+
+	REC_LOG_V("Evicting code cache region %u: %u blocks at %p..%p\n",
+	          recmem_oldest_region, reg->num_blocks, reg->start, reg->end);
+
+	recmem_stats.evictions++;
+	recmem_stats.evicted_blocks += reg->num_blocks;
+
+	reg->start = reg->end = NULL;
+	reg->num_blocks = 0;
+	recmem_oldest_region = (recmem_oldest_region + 1) % RECMEM_REGIONS;
+	recmem_live_regions--;
+}
+
+/* Close the region being filled and open the next one, at 'recMem' or at
+ *  the start of the code cache if there's not enough room left above it.
+ */
+static void recmem_next_region()
+{
+	u8 *start = (u8*)recMem;
+	if (start + RECMEM_REGION_SIZE + RECMEM_REGION_SLACK > recMemBase + RECMEM_SIZE)
+		start = recMemBase;
+	u8 *end = start + RECMEM_REGION_SIZE + RECMEM_REGION_SLACK;
+
+	// Evict oldest regions until a free slot exists and no live region
+	//  overlaps the space the new region might fill.
+	for (;;) {
+		bool overlap = false;
+		u32 r = recmem_oldest_region;
+		for (u32 i = 0; i < recmem_live_regions; ++i) {
+			if (recmem_regions[r].start < end && recmem_regions[r].end > start)
+				overlap = true;
+			r = (r + 1) % RECMEM_REGIONS;
+		}
+
+		if (!overlap && recmem_live_regions < RECMEM_REGIONS)
+			break;
+		recmem_evict_oldest_region();
+	}
+
+	recmem_cur_region = (recmem_oldest_region + recmem_live_regions) % RECMEM_REGIONS;
+	recmem_live_regions++;
+
+	RecMemRegion *reg = &recmem_regions[recmem_cur_region];
+	reg->start = reg->end = start;
+	reg->num_blocks = 0;
+
+	recMem = (u32*)start;
+}
+
+/* Empty the code cache, called from recReset() */
+static void recmem_reset()
+{
+	memset(recmem_regions, 0, sizeof(recmem_regions));
+	recmem_oldest_region = recmem_cur_region = 0;
+	recmem_live_regions = 1;
+	recmem_regions[0].start = recmem_regions[0].end = recMemBase;
+
+	recMem = (u32*)recMemBase;
 }
 
 
+/* Called from tier stubs: interpret code at psxRegs.pc, or if it's now hot,
+ *  drop the stub so the dispatch loop recompiles it (see rec_tier.h).
+ */
+static void recTierStub()
+{
+	if (recTierHot(psxRegs.pc)) {
+		u32 *block_ptr = (u32*)PC_REC(psxRegs.pc);
+		*block_ptr = 0;
+		block_link_unlink_range(block_ptr, block_ptr);
+		return;
+	}
+
+	recTierInterpret();
+}
+
+/* Emit stub block for 'pc', which calls recTierStub() and returns to the
+ *  dispatch loop with the new psxRegs.pc. It adds no cycles of its own:
+ *  interpreted code is charged by recTierInterpret().
+ */
+static void recTierEmitStub()
+{
+	LI32(TEMP_1, pc);
+	JAL(recTierStub);
+	SW(TEMP_1, PERM_REG_1, off(pc));        // <BD> BD slot of JAL() above
+
+	rec_recompile_end_part1();
+
+	LW(MIPSREG_V0, PERM_REG_1, off(pc)); // <BD> Block retval $v0 = psxRegs.pc
+
+	rec_recompile_end_part2(false);
+}
+
 static void recRecompile()
 {
 	// Notify plugin_lib that we're recompiling (affects frameskip timing)
 	pl_dynarec_notify();
 
-	if (((uptr)recMem - (uptr)recMemBase) >= RECMEM_SIZE_MAX ) {
-		REC_LOG("Code cache size limit exceeded: flushing code cache.\n");
-		recReset();
+	struct timeval tv_start;
+	gettimeofday(&tv_start, 0);
+
+	RecMemRegion *region = &recmem_regions[recmem_cur_region];
+	if (((u8*)recMem - region->start) >= RECMEM_REGION_SIZE ||
+	    region->num_blocks == RECMEM_REGION_BLOCKS) {
+		recmem_next_region();
+		region = &recmem_regions[recmem_cur_region];
 	}
+	region->block_pc[region->num_blocks++] = psxRegs.pc;
 
 	recMemStart = recMem;
 
@@ -449,13 +814,37 @@ static void recRecompile()
 		code_pages[masked_pc/4096/8] |= (1 << ((masked_pc/4096) & 7));
 	}
 
+	// Tiered mode: code that isn't hot yet gets a stub that interprets it,
+	//  counting entries until it is.
+	if (rec_tier_active && !recTierIsHot(pc)) {
+		recTierEmitStub();
+		region->end = (u8*)recMem;
+		clear_insn_cache(recMemStart, recMem, 0);
+		block_link_resolve((u32*)PC_REC(oldpc));
+		return;
+	}
+
 	DISASM_INIT();
 
 	rec_recompile_start();
 
+	// Hot-block profiler: count executions of block
+	if (rec_stats_active) {
+		u32 *exec_count = recStatsBlockStart(pc, recMemStart);
+		if (exec_count) {
+			LUI(TEMP_1, ADR_HI(exec_count));
+			LW(TEMP_2, TEMP_1, ADR_LO(exec_count));
+			ADDIU(TEMP_2, TEMP_2, 1);
+			SW(TEMP_2, TEMP_1, ADR_LO(exec_count));
+		}
+	}
+
 	// Reset const-propagation
 	ResetConsts();
 
+	// Find which PSX regs are live where, for the register allocator
+	regAnalyzeBlock(pc);
+
 	// Flag indicates when recompilation should stop
 	end_block = false;
 
@@ -475,6 +864,36 @@ static void recRecompile()
 	//  set $ra before block entry. See rec_recompile_end_part1().
 	host_ra_reg_has_block_retaddr = (block_ret_addr == 0);
 
+#ifdef USE_IDLE_LOOP_SKIP
+	{
+		const u32 idle_branch_pc = psxIdleLoopFind(pc);
+		if (idle_branch_pc) {
+			// Block is the whole loop, ending after BD slot of its branch
+			LI32(MIPSREG_A0, idle_branch_pc);
+			LI32(MIPSREG_A1, ADJUST_CLOCK((idle_branch_pc + 8 - oldpc)/4));
+			JAL(psxIdleLoopBlockEntry);
+			NOP(); // <BD>
+		}
+	}
+#endif
+
+	// BIOS call vector: return to caller if the function was run natively.
+	//  psxBiosHookCall() has set psxRegs.pc and psxRegs.cycle then.
+	if (bios_hooks_active && psxBiosHookIsVector(pc)) {
+		LI32(MIPSREG_A0, pc);
+		JAL(psxBiosHookCall);
+		NOP(); // <BD>
+		u32 *backpatch = (u32 *)recMem;
+		BEQZ(MIPSREG_V0, 0);
+		NOP(); // <BD>
+
+		rec_recompile_end_part1();
+		LW(MIPSREG_V0, PERM_REG_1, off(pc)); // <BD> Block retval $v0 = psxRegs.pc
+		rec_recompile_end_part2(false);
+
+		fixup_branch(backpatch);
+	}
+
 	// Number of discardable instructions we are currently skipping
 	int discard_cnt = 0;
 
@@ -490,8 +909,10 @@ static void recRecompile()
 		if (discard_cnt == 0) {
 			int discard_type = 0;
 			discard_cnt = rec_discard_scan(pc, &discard_type);
-			if (discard_cnt > 0)
+			if (discard_cnt > 0) {
 				DISASM_MSG(" ->BEGIN code discard: %s\n", rec_discard_type_str(discard_type));
+				rec_stats_add_discard(discard_cnt);
+			}
 		}
 #endif
 
@@ -502,19 +923,42 @@ static void recRecompile()
 		// Skip next discardable instruction in any sequence found.
 		if (discard_cnt > 0) {
 			--discard_cnt;
-			if (discard_cnt == 0)
+			if (discard_cnt == 0) {
 				DISASM_MSG(" ->END code discard.\n");
+			}
 			continue;
 		}
 #endif
 
 		// Recompile next instruction.
-		recBSC[psxRegs.code>>26]();
+		regLiveUpdate(pc - 4);
+		recOpcode();
 		regUpdate();
 	} while (!end_block);
 
+	// Write-protect the RAM pages the block was recompiled from
+	if (smc_protect_code)
+		psxSmcProtect(oldpc, pc);
+
+	region->end = (u8*)recMem;
+
 	DISASM_HOST();
 	clear_insn_cache(recMemStart, recMem, 0);
+
+	// Link exits of other blocks that jump to this one
+	block_link_resolve((u32*)PC_REC(oldpc));
+
+	// Report time spent to plugin_lib, which tracks compile stalls per frame
+	struct timeval tv_end;
+	gettimeofday(&tv_end, 0);
+	const u32 usecs = (tv_end.tv_sec - tv_start.tv_sec) * 1000000 +
+	                  tv_end.tv_usec - tv_start.tv_usec;
+	pl_dynarec_stall(usecs);
+
+	if (rec_stats_active)
+		recStatsBlockEnd(pc, (u8*)recMem - (u8*)recMemStart, recMem - recMemStart, usecs);
+
+	rec_perf_block(oldpc, recMemStart, (u8*)recMem - (u8*)recMemStart);
 }
 
 
@@ -526,12 +970,8 @@ static int recInit()
 
 	// Init code buffer, to allocate the RAM we need in advance. Filling with
 	//  all-1's should force an exception on any accidental non-code execution.
-	{
-		size_t fill_size = RECMEM_SIZE_MAX + 0x1000;  // 4KB past 'maximum' we'd ever use.
-		if (fill_size > RECMEM_SIZE)
-			fill_size = RECMEM_SIZE;
-		memset(recMemBase, 0xff, fill_size);
-	}
+	//  All of it can be used: regions may run into slack space at the end.
+	memset(recMemBase, 0xff, RECMEM_SIZE);
 
 	// The tables recRAM and recROM hold block code pointers for all valid PC
 	//  values for a PS1 program, after masking away banking and/or mirroring.
@@ -566,6 +1006,18 @@ static int recInit()
 		printf("Error allocating memory\n"); return -1;
 	}
 
+#ifdef ASM_EXECUTE_LOOP
+	if (Config.RecVerify) {
+		printf("WARNING: -recverify needs a build with NO_ASM_EXECUTE_LOOP, ignoring it.\n");
+		Config.RecVerify = false;
+	}
+#endif
+
+	psxVerifyInit();
+	recStatsInit();
+	recPerfInit();
+	recTierInit();
+
 	for (int i = 0; i < 0x80; i++)
 		psxRecLUT[i + 0x0000] = (uptr)recRAM + (((i & 0x1f) << 16) * (REC_RAM_PTR_SIZE/4));
 
@@ -590,10 +1042,37 @@ static int recInit()
 }
 
 
+/* Hot-block report: disassemble a block's host code, if still in cache */
+static void recPrintHostCode(const RecStatsBlock *b)
+{
+	const u32 *host = (const u32 *)b->host;
+	char buf[512];
+
+	if (PC_REC32(b->pc) != (u32)host) {
+		printf("Host code: no longer in code cache\n");
+		return;
+	}
+
+	printf("Host code (%u opcodes):\n", b->host_insns);
+	for (u32 i = 0; i < b->host_insns; i++) {
+		disasm_mips_instruction(host[i], buf, (u32)&host[i], NULL, 0);
+		printf("  %08x: %08x  %s\n", (u32)&host[i], host[i], buf);
+	}
+}
+
 static void recShutdown()
 {
 	REC_LOG("Shutting down\n");
 
+	if (recmem_stats.evictions)
+		REC_LOG("Code cache: %u regions evicted, %u blocks unlinked\n",
+		        recmem_stats.evictions, recmem_stats.evicted_blocks);
+	pl_dynarec_print_stats();
+	recStatsShutdown(recPrintHostCode);
+	recPerfShutdown();
+	recTierShutdown();
+	psxVerifyShutdown();
+
 	if (psx_mem_mapped)
 		rec_munmap_psx_mem();
 	if (rec_mem_mapped)
@@ -655,6 +1134,25 @@ __attribute__((noinline)) static void recFunc(void *fn)
 		  "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "fp", "ra", "memory"
 	);
 }
+
+/* psxVerifyBlock() takes a function to call, not a block ptr */
+static void *verify_block;
+
+static void recFuncVerify()
+{
+	recFunc(verify_block);
+}
+
+/* Run block 'fn', checking it against the interpreter if -recverify is set */
+static inline void recRunBlock(void *fn)
+{
+	if (!Config.RecVerify) {
+		recFunc(fn);
+	} else {
+		verify_block = fn;
+		psxVerifyBlock(recFuncVerify);
+	}
+}
 #endif
 
 
@@ -677,7 +1175,7 @@ __attribute__((noinline)) void recExecute_indirect_return_lut()
 		if (*p == 0)
 			recRecompile();
 
-		recFunc((void *)*p);
+		recRunBlock((void *)*p);
 
 		if (psxRegs.cycle >= psxRegs.io_cycle_counter)
 			psxBranchTest();
@@ -842,7 +1340,7 @@ __attribute__((noinline)) static void recExecute_indirect_return_mmap()
 		if (*p == 0)
 			recRecompile();
 
-		recFunc((void *)*p);
+		recRunBlock((void *)*p);
 
 		if (psxRegs.cycle >= psxRegs.io_cycle_counter)
 			psxBranchTest();
@@ -1449,7 +1947,7 @@ __attribute__((noinline)) static void recExecuteBlock(unsigned target_pc)
 		if (*p == 0)
 			recRecompile();
 
-		recFunc((void *)*p);
+		recRunBlock((void *)*p);
 
 		if (psxRegs.cycle >= psxRegs.io_cycle_counter)
 			psxBranchTest();
@@ -1674,9 +2172,15 @@ static void recClear(u32 Addr, u32 Size)
 	//       mirror region the game is already using, reducing TLB pressure.
 	uptr dst_base = !rec_mem_mapped ? (uptr)recRAM : (uptr)PC_REC_MMAP(Addr & ~0x1fffff);
 
+	rec_stats_add_clear(has_code);
+
 	if (has_code) {
 		void *dst = (void*)(dst_base + (masked_ram_addr * REC_RAM_PTR_SIZE/4));
 		memset(dst, 0, Size*REC_RAM_PTR_SIZE);
+
+		// Exits linked to the invalidated blocks go back to dispatch loop
+		u32 *first = (u32*)PC_REC(masked_ram_addr);
+		block_link_unlink_range(first, first + (Size-1));
 	}
 }
 
@@ -1711,6 +2215,7 @@ void recNotify(int note, void *data __attribute__((unused)))
 			 *  invalidations after stores, boosting speed.
 			 */
 			recClear(0, 0x200000/4);
+			rec_stats_add_flush();
 			REC_LOG_V("R3000ACPU_NOTIFY_CACHE_UNISOLATED\n");
 			break;
 
@@ -1738,6 +2243,7 @@ void recNotify(int note, void *data __attribute__((unused)))
 			 */
 			if (flush_code_on_dma3_exe_load) {
 				recClear(0, 0x200000/4);
+				rec_stats_add_flush();
 				REC_LOG_V("R3000ACPU_NOTIFY_DMA3_EXE_LOAD .. Flushing dynarec cache\n");
 			} else {
 				REC_LOG_V("R3000ACPU_NOTIFY_DMA3_EXE_LOAD\n");
@@ -1755,8 +2261,11 @@ static void recReset()
 	memset(code_pages, 0, sizeof(code_pages));
 	memset(recRAM, 0, REC_RAM_SIZE);
 	memset(recROM, 0, REC_ROM_SIZE);
+	psxSmcReset();
 
-	recMem = (u32*)recMemBase;
+	recmem_reset();
+	block_link_reset();
+	rec_stats_add_flush();
 
 	regReset();
 
@@ -1,6 +1,19 @@
 #define REG_CACHE_START		MIPSREG_S0
 #define REG_CACHE_END		(MIPSREG_S7+1)
 
+/* Caller-saved t4..t7 are used too, but only while recompiling an opcode
+ *  whose code can't call C. See regLiveUpdate() */
+#define REG_CACHE_TMP_START	MIPSREG_T4
+#define REG_CACHE_TMP_END	(MIPSREG_T7+1)
+
+/* PSX regs tracked: GPRs, then LO,HI (psxRegs.GPR.r[32],r[33]) */
+#define REG_LO			32
+#define REG_HI			33
+#define REG_PSX_COUNT		34
+
+/* Max opcodes scanned ahead by regAnalyzeBlock() */
+#define REG_LIVE_MAX_OPS	256
+
 #define REG_LOAD		0
 #define REG_FIND		1
 #define REG_LOADBRANCH		2
@@ -30,14 +43,25 @@ typedef struct {
 } PSX_RecRegister;
 
 typedef struct {
-	PSX_RecRegister		psx[32];
+	PSX_RecRegister		psx[REG_PSX_COUNT];
 	HOST_RecRegister	host[32];
 	u32			reglist[32];
-	u32			reglist_cnt;
 } RecRegisters;
 
 RecRegisters regcache;
 
+/* Liveness data for block being recompiled, see regAnalyzeBlock() */
+static struct {
+	u32	start_pc;
+	u32	num_ops;                        // Opcodes analyzed
+	u32	cur;                            // Index of opcode being recompiled
+	bool	tmp_regs_usable;                // Can t4..t7 hold PSX regs right now?
+	bool	calls[REG_LIVE_MAX_OPS];        // Code emitted for opcode might call C?
+	u64	reads[REG_LIVE_MAX_OPS];        // PSX regs read by opcode
+	u64	live[REG_LIVE_MAX_OPS+1];       // PSX regs live on entry to opcode
+	u16	uses[REG_LIVE_MAX_OPS+1][REG_PSX_COUNT]; // Reads from opcode onward
+} reglive;
+
 // Stack for regPushState()/regPopState()
 static int          regcache_bak_idx  = 0;
 static const int    regcache_bak_size = 8; // Abitrary size choice (overkill?)
@@ -46,7 +70,7 @@ static RecRegisters regcache_bak[regcache_bak_size];
 /* Spill regs to psxRegs if they are in host regs and were modified */
 static void regClearJump(void)
 {
-	for (int i = 1; i < 32; i++) {
+	for (int i = 1; i < REG_PSX_COUNT; i++) {
 		if (regcache.psx[i].ismapped) {
 			int mappedto = regcache.psx[i].mappedto;
 
@@ -66,80 +90,164 @@ static void regClearJump(void)
 	}
 }
 
-static void regFreeRegs(void)
+/* Release host reg 'hostreg', spilling PSX reg it holds if it was modified */
+static void regFreeHost(u32 hostreg, bool spill)
 {
-	//DEBUGF("regFreeRegs\n");
-	int i = 0;
-	int firstfound = 0;
+	if (regcache.host[hostreg].ismapped) {
+		int psxreg = regcache.host[hostreg].mappedto;
 
-	while (regcache.reglist[i] != 0xFF) {
-		int hostreg = regcache.reglist[i];
-		//DEBUGF("spilling %dth reg (%d)", i, hostreg);
+		if (spill && regcache.psx[psxreg].psx_ischanged) {
+			SW(hostreg, PERM_REG_1, offGPR(psxreg));
+		}
 
-		if (!regcache.host[hostreg].host_islocked) {
-			int psxreg = regcache.host[hostreg].mappedto;
+		regcache.psx[psxreg].psx_ischanged = false;
+		regcache.psx[psxreg].ismapped = false;
+		regcache.psx[psxreg].mappedto = 0;
+	}
 
-			if (regcache.psx[psxreg].psx_ischanged) {
-				SW(hostreg, PERM_REG_1, offGPR(psxreg));
-			}
+	regcache.host[hostreg].ismapped = false;
+	regcache.host[hostreg].mappedto = 0;
+	regcache.host[hostreg].host_type = REG_EMPTY;
+	regcache.host[hostreg].host_age = 0;
+	regcache.host[hostreg].host_use = 0;
+	regcache.host[hostreg].host_islocked = 0;
+}
 
-			regcache.psx[psxreg].psx_ischanged = false;
-			regcache.host[hostreg].ismapped = regcache.psx[psxreg].ismapped = false;
-			regcache.host[hostreg].mappedto = regcache.psx[psxreg].mappedto = 0;
-			regcache.host[hostreg].host_type = REG_EMPTY;
-			regcache.host[hostreg].host_age = 0;
-			regcache.host[hostreg].host_use = 0;
-			regcache.host[hostreg].host_islocked = 0;
-
-			if (firstfound == 0) {
-				regcache.reglist_cnt = i;
-				//DEBUGF("setting reglist_cnt %d", i);
-				firstfound = 1;
-			}
-		}
-		//else DEBUGF("locked :(");
+static inline bool regIsTmpHost(u32 hostreg)
+{
+	return hostreg >= REG_CACHE_TMP_START && hostreg < REG_CACHE_TMP_END;
+}
+
+/* Opcodes from the current one onward in block that read PSX reg 'regpsx' */
+static inline u32 regUsesLeft(u32 regpsx)
+{
+	if (reglive.cur >= reglive.num_ops)
+		return 0xffff; // Unknown, assume many
+	return reglive.uses[reglive.cur][regpsx];
+}
+
+/* Opcodes until PSX reg 'regpsx' is next read, counting from current one */
+static u32 regNextRead(u32 regpsx)
+{
+	if (reglive.cur >= reglive.num_ops)
+		return 0; // Unknown, assume soon
 
-		i++;
+	for (u32 i = reglive.cur; i < reglive.num_ops; i++) {
+		if (reglive.reads[i] & ((u64)1 << regpsx))
+			return i - reglive.cur;
 	}
 
-	if (!firstfound) DEBUGF("FATAL ERROR: unable to free register");
+	return REG_LIVE_MAX_OPS;
 }
 
-static u32 regAllocHost()
+/* Free one unlocked host reg. Private copies made by REG_LOADBRANCH go
+ *  first, then the PSX reg read furthest in the future (or never again),
+ *  preferring one that needs no spilling.
+ * Returns: false if every host reg is locked.
+ */
+static bool regFreeRegs(void)
 {
-	//DEBUGF("regMipsToHostHelper regpsx %d action %d type %d reglist_cnt %d", regpsx, action, type, regcache.reglist_cnt);
-	int regnum = regcache.reglist[regcache.reglist_cnt];
+	//DEBUGF("regFreeRegs\n");
+	int victim = -1;
+	u32 victim_dist = 0;
+	bool victim_changed = true;
+	u32 victim_age = 0;
+
+	for (int i = 0; regcache.reglist[i] != 0xFF; i++) {
+		int hostreg = regcache.reglist[i];
+
+		if (regcache.host[hostreg].host_type == REG_EMPTY ||
+		    regcache.host[hostreg].host_islocked)
+			continue;
 
-	//DEBUGF("regnum 1 %d", regnum);
+		if (regIsTmpHost(hostreg) && !reglive.tmp_regs_usable)
+			continue;
 
-	while (regnum != 0xFF) {
-		//DEBUGF("checking reg %d", regnum);
-		if (regcache.host[regnum].host_type == REG_EMPTY) {
+		if (!regcache.host[hostreg].ismapped) {
+			victim = hostreg;
 			break;
 		}
 
-		regcache.reglist_cnt++;
-		//DEBUGF("setting reglist_cnt %d", regcache.reglist_cnt);
-		regnum = regcache.reglist[regcache.reglist_cnt];
+		int psxreg = regcache.host[hostreg].mappedto;
+		u32 dist = regNextRead(psxreg);
+		bool changed = regcache.psx[psxreg].psx_ischanged;
+		u32 age = regcache.host[hostreg].host_age;
+
+		if (victim < 0 || dist > victim_dist ||
+		    (dist == victim_dist && (changed < victim_changed ||
+		                             (changed == victim_changed && age > victim_age)))) {
+			victim = hostreg;
+			victim_dist = dist;
+			victim_changed = changed;
+			victim_age = age;
+		}
 	}
 
-	//DEBUGF("regnum 2 %d", regnum);
-	if (regnum == 0xFF) {
-		regFreeRegs();
-		regnum = regcache.reglist[regcache.reglist_cnt];
-		if (regnum == 0xff)
-			regClearJump();
+	if (victim < 0) {
+		DEBUGF("FATAL ERROR: unable to free register");
+		return false;
+	}
+
+	//DEBUGF("spilling reg %d", victim);
+	regFreeHost(victim, true);
+	return true;
+}
+
+/* Find an empty host reg for PSX reg 'regpsx'. While t4..t7 are usable, PSX
+ *  regs read at most once more go there first, leaving s0..s7 to the ones
+ *  that are likely to stay resident across calls to C.
+ */
+static int regFindEmptyHost(u32 regpsx)
+{
+	bool prefer_tmp = reglive.tmp_regs_usable && regUsesLeft(regpsx) <= 1;
+
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; regcache.reglist[i] != 0xFF; i++) {
+			int hostreg = regcache.reglist[i];
+			bool is_tmp = regIsTmpHost(hostreg);
+
+			if (is_tmp && !reglive.tmp_regs_usable)
+				continue;
+			if (pass == 0 && is_tmp != prefer_tmp)
+				continue;
+			if (regcache.host[hostreg].host_type == REG_EMPTY)
+				return hostreg;
+		}
 	}
 
-	regcache.reglist_cnt++;
-	//DEBUGF("setting reglist_cnt %d", regcache.reglist_cnt);
+	return 0;
+}
+
+static u32 regAllocHost(u32 regpsx)
+{
+	int regnum = regFindEmptyHost(regpsx);
+
+	if (!regnum) {
+		if (!regFreeRegs())
+			regClearJump();
+		regnum = regFindEmptyHost(regpsx);
+	}
 
 	return regnum;
 }
 
+/* Load PSX reg 'regpsx' into host reg 'hostreg' */
+static void regLoadHost(u32 hostreg, u32 regpsx)
+{
+	// If reg value is known-const, see if it can be loaded with just one ALU op
+	if (regpsx < 32 && IsConst(regpsx) &&
+	    ( (((u32)GetConst(regpsx) <= 0xffff) || !(GetConst(regpsx) & 0xffff)) ||
+	      (((s32)GetConst(regpsx) < 0) && ((s32)GetConst(regpsx) >= -32768))    ))
+	{
+		LI32(hostreg, GetConst(regpsx));
+	} else {
+		LW(hostreg, PERM_REG_1, offGPR(regpsx));
+	}
+}
+
 static u32 regMipsToHostHelper(u32 regpsx, u32 action, u32 type)
 {
-	int regnum = regAllocHost();
+	int regnum = regAllocHost(regpsx);
 
 	regcache.host[regnum].host_type = type;
 	regcache.host[regnum].host_islocked++;
@@ -158,29 +266,14 @@ static u32 regMipsToHostHelper(u32 regpsx, u32 action, u32 type)
 		regcache.host[regnum].ismapped = false;
 		regcache.host[regnum].mappedto = 0;
 
-		// If reg value is known-const, see if it can be loaded with just one ALU op
-		if (IsConst(regpsx) && ( (((u32)GetConst(regpsx) <= 0xffff) || !(GetConst(regpsx) & 0xffff)) ||
-		                         (((s32)GetConst(regpsx) < 0) && ((s32)GetConst(regpsx) >= -32768))    ))
-		{
-			LI32(regnum, GetConst(regpsx));
-		} else {
-			LW(regnum, PERM_REG_1, offGPR(regpsx));
-		}
+		regLoadHost(regnum, regpsx);
 
 		//DEBUGF("regnum 3 %d", regnum);
 		return regnum;
 	}
 
-	if (action == REG_LOAD) {
-		// If reg value is known-const, see if it can be loaded with just one ALU op
-		if (IsConst(regpsx) && ( (((u32)GetConst(regpsx) <= 0xffff) || !(GetConst(regpsx) & 0xffff)) ||
-		                         (((s32)GetConst(regpsx) < 0) && ((s32)GetConst(regpsx) >= -32768))    ))
-		{
-			LI32(regcache.psx[regpsx].mappedto, GetConst(regpsx));
-		} else {
-			LW(regcache.psx[regpsx].mappedto, PERM_REG_1, offGPR(regpsx));
-		}
-	}
+	if (action == REG_LOAD)
+		regLoadHost(regnum, regpsx);
 
 	return regnum;
 }
@@ -247,7 +340,7 @@ static void regUnlock(u32 reghost)
 
 static void regClearBranch(void)
 {
-	for (int i = 1; i < 32; i++) {
+	for (int i = 1; i < REG_PSX_COUNT; i++) {
 		if (regcache.psx[i].ismapped && regcache.psx[i].psx_ischanged) {
 			SW(regcache.psx[i].mappedto, PERM_REG_1, offGPR(i));
 		}
@@ -257,7 +350,7 @@ static void regClearBranch(void)
 static void regReset()
 {
 	int i, i2;
-	for (i = 0; i < 32; i++) {
+	for (i = 0; i < REG_PSX_COUNT; i++) {
 		regcache.psx[i].psx_ischanged = false;
 		regcache.psx[i].ismapped = false;
 		regcache.psx[i].mappedto = 0;
@@ -274,17 +367,23 @@ static void regReset()
 
 	for (i = REG_CACHE_START; i < REG_CACHE_END; i++)
 		regcache.host[i].host_type = REG_EMPTY;
+	for (i = REG_CACHE_TMP_START; i < REG_CACHE_TMP_END; i++)
+		regcache.host[i].host_type = REG_EMPTY;
 
-	for (i = 0, i2 = 0; i < 32; i++) {
-		if (regcache.host[i].host_type == REG_EMPTY) {
-			regcache.reglist[i2] = i;
-			i2++;
-		}
-	}
+	// Callee-saved regs come first in list, so they are tried first
+	i2 = 0;
+	for (i = REG_CACHE_START; i < REG_CACHE_END; i++)
+		regcache.reglist[i2++] = i;
+	for (i = REG_CACHE_TMP_START; i < REG_CACHE_TMP_END; i++)
+		regcache.reglist[i2++] = i;
 
 	regcache.reglist[i2] = 0xFF;
-	regcache.reglist_cnt = 0;
 	regcache_bak_idx = 0; // Empty regcache stack
+
+	// No liveness info until regAnalyzeBlock() is called
+	reglive.num_ops = 0;
+	reglive.cur = 0;
+	reglive.tmp_regs_usable = false;
 	//DEBUGF("reglist len %d", i2);
 }
 
@@ -298,6 +397,189 @@ static void regUpdate(void)
 			regcache.host[ilock].host_islocked = 0;
 		}
 	}
+
+	for (ilock = REG_CACHE_TMP_START; ilock < REG_CACHE_TMP_END; ilock++) {
+		if (regcache.host[ilock].ismapped) {
+			regcache.host[ilock].host_age++;
+			regcache.host[ilock].host_islocked = 0;
+		}
+	}
+}
+
+/* Release PSX regs held in t4..t7, spilling those that were modified */
+static void regFlushTmpHosts(void)
+{
+	for (int i = REG_CACHE_TMP_START; i < REG_CACHE_TMP_END; i++) {
+		if (regcache.host[i].host_type != REG_EMPTY)
+			regFreeHost(i, true);
+	}
+}
+
+/* Opcode classes for regAnalyzeBlock() */
+enum {
+	REG_OP_INLINE,   // Emitted code never calls C
+	REG_OP_CALLS,    // Load/store/GTE: emitted code might call C
+	REG_OP_BRANCH,   // Conditional branch, followed by BD slot
+	REG_OP_JUMP,     // J,JAL,JR,JALR, followed by BD slot
+	REG_OP_BARRIER   // SYSCALL,BREAK,COP0,HLE or unknown opcode
+};
+
+static int regOpcodeClass(u32 op)
+{
+	switch (op >> 26) {
+		case 0x00: /* SPECIAL prefix */
+			switch (op & 0x3f) {
+				case 0x00: case 0x02: case 0x03: /* SLL,SRL,SRA */
+				case 0x04: case 0x06: case 0x07: /* SLLV,SRLV,SRAV */
+				case 0x10: case 0x11: case 0x12: case 0x13: /* MFHI,MTHI,MFLO,MTLO */
+				case 0x18: case 0x19: case 0x1a: case 0x1b: /* MULT,MULTU,DIV,DIVU */
+				case 0x20: case 0x21: case 0x22: case 0x23: /* ADD,ADDU,SUB,SUBU */
+				case 0x24: case 0x25: case 0x26: case 0x27: /* AND,OR,XOR,NOR */
+				case 0x2a: case 0x2b:                       /* SLT,SLTU */
+					return REG_OP_INLINE;
+				case 0x08: case 0x09:                       /* JR,JALR */
+					return REG_OP_JUMP;
+			}
+			return REG_OP_BARRIER;
+		case 0x01: /* REGIMM prefix */
+			switch ((op >> 16) & 0x1f) {
+				case 0x00: case 0x01: case 0x10: case 0x11: /* BLTZ,BGEZ,BLTZAL,BGEZAL */
+					return REG_OP_BRANCH;
+			}
+			return REG_OP_BARRIER;
+		case 0x02: case 0x03:                               /* J,JAL */
+			return REG_OP_JUMP;
+		case 0x04: case 0x05: case 0x06: case 0x07:         /* BEQ,BNE,BLEZ,BGTZ */
+			return REG_OP_BRANCH;
+		case 0x08: case 0x09: case 0x0a: case 0x0b:         /* ADDI,ADDIU,SLTI,SLTIU */
+		case 0x0c: case 0x0d: case 0x0e: case 0x0f:         /* ANDI,ORI,XORI,LUI */
+			return REG_OP_INLINE;
+		case 0x12:                                          /* COP2 (GTE) */
+		case 0x20: case 0x21: case 0x22: case 0x23:         /* LB,LH,LWL,LW */
+		case 0x24: case 0x25: case 0x26:                    /* LBU,LHU,LWR */
+		case 0x28: case 0x29: case 0x2a: case 0x2b:         /* SB,SH,SWL,SW */
+		case 0x2e:                                          /* SWR */
+		case 0x32: case 0x3a:                               /* LWC2,SWC2 */
+			return REG_OP_CALLS;
+	}
+
+	return REG_OP_BARRIER;
+}
+
+/* Scan block at 'start_pc' ahead of recompiling it, up to its first jump's
+ *  BD slot, first barrier opcode or the end of its 64KB page. Records which
+ *  PSX regs each opcode reads and which are live on entry to it, and how many
+ *  reads of each remain from there on. Reads and writes come from the shared
+ *  block IR (../rec_ir.h), built here for recOpcode() to lower ops from.
+ *  Branches, jumps, BD slots and barrier opcodes might leave the block, so
+ *  every PSX reg is live at them, as at the end of the scanned range. Code
+ *  rec_discard_scan() finds is analyzed like any other: it starts with a
+ *  branch, so nothing can be found dead inside it.
+ */
+static void regAnalyzeBlock(u32 start_pc)
+{
+	const u64 all_regs = ((u64)1 << REG_PSX_COUNT) - 1;
+	u64  writes[REG_LIVE_MAX_OPS];
+	bool barrier[REG_LIVE_MAX_OPS];
+	bool in_bd_slot = false;
+	bool end_scan = false;
+	bool end_scan_after_bd = false;
+	u32  n = 0;
+
+	// IR goes on past conditional branches, like the block. Leave room in
+	//  the page for the BD slot of a branch at its last op.
+	const int page_ops = (0x10000 - (start_pc & 0xffff)) / 4;
+	recIRBuild(&rec_ir, start_pc, page_ops > REG_LIVE_MAX_OPS ? REG_LIVE_MAX_OPS : page_ops-1, true);
+	recIROptimize(&rec_ir);
+
+	reglive.start_pc = start_pc;
+
+	while (n < REG_LIVE_MAX_OPS && n < (u32)rec_ir.num_ops && !end_scan) {
+		const RecIROp *ir_op = &rec_ir.ops[n];
+		const u32 op = ir_op->code;
+		const int op_class = regOpcodeClass(op);
+
+		if (op_class == REG_OP_BARRIER) {
+			reglive.reads[n] = all_regs;
+			writes[n] = 0;
+			end_scan = true;
+		} else {
+			// IR bits 32,33 are LO,HI, same as REG_LO,REG_HI
+			reglive.reads[n] = ir_op->reads;
+			writes[n] = ir_op->writes;
+			end_scan = in_bd_slot && end_scan_after_bd;
+
+			// LSU emitters still emit redundant loads as loads
+			if (ir_op->flags & REC_IR_REDUNDANT)
+				reglive.reads[n] |= (u64)1 << _fRs_(op);
+#ifdef USE_BLOCK_IR
+			// recOpcode() skips dead ALU ops
+			if ((ir_op->flags & REC_IR_DEAD) && ir_op->kind == REC_IR_ALU)
+				reglive.reads[n] = 0;
+#endif
+		}
+
+		reglive.calls[n] = (op_class != REG_OP_INLINE);
+		barrier[n] = in_bd_slot || (op_class != REG_OP_INLINE && op_class != REG_OP_CALLS);
+		end_scan_after_bd = (op_class == REG_OP_JUMP);
+		in_bd_slot = (op_class == REG_OP_BRANCH || op_class == REG_OP_JUMP);
+		n++;
+	}
+
+	reglive.num_ops = n;
+	reglive.live[n] = all_regs;
+	memset(reglive.uses[n], 0, sizeof(reglive.uses[n]));
+
+	for (int i = n-1; i >= 0; i--) {
+		if (barrier[i])
+			reglive.live[i] = all_regs;
+		else
+			reglive.live[i] = (reglive.live[i+1] & ~writes[i]) | reglive.reads[i];
+
+		for (int r = 0; r < REG_PSX_COUNT; r++)
+			reglive.uses[i][r] = reglive.uses[i+1][r] + ((reglive.reads[i] >> r) & 1);
+	}
+}
+
+/* Called before recompiling each opcode, with its PC.
+ *  PSX regs whose values are dead here are released without spilling.
+ *  t4..t7 are only usable while the code emitted next can't call C: the
+ *  opcode itself or the next two, which LUI+ADDU+LW-style load optimizations
+ *  (and other emitters combining opcodes) may recompile along with it.
+ */
+static void regLiveUpdate(u32 op_pc)
+{
+	const u32 idx = (op_pc - reglive.start_pc) / 4;
+
+	if (op_pc < reglive.start_pc || idx >= reglive.num_ops) {
+		reglive.cur = reglive.num_ops;
+		reglive.tmp_regs_usable = false;
+		regFlushTmpHosts();
+		return;
+	}
+
+	reglive.cur = idx;
+
+	// A MULT/MULTU converted to 3-op MUL wrote a later MFLO's dest reg
+	//  early, which the liveness info doesn't know. See convertMultiplyTo3Op()
+	if (!skip_emitting_next_mflo) {
+		for (int i = 1; i < REG_PSX_COUNT; i++) {
+			if (regcache.psx[i].ismapped && !(reglive.live[idx] & ((u64)1 << i))) {
+				// Const-propagation mustn't assume the value is still in place
+				if (i < 32)
+					SetUndef(i);
+				regFreeHost(regcache.psx[i].mappedto, false);
+			}
+		}
+	}
+
+	bool calls = false;
+	for (u32 i = idx; i < idx+3; i++)
+		calls |= (i >= reglive.num_ops) || reglive.calls[i];
+
+	reglive.tmp_regs_usable = !calls;
+	if (calls)
+		regFlushTmpHosts();
 }
 
 static void regPushState()
@@ -1,9 +1,5 @@
-#include "rec_lsu.cpp.h" // Load Store Unit
-#include "rec_gte.cpp.h" // Geometry Transformation Engine
-#include "rec_alu.cpp.h" // Arithmetic Logical Unit
-#include "rec_mdu.cpp.h" // Multiple Divide Unit
-#include "rec_cp0.cpp.h" // Coprocessor 0
-#include "rec_bcu.cpp.h" // Branch Control Unit
+/* Opcode dispatch tables, shared by the MIPS and x86_64 backends. Included
+ *  by their recompiler.cpp after the backend's rec_*.cpp.h emitters. */
 
 static void recNULL() { }
 
@@ -0,0 +1,524 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Backend-neutral block IR for the recompilers, see rec_ir.h
+ *
+ *  Like the recompilers themselves, the passes ignore load-delay slots and
+ * ADD/ADDI/SUB overflow exceptions. Only RAM, scratchpad and ROM accesses
+ * are ever omitted or reused: hardware I/O accesses have side effects. A
+ * 'fuzzy' region is trusted the same way the MIPS recompiler trusts it:
+ * a const address plus an unknown index is assumed to stay in its region.
+ */
+
+#include "rec_ir.h"
+#include "r3000a.h"
+#include "psxmem.h"
+
+#define IR_REG(r) ((u64)1 << (r))
+#define ALL_REGS  (IR_REG(REC_IR_HI+1) - 1)  // GPRs and LO/HI
+
+/* Address region of known-const address 'addr' */
+static u8 irAddrRegion(u32 addr)
+{
+	const u32 seg = addr >> 29;
+	const u32 a = addr & 0x1fffffff;
+
+	// Only KUSEG, KSEG0, KSEG1 are mapped; KSEG2 has the cache control port
+	if (seg != 0 && seg != 4 && seg != 5)
+		return addr >= 0xc0000000 ? REC_IR_REGION_HW : REC_IR_REGION_UNKNOWN;
+
+	if (a < 0x00800000)
+		return REC_IR_REGION_RAM;
+	if (a >= 0x1f800000 && a < 0x1f800400)
+		return REC_IR_REGION_SCRATCHPAD;
+	if ((a >> 16) == 0x1f80)
+		return REC_IR_REGION_HW;
+	if (a >= 0x1fc00000 && a < 0x1fc80000)
+		return REC_IR_REGION_ROM;
+	return REC_IR_REGION_UNKNOWN;
+}
+
+/* Region of a const 'base' plus an unknown index. The same ranges as the
+ *  MIPS recompiler's recADDU() are used: scratchpad is only assumed when
+ *  'base' isn't its very first byte, as I/O ports lie right past it.
+ */
+static u8 irFuzzyRegion(u32 base)
+{
+	if (base >= 0x80000000 && base < 0x80800000)
+		return REC_IR_REGION_RAM;
+	if (base >= 0x1f800001 && base < 0x1f800400)
+		return REC_IR_REGION_SCRATCHPAD;
+	if ((base >= 0x1f000000 && base < 0x1f810000) ||
+	    (base >= 0xbfc00000 && base < 0xbfc80000))
+		return REC_IR_REGION_NONRAM;
+	return REC_IR_REGION_UNKNOWN;
+}
+
+/* Can load/store in 'region' be omitted or reused? */
+static inline bool irRegionNoSideEffects(u8 region)
+{
+	return region == REC_IR_REGION_RAM || region == REC_IR_REGION_SCRATCHPAD ||
+	       region == REC_IR_REGION_ROM;
+}
+
+static inline void irSetALU(RecIROp *op, u32 reads, u32 rd)
+{
+	op->kind = REC_IR_ALU;
+	op->reads = reads;
+	op->writes = IR_REG(rd);
+	op->rd = rd;
+}
+
+/* Decode op->code. Returns true if block ends after this op (or after its
+ *  BD slot, for a branch). */
+static bool irDecode(RecIROp *op)
+{
+	const u32 code = op->code;
+	const u32 rs = _fRs_(code), rt = _fRt_(code), rd = _fRd_(code);
+	bool end = false;
+
+	op->kind = REC_IR_OTHER;
+	op->reads = op->writes = 0;
+	op->rd = op->src = op->flags = 0;
+	op->region = REC_IR_REGION_UNKNOWN;
+	op->value = op->addr = 0;
+
+	switch (_fOp_(code)) {
+		case 0x00: // SPECIAL
+			switch (_fFunct_(code)) {
+				case 0x00: case 0x02: case 0x03: // SLL,SRL,SRA
+					irSetALU(op, IR_REG(rt), rd);
+					break;
+				case 0x04: case 0x06: case 0x07: // SLLV,SRLV,SRAV
+				case 0x20: case 0x21: case 0x22: case 0x23: // ADD,ADDU,SUB,SUBU
+				case 0x24: case 0x25: case 0x26: case 0x27: // AND,OR,XOR,NOR
+				case 0x2a: case 0x2b: // SLT,SLTU
+					irSetALU(op, IR_REG(rs) | IR_REG(rt), rd);
+					break;
+				case 0x08: // JR
+					op->kind = REC_IR_BRANCH;
+					op->reads = IR_REG(rs);
+					break;
+				case 0x09: // JALR
+					op->kind = REC_IR_BRANCH;
+					op->reads = IR_REG(rs);
+					op->writes = IR_REG(rd);
+					break;
+				case 0x10: case 0x12: // MFHI,MFLO
+					op->kind = REC_IR_MFHILO;
+					op->reads = IR_REG(_fFunct_(code) == 0x10 ? REC_IR_HI : REC_IR_LO);
+					op->writes = IR_REG(rd);
+					op->rd = rd;
+					break;
+				case 0x11: case 0x13: // MTHI,MTLO
+					op->reads = IR_REG(rs);
+					op->writes = IR_REG(_fFunct_(code) == 0x11 ? REC_IR_HI : REC_IR_LO);
+					break;
+				case 0x18: case 0x19: case 0x1a: case 0x1b: // MULT,MULTU,DIV,DIVU
+					op->reads = IR_REG(rs) | IR_REG(rt);
+					op->writes = IR_REG(REC_IR_LO) | IR_REG(REC_IR_HI);
+					break;
+				default: // SYSCALL,BREAK,invalid
+					op->kind = REC_IR_BARRIER;
+					end = true;
+					break;
+			}
+			break;
+		case 0x01: // REGIMM
+			switch (rt) {
+				case 0x00: case 0x01: // BLTZ,BGEZ
+					op->kind = REC_IR_BRANCH;
+					op->reads = IR_REG(rs);
+					break;
+				case 0x10: case 0x11: // BLTZAL,BGEZAL
+					op->kind = REC_IR_BRANCH;
+					op->reads = IR_REG(rs);
+					op->writes = IR_REG(31);
+					op->flags = REC_IR_LINK_COND;
+					break;
+				default:
+					op->kind = REC_IR_BARRIER;
+					break;
+			}
+			break;
+		case 0x02: // J
+			op->kind = REC_IR_BRANCH;
+			break;
+		case 0x03: // JAL
+			op->kind = REC_IR_BRANCH;
+			op->writes = IR_REG(31);
+			break;
+		case 0x04: case 0x05: // BEQ,BNE
+			op->kind = REC_IR_BRANCH;
+			op->reads = IR_REG(rs) | IR_REG(rt);
+			break;
+		case 0x06: case 0x07: // BLEZ,BGTZ
+			op->kind = REC_IR_BRANCH;
+			op->reads = IR_REG(rs);
+			break;
+		case 0x08: case 0x09: case 0x0a: case 0x0b: // ADDI,ADDIU,SLTI,SLTIU
+		case 0x0c: case 0x0d: case 0x0e:            // ANDI,ORI,XORI
+			irSetALU(op, IR_REG(rs), rt);
+			break;
+		case 0x0f: // LUI
+			irSetALU(op, 0, rt);
+			break;
+		case 0x10: // COP0
+			switch (rs) {
+				case 0x00: case 0x02: // MFC0,CFC0
+					op->writes = IR_REG(rt);
+					break;
+				case 0x04: case 0x06: // MTC0,CTC0
+					op->reads = IR_REG(rt);
+					// Writes to Status/Cause can raise an interrupt
+					if (rd == 12 || rd == 13)
+						end = true;
+					break;
+				case 0x10: // RFE
+					break;
+				default:
+					op->kind = REC_IR_BARRIER;
+					break;
+			}
+			break;
+		case 0x12: // COP2
+			if (_fFunct_(code) == 0) {
+				switch (rs) {
+					case 0x00: case 0x02: // MFC2,CFC2
+						op->writes = IR_REG(rt);
+						break;
+					case 0x04: case 0x06: // MTC2,CTC2
+						op->reads = IR_REG(rt);
+						break;
+					default:
+						op->kind = REC_IR_BARRIER;
+						break;
+				}
+			}
+			// GTE commands don't touch GPRs
+			break;
+		case 0x20: case 0x21: case 0x23: case 0x24: case 0x25: // LB,LH,LW,LBU,LHU
+			op->kind = REC_IR_LOAD;
+			op->reads = IR_REG(rs);
+			op->writes = IR_REG(rt);
+			op->rd = rt;
+			break;
+		case 0x22: case 0x26: // LWL,LWR
+			op->reads = IR_REG(rs) | IR_REG(rt);
+			op->writes = IR_REG(rt);
+			break;
+		case 0x28: case 0x29: case 0x2b: // SB,SH,SW
+			op->kind = REC_IR_STORE;
+			op->reads = IR_REG(rs) | IR_REG(rt);
+			break;
+		case 0x2a: case 0x2e: // SWL,SWR
+			op->reads = IR_REG(rs) | IR_REG(rt);
+			break;
+		case 0x32: case 0x3a: // LWC2,SWC2
+			op->reads = IR_REG(rs);
+			break;
+		case 0x3b: // HLE
+			op->kind = REC_IR_BARRIER;
+			end = true;
+			break;
+		default:
+			op->kind = REC_IR_BARRIER;
+			break;
+	}
+
+	if (op->kind == REC_IR_BARRIER)
+		op->reads = ALL_REGS;
+
+	// Writes to $r0 are discarded
+	op->writes &= ~IR_REG(0);
+	if (op->rd == 0 && (op->kind == REC_IR_ALU || op->kind == REC_IR_MFHILO ||
+	                    op->kind == REC_IR_LOAD))
+		op->writes = 0;
+
+	return end;
+}
+
+/* Is op a jump (J,JAL,JR,JALR), i.e. not a conditional branch? */
+static inline bool irIsJump(const RecIROp *op)
+{
+	const u32 code = op->code;
+	return _fOp_(code) == 0x02 || _fOp_(code) == 0x03 ||
+	       (_fOp_(code) == 0x00 && (_fFunct_(code) == 0x08 || _fFunct_(code) == 0x09));
+}
+
+void recIRBuild(RecIRBlock *b, u32 start_pc, int max_ops, bool past_branches)
+{
+	bool in_bd = false;
+	u32 pc = start_pc;
+
+	if (max_ops > REC_IR_MAX_OPS)
+		max_ops = REC_IR_MAX_OPS;
+
+	b->start_pc = start_pc;
+	b->num_ops = 0;
+
+	while (b->num_ops < max_ops || in_bd) {
+		RecIROp *op = &b->ops[b->num_ops++];
+		op->pc = pc;
+		op->code = PSXMu32(pc);
+		pc += 4;
+
+		const bool end = irDecode(op);
+		if (in_bd) {
+			// Only the not-taken path of a conditional branch goes on
+			if (!past_branches || end || op->kind == REC_IR_BRANCH ||
+			    irIsJump(&b->ops[b->num_ops-2]))
+				break;
+			in_bd = false;
+		} else if (op->kind == REC_IR_BRANCH) {
+			in_bd = true;
+		} else if (end) {
+			break;
+		}
+	}
+
+	b->end_pc = pc;
+}
+
+/* Result of ALU op whose sources are all known, 'val' holding GPR values */
+static u32 irEvalALU(u32 code, const u32 *val)
+{
+	const u32 rs = val[_fRs_(code)], rt = val[_fRt_(code)];
+	const u32 imm = (s32)_fImm_(code), immu = code & 0xffff;
+
+	switch (_fOp_(code)) {
+		case 0x00:
+			switch (_fFunct_(code)) {
+				case 0x00: return rt << _fSa_(code);
+				case 0x02: return rt >> _fSa_(code);
+				case 0x03: return (s32)rt >> _fSa_(code);
+				case 0x04: return rt << (rs & 0x1f);
+				case 0x06: return rt >> (rs & 0x1f);
+				case 0x07: return (s32)rt >> (rs & 0x1f);
+				case 0x20: case 0x21: return rs + rt;
+				case 0x22: case 0x23: return rs - rt;
+				case 0x24: return rs & rt;
+				case 0x25: return rs | rt;
+				case 0x26: return rs ^ rt;
+				case 0x27: return ~(rs | rt);
+				case 0x2a: return (s32)rs < (s32)rt;
+				case 0x2b: return rs < rt;
+			}
+			break;
+		case 0x08: case 0x09: return rs + imm;
+		case 0x0a: return (s32)rs < (s32)imm;
+		case 0x0b: return rs < imm;
+		case 0x0c: return rs & immu;
+		case 0x0d: return rs | immu;
+		case 0x0e: return rs ^ immu;
+		case 0x0f: return immu << 16;
+	}
+	return 0;
+}
+
+/* Constant folding and address-region inference, forward over block */
+static void irPassConsts(RecIRBlock *b)
+{
+	u32 known = 1;       // $r0 is always zero
+	u32 val[32] = { 0 };
+	u8  fuzzy[32] = { 0 };
+
+	for (int i = 0; i < b->num_ops; i++) {
+		RecIROp *op = &b->ops[i];
+		const u32 code = op->code;
+		u8 new_fuzzy = REC_IR_REGION_UNKNOWN;
+
+		switch (op->kind) {
+			case REC_IR_ALU:
+				if ((op->reads & known) == op->reads) {
+					op->value = irEvalALU(code, val);
+					op->flags |= REC_IR_CONST;
+				} else if (_fOp_(code) == 0 && (_fFunct_(code) == 0x20 || _fFunct_(code) == 0x21)) {
+					// ADD/ADDU of a const and an unknown: static array access?
+					const u32 rs = _fRs_(code), rt = _fRt_(code);
+					if (known & IR_REG(rs))
+						new_fuzzy = irFuzzyRegion(val[rs]);
+					else if (known & IR_REG(rt))
+						new_fuzzy = irFuzzyRegion(val[rt]);
+				}
+				break;
+			case REC_IR_LOAD:
+			case REC_IR_STORE: {
+				const u32 base = _fRs_(code);
+				if (known & IR_REG(base)) {
+					op->addr = val[base] + _fImm_(code);
+					op->flags |= REC_IR_ADDR_CONST;
+					op->region = irAddrRegion(op->addr);
+				} else {
+					op->region = fuzzy[base];
+				}
+			} break;
+			case REC_IR_BRANCH:
+				// JAL/JALR link address is known
+				if (op->writes && !(op->flags & REC_IR_LINK_COND)) {
+					op->value = op->pc + 8;
+					op->flags |= REC_IR_CONST;
+				}
+				break;
+			default:
+				break;
+		}
+
+		for (int r = 1; r < 32; r++) {
+			if (!(op->writes & IR_REG(r)))
+				continue;
+			if (op->flags & REC_IR_CONST) {
+				known |= IR_REG(r);
+				val[r] = op->value;
+			} else {
+				known &= ~IR_REG(r);
+			}
+			fuzzy[r] = new_fuzzy;
+		}
+	}
+}
+
+/* Redundant load elimination, forward over block. Loads that are still
+ *  valid are kept in a small table, cleared by anything that could write
+ *  to memory or has side effects.
+ */
+static void irPassLoads(RecIRBlock *b)
+{
+	struct { u32 code; u8 base, rt; } avail[8];
+	int num_avail = 0;
+
+	for (int i = 0; i < b->num_ops; i++) {
+		RecIROp *op = &b->ops[i];
+		const u32 code = op->code;
+
+		if (op->kind == REC_IR_LOAD && irRegionNoSideEffects(op->region) &&
+		    !(i > 0 && b->ops[i-1].kind == REC_IR_BRANCH)) {
+			// Same opcode, base reg and offset; only the target reg differs.
+			//  A load in a BD slot is left alone: the backend might have to
+			//  let the interpreter execute it along with its branch.
+			for (int j = 0; j < num_avail; j++) {
+				if ((avail[j].code & ~(0x1f << 16)) == (code & ~(0x1f << 16))) {
+					op->flags |= REC_IR_REDUNDANT;
+					op->src = avail[j].rt;
+					op->reads = IR_REG(op->src);
+					break;
+				}
+			}
+		} else if (op->kind != REC_IR_ALU && op->kind != REC_IR_MFHILO &&
+		           !(op->kind == REC_IR_LOAD && irRegionNoSideEffects(op->region))) {
+			num_avail = 0;
+		}
+
+		// Drop loads whose base or target reg is overwritten
+		for (int j = 0; j < num_avail; j++) {
+			if (op->writes & (IR_REG(avail[j].base) | IR_REG(avail[j].rt)))
+				avail[j--] = avail[--num_avail];
+		}
+
+		if (op->kind == REC_IR_LOAD && irRegionNoSideEffects(op->region) &&
+		    op->rd && op->rd != _fRs_(code)) {
+			if (num_avail == 8)
+				avail[0] = avail[--num_avail];
+			avail[num_avail].code = code;
+			avail[num_avail].base = _fRs_(code);
+			avail[num_avail].rt = op->rd;
+			num_avail++;
+		}
+	}
+}
+
+/* Dead-store elimination, forward over block: a store is dead if a later
+ *  one writes the same bytes before any load or side effect. A store to I/O
+ *  could start a DMA reading RAM, so it counts as a side effect. So does a
+ *  branch: the block might be left after its BD slot.
+ */
+static void irPassStores(RecIRBlock *b)
+{
+	int pending[8];
+	int num_pending = 0;
+
+	for (int i = 0; i < b->num_ops; i++) {
+		RecIROp *op = &b->ops[i];
+		const u32 code = op->code;
+
+		if (op->kind == REC_IR_STORE && irRegionNoSideEffects(op->region)) {
+			for (int j = 0; j < num_pending; j++) {
+				RecIROp *prev = &b->ops[pending[j]];
+				// Same opcode, base reg and offset; only the value reg differs
+				if ((prev->code & ~(0x1f << 16)) == (code & ~(0x1f << 16))) {
+					prev->flags |= REC_IR_DEAD;
+					pending[j--] = pending[--num_pending];
+				}
+			}
+		} else if (op->kind != REC_IR_ALU && op->kind != REC_IR_MFHILO) {
+			num_pending = 0;
+		}
+
+		// Drop stores whose base reg is overwritten
+		for (int j = 0; j < num_pending; j++) {
+			if (op->writes & IR_REG(_fRs_(b->ops[pending[j]].code)))
+				pending[j--] = pending[--num_pending];
+		}
+
+		if (op->kind == REC_IR_STORE && irRegionNoSideEffects(op->region) &&
+		    op->region != REC_IR_REGION_ROM &&
+		    !(i > 0 && b->ops[i-1].kind == REC_IR_BRANCH)) {
+			if (num_pending == 8)
+				pending[0] = pending[--num_pending];
+			pending[num_pending++] = i;
+		}
+	}
+}
+
+/* Dead-code elimination, backward over block. All GPRs and LO/HI are live
+ *  past its last op and past the BD slot of each branch.
+ */
+static void irPassDead(RecIRBlock *b)
+{
+	u64 live = ALL_REGS;
+
+	for (int i = b->num_ops - 1; i >= 0; i--) {
+		RecIROp *op = &b->ops[i];
+
+		if (i > 0 && b->ops[i-1].kind == REC_IR_BRANCH)
+			live = ALL_REGS;
+
+		if (op->flags & REC_IR_DEAD)
+			continue;
+
+		const bool pure = op->kind == REC_IR_ALU || op->kind == REC_IR_MFHILO ||
+		                  (op->kind == REC_IR_LOAD && irRegionNoSideEffects(op->region));
+		if (pure && !(live & op->writes)) {
+			op->flags |= REC_IR_DEAD;
+			continue;
+		}
+
+		// A conditional link leaves $ra as it was if branch isn't taken
+		if (!(op->flags & REC_IR_LINK_COND))
+			live &= ~op->writes;
+		live |= op->reads;
+	}
+}
+
+void recIROptimize(RecIRBlock *b)
+{
+	irPassConsts(b);
+	irPassLoads(b);
+	irPassStores(b);
+	irPassDead(b);
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Backend-neutral block IR for the recompilers
+ *
+ *  recIRBuild() decodes the PS1 code of a block into one RecIROp per
+ * opcode, listing the GPRs and LO/HI each reads and writes. recIROptimize() then
+ * runs passes shared by all backends over it:
+ *   - Constant folding: ALU ops whose sources are known consts get their
+ *     result in 'value' and REC_IR_CONST set.
+ *   - Address-region inference: loads/stores get the region their address
+ *     falls in, from a known-const base reg or, like the MIPS recompiler's
+ *     'fuzzy' addresses, from a base reg that is a const plus an unknown.
+ *   - Redundant load elimination: a load from the same base reg, offset and
+ *     width as an earlier RAM/scratchpad/ROM load, with nothing in between that
+ *     could change either, gets REC_IR_REDUNDANT and 'src' set to the GPR
+ *     that still holds the earlier result.
+ *   - Dead-store elimination: a RAM/scratchpad store overwritten by a later
+ *     store to the same address before anything could read it.
+ *   - Dead-code elimination: side-effect free ops (ALU ops, MFHI/MFLO and
+ *     RAM/scratchpad/ROM loads) whose result is overwritten before being read
+ *     get REC_IR_DEAD.
+ *  A backend then lowers each op: skip it if dead, set a folded const,
+ *  copy a redundant load's 'src' GPR, or emit it as usual, using 'region'
+ *  to pick an access method.
+ *
+ *  A block ends after a jump or branch and its BD slot, at SYSCALL, BREAK,
+ * HLE ops and writes to COP0 Status/Cause, or after 'max_ops' opcodes.
+ * Built with 'past_branches', it only ends after the BD slot of a jump:
+ * conditional branches are followed by their not-taken path, and might
+ * leave the block after their BD slot. A backend may end its block later
+ * (e.g. at a never-taken const branch), or after any branch's BD slot, but
+ * never earlier: all GPRs are considered live past the last op and past
+ * the BD slot of every branch.
+ */
+
+#ifndef REC_IR_H
+#define REC_IR_H
+
+#include "psxcommon.h"
+
+enum RecIRKind {
+	REC_IR_ALU,      // GPR result only depends on GPR sources: no side effects
+	REC_IR_MFHILO,   // MFHI/MFLO: no side effects, result not known at compile time
+	REC_IR_LOAD,     // LB/LBU/LH/LHU/LW
+	REC_IR_STORE,    // SB/SH/SW
+	REC_IR_BRANCH,   // Branch or jump, followed by BD slot
+	REC_IR_OTHER,    // Anything else: decoded reads/writes, has side effects
+	REC_IR_BARRIER   // Could read any GPR (unknown op, SYSCALL, HLE..)
+};
+
+enum RecIRRegion {
+	REC_IR_REGION_UNKNOWN,
+	REC_IR_REGION_RAM,         // 2MB RAM and its mirrors
+	REC_IR_REGION_SCRATCHPAD,
+	REC_IR_REGION_HW,          // Hardware I/O ports
+	REC_IR_REGION_ROM,         // BIOS ROM
+	REC_IR_REGION_NONRAM       // Fuzzy: scratchpad, I/O, expansion or ROM
+};
+
+// RecIROp flags
+#define REC_IR_CONST      (1 << 0)  // Result is known const 'value'
+#define REC_IR_DEAD       (1 << 1)  // Op can be omitted
+#define REC_IR_REDUNDANT  (1 << 2)  // Load result is already in GPR 'src'
+#define REC_IR_ADDR_CONST (1 << 3)  // Load/store address is known const 'addr'
+#define REC_IR_LINK_COND  (1 << 4)  // BLTZAL/BGEZAL: $ra written only if taken
+
+#define REC_IR_MAX_OPS 256
+
+// Bits of LO/HI in RecIROp reads/writes masks, after the 32 GPRs. Same
+//  indices as in psxRegs.GPR.r[]
+#define REC_IR_LO 32
+#define REC_IR_HI 33
+
+struct RecIROp {
+	u32 pc;
+	u32 code;
+	u64 reads;       // Mask of GPRs and LO/HI read
+	u64 writes;      // Mask of GPRs and LO/HI written
+	u32 value;       // REC_IR_CONST: result
+	u32 addr;        // REC_IR_ADDR_CONST: effective address
+	u8  kind;        // RecIRKind
+	u8  region;      // RecIRRegion, for loads/stores
+	u8  rd;          // GPR written by ALU op, MFHI/MFLO or load, 0 if none
+	u8  src;         // REC_IR_REDUNDANT: GPR holding the loaded value
+	u8  flags;
+};
+
+struct RecIRBlock {
+	u32     start_pc;
+	u32     end_pc;  // PC past last op
+	int     num_ops;
+	RecIROp ops[REC_IR_MAX_OPS + 1];  // +1: BD slot of a branch at last op
+};
+
+// Decode block at 'start_pc' of at most 'max_ops' opcodes (a branch at the
+//  last one still gets its BD slot). If 'past_branches', block goes on past
+//  conditional branches, see above.
+void recIRBuild(RecIRBlock *b, u32 start_pc, int max_ops, bool past_branches);
+
+// Run all shared passes over block.
+void recIROptimize(RecIRBlock *b);
+
+// Op at 'pc' in block, or NULL if it lies outside it.
+static inline const RecIROp *recIROpAt(const RecIRBlock *b, u32 pc)
+{
+	const u32 i = (pc - b->start_pc) / 4;
+	return (pc >= b->start_pc && i < (u32)b->num_ops) ? &b->ops[i] : NULL;
+}
+
+#endif //REC_IR_H
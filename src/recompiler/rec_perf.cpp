@@ -0,0 +1,243 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Linux perf integration for recompilers
+ *
+ *  Map file lines are "<host addr> <size> <name>", see perf's
+ * tools/perf/Documentation/jit-interface.txt. The jitdump format is
+ * described in tools/perf/Documentation/jitdump-specification.txt; only
+ * JIT_CODE_LOAD and JIT_CODE_CLOSE records are written. perf finds the
+ * jitdump file through the executable mmap of it made here.
+ *
+ *  Blocks are named "psx_<guest pc>". A block at an address found in the
+ * BIOS A0/B0/C0 function tables gets the function's name appended (see
+ * psxBiosFunctionName()), as does one starting with an HLE BIOS opcode
+ * (see psxhle.cpp).
+ */
+
+#include <elf.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "rec_perf.h"
+#include "psxmem.h"
+#include "psxbios.h"
+
+bool rec_perf_active;
+
+static FILE *perf_map;
+static FILE *jit_dump;
+static void *jit_dump_marker;  // Executable mapping of jit_dump, for perf
+static u64   jit_code_index;
+
+#define JITDUMP_MAGIC    0x4A695444
+#define JITDUMP_VERSION  1
+
+enum { JIT_CODE_LOAD = 0, JIT_CODE_CLOSE = 3 };
+
+struct JitHeader {
+	u32 magic;
+	u32 version;
+	u32 total_size;
+	u32 elf_mach;
+	u32 pad1;
+	u32 pid;
+	u64 timestamp;
+	u64 flags;
+};
+
+struct JitRecordPrefix {
+	u32 id;
+	u32 total_size;
+	u64 timestamp;
+};
+
+struct JitCodeLoad {
+	JitRecordPrefix p;
+	u32 pid;
+	u32 tid;
+	u64 vma;
+	u64 code_addr;
+	u64 code_size;
+	u64 code_index;
+	// Followed by name string and code
+};
+
+#if defined(__x86_64__)
+#define JIT_ELF_MACH  EM_X86_64
+#elif defined(__i386__)
+#define JIT_ELF_MACH  EM_386
+#elif defined(__mips__)
+#define JIT_ELF_MACH  EM_MIPS
+#elif defined(__aarch64__)
+#define JIT_ELF_MACH  EM_AARCH64
+#elif defined(__arm__)
+#define JIT_ELF_MACH  EM_ARM
+#else
+#define JIT_ELF_MACH  EM_NONE
+#endif
+
+// Must match clock perf uses: 'perf record -k 1'
+static u64 jit_timestamp(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void jit_dump_open(void)
+{
+	char filename[64];
+	sprintf(filename, "/tmp/jit-%d.dump", (int)getpid());
+
+	int fd = open(filename, O_CREAT | O_TRUNC | O_RDWR, 0666);
+	if (fd < 0) {
+		printf("Error creating %s\n", filename);
+		return;
+	}
+
+	// perf record notes this mapping, which is how perf inject finds file
+	const long page_size = sysconf(_SC_PAGESIZE);
+	jit_dump_marker = mmap(NULL, page_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+	if (jit_dump_marker == MAP_FAILED) {
+		printf("Error mapping %s\n", filename);
+		jit_dump_marker = NULL;
+		close(fd);
+		return;
+	}
+
+	jit_dump = fdopen(fd, "wb");
+	if (!jit_dump) {
+		munmap(jit_dump_marker, page_size);
+		jit_dump_marker = NULL;
+		close(fd);
+		return;
+	}
+
+	JitHeader h;
+	memset(&h, 0, sizeof(h));
+	h.magic = JITDUMP_MAGIC;
+	h.version = JITDUMP_VERSION;
+	h.total_size = sizeof(h);
+	h.elf_mach = JIT_ELF_MACH;
+	h.pid = getpid();
+	h.timestamp = jit_timestamp();
+	fwrite(&h, sizeof(h), 1, jit_dump);
+	jit_code_index = 0;
+}
+
+static void jit_dump_close(void)
+{
+	if (!jit_dump)
+		return;
+
+	JitRecordPrefix p;
+	p.id = JIT_CODE_CLOSE;
+	p.total_size = sizeof(p);
+	p.timestamp = jit_timestamp();
+	fwrite(&p, sizeof(p), 1, jit_dump);
+
+	fclose(jit_dump);
+	jit_dump = NULL;
+	munmap(jit_dump_marker, sysconf(_SC_PAGESIZE));
+	jit_dump_marker = NULL;
+}
+
+void recPerfInit(void)
+{
+	recPerfShutdown();
+
+	if (Config.RecPerfMap) {
+		char filename[64];
+		sprintf(filename, "/tmp/perf-%d.map", (int)getpid());
+		perf_map = fopen(filename, "w");
+		if (!perf_map)
+			printf("Error creating %s\n", filename);
+	}
+
+	if (Config.RecPerfMap >= 2)
+		jit_dump_open();
+
+	rec_perf_active = perf_map || jit_dump;
+}
+
+void recPerfShutdown(void)
+{
+	if (perf_map) {
+		fclose(perf_map);
+		perf_map = NULL;
+	}
+	jit_dump_close();
+	rec_perf_active = false;
+}
+
+// Names of psxHLEt[] entries
+static const char * const hle_names[] = {
+	"hleDummy", "hleA0", "hleB0", "hleC0", "hleBootstrap", "hleExecRet"
+};
+
+// Append BIOS/HLE name for block at 'pc' to 'name', if any
+static void bios_symbol(u32 pc, char *name, size_t size)
+{
+	const u32 *code = (const u32 *)PSXM(pc);
+	if (code) {
+		const u32 opcode = SWAP32(*code);
+		const u32 hle = opcode & 0x03ffffff;
+		if ((opcode >> 26) == 0x3b &&
+		    hle < sizeof(hle_names) / sizeof(hle_names[0])) {
+			snprintf(name + strlen(name), size - strlen(name), "_%s", hle_names[hle]);
+			return;
+		}
+	}
+
+	char bios_name[64];
+	if (psxBiosFunctionName(pc, bios_name, sizeof(bios_name)))
+		snprintf(name + strlen(name), size - strlen(name), "_%s", bios_name);
+}
+
+void recPerfBlock(u32 pc, const void *host, u32 host_size)
+{
+	char name[128];
+
+	if (host_size == 0)
+		return;
+
+	snprintf(name, sizeof(name), "psx_%08x", pc);
+	bios_symbol(pc, name, sizeof(name));
+
+	if (perf_map)
+		fprintf(perf_map, "%lx %x %s\n", (unsigned long)(uptr)host, host_size, name);
+
+	if (jit_dump) {
+		const u32 name_len = strlen(name) + 1;
+		JitCodeLoad r;
+		r.p.id = JIT_CODE_LOAD;
+		r.p.total_size = sizeof(r) + name_len + host_size;
+		r.p.timestamp = jit_timestamp();
+		r.pid = getpid();
+		r.tid = syscall(SYS_gettid);
+		r.vma = r.code_addr = (uptr)host;
+		r.code_size = host_size;
+		r.code_index = jit_code_index++;
+		fwrite(&r, sizeof(r), 1, jit_dump);
+		fwrite(name, name_len, 1, jit_dump);
+		fwrite(host, host_size, 1, jit_dump);
+	}
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Linux perf integration for recompilers
+ *
+ *  With Config.RecPerfMap (-recperfmap command line option), each block
+ * a recompiler emits is described in /tmp/perf-<pid>.map, so 'perf report'
+ * shows samples in recompiled code by guest PC (and BIOS function, if
+ * known) instead of as anonymous memory.
+ *
+ *  With Config.RecPerfMap == 2 (-recjitdump), blocks and their host code
+ * are also written to jitdump file /tmp/jit-<pid>.dump. Record with
+ * 'perf record -k 1', then run 'perf inject --jit' on the result: unlike
+ * the map file, this copes with code cache flushes reusing host addresses.
+ *
+ *  When off, the only cost is a test of 'rec_perf_active' on each block
+ * compiled.
+ */
+
+#ifndef REC_PERF_H
+#define REC_PERF_H
+
+#include "psxcommon.h"
+
+extern bool rec_perf_active;
+
+void recPerfInit(void);
+void recPerfShutdown(void);
+void recPerfBlock(u32 pc, const void *host, u32 host_size);
+
+// Block for guest code at 'pc' was emitted to 'host'
+static inline void rec_perf_block(u32 pc, const void *host, u32 host_size)
+{
+	if (__builtin_expect(rec_perf_active, 0))
+		recPerfBlock(pc, host, host_size);
+}
+
+#endif //REC_PERF_H
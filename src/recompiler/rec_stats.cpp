@@ -0,0 +1,293 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Recompiler statistics and hot-block profiler
+ *
+ *  Each compiled block gets an entry in rec_stats_blocks[] while profiling,
+ * until it's full. A block compiled again at the same PC (after being
+ * invalidated or evicted) gets a new entry; the report merges entries
+ * by PC, and disassembles the most recent one.
+ *
+ *  Guest code is disassembled as it is in RAM at shutdown, which can
+ * differ from what was compiled if it was overwritten since.
+ */
+
+#include "rec_stats.h"
+#include "psxmem.h"
+#include "recompiler/mips/disasm.h"
+
+bool rec_stats_active;
+
+#define REC_STATS_MAX_BLOCKS  (128 * 1024)
+
+// Compile time per frame histogram buckets, in usecs
+static const u32 frame_usecs_limits[] = { 1000, 4000, 16000, 0xffffffff };
+#define FRAME_BUCKETS  (sizeof(frame_usecs_limits) / sizeof(frame_usecs_limits[0]))
+
+static struct {
+	u32 blocks;            // Blocks compiled
+	u64 guest_insns;       // Guest opcodes in them
+	u64 host_bytes;        // Host code emitted
+	u64 host_insns;        // Host opcodes emitted, if backend knows
+	u64 compile_usecs;
+	u32 frames;            // Frames emulated
+	u32 frame_usecs;       // Compile time in current frame
+	u32 max_frame_usecs;
+	u32 frame_hist[FRAME_BUCKETS];  // Frames that compiled anything, by time
+	u32 flushes;           // Whole code cache flushed
+	u64 clears;            // recClear() calls..
+	u64 clears_code;       // ..that covered pages holding code
+	u32 discards;          // Discarded code sequences
+	u32 discarded_insns;
+} rec_stats;
+
+static RecStatsBlock *rec_stats_blocks;  // Allocated when profiling
+static u32 rec_stats_num_blocks;
+static RecStatsBlock *rec_stats_cur;     // Block being compiled, or NULL
+static u32 rec_stats_cur_pc;
+
+void recStatsInit(void)
+{
+	memset(&rec_stats, 0, sizeof(rec_stats));
+	rec_stats_num_blocks = 0;
+	rec_stats_cur = NULL;
+
+	if (Config.RecProfile && !rec_stats_blocks) {
+		rec_stats_blocks = (RecStatsBlock *)calloc(REC_STATS_MAX_BLOCKS, sizeof(RecStatsBlock));
+		if (!rec_stats_blocks)
+			printf("Error allocating memory for recompiler profile\n");
+	}
+
+	rec_stats_active = Config.RecStats || rec_stats_blocks;
+}
+
+void recStatsFrame(void)
+{
+	if (!rec_stats_active)
+		return;
+
+	rec_stats.frames++;
+	if (rec_stats.frame_usecs == 0)
+		return;
+
+	u32 i = 0;
+	while (rec_stats.frame_usecs >= frame_usecs_limits[i])
+		i++;
+	rec_stats.frame_hist[i]++;
+	if (rec_stats.frame_usecs > rec_stats.max_frame_usecs)
+		rec_stats.max_frame_usecs = rec_stats.frame_usecs;
+	rec_stats.frame_usecs = 0;
+}
+
+u32 *recStatsBlockStart(u32 pc, const void *host)
+{
+	rec_stats_cur_pc = pc;
+	rec_stats_cur = NULL;
+
+	if (rec_stats_blocks && rec_stats_num_blocks < REC_STATS_MAX_BLOCKS) {
+		rec_stats_cur = &rec_stats_blocks[rec_stats_num_blocks++];
+		rec_stats_cur->pc = pc;
+		rec_stats_cur->host = host;
+		rec_stats_cur->exec_count = 0;
+		return &rec_stats_cur->exec_count;
+	}
+
+	return NULL;
+}
+
+void recStatsBlockEnd(u32 end_pc, u32 host_bytes, u32 host_insns, u32 usecs)
+{
+	rec_stats.blocks++;
+	rec_stats.guest_insns += (end_pc - rec_stats_cur_pc) / 4;
+	rec_stats.host_bytes += host_bytes;
+	rec_stats.host_insns += host_insns;
+	rec_stats.compile_usecs += usecs;
+	rec_stats.frame_usecs += usecs;
+
+	if (rec_stats_cur) {
+		rec_stats_cur->end_pc = end_pc;
+		rec_stats_cur->host_bytes = host_bytes;
+		rec_stats_cur->host_insns = host_insns;
+		rec_stats_cur = NULL;
+	}
+}
+
+void recStatsAddClear(bool has_code)
+{
+	rec_stats.clears++;
+	if (has_code)
+		rec_stats.clears_code++;
+}
+
+void recStatsAddFlush(void)
+{
+	rec_stats.flushes++;
+}
+
+void recStatsAddDiscard(int num_insns)
+{
+	rec_stats.discards++;
+	rec_stats.discarded_insns += num_insns;
+}
+
+/* Hot-block report */
+
+struct HotBlock {
+	const RecStatsBlock *b;  // Most recent entry for PC
+	u64 execs;
+	u64 insns;               // Guest opcodes executed
+	u32 compiles;
+};
+
+// Sort entry indices by PC, then compile order
+static int cmp_entry_pc(const void *a, const void *b)
+{
+	const u32 x = *(const u32 *)a;
+	const u32 y = *(const u32 *)b;
+	if (rec_stats_blocks[x].pc != rec_stats_blocks[y].pc)
+		return (rec_stats_blocks[x].pc < rec_stats_blocks[y].pc) ? -1 : 1;
+	return (x < y) ? -1 : 1;
+}
+
+static int cmp_hot_insns(const void *a, const void *b)
+{
+	const HotBlock *x = (const HotBlock *)a;
+	const HotBlock *y = (const HotBlock *)b;
+	if (x->insns != y->insns)
+		return (x->insns > y->insns) ? -1 : 1;
+	return (x->b->pc < y->b->pc) ? -1 : 1;
+}
+
+static void print_guest_code(const RecStatsBlock *b)
+{
+	char buf[256];
+
+	for (u32 pc = b->pc; pc != b->end_pc; pc += 4) {
+		const u32 *p = (const u32 *)PSXM(pc);
+		if (p == NULL)
+			break;
+		const u32 code = SWAP32(*p);
+		disasm_mips_instruction(code, buf, pc, NULL, 0);
+		printf("  %08x: %08x  %s\n", pc, code, buf);
+	}
+}
+
+static void print_hot_blocks(void (*print_host)(const RecStatsBlock *b))
+{
+	const u32 num = rec_stats_num_blocks;
+	if (num == 0)
+		return;
+
+	HotBlock *hot = (HotBlock *)calloc(num, sizeof(HotBlock));
+	u32 *order = (u32 *)malloc(num * sizeof(u32));
+	if (!hot || !order) {
+		free(hot);
+		free(order);
+		return;
+	}
+
+	// Merge entries with same PC
+	for (u32 i = 0; i < num; i++)
+		order[i] = i;
+	qsort(order, num, sizeof(u32), cmp_entry_pc);
+
+	u32 num_hot = 0;
+	u64 total_insns = 0;
+	for (u32 i = 0; i < num; i++) {
+		const RecStatsBlock *b = &rec_stats_blocks[order[i]];
+		if (num_hot == 0 || hot[num_hot-1].b->pc != b->pc)
+			num_hot++;
+		HotBlock *h = &hot[num_hot-1];
+		const u64 insns = (u64)b->exec_count * ((b->end_pc - b->pc) / 4);
+		h->b = b;
+		h->execs += b->exec_count;
+		h->insns += insns;
+		h->compiles++;
+		total_insns += insns;
+	}
+
+	qsort(hot, num_hot, sizeof(HotBlock), cmp_hot_insns);
+
+	const u32 num_report = (num_hot < Config.RecProfile) ? num_hot : Config.RecProfile;
+
+	printf("Hot blocks: %u of %u compiled blocks at %u PCs, %llu guest opcodes executed\n",
+	       num_report, num, num_hot, (unsigned long long)total_insns);
+	if (num == REC_STATS_MAX_BLOCKS)
+		printf(" (profile full: later blocks weren't counted)\n");
+	printf("  rank  pc        opcodes  executions  guest ops   %%    host bytes  compiles\n");
+	for (u32 i = 0; i < num_report; i++) {
+		const HotBlock *h = &hot[i];
+		printf("  %4u  %08x  %7u  %10llu  %10llu  %5.2f  %10u  %8u\n",
+		       i + 1, h->b->pc, (h->b->end_pc - h->b->pc) / 4,
+		       (unsigned long long)h->execs, (unsigned long long)h->insns,
+		       total_insns ? 100.0 * h->insns / total_insns : 0.0,
+		       h->b->host_bytes, h->compiles);
+	}
+
+	for (u32 i = 0; i < num_report; i++) {
+		const RecStatsBlock *b = hot[i].b;
+		printf("\nBlock #%u at %08x, guest code:\n", i + 1, b->pc);
+		print_guest_code(b);
+		if (print_host)
+			print_host(b);
+	}
+
+	free(hot);
+	free(order);
+}
+
+void recStatsShutdown(void (*print_host)(const RecStatsBlock *b))
+{
+	if (!rec_stats_active)
+		return;
+
+	if (Config.RecStats) {
+		u32 frames_compiling = 0;
+		for (u32 i = 0; i < FRAME_BUCKETS; i++)
+			frames_compiling += rec_stats.frame_hist[i];
+
+		printf("Recompiler: %u blocks compiled, %llu guest opcodes, %llu host bytes",
+		       rec_stats.blocks, (unsigned long long)rec_stats.guest_insns,
+		       (unsigned long long)rec_stats.host_bytes);
+		if (rec_stats.host_insns)
+			printf(", %llu host opcodes (%.2f per guest opcode)",
+			       (unsigned long long)rec_stats.host_insns,
+			       rec_stats.guest_insns ? (double)rec_stats.host_insns / rec_stats.guest_insns : 0.0);
+		printf("\n");
+		printf("Recompiler: %llu usecs compiling, in %u of %u frames (max %u usecs), "
+		       "<1ms: %u <4ms: %u <16ms: %u >=16ms: %u\n",
+		       (unsigned long long)rec_stats.compile_usecs, frames_compiling, rec_stats.frames,
+		       rec_stats.max_frame_usecs, rec_stats.frame_hist[0], rec_stats.frame_hist[1],
+		       rec_stats.frame_hist[2], rec_stats.frame_hist[3]);
+		printf("Recompiler: %u code cache flushes, %llu recClear() calls, %llu hit code pages\n",
+		       rec_stats.flushes, (unsigned long long)rec_stats.clears,
+		       (unsigned long long)rec_stats.clears_code);
+		if (rec_stats.discards)
+			printf("Recompiler: %u code sequences discarded, %u guest opcodes\n",
+			       rec_stats.discards, rec_stats.discarded_insns);
+	}
+
+	if (rec_stats_blocks) {
+		print_hot_blocks(print_host);
+		free(rec_stats_blocks);
+		rec_stats_blocks = NULL;
+		rec_stats_num_blocks = 0;
+	}
+
+	rec_stats_active = false;
+}
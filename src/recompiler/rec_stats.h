@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Recompiler statistics and hot-block profiler
+ *
+ *  With Config.RecStats (-recstats command line option), a recompiler
+ * counts the blocks it compiles, the guest opcodes and host code in them,
+ * time spent compiling (in total and per emulated frame), code cache
+ * flushes, recClear() invalidations with and without code in the pages
+ * they cover, and discarded code sequences. A summary is printed at
+ * shutdown.
+ *
+ *  With Config.RecProfile set to N (-recprofile N), blocks are also
+ * compiled with an execution counter. At shutdown, the N blocks that ran
+ * the most guest opcodes (executions * opcodes) are listed, followed by
+ * a disassembly of each.
+ *
+ *  When both are off, the only cost is a test of 'rec_stats_active' on
+ * each block compiled and each recClear().
+ */
+
+#ifndef REC_STATS_H
+#define REC_STATS_H
+
+#include "psxcommon.h"
+
+struct RecStatsBlock {
+	u32 pc;
+	u32 end_pc;       // PC past last guest opcode
+	const void *host; // Host code, might have been flushed since
+	u32 host_bytes;
+	u32 host_insns;   // 0: unknown (variable-length host opcodes)
+	u32 exec_count;   // Incremented by block on entry, wraps at 2^32
+};
+
+extern bool rec_stats_active;
+
+void recStatsInit(void);
+
+// Print summary and hot-block report. 'print_host' disassembles a block's
+//  host code, if it's still there; can be NULL.
+void recStatsShutdown(void (*print_host)(const RecStatsBlock *b));
+
+// Called once per emulated frame
+void recStatsFrame(void);
+
+// Compiling block at 'pc' to 'host'. Returns the counter block should
+//  increment on each execution, or NULL if it shouldn't.
+u32 *recStatsBlockStart(u32 pc, const void *host);
+
+// Done compiling block started above. 'usecs' is time taken.
+void recStatsBlockEnd(u32 end_pc, u32 host_bytes, u32 host_insns, u32 usecs);
+
+void recStatsAddClear(bool has_code);
+void recStatsAddFlush(void);
+void recStatsAddDiscard(int num_insns);
+
+// Called from recClear(): 'has_code' is true if pages held code
+static inline void rec_stats_add_clear(bool has_code)
+{
+	if (__builtin_expect(rec_stats_active, 0))
+		recStatsAddClear(has_code);
+}
+
+// Whole code cache flushed
+static inline void rec_stats_add_flush(void)
+{
+	if (__builtin_expect(rec_stats_active, 0))
+		recStatsAddFlush();
+}
+
+// Sequence of 'num_insns' guest opcodes discarded while compiling
+static inline void rec_stats_add_discard(int num_insns)
+{
+	if (__builtin_expect(rec_stats_active, 0))
+		recStatsAddDiscard(num_insns);
+}
+
+#endif //REC_STATS_H
@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Tiered execution: interpreter first, recompile only hot blocks
+ *
+ *  Entry counts are one byte per word of RAM (2MB, mirrors share counts)
+ * and BIOS ROM (512KB). Code anywhere else (scratchpad, expansion ROM) is
+ * compiled right away, as it always was.
+ *
+ *  Interpreted code is run by the plain interpreter's execI(), which
+ * handles branch delay slots, load delays and calls psxBranchTest() on
+ * taken branches itself. The interpreter advances psxRegs.cycle by BIAS
+ * per opcode; the difference from the recompiler's cycle_multiplier rate
+ * is made up afterwards, so timing doesn't depend on which tier ran code.
+ */
+
+#include "rec_tier.h"
+#include "r3000a.h"
+#include "psxmem.h"
+
+bool rec_tier_active;
+
+extern void execI(void);           // in psxinterpreter.cpp
+extern u32 cycle_multiplier;       // in recompiler.cpp
+
+// Most opcodes interpreted in one go: bounds time between recRun()
+//  checks of psxRegs.cycle when code loops without a taken branch
+#define REC_TIER_MAX_INSNS  256
+
+#define RAM_COUNTS  (0x200000 / 4)
+#define ROM_COUNTS  (0x80000 / 4)
+
+static u8 *tier_counts;            // RAM_COUNTS RAM counters, then ROM's
+static u8  tier_threshold;
+
+static struct {
+	u64 runs;                      // recTierInterpret() calls
+	u64 insns;                     // Opcodes interpreted
+} tier_stats;
+
+void recTierInit(void)
+{
+	recTierShutdown();
+
+	if (Config.Cpu != CPU_DYNAREC_TIERED || Config.RecTierThreshold == 0)
+		return;
+
+	tier_counts = (u8 *)calloc(RAM_COUNTS + ROM_COUNTS, 1);
+	if (!tier_counts) {
+		printf("Error allocating memory for tiered recompiler\n");
+		return;
+	}
+
+	memset(&tier_stats, 0, sizeof(tier_stats));
+	tier_threshold = Config.RecTierThreshold;
+	rec_tier_active = true;
+}
+
+void recTierShutdown(void)
+{
+	if (tier_counts && Config.RecStats) {
+		printf("Recompiler: tiered, %llu opcodes interpreted in %llu runs\n",
+		       (unsigned long long)tier_stats.insns,
+		       (unsigned long long)tier_stats.runs);
+	}
+
+	free(tier_counts);
+	tier_counts = NULL;
+	rec_tier_active = false;
+}
+
+// Entry counter for code at 'pc', or NULL if it's always compiled
+static u8 *tier_count(u32 pc)
+{
+	const u32 addr = pc & 0x1fffffff;
+
+	if (addr < 0x800000)
+		return &tier_counts[(addr & 0x1ffffc) >> 2];
+	if (addr >= 0x1fc00000 && addr < 0x1fc80000)
+		return &tier_counts[RAM_COUNTS + ((addr & 0x7fffc) >> 2)];
+	return NULL;
+}
+
+bool recTierIsHot(u32 pc)
+{
+	const u8 *count = tier_count(pc);
+	return !count || *count >= tier_threshold;
+}
+
+bool recTierHot(u32 pc)
+{
+	u8 *count = tier_count(pc);
+
+	// Count stays at threshold, so code evicted later compiles right away
+	if (!count || *count >= tier_threshold)
+		return true;
+
+	(*count)++;
+	return false;
+}
+
+// Is 'opcode' a jump or branch?
+static inline bool is_branch(u32 opcode)
+{
+	const u32 op = opcode >> 26;
+	return (op >= 0x01 && op <= 0x07) ||           // REGIMM, J, JAL, Bxx
+	       (op == 0x00 && (opcode & 0x3e) == 0x08); // JR, JALR
+}
+
+void recTierInterpret(void)
+{
+	u32 n = 0;
+
+	for (;;) {
+		const u32 prev_pc = psxRegs.pc;
+		const u32 *code = (u32 *)PSXM(prev_pc);
+		const bool branch = code && is_branch(SWAP32(*code));
+
+		execI();
+		n++;
+
+		// Taken branch or jump, or exception. A taken branch ran its delay
+		//  slot too, charging BIAS for it.
+		if (psxRegs.pc != prev_pc + 4) {
+			if (branch)
+				n++;
+			break;
+		}
+		if (n >= REC_TIER_MAX_INSNS)
+			break;
+
+		// Branch not taken: stop after its delay slot, like a block would
+		if (branch) {
+			execI();
+			n++;
+			break;
+		}
+	}
+
+	// Charge cycles at recompiled code's rate (execI() charged n*BIAS)
+	psxRegs.cycle += ((n * cycle_multiplier) >> 8) - n * BIAS;
+
+	tier_stats.runs++;
+	tier_stats.insns += n;
+}
@@ -0,0 +1,55 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02111-1307 USA.           *
+ ***************************************************************************/
+
+/*
+ * Tiered execution: interpreter first, recompile only hot blocks
+ *
+ *  With Config.Cpu == CPU_DYNAREC_TIERED (-rectiered command line option),
+ * the recompiler doesn't compile code at a PC the first times it is
+ * reached. The code is interpreted instead, and compiled once it has been
+ * entered Config.RecTierThreshold times (-rectierthreshold option). Code
+ * that runs only a few times (BIOS boot, loaders, decompression stubs)
+ * then costs no compile time and no code cache space.
+ *
+ *  Counters are kept per word of RAM and BIOS ROM, and survive code cache
+ * flushes: a hot block evicted from the cache is recompiled as soon as
+ * it's reached again.
+ */
+
+#ifndef REC_TIER_H
+#define REC_TIER_H
+
+#include "psxcommon.h"
+
+extern bool rec_tier_active;
+
+void recTierInit(void);
+void recTierShutdown(void);
+
+// Count an entry to code at 'pc', which has no recompiled block. Returns
+//  true if it should now be recompiled, false if it should be interpreted.
+bool recTierHot(u32 pc);
+
+// Same, without counting the entry
+bool recTierIsHot(u32 pc);
+
+// Interpret from psxRegs.pc up to and including the first jump or branch
+//  and its delay slot, setting psxRegs.pc and advancing psxRegs.cycle as a
+//  recompiled block would.
+void recTierInterpret(void);
+
+#endif //REC_TIER_H
@@ -0,0 +1,253 @@
+/******************************************************************************
+ * IMPORTANT: The following host registers have unique usage restrictions.    *
+ *            See notes in x86_64_codegen.h for full details.                 *
+ *  HOST_RBX (PERM_REG_1), HOST_R12 (BRANCH_REG)                              *
+ *****************************************************************************/
+
+/* NOTE: Ops whose sources are all known consts are folded by the block IR
+ *  and set in recOpcode(), see ../rec_ir.h. Emitters below only handle a
+ *  const source where it gives shorter code: consts are always in psxRegs.
+ */
+
+/* Rt = Rs <op> imm, 'ext' is a group-1 ALU op */
+static void emitALUImm(int ext, u32 imm)
+{
+	if (_Rs_ == _Rt_) {
+		ALU32ItoM(ext, offGPR(_Rt_), imm);
+		SetUndef(_Rt_);
+		return;
+	}
+
+	MOV32MtoR(HOST_EAX, offGPR(_Rs_));
+	ALU32ItoR(ext, HOST_EAX, imm);
+	emitStoreGPR(_Rt_, HOST_EAX);
+}
+
+/* Rt = Rs < imm, 'cc' is CC_L (signed) or CC_B (unsigned) */
+static void emitSLTImm(int cc, u32 imm)
+{
+	MOV32MtoR(HOST_EAX, offGPR(_Rs_));
+	CMP32ItoR(HOST_EAX, imm);
+	SETCC8R(cc, HOST_EAX);
+	MOVZX8RtoR(HOST_EAX, HOST_EAX);
+	emitStoreGPR(_Rt_, HOST_EAX);
+}
+
+static void recADDIU()
+{
+// Rt = Rs + Im
+	if (!_Rt_) return;
+
+	emitALUImm(ALU_ADD, _Imm_);
+}
+
+static void recADDI()
+{
+// Rt = Rs + Im (Exception on Integer Overflow)
+	recADDIU();
+}
+
+static void recSLTI()
+{
+// Rt = Rs < Im (Signed)
+	if (!_Rt_) return;
+
+	emitSLTImm(CC_L, _Imm_);
+}
+
+static void recSLTIU()
+{
+// Rt = Rs < Im (Unsigned)
+	if (!_Rt_) return;
+
+	emitSLTImm(CC_B, _Imm_);
+}
+
+static void recANDI()
+{
+// Rt = Rs And Im
+	if (!_Rt_) return;
+
+	emitALUImm(ALU_AND, _ImmU_);
+}
+
+static void recORI()
+{
+// Rt = Rs Or Im
+	if (!_Rt_) return;
+
+	emitALUImm(ALU_OR, _ImmU_);
+}
+
+static void recXORI()
+{
+// Rt = Rs Xor Im
+	if (!_Rt_) return;
+
+	emitALUImm(ALU_XOR, _ImmU_);
+}
+
+static void recLUI()
+{
+// Rt = Imm << 16
+	if (!_Rt_) return;
+
+	emitSetConstGPR(_Rt_, psxRegs.code << 16);
+}
+
+
+/* Load Rs into EAX and apply group-1 ALU op 'ext' with Rt */
+static void emitALURegs(int ext)
+{
+	emitLoadGPR(HOST_EAX, _Rs_);
+	if (IsConst(_Rt_))
+		ALU32ItoR(ext, HOST_EAX, GetConst(_Rt_));
+	else
+		ALU32MtoR(ext, HOST_EAX, offGPR(_Rt_));
+}
+
+/* Rd = Rs < Rt, 'cc' is CC_L (signed) or CC_B (unsigned) */
+static void emitSLTRegs(int cc)
+{
+	emitALURegs(ALU_CMP);
+	SETCC8R(cc, HOST_EAX);
+	MOVZX8RtoR(HOST_EAX, HOST_EAX);
+	emitStoreGPR(_Rd_, HOST_EAX);
+}
+
+#define REC_RTYPE_RD_RS_RT(name, ext) \
+static void rec##name() \
+{ \
+	if (!_Rd_) return; \
+	emitALURegs(ext); \
+	emitStoreGPR(_Rd_, HOST_EAX); \
+}
+
+REC_RTYPE_RD_RS_RT(ADDU, ALU_ADD)  // Rd = Rs + Rt
+REC_RTYPE_RD_RS_RT(SUBU, ALU_SUB)  // Rd = Rs - Rt
+REC_RTYPE_RD_RS_RT(AND,  ALU_AND)  // Rd = Rs And Rt
+REC_RTYPE_RD_RS_RT(OR,   ALU_OR)   // Rd = Rs Or Rt
+REC_RTYPE_RD_RS_RT(XOR,  ALU_XOR)  // Rd = Rs Xor Rt
+
+static void recADD()
+{
+// Rd = Rs + Rt (Exception on Integer Overflow)
+	recADDU();
+}
+
+static void recSUB()
+{
+// Rd = Rs - Rt (Exception on Integer Overflow)
+	recSUBU();
+}
+
+static void recNOR()
+{
+// Rd = Rs Nor Rt
+	if (!_Rd_) return;
+
+	emitALURegs(ALU_OR);
+	NOT32R(HOST_EAX);
+	emitStoreGPR(_Rd_, HOST_EAX);
+}
+
+static void recSLT()
+{
+// Rd = Rs < Rt (Signed)
+	if (!_Rd_) return;
+
+	emitSLTRegs(CC_L);
+}
+
+static void recSLTU()
+{
+// Rd = Rs < Rt (Unsigned)
+	if (!_Rd_) return;
+
+	emitSLTRegs(CC_B);
+}
+
+
+/* Rd = Rt <shift> sa, 'ext' is SHIFT_SHL/SHR/SAR */
+static void emitShiftImm(int ext, u32 sa)
+{
+	if (_Rd_ == _Rt_) {
+		if (sa) {
+			emit_mem(0, 0xc1, ext, PERM_REG_1, offGPR(_Rd_));
+			write8(sa);
+		}
+		SetUndef(_Rd_);
+		return;
+	}
+
+	MOV32MtoR(HOST_EAX, offGPR(_Rt_));
+	if (sa)
+		SHIFT32ItoR(ext, HOST_EAX, sa);
+	emitStoreGPR(_Rd_, HOST_EAX);
+}
+
+static void recSLL()
+{
+// Rd = Rt << Sa
+	if (!_Rd_) return;
+
+	emitShiftImm(SHIFT_SHL, _Sa_);
+}
+
+static void recSRL()
+{
+// Rd = Rt >> Sa
+	if (!_Rd_) return;
+
+	emitShiftImm(SHIFT_SHR, _Sa_);
+}
+
+static void recSRA()
+{
+// Rd = Rt >> Sa (arithmetic)
+	if (!_Rd_) return;
+
+	emitShiftImm(SHIFT_SAR, _Sa_);
+}
+
+/* Rd = Rt <shift> Rs, 'ext' is SHIFT_SHL/SHR/SAR.
+ *  Shift amount is masked to 5 bits by x86, same as the R3000A.
+ */
+static void emitShiftVar(int ext)
+{
+	if (IsConst(_Rs_)) {
+		const u32 sa = GetConst(_Rs_) & 31;
+		emitLoadGPR(HOST_EAX, _Rt_);
+		if (sa)
+			SHIFT32ItoR(ext, HOST_EAX, sa);
+	} else {
+		MOV32MtoR(HOST_ECX, offGPR(_Rs_));
+		emitLoadGPR(HOST_EAX, _Rt_);
+		emit_reg(0, 0xd3, ext, HOST_EAX);
+	}
+	emitStoreGPR(_Rd_, HOST_EAX);
+}
+
+static void recSLLV()
+{
+// Rd = Rt << Rs
+	if (!_Rd_) return;
+
+	emitShiftVar(SHIFT_SHL);
+}
+
+static void recSRLV()
+{
+// Rd = Rt >> Rs
+	if (!_Rd_) return;
+
+	emitShiftVar(SHIFT_SHR);
+}
+
+static void recSRAV()
+{
+// Rd = Rt >> Rs (arithmetic)
+	if (!_Rd_) return;
+
+	emitShiftVar(SHIFT_SAR);
+}
@@ -0,0 +1,347 @@
+/******************************************************************************
+ * IMPORTANT: The following host registers have unique usage restrictions.    *
+ *            See notes in x86_64_codegen.h for full details.                 *
+ *  HOST_RBX (PERM_REG_1), HOST_R12 (BRANCH_REG)                              *
+ *****************************************************************************/
+
+/* Detect conditional branches on known-const reg vals, eliminating
+ *  dead code and unnecessary branches.
+ */
+#define USE_CONST_BRANCH_OPTIMIZATIONS
+
+/* Emit code to end block, returning to dispatch loop with new PC 'new_pc'.
+ *  Caller has already emitted block's cycle count, see emitBlockCycles().
+ */
+static void emitBlockExitConst(const u32 new_pc)
+{
+	MOV32ItoM(off(pc), new_pc);
+	rec_recompile_end();
+}
+
+static void recSYSCALL()
+{
+	emitBlockCycles(pc);
+	MOV32ItoM(off(pc), pc - 4);
+	MOV32ItoR(HOST_EDI, 0x20);
+	MOV32ItoR(HOST_ESI, (branch ? 1 : 0));
+	CALLFunc((void *)psxException);
+
+	// Block returns with new PC set by psxException()
+	rec_recompile_end();
+	end_block = true;
+}
+
+/* Check if an opcode has a delayed read if in delay slot */
+static int iLoadTest(u32 code)
+{
+	// check for load delay
+	u32 op = _fOp_(code);
+	switch (op) {
+	case 0x10: // COP0
+		switch (_fRs_(code)) {
+		case 0x00: // MFC0
+		case 0x02: // CFC0
+			return 1;
+		}
+		break;
+	case 0x12: // COP2
+		switch (_fFunct_(code)) {
+		case 0x00:
+			switch (_fRs_(code)) {
+			case 0x00: // MFC2
+			case 0x02: // CFC2
+				return 1;
+			}
+			break;
+		}
+		break;
+	case 0x32: // LWC2
+		return 1;
+	default:
+		// LB/LH/LWL/LW/LBU/LHU/LWR
+		if (op >= 0x20 && op <= 0x26) {
+			return 1;
+		}
+		break;
+	}
+	return 0;
+}
+
+/* Does opcode in BD slot at 'pc' need the interpreter's branch handling?
+ *  'bpc' is branch target, or 0 if it's not known at recompile time.
+ *
+ *  The interpreter handles branches in BD slots, exceptions and HLE calls
+ *  from a BD slot, and loads in a BD slot whose target is read by the
+ *  opcode at branch target (see psxDelayTest()). These are all rare, so
+ *  the branch is just executed by the interpreter's handler instead.
+ */
+static bool rec_delay_slot_needs_interpreter(const u32 bpc)
+{
+	const u32 code = OPCODE_AT(pc);
+
+	if (opcodeIsBranchOrJump(code))
+		return true;
+
+	switch (_fOp_(code)) {
+		case 0x00: // SPECIAL
+			if (_fFunct_(code) == 0x0c) // SYSCALL
+				return true;
+			break;
+		case 0x10: // COP0
+			if ((_fRs_(code) == 0x04 || _fRs_(code) == 0x06) && // MTC0,CTC0
+			    (_fRd_(code) == 12 || _fRd_(code) == 13))       // Status,Cause
+				return true;
+			break;
+		case 0x3b: // HLE
+			return true;
+	}
+
+	if (iLoadTest(code)) {
+		if (bpc == 0)
+			return true;
+		const int i = psxTestLoadDelay(_fRt_(code), OPCODE_AT(bpc));
+		// 1: delayReadWrite	// the branch delay load is skipped
+		// 2: delayRead		// branch delay load
+		// 3: delayWrite	// no changes from normal behavior
+		if (i == 1 || i == 2)
+			return true;
+	}
+
+	return false;
+}
+
+/* Recompile opcode in BD slot at 'pc' */
+static void recDelaySlot()
+{
+	branch = true;
+	psxRegs.code = OPCODE_AT(pc);
+	DISASM_PSX(pc);
+	pc += 4;
+	recOpcode();
+	branch = false;
+}
+
+#ifdef USE_CONST_BRANCH_OPTIMIZATIONS
+static bool evalCond(int cc, s32 a, s32 b)
+{
+	switch (cc) {
+		case CC_E:  return a == b;
+		case CC_NE: return a != b;
+		case CC_L:  return a <  b;
+		case CC_GE: return a >= b;
+		case CC_LE: return a <= b;
+		case CC_G:  return a >  b;
+	}
+	return false;
+}
+#endif
+
+/* Emit conditional branch taken when (Rs <cc> Rt), or when (Rs <cc> 0)
+ *  if 'cmp_zero' is set. Sets $ra to return address if branch is taken
+ *  and 'link' is set.
+ */
+static void emitBranchCond(int cc, bool cmp_zero, bool link)
+{
+	const u32 rs = _Rs_;
+	const u32 rt = cmp_zero ? 0 : _Rt_;
+	const u32 bpc = _Imm_ * 4 + pc;
+	const u32 nbpc = pc + 4;
+
+	if (rec_delay_slot_needs_interpreter(bpc)) {
+		emitInterpreterBlockEnd(psxBSC[_Op_]);
+		return;
+	}
+
+#ifdef USE_CONST_BRANCH_OPTIMIZATIONS
+	if (IsConst(rs) && IsConst(rt)) {
+		if (!evalCond(cc, GetConst(rs), GetConst(rt))) {
+			// Branch is never taken: BD slot is just the next opcode
+			return;
+		}
+
+		if (link)
+			emitSetConstGPR(31, nbpc);
+		recDelaySlot();
+		emitBlockCycles(pc);
+		emitBlockExitConst(bpc);
+		end_block = true;
+		return;
+	}
+#endif
+
+	// Condition is kept in BRANCH_REG, BD slot could write to Rs/Rt
+	emitLoadGPR(HOST_EAX, rs);
+	if (IsConst(rt))
+		CMP32ItoR(HOST_EAX, GetConst(rt));
+	else
+		CMP32MtoR(HOST_EAX, offGPR(rt));
+	SETCC8R(cc, HOST_EAX);
+	MOVZX8RtoR(BRANCH_REG, HOST_EAX);
+
+	if (link) {
+		// SETcc,MOVZX don't affect flags
+		u8 *backpatch = JCC32(cc ^ 1);
+		MOV32ItoM(offGPR(31), nbpc);
+		fixup_branch(backpatch);
+		SetUndef(31);
+	}
+
+	recDelaySlot();
+
+	// Both paths advance cycles by the same amount
+	emitBlockCycles(pc);
+	TEST32RtoR(BRANCH_REG, BRANCH_REG);
+	u8 *backpatch = JCC32(CC_E);
+	emitBlockExitConst(bpc);
+	fixup_branch(backpatch);
+	emitBlockExitConst(nbpc);
+
+	end_block = true;
+}
+
+static void recBEQ()
+{
+// Branch if Rs == Rt
+	if (_Rs_ == _Rt_) {
+		// Always taken (also catches 'b' pseudo-op 'beq $zero,$zero')
+		const u32 bpc = _Imm_ * 4 + pc;
+		if (rec_delay_slot_needs_interpreter(bpc)) {
+			emitInterpreterBlockEnd(psxBSC[_Op_]);
+			return;
+		}
+		recDelaySlot();
+		emitBlockCycles(pc);
+		emitBlockExitConst(bpc);
+		end_block = true;
+		return;
+	}
+
+	emitBranchCond(CC_E, false, false);
+}
+
+static void recBNE()
+{
+// Branch if Rs != Rt
+	emitBranchCond(CC_NE, false, false);
+}
+
+static void recBLEZ()
+{
+// Branch if Rs <= 0
+	emitBranchCond(CC_LE, true, false);
+}
+
+static void recBGTZ()
+{
+// Branch if Rs > 0
+	emitBranchCond(CC_G, true, false);
+}
+
+static void recBLTZ()
+{
+// Branch if Rs < 0
+	emitBranchCond(CC_L, true, false);
+}
+
+static void recBGEZ()
+{
+// Branch if Rs >= 0
+	emitBranchCond(CC_GE, true, false);
+}
+
+static void recBLTZAL()
+{
+// Branch if Rs < 0 and link
+	emitBranchCond(CC_L, true, true);
+}
+
+static void recBGEZAL()
+{
+// Branch if Rs >= 0 and link
+	emitBranchCond(CC_GE, true, true);
+}
+
+static void recJ()
+{
+// j target
+	const u32 bpc = _Target_ * 4 + (pc & 0xf0000000);
+
+	if (rec_delay_slot_needs_interpreter(bpc)) {
+		emitInterpreterBlockEnd(psxBSC[_Op_]);
+		return;
+	}
+
+	recDelaySlot();
+	emitBlockCycles(pc);
+	emitBlockExitConst(bpc);
+	end_block = true;
+}
+
+static void recJAL()
+{
+// jal target
+	const u32 bpc = _Target_ * 4 + (pc & 0xf0000000);
+
+	if (rec_delay_slot_needs_interpreter(bpc)) {
+		emitInterpreterBlockEnd(psxBSC[_Op_]);
+		return;
+	}
+
+	emitSetConstGPR(31, pc + 4);
+	recDelaySlot();
+	emitBlockCycles(pc);
+	emitBlockExitConst(bpc);
+	end_block = true;
+}
+
+/* Indirect jump to Rs, setting Rd to return address if 'link' is set */
+static void emitJumpReg(bool link)
+{
+	const u32 rd = _Rd_;
+	const u32 nbpc = pc + 4;
+
+	// Target is known if Rs is const
+	const u32 bpc = IsConst(_Rs_) ? GetConst(_Rs_) : 0;
+
+	if (rec_delay_slot_needs_interpreter(bpc)) {
+		emitInterpreterBlockEnd(psxBSC[_Op_]);
+		return;
+	}
+
+	// Target is kept in BRANCH_REG, BD slot could write to Rs
+	emitLoadGPR(BRANCH_REG, _Rs_);
+
+	if (link && rd)
+		emitSetConstGPR(rd, nbpc);
+
+	recDelaySlot();
+	emitBlockCycles(pc);
+	MOV32RtoM(off(pc), BRANCH_REG);
+	rec_recompile_end();
+	end_block = true;
+}
+
+static void recJR()
+{
+// jr Rs
+	emitJumpReg(false);
+}
+
+static void recJALR()
+{
+// jalr Rs
+	emitJumpReg(true);
+}
+
+static void recBREAK() { }
+
+static void recHLE()
+{
+	emitBlockCycles(pc);
+	MOV32ItoM(off(pc), pc);
+	CALLFunc((void *)psxHLEt[psxRegs.code & 0x7]);
+
+	// Block returns with new PC set by HLE function
+	rec_recompile_end();
+	end_block = true;
+}
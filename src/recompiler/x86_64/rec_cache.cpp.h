@@ -0,0 +1,500 @@
+/*
+ * Persistent code cache
+ *
+ *  When Config.RecCacheDir is set, blocks are saved to a file per game in
+ * that dir, named after CdromId ("BIOS" before a CD is identified), and
+ * reused by later runs: recRecompile() first looks the PC up in the file
+ * loaded for the current game, and copies the saved code instead of
+ * recompiling when the guest code it was recompiled from is unchanged.
+ *
+ *  Blocks are only position-dependent through their references to host
+ * functions and globals (see emit_reloc()), which are saved relative to
+ * the start of the executable and fixed up when loaded. A block referring
+ * to anything outside the executable image (i.e. the heap) isn't saved.
+ *
+ *  A block is keyed by its guest PC and a hash of every guest code word
+ * read while recompiling it (see rec_note_code_read()). A file is only
+ * used by the same executable, with the same options from
+ * rec_set_options(): the file header holds a hash of these.
+ *
+ *  Time spent recompiling vs loading blocks from the file is printed at
+ * shutdown. Comparing a first (cold) run with a second (warm) one shows
+ * what the cache saves at startup.
+ */
+
+#include <sys/time.h>
+
+/* Start and end of the executable image, defined by the linker */
+extern char __executable_start[], _end[];
+
+#define RCACHE_MAGIC      "PCSXRC01"
+#define RCACHE_MAX_SIZE   (64 * 1024 * 1024)  /* Stop saving blocks past this */
+
+typedef struct {
+	char magic[8];
+	u64  build_hash;       /* See rcache_build_hash() */
+	u32  num_blocks;
+	u32  size;             /* Bytes of block data following header */
+} RecCacheHeader;
+
+/* Block data: header, followed by relocations, code deps, and host code,
+ *  padded to 8 bytes */
+typedef struct {
+	u32  pc;               /* Guest code range [pc,end_pc) block was */
+	u32  end_pc;           /*  recompiled from (and resumes at)      */
+	u64  code_hash;        /* See rcache_code_hash() */
+	u16  num_relocs;
+	u16  num_deps;
+	u32  host_size;        /* Bytes of host code */
+} RecCacheBlock;
+
+typedef struct {
+	u32  offset;           /* Offset of displacement/address in host code */
+	u32  type;             /* RELOC_REL32 or RELOC_ABS64 */
+	s64  target;           /* Target, relative to __executable_start */
+} RecCacheReloc;
+
+/* Index entry, PC to offset of block in rcache_data */
+typedef struct {
+	u32  pc;
+	u32  offset;
+} RecCacheIndex;
+
+RecReloc rec_relocs[REC_MAX_RELOCS];
+int      rec_num_relocs;
+u32      rec_code_lo, rec_code_hi;
+u32      rec_code_deps[REC_MAX_CODE_DEPS];
+int      rec_num_code_deps;
+
+static bool           rcache_open;          /* File for 'rcache_id' loaded? */
+static char           rcache_id[sizeof(CdromId)];
+static u64            rcache_hash;          /* Build hash file was loaded with */
+static bool           rcache_dirty;         /* New blocks not saved yet? */
+static u8            *rcache_data;          /* All blocks, loaded and new */
+static u32            rcache_size, rcache_alloc;
+static u32            rcache_num_blocks;
+static RecCacheIndex *rcache_index;         /* Open-addressed hash table */
+static u32            rcache_index_size;    /* Power of two, 0 if none */
+
+static struct {
+	u32 loaded, compiled, rejected;
+	u64 load_usecs, compile_usecs;
+} rcache_stats;
+
+static u64 rcache_hash_add(u64 hash, const void *data, size_t len)
+{
+	// FNV-1a
+	const u8 *p = (const u8 *)data;
+	while (len--)
+		hash = (hash ^ *p++) * 0x100000001b3ULL;
+	return hash;
+}
+
+/* Hash of everything besides guest code that emitted code depends on */
+static u64 rcache_build_hash()
+{
+	u64 hash = 0xcbf29ce484222325ULL;
+
+	// Layout of executable image: offsets of a few symbols in other files
+	const uptr base = (uptr)__executable_start;
+	const uptr syms[] = {
+		(uptr)&psxRegs - base, (uptr)psxBranchTest - base,
+		(uptr)psxMemRead32 - base, (uptr)psxMemWrite32 - base,
+		(uptr)psxException - base, (uptr)psxIdleLoopBlockEntry - base,
+		(uptr)&psxMemRLUT - base, (uptr)psxHLEt[0] - base,
+		(uptr)recClear - base, (uptr)_end - base
+	};
+	hash = rcache_hash_add(hash, syms, sizeof(syms));
+
+	// Options from rec_set_options() and elsewhere
+	const u32 opts[] = {
+		emit_code_invalidations, flush_code_on_dma3_exe_load,
+		smc_protect_code, cycle_multiplier, (u32)sizeof(psxRegisters),
+		bios_hooks_active,
+		// psxCP2[] ops that blocks call, see gteInit()
+		gte_lazy_flag, gte_simd_ops
+	};
+	hash = rcache_hash_add(hash, opts, sizeof(opts));
+
+	return hash;
+}
+
+/* Hash guest code words [lo,hi) and those at 'deps' */
+static u64 rcache_code_hash(u32 lo, u32 hi, const u32 *deps, int num_deps)
+{
+	u64 hash = 0xcbf29ce484222325ULL;
+
+	for (u32 loc = lo; loc < hi; loc += 4) {
+		const u32 code = PSXMu32(loc);
+		hash = rcache_hash_add(hash, &code, 4);
+	}
+
+	for (int i = 0; i < num_deps; i++) {
+		const u32 dep[2] = { deps[i], PSXMu32(deps[i]) };
+		hash = rcache_hash_add(hash, dep, sizeof(dep));
+	}
+
+	return hash;
+}
+
+/* Are guest code words [lo,hi) and those at 'deps' readable now? */
+static bool rcache_code_mapped(u32 lo, u32 hi, const u32 *deps, int num_deps)
+{
+	if (hi <= lo || hi - lo > 0x10000 ||
+	    !psxMemRLUTEntry(lo >> 16) || !psxMemRLUTEntry((hi-4) >> 16))
+		return false;
+
+	for (int i = 0; i < num_deps; i++) {
+		if (!psxMemRLUTEntry(deps[i] >> 16))
+			return false;
+	}
+
+	return true;
+}
+
+static inline u32 rcache_block_size(const RecCacheBlock *b)
+{
+	u32 size = sizeof(RecCacheBlock) + b->num_relocs * sizeof(RecCacheReloc) +
+	           b->num_deps * sizeof(u32) + b->host_size;
+	return (size + 7) & ~7;
+}
+
+static inline u32 rcache_index_hash(u32 pc)
+{
+	return (pc >> 2) * 0x9e3779b1;
+}
+
+static void rcache_index_add(u32 pc, u32 offset);
+
+static void rcache_index_grow()
+{
+	RecCacheIndex *old = rcache_index;
+	u32 old_size = rcache_index_size;
+
+	rcache_index_size = old_size ? old_size * 2 : 4096;
+	rcache_index = (RecCacheIndex *)calloc(rcache_index_size, sizeof(RecCacheIndex));
+
+	for (u32 i = 0; i < old_size; i++) {
+		if (old[i].offset)
+			rcache_index_add(old[i].pc, old[i].offset);
+	}
+	free(old);
+}
+
+/* Offsets in rcache_data start past the file header, so 0 means empty */
+static void rcache_index_add(u32 pc, u32 offset)
+{
+	if (rcache_num_blocks * 2 >= rcache_index_size)
+		rcache_index_grow();
+
+	u32 i = rcache_index_hash(pc) & (rcache_index_size - 1);
+	while (rcache_index[i].offset)
+		i = (i + 1) & (rcache_index_size - 1);
+	rcache_index[i].pc = pc;
+	rcache_index[i].offset = offset;
+}
+
+/* Returns false if the path doesn't fit in MAXPATHLEN */
+static bool rcache_path(char *path, const char *id)
+{
+	return snprintf(path, MAXPATHLEN, "%s/%s.rcache", Config.RecCacheDir,
+	                id[0] ? id : "BIOS") < MAXPATHLEN;
+}
+
+static void rcache_save()
+{
+	char path[MAXPATHLEN];
+	RecCacheHeader hdr;
+
+	if (!rcache_open || !rcache_dirty)
+		return;
+
+	memcpy(hdr.magic, RCACHE_MAGIC, sizeof(hdr.magic));
+	hdr.build_hash = rcache_hash;
+	hdr.num_blocks = rcache_num_blocks;
+	hdr.size = rcache_size - sizeof(hdr);
+	memcpy(rcache_data, &hdr, sizeof(hdr));
+
+	rcache_dirty = false;
+	if (!rcache_path(path, rcache_id))
+		return;
+
+	FILE *f = fopen(path, "wb");
+	if (!f || fwrite(rcache_data, rcache_size, 1, f) != 1)
+		REC_LOG("Error writing code cache file %s\n", path);
+	else
+		REC_LOG("Saved %u blocks to code cache file %s\n", rcache_num_blocks, path);
+	if (f)
+		fclose(f);
+}
+
+static void rcache_close()
+{
+	rcache_save();
+
+	free(rcache_data);   rcache_data = NULL;
+	free(rcache_index);  rcache_index = NULL;
+	rcache_size = rcache_alloc = rcache_num_blocks = rcache_index_size = 0;
+	rcache_open = false;
+}
+
+/* Load file for current CdromId and build hash, if there's one */
+static void rcache_load()
+{
+	char path[MAXPATHLEN];
+	RecCacheHeader hdr;
+
+	strcpy(rcache_id, CdromId);
+	rcache_hash = rcache_build_hash();
+	rcache_open = true;
+	rcache_dirty = false;
+
+	rcache_alloc = 1024 * 1024;
+	rcache_data = (u8 *)malloc(rcache_alloc);
+	rcache_size = sizeof(RecCacheHeader);
+	rcache_index_grow();
+
+	// Path too long: blocks are kept in memory only, rcache_save() skips it
+	if (!rcache_path(path, rcache_id)) {
+		REC_LOG("Code cache file path too long, not loading or saving it\n");
+		return;
+	}
+
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    memcmp(hdr.magic, RCACHE_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.size > RCACHE_MAX_SIZE) {
+		REC_LOG("Ignoring invalid code cache file %s\n", path);
+		fclose(f);
+		return;
+	}
+
+	if (hdr.build_hash != rcache_hash) {
+		REC_LOG("Ignoring code cache file %s: made by another build or with other options\n", path);
+		fclose(f);
+		return;
+	}
+
+	rcache_alloc = sizeof(hdr) + hdr.size + 1024 * 1024;
+	rcache_data = (u8 *)realloc(rcache_data, rcache_alloc);
+	if (fread(rcache_data + sizeof(hdr), hdr.size, 1, f) != 1) {
+		REC_LOG("Error reading code cache file %s\n", path);
+		fclose(f);
+		return;
+	}
+	fclose(f);
+
+	// Index blocks, checking they stay inside the file
+	u32 offset = sizeof(hdr);
+	const u32 end = sizeof(hdr) + hdr.size;
+	for (u32 i = 0; i < hdr.num_blocks; i++) {
+		if (end - offset < sizeof(RecCacheBlock))
+			break;
+		const RecCacheBlock *b = (const RecCacheBlock *)(rcache_data + offset);
+		const u32 size = rcache_block_size(b);
+		if (size > end - offset)
+			break;
+		rcache_num_blocks++;
+		rcache_index_add(b->pc, offset);
+		offset += size;
+	}
+	rcache_size = offset;
+
+	REC_LOG("Loaded %u blocks from code cache file %s\n", rcache_num_blocks, path);
+}
+
+/* Make sure file for current game and options is the one loaded */
+static void rcache_check_file()
+{
+	if (rcache_open && strcmp(rcache_id, CdromId) == 0 &&
+	    rcache_hash == rcache_build_hash())
+		return;
+
+	rcache_close();
+	rcache_load();
+}
+
+/* Copy block 'b' to recMem, fixing up its relocations.
+ *  Returns false if a rel32 target is now out of reach.
+ */
+static bool rcache_copy_block(const RecCacheBlock *b)
+{
+	const RecCacheReloc *relocs = (const RecCacheReloc *)(b + 1);
+	const u8 *code = (const u8 *)(relocs + b->num_relocs) + b->num_deps * sizeof(u32);
+	const uptr base = (uptr)__executable_start;
+
+	memcpy(recMem, code, b->host_size);
+
+	for (int i = 0; i < b->num_relocs; i++) {
+		u8 *loc = recMem + relocs[i].offset;
+		const uptr target = base + relocs[i].target;
+
+		if (relocs[i].type == RELOC_ABS64) {
+			const u64 addr = target;
+			memcpy(loc, &addr, 8);
+		} else {
+			const s64 rel = (s64)(target - (uptr)(loc + 4));
+			if (rel != (s64)(s32)rel)
+				return false;
+			const s32 rel32 = (s32)rel;
+			memcpy(loc, &rel32, 4);
+		}
+	}
+
+	return true;
+}
+
+/* Called by recRecompile() before recompiling block at 'pc'.
+ *  Returns guest PC after last opcode of block if a saved one was copied
+ *  to recMem (and advances recMem past it), 0 if there's none.
+ */
+static u32 rec_cache_load_block(u32 pc)
+{
+	if (!Config.RecCacheDir[0])
+		return 0;
+
+	rcache_check_file();
+	if (!rcache_num_blocks)
+		return 0;
+
+	struct timeval tv_start, tv_end;
+	gettimeofday(&tv_start, 0);
+
+	u32 end_pc = 0;
+	for (u32 i = rcache_index_hash(pc) & (rcache_index_size - 1);
+	     rcache_index[i].offset; i = (i + 1) & (rcache_index_size - 1)) {
+		if (rcache_index[i].pc != pc)
+			continue;
+
+		const RecCacheBlock *b = (const RecCacheBlock *)(rcache_data + rcache_index[i].offset);
+		const u32 *deps = (const u32 *)((const RecCacheReloc *)(b + 1) + b->num_relocs);
+
+		if (b->host_size > RECMEM_SIZE - RECMEM_SIZE_MAX ||
+		    !rcache_code_mapped(b->pc, b->end_pc, deps, b->num_deps) ||
+		    rcache_code_hash(b->pc, b->end_pc, deps, b->num_deps) != b->code_hash)
+			continue;
+
+		if (!rcache_copy_block(b)) {
+			rcache_stats.rejected++;
+			continue;
+		}
+
+		recMem += b->host_size;
+		end_pc = b->end_pc;
+		break;
+	}
+
+	if (end_pc) {
+		gettimeofday(&tv_end, 0);
+		rcache_stats.loaded++;
+		rcache_stats.load_usecs += (tv_end.tv_sec - tv_start.tv_sec) * 1000000 +
+		                           tv_end.tv_usec - tv_start.tv_usec;
+	}
+
+	return end_pc;
+}
+
+/* Called by recRecompile() after recompiling block [start_pc,end_pc) to
+ *  host code [code,recMem), which took 'usecs'.
+ */
+static void rec_cache_save_block(u32 start_pc, u32 end_pc, const u8 *code, u32 usecs)
+{
+	if (!Config.RecCacheDir[0])
+		return;
+
+	rcache_stats.compiled++;
+	rcache_stats.compile_usecs += usecs;
+
+	if (rec_num_relocs > REC_MAX_RELOCS || rec_num_code_deps > REC_MAX_CODE_DEPS)
+		return;
+
+	// Range of code read must include the block
+	if (rec_code_lo > start_pc || rec_code_hi < end_pc)
+		return;
+
+	RecCacheBlock b;
+	RecCacheReloc relocs[REC_MAX_RELOCS];
+	u32 deps[REC_MAX_CODE_DEPS];
+	const uptr base = (uptr)__executable_start;
+
+	b.pc = start_pc;
+	b.end_pc = rec_code_hi;
+	b.num_relocs = rec_num_relocs;
+	b.host_size = recMem - code;
+
+	for (int i = 0; i < rec_num_relocs; i++) {
+		const u8 *loc = rec_relocs[i].loc;
+		uptr target;
+
+		if (rec_relocs[i].type == RELOC_ABS64) {
+			u64 addr;
+			memcpy(&addr, loc, 8);
+			target = addr;
+		} else {
+			s32 rel;
+			memcpy(&rel, loc, 4);
+			target = (uptr)(loc + 4) + rel;
+		}
+
+		// Heap addresses are different each run
+		if (target < base || target >= (uptr)_end)
+			return;
+
+		relocs[i].offset = loc - code;
+		relocs[i].type = rec_relocs[i].type;
+		relocs[i].target = (s64)(target - base);
+	}
+
+	b.num_deps = 0;
+	for (int i = 0; i < rec_num_code_deps; i++) {
+		if (rec_code_deps[i] < rec_code_lo || rec_code_deps[i] >= rec_code_hi)
+			deps[b.num_deps++] = rec_code_deps[i];
+	}
+
+	b.code_hash = rcache_code_hash(b.pc, b.end_pc, deps, b.num_deps);
+
+	const u32 size = rcache_block_size(&b);
+	if (rcache_size + size - sizeof(RecCacheHeader) > RCACHE_MAX_SIZE)
+		return;
+	if (rcache_size + size > rcache_alloc) {
+		rcache_alloc = (rcache_size + size) * 2;
+		rcache_data = (u8 *)realloc(rcache_data, rcache_alloc);
+	}
+
+	u8 *p = rcache_data + rcache_size;
+	memset(p, 0, size);
+	memcpy(p, &b, sizeof(b));                   p += sizeof(b);
+	memcpy(p, relocs, b.num_relocs * sizeof(RecCacheReloc));
+	p += b.num_relocs * sizeof(RecCacheReloc);
+	memcpy(p, deps, b.num_deps * sizeof(u32));  p += b.num_deps * sizeof(u32);
+	memcpy(p, code, b.host_size);
+
+	rcache_num_blocks++;
+	rcache_index_add(b.pc, rcache_size);
+	rcache_size += size;
+	rcache_dirty = true;
+}
+
+static void rec_cache_shutdown()
+{
+	if (!rcache_open)
+		return;
+
+	rcache_close();
+
+	if (rcache_stats.loaded || rcache_stats.compiled) {
+		REC_LOG("Code cache: %u blocks loaded in %.1f ms (%.2f us/block), "
+		        "%u recompiled in %.1f ms (%.2f us/block)\n",
+		        rcache_stats.loaded, rcache_stats.load_usecs / 1000.0,
+		        rcache_stats.loaded ? (double)rcache_stats.load_usecs / rcache_stats.loaded : 0.0,
+		        rcache_stats.compiled, rcache_stats.compile_usecs / 1000.0,
+		        rcache_stats.compiled ? (double)rcache_stats.compile_usecs / rcache_stats.compiled : 0.0);
+	}
+	if (rcache_stats.rejected)
+		REC_LOG("Code cache: %u blocks not loaded, host functions out of reach\n",
+		        rcache_stats.rejected);
+	memset(&rcache_stats, 0, sizeof(rcache_stats));
+}
@@ -0,0 +1,64 @@
+/******************************************************************************
+ * IMPORTANT: The following host registers have unique usage restrictions.    *
+ *            See notes in x86_64_codegen.h for full details.                 *
+ *  HOST_RBX (PERM_REG_1), HOST_R12 (BRANCH_REG)                              *
+ *****************************************************************************/
+
+static void recMFC0()
+{
+// Rt = Cop0->Rd
+	if (!_Rt_) return;
+
+	MOV32MtoR(HOST_EAX, offCP0(_Rd_));
+	emitStoreGPR(_Rt_, HOST_EAX);
+}
+
+static void recCFC0()
+{
+// Rt = Cop0->Rd
+
+	recMFC0();
+}
+
+static void recMTC0()
+{
+// Cop0->Rd = Rt
+
+	if (_Rd_ == 12 || _Rd_ == 13) {
+		// Writes to Status/Cause can raise a SW interrupt: let interpreter's
+		//  MTC0() check for it, then end the block. Also force a call to
+		//  psxBranchTest(), as interrupts may have just been unmasked.
+		emitBlockCycles(pc);
+		emitCallInterpreter(psxCP0[_Rs_], true);
+		MOV32ItoM(off(io_cycle_counter), 0);
+		rec_recompile_end();
+		end_block = true;
+		return;
+	}
+
+	emitLoadGPR(HOST_EAX, _Rt_);
+	MOV32RtoM(offCP0(_Rd_), HOST_EAX);
+}
+
+static void recCTC0()
+{
+// Cop0->Rd = Rt
+
+	recMTC0();
+}
+
+static void recRFE()
+{
+	// Status = (Status & ~0xf) | ((Status & 0x3c) >> 2)
+	MOV32MtoR(HOST_EAX, off(CP0.n.Status));
+	MOV32RtoR(HOST_ECX, HOST_EAX);
+	AND32ItoR(HOST_EAX, 0xfffffff0);
+	SHR32ItoR(HOST_ECX, 2);
+	AND32ItoR(HOST_ECX, 0x0f);
+	OR32RtoR(HOST_EAX, HOST_ECX);
+	MOV32RtoM(off(CP0.n.Status), HOST_EAX);
+
+	// Interrupts may have just been re-enabled: have dispatch loop call
+	//  psxBranchTest() at end of block.
+	MOV32ItoM(off(io_cycle_counter), 0);
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+ * IMPORTANT: The following host registers have unique usage restrictions.    *
+ *            See notes in x86_64_codegen.h for full details.                 *
+ *  HOST_RBX (PERM_REG_1), HOST_R12 (BRANCH_REG)                              *
+ *****************************************************************************/
+
+/* GTE ops and transfers call the same C functions the interpreter uses,
+ *  through its psxCP2[]/psxCP2BSC[] tables. They read their operands from
+ *  psxRegs.code, which emitCallInterpreter() sets.
+ */
+
+/* Emit code to call GTE op 'f' of the interpreter's psxCP2[] table */
+#define CP2_FUNC(f) \
+static void rec##f() \
+{ \
+	emitCallInterpreter(psxCP2[_Funct_], false); \
+}
+
+CP2_FUNC(RTPS);
+CP2_FUNC(NCLIP);
+CP2_FUNC(OP);
+CP2_FUNC(DPCS);
+CP2_FUNC(INTPL);
+CP2_FUNC(MVMVA);
+CP2_FUNC(NCDS);
+CP2_FUNC(CDP);
+CP2_FUNC(NCDT);
+CP2_FUNC(NCCS);
+CP2_FUNC(CC);
+CP2_FUNC(NCS);
+CP2_FUNC(NCT);
+CP2_FUNC(SQR);
+CP2_FUNC(DCPL);
+CP2_FUNC(DPCT);
+CP2_FUNC(AVSZ3);
+CP2_FUNC(AVSZ4);
+CP2_FUNC(RTPT);
+CP2_FUNC(GPF);
+CP2_FUNC(GPL);
+CP2_FUNC(NCCT);
+
+static void recMFC2()
+{
+// Rt = Cop2->Rd
+	emitCallInterpreter(psxCP2BSC[_Rs_], false);
+	SetUndef(_Rt_);
+}
+
+static void recCFC2()
+{
+// Rt = Cop2->Rd (control)
+	emitCallInterpreter(psxCP2BSC[_Rs_], false);
+	SetUndef(_Rt_);
+}
+
+static void recMTC2()
+{
+// Cop2->Rd = Rt
+	emitCallInterpreter(psxCP2BSC[_Rs_], false);
+}
+
+static void recCTC2()
+{
+// Cop2->Rd = Rt (control)
+	emitCallInterpreter(psxCP2BSC[_Rs_], false);
+}
+
+static void recLWC2()
+{
+// Cop2->Rt = mem[Rs + Im]
+	emitCallInterpreter(psxBSC[_Op_], false);
+}
+
+static void recSWC2()
+{
+// mem[Rs + Im] = Cop2->Rt
+	emitCallInterpreter(psxBSC[_Op_], false);
+}
@@ -0,0 +1,278 @@
+/******************************************************************************
+ * IMPORTANT: The following host registers have unique usage restrictions.    *
+ *            See notes in x86_64_codegen.h for full details.                 *
+ *  HOST_RBX (PERM_REG_1), HOST_R12 (BRANCH_REG)                              *
+ *****************************************************************************/
+
+/* Loads and stores go through psxMemRLUT[]/psxMemWLUT[], just like
+ *  psxMemRead*()/psxMemWrite*() do. Inline code handles any address whose
+ *  LUT entry is valid; hardware I/O addresses and NULL psxMemWLUT[] entries
+ *  (cache isolation, ROM) are left to the C functions. With compact LUTs
+ *  (USE_COMPACT_MEMLUT), non-const addresses take one more indirection.
+ *  Address is kept in EDI and store value in ESI, so both are already in
+ *  place as the first and second args of a C call.
+ */
+
+enum {
+	LSU_S8 = 0, LSU_U8, LSU_S16, LSU_U16, LSU_32
+};
+
+/* Is upper half of address 't' the hardware I/O page? (any segment) */
+static inline bool isHwPage(const u32 t)
+{
+	return (t & 0x1fff) == 0x1f80;
+}
+
+#ifdef USE_DIRECT_MEM_ACCESS
+/* Emit only a C call for the current load/store? True for a const hardware
+ *  I/O address, or when the block IR found the base reg to be a const plus
+ *  an unknown index pointing outside RAM (a static array in scratchpad,
+ *  I/O or ROM), where inline access would seldom be taken.
+ */
+static bool LSU_use_only_indirect_access(bool is_const, u32 addr)
+{
+	if (is_const)
+		return isHwPage(addr >> 16);
+
+	return rec_ir_op && (rec_ir_op->region == REC_IR_REGION_HW ||
+	                     rec_ir_op->region == REC_IR_REGION_NONRAM);
+}
+
+/* Load psxMemRLUT[]/psxMemWLUT[] entry for the 64KB page of the address
+ *  into EDX. For a non-const address, EAX must hold address >> 16 and is
+ *  trashed, as is ECX.
+ */
+static void emitLUTEntry(bool write, bool is_const, u32 addr)
+{
+#ifdef USE_COMPACT_MEMLUT
+	// First-level entries never change, second-level entries do
+	if (is_const) {
+		const u32 t = addr >> 16;
+		MOV64GtoR(HOST_EDX, write ? &psxMemWLUTEntry(t) : &psxMemRLUTEntry(t));
+		return;
+	}
+	LEA64ItoR(HOST_EDX, write ? psxMemWLUT : psxMemRLUT);
+	MOV32RtoR(HOST_ECX, HOST_EAX);
+	SHR32ItoR(HOST_ECX, 8);
+	MOV64SIB8toR(HOST_EDX, HOST_EDX, HOST_ECX);
+	AND32ItoR(HOST_EAX, 0xff);
+	MOV64SIB8toR(HOST_EDX, HOST_EDX, HOST_EAX);
+#else
+	MOV64GtoR(HOST_EDX, write ? &psxMemWLUT : &psxMemRLUT);
+	if (is_const)
+		MOV64BDtoR(HOST_EDX, HOST_EDX, (addr >> 16) * sizeof(uptr));
+	else
+		MOV64SIB8toR(HOST_EDX, HOST_EDX, HOST_EAX);
+#endif
+}
+#endif
+
+/* Set EDI to effective address of current load/store. Returns true and
+ *  sets 'addr' if it's a known const.
+ */
+static bool emitEffectiveAddress(u32 &addr)
+{
+#ifdef USE_CONST_ADDRESSES
+	if (IsConst(_Rs_)) {
+		addr = GetConst(_Rs_) + _Imm_;
+		MOV32ItoR(HOST_EDI, addr);
+		return true;
+	}
+#endif
+
+	MOV32MtoR(HOST_EDI, offGPR(_Rs_));
+	if (_Imm_)
+		ADD32ItoR(HOST_EDI, _Imm_);
+	return false;
+}
+
+/* Zero/sign-extend 8/16-bit val in EAX, as returned by psxMemRead8/16 */
+static void emitExtendLoadResult(int type)
+{
+	switch (type) {
+		case LSU_S8:  MOVSX8RtoR(HOST_EAX, HOST_EAX);  break;
+		case LSU_U8:  MOVZX8RtoR(HOST_EAX, HOST_EAX);  break;
+		case LSU_S16: MOVSX16RtoR(HOST_EAX, HOST_EAX); break;
+		case LSU_U16: MOVZX16RtoR(HOST_EAX, HOST_EAX); break;
+		default: break;
+	}
+}
+
+static void emitLoad(int type)
+{
+	static const void *read_funcs[] = {
+		(void *)psxMemRead8,  (void *)psxMemRead8,
+		(void *)psxMemRead16, (void *)psxMemRead16,
+		(void *)psxMemRead32
+	};
+	u8 *backpatch_hw = NULL, *backpatch_done = NULL;
+	u32 addr = 0;
+
+#ifdef USE_DIRECT_MEM_ACCESS
+	bool is_const = emitEffectiveAddress(addr);
+
+	if (!LSU_use_only_indirect_access(is_const, addr)) {
+		if (is_const) {
+			emitLUTEntry(false, true, addr);
+			MOV32ItoR(HOST_ECX, addr & 0xffff);
+		} else {
+			MOV32RtoR(HOST_EAX, HOST_EDI);
+			SHR32ItoR(HOST_EAX, 16);
+			MOV32RtoR(HOST_ECX, HOST_EAX);
+			AND32ItoR(HOST_ECX, 0x1fff);
+			CMP32ItoR(HOST_ECX, 0x1f80);
+			backpatch_hw = JCC32(CC_E);
+			emitLUTEntry(false, false, 0);
+			MOVZX16RtoR(HOST_ECX, HOST_EDI);
+		}
+
+		switch (type) {
+			case LSU_S8:  MOVSX8SIBtoR(HOST_EAX, HOST_EDX, HOST_ECX);  break;
+			case LSU_U8:  MOVZX8SIBtoR(HOST_EAX, HOST_EDX, HOST_ECX);  break;
+			case LSU_S16: MOVSX16SIBtoR(HOST_EAX, HOST_EDX, HOST_ECX); break;
+			case LSU_U16: MOVZX16SIBtoR(HOST_EAX, HOST_EDX, HOST_ECX); break;
+			default:      MOV32SIBtoR(HOST_EAX, HOST_EDX, HOST_ECX);   break;
+		}
+
+		if (is_const) {
+			emitStoreGPR(_Rt_, HOST_EAX);
+			return;
+		}
+
+		backpatch_done = JMP32();
+		fixup_branch(backpatch_hw);
+	}
+#else
+	emitEffectiveAddress(addr);
+#endif
+
+	CALLFunc(read_funcs[type]);
+	emitExtendLoadResult(type);
+
+	if (backpatch_done)
+		fixup_branch(backpatch_done);
+
+	// Load is performed even when Rt is $r0, it could have side effects
+	emitStoreGPR(_Rt_, HOST_EAX);
+}
+
+static void recLB()  { emitLoad(LSU_S8);  }
+static void recLBU() { emitLoad(LSU_U8);  }
+static void recLH()  { emitLoad(LSU_S16); }
+static void recLHU() { emitLoad(LSU_U16); }
+static void recLW()  { emitLoad(LSU_32);  }
+
+/* Invalidate code block at address in EDI if its page of RAM has code.
+ *  Skipped with the Icache workaround for Formula One games, see
+ *  rec_set_options().
+ */
+static void emitCodeInvalidation()
+{
+	MOV32RtoR(HOST_EAX, HOST_EDI);
+	AND32ItoR(HOST_EAX, 0x1fffff);
+	SHR32ItoR(HOST_EAX, 12);
+	LEA64ItoR(HOST_EDX, code_pages);
+	BT32RtoBD(HOST_EDX, HOST_EAX);
+	u8 *backpatch = JCC32(CC_AE);
+	MOV32ItoR(HOST_ESI, 1);
+	CALLFunc((void *)recClear);
+	fixup_branch(backpatch);
+}
+
+static void emitStore(int type)
+{
+	static const void *write_funcs[] = {
+		(void *)psxMemWrite8,  (void *)psxMemWrite8,
+		(void *)psxMemWrite16, (void *)psxMemWrite16,
+		(void *)psxMemWrite32
+	};
+	u8 *backpatch_hw = NULL, *backpatch_null = NULL, *backpatch_done = NULL;
+	u32 addr = 0;
+
+	emitLoadGPR(HOST_ESI, _Rt_);
+
+#ifdef USE_DIRECT_MEM_ACCESS
+	bool is_const = emitEffectiveAddress(addr);
+
+	if (!LSU_use_only_indirect_access(is_const, addr)) {
+		if (is_const) {
+			emitLUTEntry(true, true, addr);
+		} else {
+			MOV32RtoR(HOST_EAX, HOST_EDI);
+			SHR32ItoR(HOST_EAX, 16);
+			MOV32RtoR(HOST_ECX, HOST_EAX);
+			AND32ItoR(HOST_ECX, 0x1fff);
+			CMP32ItoR(HOST_ECX, 0x1f80);
+			backpatch_hw = JCC32(CC_E);
+			emitLUTEntry(true, false, 0);
+		}
+
+		// NULL entry: RAM is cache-isolated, or address isn't writable
+		TEST64RtoR(HOST_EDX, HOST_EDX);
+		backpatch_null = JCC32(CC_E);
+
+		MOVZX16RtoR(HOST_ECX, HOST_EDI);
+		switch (type) {
+			case LSU_U8:
+				MOV32RtoR(HOST_EAX, HOST_ESI);
+				MOV8RtoSIB(HOST_EDX, HOST_ECX, HOST_EAX);
+				break;
+			case LSU_U16:
+				MOV16RtoSIB(HOST_EDX, HOST_ECX, HOST_ESI);
+				break;
+			default:
+				MOV32RtoSIB(HOST_EDX, HOST_ECX, HOST_ESI);
+				break;
+		}
+
+		if (emit_code_invalidations)
+			emitCodeInvalidation();
+
+		backpatch_done = JMP32();
+		if (backpatch_hw)
+			fixup_branch(backpatch_hw);
+		fixup_branch(backpatch_null);
+	}
+#else
+	emitEffectiveAddress(addr);
+#endif
+
+	// Narrow args must be zero-extended by the caller
+	if (type == LSU_U8)
+		AND32ItoR(HOST_ESI, 0xff);
+	else if (type == LSU_U16)
+		AND32ItoR(HOST_ESI, 0xffff);
+	CALLFunc(write_funcs[type]);
+
+	if (backpatch_done)
+		fixup_branch(backpatch_done);
+}
+
+static void recSB() { emitStore(LSU_U8);  }
+static void recSH() { emitStore(LSU_U16); }
+static void recSW() { emitStore(LSU_32);  }
+
+/* Unaligned loads/stores are rare enough that they just call the
+ *  interpreter. Consts are always written back, so psxRegs is up to date.
+ */
+static void recLWL()
+{
+	emitCallInterpreter(psxBSC[_Op_], false);
+	SetUndef(_Rt_);
+}
+
+static void recLWR()
+{
+	emitCallInterpreter(psxBSC[_Op_], false);
+	SetUndef(_Rt_);
+}
+
+static void recSWL()
+{
+	emitCallInterpreter(psxBSC[_Op_], false);
+}
+
+static void recSWR()
+{
+	emitCallInterpreter(psxBSC[_Op_], false);
+}
@@ -0,0 +1,146 @@
+/******************************************************************************
+ * IMPORTANT: The following host registers have unique usage restrictions.    *
+ *            See notes in x86_64_codegen.h for full details.                 *
+ *  HOST_RBX (PERM_REG_1), HOST_R12 (BRANCH_REG)                              *
+ *****************************************************************************/
+
+#define offLO	off(GPR.n.lo)
+#define offHI	off(GPR.n.hi)
+
+static void recMFHI()
+{
+// Rd = Hi
+	if (!_Rd_) return;
+
+	MOV32MtoR(HOST_EAX, offHI);
+	emitStoreGPR(_Rd_, HOST_EAX);
+}
+
+static void recMTHI()
+{
+// Hi = Rs
+	emitLoadGPR(HOST_EAX, _Rs_);
+	MOV32RtoM(offHI, HOST_EAX);
+}
+
+static void recMFLO()
+{
+// Rd = Lo
+	if (!_Rd_) return;
+
+	MOV32MtoR(HOST_EAX, offLO);
+	emitStoreGPR(_Rd_, HOST_EAX);
+}
+
+static void recMTLO()
+{
+// Lo = Rs
+	emitLoadGPR(HOST_EAX, _Rs_);
+	MOV32RtoM(offLO, HOST_EAX);
+}
+
+/* EDX:EAX = Rs * Rt, 'ext' is 4 (MUL) or 5 (IMUL) */
+static void emitMultiply(int ext)
+{
+	emitLoadGPR(HOST_EAX, _Rs_);
+	if (IsConst(_Rt_)) {
+		MOV32ItoR(HOST_ECX, GetConst(_Rt_));
+		emit_reg(0, 0xf7, ext, HOST_ECX);
+	} else {
+		emit_mem(0, 0xf7, ext, PERM_REG_1, offGPR(_Rt_));
+	}
+	MOV32RtoM(offLO, HOST_EAX);
+	MOV32RtoM(offHI, HOST_EDX);
+}
+
+static void recMULT()
+{
+// Lo/Hi = Rs * Rt (signed)
+	if (IsConst(_Rs_) && IsConst(_Rt_)) {
+		u64 res = (s64)(s32)GetConst(_Rs_) * (s64)(s32)GetConst(_Rt_);
+		MOV32ItoM(offLO, (u32)res);
+		MOV32ItoM(offHI, (u32)(res >> 32));
+		return;
+	}
+
+	emitMultiply(5);
+}
+
+static void recMULTU()
+{
+// Lo/Hi = Rs * Rt (unsigned)
+	if (IsConst(_Rs_) && IsConst(_Rt_)) {
+		u64 res = (u64)GetConst(_Rs_) * (u64)GetConst(_Rt_);
+		MOV32ItoM(offLO, (u32)res);
+		MOV32ItoM(offHI, (u32)(res >> 32));
+		return;
+	}
+
+	emitMultiply(4);
+}
+
+static void recDIV()
+{
+// Lo/Hi = Rs / Rt (signed)
+	// Div-by-zero and 0x80000000/-1 give the PS1 results instead of
+	//  trapping on the host:
+	//   Rt == 0:  Lo = (Rs >= 0) ? -1 : 1,  Hi = Rs
+	//   overflow: Lo = 0x80000000,          Hi = 0
+	u8 *backpatch1, *backpatch2, *backpatch3, *backpatch4, *backpatch5;
+
+	emitLoadGPR(HOST_EAX, _Rs_);
+	emitLoadGPR(HOST_ECX, _Rt_);
+
+	TEST32RtoR(HOST_ECX, HOST_ECX);
+	backpatch1 = JCC32(CC_E);
+
+	CMP32ItoR(HOST_ECX, -1);
+	backpatch2 = JCC32(CC_NE);
+	CMP32ItoR(HOST_EAX, 0x80000000);
+	backpatch3 = JCC32(CC_NE);
+	XOR32RtoR(HOST_EDX, HOST_EDX);
+	backpatch4 = JMP32();
+
+	fixup_branch(backpatch2);
+	fixup_branch(backpatch3);
+	CDQ();
+	IDIV32R(HOST_ECX);
+	backpatch5 = JMP32();
+
+	// Rt == 0
+	fixup_branch(backpatch1);
+	MOV32RtoR(HOST_EDX, HOST_EAX);
+	SAR32ItoR(HOST_EAX, 31);
+	ADD32RtoR(HOST_EAX, HOST_EAX);
+	NOT32R(HOST_EAX);
+
+	fixup_branch(backpatch4);
+	fixup_branch(backpatch5);
+	MOV32RtoM(offLO, HOST_EAX);
+	MOV32RtoM(offHI, HOST_EDX);
+}
+
+static void recDIVU()
+{
+// Lo/Hi = Rs / Rt (unsigned)
+	// Rt == 0: Lo = 0xffffffff, Hi = Rs
+	u8 *backpatch1, *backpatch2;
+
+	emitLoadGPR(HOST_EAX, _Rs_);
+	emitLoadGPR(HOST_ECX, _Rt_);
+
+	TEST32RtoR(HOST_ECX, HOST_ECX);
+	backpatch1 = JCC32(CC_E);
+	XOR32RtoR(HOST_EDX, HOST_EDX);
+	DIV32R(HOST_ECX);
+	backpatch2 = JMP32();
+
+	// Rt == 0
+	fixup_branch(backpatch1);
+	MOV32RtoR(HOST_EDX, HOST_EAX);
+	MOV32ItoR(HOST_EAX, 0xffffffff);
+
+	fixup_branch(backpatch2);
+	MOV32RtoM(offLO, HOST_EAX);
+	MOV32RtoM(offHI, HOST_EDX);
+}
@@ -0,0 +1,724 @@
+/*
+ * x86-64 recompiler for pcsx4all
+ *
+ *  Follows the structure of the MIPS recompiler in ../mips: same block
+ * lookup tables, code-page invalidation, const-propagation and code-discard
+ * scan, with an x86-64 code emitter in place of the MIPS one.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stddef.h>
+#include <sys/mman.h>
+#include "plugin_lib.h"
+#include "psxcommon.h"
+#include "psxhle.h"
+#include "psxmem.h"
+#include "psxhw.h"
+#include "psxidle.h"
+#include "psxbioshook.h"
+#include "psxsmc.h"
+#include "psxverify.h"
+#include "r3000a.h"
+#include "gte.h"
+#include "recompiler/rec_ir.h"
+#include "recompiler/rec_stats.h"
+#include "recompiler/rec_perf.h"
+#include "recompiler/rec_tier.h"
+
+/* Standard console logging */
+#define REC_LOG(...) printf("x86rec: " __VA_ARGS__)
+#ifndef REC_LOG
+#define REC_LOG(...)
+#endif
+
+/* Verbose console logging (uncomment next line to enable) */
+//#define REC_LOG_V REC_LOG
+#ifndef REC_LOG_V
+#define REC_LOG_V(...)
+#endif
+
+/* Scan for and skip useless code in PS1 executable: */
+#define USE_CODE_DISCARD
+
+/* Blocks that are side-effect free polling loops fast-forward to the next
+ *  event once they branch back to themselves, see psxidle.cpp */
+#define USE_IDLE_LOOP_SKIP
+
+/* Const propagation is applied to addresses */
+#define USE_CONST_ADDRESSES
+
+/* Generate inline RAM access or always call psxMemRead/Write C functions */
+#define USE_DIRECT_MEM_ACCESS
+
+/* Lower ops from the shared block IR after its passes: constant folding,
+ *  dead code/store and redundant load elimination, see ../rec_ir.h */
+#define USE_BLOCK_IR
+
+//#define DEBUGG printf
+
+/* Bit vector indicating which PS1 RAM pages contain the start of blocks.
+ *  Used to determine when code invalidation in recClear() can be skipped.
+ */
+static u8 code_pages[0x200000/4096/8];
+
+/* Pointers to the recompiled blocks go here. psxRecLUT[] uses upper 16 bits of
+ *  a PC value as an index to lookup a block pointer stored in recRAM/recROM.
+ */
+#define REC_RAM_PTR_SIZE sizeof(uptr)
+#define REC_RAM_SIZE (0x200000 / 4 * REC_RAM_PTR_SIZE)
+#define REC_ROM_SIZE ( 0x80000 / 4 * REC_RAM_PTR_SIZE)
+
+static s8 *recRAM;
+static s8 *recROM;
+static uptr psxRecLUT[0x10000];
+
+#undef PC_REC
+#define PC_REC(x)	((uptr)psxRecLUT[(x) >> 16] + (((x) & 0xffff) * (REC_RAM_PTR_SIZE / 4)))
+
+#include "x86_64_codegen.h"
+
+
+/* Const-propagation data and functions */
+typedef struct {
+	u32  constval;
+	bool is_const;
+} iRegisters;
+static iRegisters iRegs[32];
+static inline void ResetConsts()
+{
+	memset(&iRegs, 0, sizeof(iRegs));
+	iRegs[0].is_const = true;  // $r0 is always zero val
+}
+static inline bool IsConst(const u32 reg)  { return iRegs[reg].is_const; }
+static inline u32  GetConst(const u32 reg) { return iRegs[reg].constval; }
+static inline void SetUndef(const u32 reg)
+{
+	if (reg)
+		iRegs[reg].is_const = false;
+}
+static inline void SetConst(const u32 reg, const u32 val)
+{
+	if (reg) {
+		iRegs[reg].constval = val;
+		iRegs[reg].is_const = true;
+	}
+}
+
+
+/* Code cache buffer
+ *  Keep this statically allocated! This keeps it close to the .text section,
+ *  so emitted code can reach C functions and globals with rel32 CALLs and
+ *  RIP-relative addressing. Dynamic allocation would get an anonymous
+ *  mmap'ing that can lie far outside the +-2GB range of a rel32.
+ *  The buffer is made executable with mprotect() in recInit().
+ */
+#define RECMEM_SIZE         (12 * 1024 * 1024)
+#define RECMEM_SIZE_MAX     (RECMEM_SIZE-(512*1024))
+static u8 recMemBase[RECMEM_SIZE] __attribute__((aligned(4096)));
+
+u8         *recMem;                /* Where does next emitted opcode in block go? */
+static u8  *recMemStart;           /* Where did first emitted opcode in block go? */
+static u32 pc;                     /* Recompiler pc */
+static u32 oldpc;                  /* Recompiler pc at start of block */
+u32 cycle_multiplier = 0x200;      /* Cycle advance per emulated instruction
+                                      Default is 0x200 == 2.00 (24.8 fixed-pt) */
+
+/* Blocks are ended after this many PS1 instructions, so that any one block
+ *  is guaranteed to fit in the slack space above RECMEM_SIZE_MAX.
+ */
+#define REC_MAX_BLOCK_INSNS 256
+
+/* Flags used during a recompilation phase */
+static bool branch;                        /* Current instruction lies in a BD slot? */
+static bool end_block;                     /* Has recompilation phase ended? */
+static bool emit_code_invalidations;       /* Emit code invalidation for store instructions? */
+static bool flush_code_on_dma3_exe_load;   /* Flush code cache when psxDma3() detects EXE load? */
+static bool smc_protect_code;              /* Write-protect RAM pages holding recompiled code? */
+
+#ifdef USE_BLOCK_IR
+static RecIRBlock rec_ir;                  /* IR of block being recompiled */
+#endif
+static const RecIROp *rec_ir_op;           /* IR op being recompiled, NULL if none */
+
+/* Number of active dispatch loops. HLE BIOS 'softcalls' run a nested
+ *  recExecuteBlock() from inside a block, see recRun().
+ */
+static int rec_dispatch_depth;
+
+/* Code cache is full: next recRecompile() will flush it */
+static inline bool recMemFull()
+{
+	return ((uptr)recMem - (uptr)recMemBase) >= RECMEM_SIZE_MAX;
+}
+
+static void recReset();
+static void recRecompile();
+static void recClear(u32 Addr, u32 Size);
+static void recNotify(int note, void *data);
+
+extern void (*recBSC[64])();
+extern void (*recSPC[64])();
+extern void (*recREG[32])();
+extern void (*recCP0[32])();
+extern void (*recCP2[64])();
+extern void (*recCP2BSC[32])();
+
+/* Interpreter opcode tables, for ops emitted as calls (psxinterpreter.cpp) */
+extern void (*psxBSC[64])(void);
+extern void (*psxSPC[64])(void);
+extern void (*psxREG[32])(void);
+extern void (*psxCP0[32])(void);
+extern void (*psxCP2[64])(void);
+extern void (*psxCP2BSC[32])(void);
+
+#define DISASM_PSX(_PC_)
+#define DISASM_HOST()
+#define DISASM_INIT()
+#define DISASM_MSG(...)
+
+
+/* Block prologue: blocks are called from C. Save the callee-saved regs
+ *  used by emitted code and realign stack to 16 bytes for calls to C.
+ */
+static void rec_recompile_start()
+{
+	PUSH64R(HOST_EBX);
+	PUSH64R(HOST_R12);
+	SUB64ItoRSP(8);
+	LEA64ItoR(PERM_REG_1, &psxRegs);
+}
+
+/* Advance psxRegs.cycle by cycles taken from block start up to 'end_pc' */
+static void emitBlockCycles(u32 end_pc)
+{
+	const u32 cycles = ADJUST_CLOCK((end_pc-oldpc)/4);
+	if (cycles)
+		ADD32ItoM(off(cycle), cycles);
+}
+
+/* End of the recompiled block. Caller has already set psxRegs.pc and
+ *  psxRegs.cycle (see emitBlockCycles()).
+ */
+static void rec_recompile_end()
+{
+	ADD64ItoRSP(8);
+	POP64R(HOST_R12);
+	POP64R(HOST_EBX);
+	RET();
+}
+
+/* Call interpreter handler 'func' for current opcode. It sees the same
+ *  psxRegs.code (and psxRegs.pc, if 'set_pc') it would in the interpreter.
+ */
+static void emitCallInterpreter(void (*func)(void), bool set_pc)
+{
+	MOV32ItoM(off(code), psxRegs.code);
+	if (set_pc)
+		MOV32ItoM(off(pc), pc);
+	CALLFunc((void *)func);
+}
+
+/* Execute current opcode with interpreter handler 'func' and end block
+ *  there. Used for ops that can change control flow in ways the emitters
+ *  don't model: exceptions, HLE calls, and branches whose BD slot holds
+ *  an opcode needing the interpreter's branch-delay handling.
+ *  Handler sets psxRegs.pc to the PC the block returns with.
+ */
+static void emitInterpreterBlockEnd(void (*func)(void))
+{
+	emitBlockCycles(pc);
+	emitCallInterpreter(func, true);
+	rec_recompile_end();
+	end_block = true;
+}
+
+/* Load PS1 GPR 'reg' into host reg, using its known const val if possible */
+static void emitLoadGPR(int hreg, u32 reg)
+{
+	if (IsConst(reg))
+		MOV32ItoR(hreg, GetConst(reg));
+	else
+		MOV32MtoR(hreg, offGPR(reg));
+}
+
+/* Store host reg to PS1 GPR 'reg', whose val is no longer known */
+static void emitStoreGPR(u32 reg, int hreg)
+{
+	if (!reg)
+		return;
+	MOV32RtoM(offGPR(reg), hreg);
+	SetUndef(reg);
+}
+
+/* Set PS1 GPR 'reg' to known const val 'val'. Consts are always written
+ *  to psxRegs right away, so C code and interpreter handlers see them.
+ */
+static void emitSetConstGPR(u32 reg, u32 val)
+{
+	if (!reg || (IsConst(reg) && GetConst(reg) == val))
+		return;
+	MOV32ItoM(offGPR(reg), val);
+	SetConst(reg, val);
+}
+
+/* Recompile opcode in psxRegs.code, at 'pc' - 4. Ops covered by the block
+ *  IR are lowered from it when a shared pass simplified them.
+ */
+static void recOpcode()
+{
+#ifdef USE_BLOCK_IR
+	rec_ir_op = recIROpAt(&rec_ir, pc - 4);
+	if (rec_ir_op) {
+		const RecIROp *op = rec_ir_op;
+
+		if (op->flags & REC_IR_DEAD)
+			return;
+
+		if (op->kind == REC_IR_ALU && (op->flags & REC_IR_CONST)) {
+			emitSetConstGPR(op->rd, op->value);
+			return;
+		}
+
+		if (op->flags & REC_IR_REDUNDANT) {
+			// Loaded value is still in GPR 'src'
+			if (op->rd != op->src) {
+				emitLoadGPR(HOST_EAX, op->src);
+				emitStoreGPR(op->rd, HOST_EAX);
+			}
+			return;
+		}
+	}
+#endif
+
+	recBSC[psxRegs.code>>26]();
+	rec_ir_op = NULL;
+}
+
+
+#include "recompiler/rec_discard.cpp.h"
+#include "rec_lsu.cpp.h" // Load Store Unit
+#include "rec_gte.cpp.h" // Geometry Transformation Engine
+#include "rec_alu.cpp.h" // Arithmetic Logical Unit
+#include "rec_mdu.cpp.h" // Multiple Divide Unit
+#include "rec_cp0.cpp.h" // Coprocessor 0
+#include "rec_bcu.cpp.h" // Branch Control Unit
+#include "recompiler/opcodes.h"
+#include "rec_cache.cpp.h"
+
+
+/* Set default recompilation options, and any per-game settings */
+static void rec_set_options()
+{
+	// Default options
+	emit_code_invalidations = true;
+	flush_code_on_dma3_exe_load = false;
+
+	// Per-game options
+	// -> Use case-insensitive comparisons! Some CDs have lowercase CdromId.
+
+	// 'Studio 33' game workarounds (other Studio 33 games seem to be OK)
+	//  See comments in recNotify(), psxDma3().
+	if (strncasecmp(CdromId, "SCES03886", 9) == 0  ||  // Formula 1 Arcade
+	    strncasecmp(CdromId, "SLUS00870", 9) == 0  ||  // Formula 1 '99  NTSC US
+	    strncasecmp(CdromId, "SCPS10101", 9) == 0  ||  // Formula 1 '99  NTSC J (untested)
+	    strncasecmp(CdromId, "SCES01979", 9) == 0  ||  // Formula 1 '99  PAL  E (requires .SBI subchannel file)
+	    strncasecmp(CdromId, "SLES01979", 9) == 0  ||  // Formula 1 '99  PAL  E (unknown revision, couldn't test)
+	    strncasecmp(CdromId, "SCES03404", 9) == 0  ||  // Formula 1 2001 PAL  E,Fi (fixes broken AI/controls)
+	    strncasecmp(CdromId, "SCES03423", 9) == 0)     // Formula 1 2001 PAL  Fr,G (fixes broken AI/controls)
+	{
+		REC_LOG("Using Icache workarounds for trouble games 'Formula One 99/2001/etc'.\n");
+		emit_code_invalidations = false;
+		flush_code_on_dma3_exe_load = true;
+	}
+
+	// Write-protect RAM pages that blocks are recompiled from, so the first
+	//  write to one invalidates all blocks overlapping it (see psxsmc.cpp).
+	//  Not with the Icache workaround above: it depends on CPU stores leaving
+	//  code alone, and a fault can't tell a CPU store from a DMA write.
+	smc_protect_code = emit_code_invalidations;
+}
+
+
+static void recRecompile()
+{
+	// Notify plugin_lib that we're recompiling (affects frameskip timing)
+	pl_dynarec_notify();
+
+	// Never called from a nested dispatch loop with a full cache, see recRun()
+	if (recMemFull()) {
+		REC_LOG("Code cache size limit exceeded: flushing code cache.\n");
+		recReset();
+	}
+
+	recMemStart = recMem;
+
+	*(uptr *)PC_REC(psxRegs.pc) = (uptr)recMem;
+	oldpc = pc = psxRegs.pc;
+
+	// If 'pc' is in PS1 RAM, mark the page of RAM as containing the start of
+	//  a block. For the range check, bit 27 is interpreted as a sign bit.
+	if ((s32)(pc << 4) >= 0) {
+		u32 masked_pc = pc & 0x1fffff;
+		code_pages[masked_pc/4096/8] |= (1 << ((masked_pc/4096) & 7));
+	}
+
+	// Reuse block saved by an earlier run, if guest code is unchanged.
+	//  Not while gathering statistics: cached blocks have no exec counter.
+	const u32 cached_end_pc = rec_stats_active ? 0 : rec_cache_load_block(pc);
+	if (cached_end_pc) {
+		if (smc_protect_code)
+			psxSmcProtect(oldpc, cached_end_pc);
+		rec_perf_block(oldpc, recMemStart, recMem - recMemStart);
+		return;
+	}
+
+	struct timeval tv_start;
+	gettimeofday(&tv_start, 0);
+
+	// Track host address references and guest code read, for the code cache
+	rec_num_relocs = 0;
+	rec_num_code_deps = 0;
+	rec_code_lo = rec_code_hi = pc;
+
+	DISASM_INIT();
+
+	rec_recompile_start();
+
+	// Hot-block profiler: count executions of block. Counter is on the
+	//  heap, so code cache won't save the block.
+	if (rec_stats_active) {
+		u32 *exec_count = recStatsBlockStart(pc, recMemStart);
+		if (exec_count) {
+			LEA64ItoR(HOST_EAX, exec_count);
+			emit_mem(0, 0x83, ALU_ADD, HOST_EAX, 0);
+			write8(1);
+		}
+	}
+
+	// Reset const-propagation
+	ResetConsts();
+
+#ifdef USE_BLOCK_IR
+	// Decode block and run shared passes. The code cache must know of every
+	//  guest code word the IR depends on.
+	recIRBuild(&rec_ir, pc, REC_MAX_BLOCK_INSNS, false);
+	recIROptimize(&rec_ir);
+	for (int i = 0; i < rec_ir.num_ops; i++)
+		rec_note_code_read(rec_ir.ops[i].pc);
+#endif
+
+	// Flag indicates when recompilation should stop
+	end_block = false;
+
+#ifdef USE_IDLE_LOOP_SKIP
+	{
+		const u32 idle_branch_pc = psxIdleLoopFind(pc);
+		if (idle_branch_pc) {
+			// Block is the whole loop, ending after BD slot of its branch
+			MOV32ItoR(HOST_EDI, idle_branch_pc);
+			MOV32ItoR(HOST_ESI, ADJUST_CLOCK((idle_branch_pc + 8 - oldpc)/4));
+			CALLFunc((void *)psxIdleLoopBlockEntry);
+		}
+	}
+#endif
+
+	// BIOS call vector: return to caller if the function was run natively.
+	//  psxBiosHookCall() has set psxRegs.pc and psxRegs.cycle then.
+	if (bios_hooks_active && psxBiosHookIsVector(pc)) {
+		MOV32ItoR(HOST_EDI, pc);
+		CALLFunc((void *)psxBiosHookCall);
+		TEST32RtoR(HOST_EAX, HOST_EAX);
+		u8 *backpatch = JCC32(CC_E);
+		rec_recompile_end();
+		fixup_branch(backpatch);
+	}
+
+	// Number of discardable instructions we are currently skipping
+	int discard_cnt = 0;
+
+	do {
+		// Flag indicates if next instruction lies in a BD slot
+		branch = false;
+
+		psxRegs.code = OPCODE_AT(pc);
+
+#ifdef USE_CODE_DISCARD
+		// If we are not already skipping past discardable code, scan
+		//  for PS1 code sequence we can discard.
+		if (discard_cnt == 0) {
+			int discard_type = 0;
+			discard_cnt = rec_discard_scan(pc, &discard_type);
+			if (discard_cnt > 0) {
+				DISASM_MSG(" ->BEGIN code discard: %s\n", rec_discard_type_str(discard_type));
+				rec_stats_add_discard(discard_cnt);
+			}
+		}
+#endif
+
+		DISASM_PSX(pc);
+		pc += 4;
+
+#ifdef USE_CODE_DISCARD
+		// Skip next discardable instruction in any sequence found.
+		if (discard_cnt > 0) {
+			--discard_cnt;
+			if (discard_cnt == 0) {
+				DISASM_MSG(" ->END code discard.\n");
+			}
+			continue;
+		}
+#endif
+
+		// Recompile next instruction.
+		recOpcode();
+
+		// Block got too long: end it, resuming at next instruction.
+		//  Don't split a discardable sequence across two blocks.
+		if (!end_block && discard_cnt == 0 &&
+		    (pc - oldpc)/4 >= REC_MAX_BLOCK_INSNS) {
+			MOV32ItoM(off(pc), pc);
+			emitBlockCycles(pc);
+			rec_recompile_end();
+			end_block = true;
+		}
+	} while (!end_block);
+
+	// Write-protect the RAM pages the block was recompiled from
+	if (smc_protect_code)
+		psxSmcProtect(oldpc, pc);
+
+	DISASM_HOST();
+
+	struct timeval tv_end;
+	gettimeofday(&tv_end, 0);
+	const u32 usecs = (tv_end.tv_sec - tv_start.tv_sec) * 1000000 +
+	                  tv_end.tv_usec - tv_start.tv_usec;
+	rec_cache_save_block(oldpc, pc, recMemStart, usecs);
+
+	// Host opcodes are variable-length and not counted here
+	if (rec_stats_active)
+		recStatsBlockEnd(pc, recMem - recMemStart, 0, usecs);
+
+	rec_perf_block(oldpc, recMemStart, recMem - recMemStart);
+}
+
+
+static int recInit()
+{
+	REC_LOG("Initializing\n");
+
+	recMem = recMemBase;
+
+	// Emitted code lives in .bss, which isn't executable by default.
+	if (mprotect(recMemBase, RECMEM_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+		printf("Error: couldn't make recompiler code buffer executable\n");
+		return -1;
+	}
+
+	if (!recRAM) recRAM = (s8*)malloc(REC_RAM_SIZE);
+	if (!recROM) recROM = (s8*)malloc(REC_ROM_SIZE);
+
+	if (recRAM == NULL || recROM == NULL) {
+		printf("Error allocating memory\n"); return -1;
+	}
+
+	psxVerifyInit();
+	recStatsInit();
+	recPerfInit();
+	recTierInit();
+
+	recReset();
+
+	for (int i = 0; i < 0x80; i++)
+		psxRecLUT[i + 0x0000] = (uptr)recRAM + (((i & 0x1f) << 16) * (REC_RAM_PTR_SIZE/4));
+
+	memcpy(&psxRecLUT[0x8000], psxRecLUT, 0x80 * sizeof(psxRecLUT[0]));
+	memcpy(&psxRecLUT[0xa000], psxRecLUT, 0x80 * sizeof(psxRecLUT[0]));
+
+	for (int i = 0; i < 0x08; i++)
+		psxRecLUT[i + 0xbfc0] = (uptr)recROM + ((i << 16) * (REC_RAM_PTR_SIZE/4));
+
+	return 0;
+}
+
+
+static void recShutdown()
+{
+	REC_LOG("Shutting down\n");
+
+	rec_cache_shutdown();
+	psxVerifyShutdown();
+	recStatsShutdown(NULL);
+	recPerfShutdown();
+	recTierShutdown();
+
+	free(recRAM);  recRAM = NULL;
+	free(recROM);  recROM = NULL;
+}
+
+
+/* Run blocks starting at psxRegs.pc until psxRegs.pc == 'target_pc'.
+ *  Each block returns having set psxRegs.pc and advanced psxRegs.cycle.
+ *  In tiered mode, code not yet hot is interpreted instead (see rec_tier.h).
+ *  A nested dispatch loop (HLE softcall) runs from inside a block, so it
+ *  can't flush a full code cache without overwriting code still on the
+ *  host stack: code it finds uncompiled then is interpreted, and the cache
+ *  is flushed once back at the top level.
+ */
+static void recRun(unsigned target_pc)
+{
+	rec_dispatch_depth++;
+
+	do {
+		uptr *p = (uptr *)PC_REC(psxRegs.pc);
+		if (*p == 0 && ((rec_tier_active && !recTierHot(psxRegs.pc)) ||
+		                (rec_dispatch_depth > 1 && recMemFull()))) {
+			recTierInterpret();
+		} else {
+			if (*p == 0)
+				recRecompile();
+
+			if (!Config.RecVerify)
+				((void (*)(void))*p)();
+			else
+				psxVerifyBlock((void (*)(void))*p);
+		}
+
+		if (psxRegs.cycle >= psxRegs.io_cycle_counter)
+			psxBranchTest();
+	} while (psxRegs.pc != target_pc);
+
+	rec_dispatch_depth--;
+}
+
+static void recExecuteBlock(unsigned target_pc)
+{
+	recRun(target_pc);
+}
+
+static void recExecute()
+{
+	// Run until emulation is stopped. 0xffffffff is never a valid PC,
+	//  as PS1 instructions are word-aligned.
+	recRun(0xffffffff);
+}
+
+
+/* Invalidate 'Size' code block pointers at word-aligned PS1 address 'Addr'. */
+static void recClear(u32 Addr, u32 Size)
+{
+	const u32 masked_ram_addr = Addr & 0x1ffffc;
+
+	if (Size == 0)
+		return;
+
+	// Check if the page(s) of PS1 RAM that 'Addr','Size' target contain the
+	//  start of any blocks. If not, invalidation would have no effect and is
+	//  skipped. This eliminates 99% of large unnecessary invalidations that
+	//  occur when many games stream CD data in-game.
+	u32 page = masked_ram_addr/4096;
+	u32 end_page = ((masked_ram_addr + (Size-1)*4)/4096) + 1;
+	bool has_code = false;
+	do {
+		u32 pflag = 1 << (page & 7);  // Each byte in code_pages[] represents 8 pages
+		has_code = code_pages[page/8] & pflag;
+	} while ((++page != end_page) && !has_code);
+
+	rec_stats_add_clear(has_code);
+
+	if (has_code) {
+		void *dst = (void*)((uptr)recRAM + (masked_ram_addr * REC_RAM_PTR_SIZE/4));
+		memset(dst, 0, Size*REC_RAM_PTR_SIZE);
+	}
+}
+
+
+/* Notification from emulator. */
+void recNotify(int note, void *data __attribute__((unused)))
+{
+	switch (note)
+	{
+		/* R3000ACPU_NOTIFY_CACHE_ISOLATED,
+		 * R3000ACPU_NOTIFY_CACHE_UNISOLATED
+		 *  Sent from psxMemWrite32_CacheCtrlPort(). Also see notes there.
+		 */
+		case R3000ACPU_NOTIFY_CACHE_ISOLATED:
+			/*  There's no need to do anything here: emitted stores check
+			 * psxMemWLUT[], which has no RAM entries while cache is isolated.
+			 */
+			REC_LOG_V("R3000ACPU_NOTIFY_CACHE_ISOLATED\n");
+			break;
+		case R3000ACPU_NOTIFY_CACHE_UNISOLATED:
+			/*  Flush entire code cache, game has loaded new code:
+			 * BIOS or routine has finished invalidating cache lines.
+			 * See the MIPS recompiler's recNotify() for full details.
+			 */
+			recClear(0, 0x200000/4);
+			rec_stats_add_flush();
+			REC_LOG_V("R3000ACPU_NOTIFY_CACHE_UNISOLATED\n");
+			break;
+
+		/* Sent from psxDma3(). Also see notes there. */
+		case R3000ACPU_NOTIFY_DMA3_EXE_LOAD:
+			/* Part of the per-game Icache workaround for 'Formula One'
+			 *  games, see rec_set_options() and the MIPS recompiler.
+			 */
+			if (flush_code_on_dma3_exe_load) {
+				recClear(0, 0x200000/4);
+				rec_stats_add_flush();
+				REC_LOG_V("R3000ACPU_NOTIFY_DMA3_EXE_LOAD .. Flushing dynarec cache\n");
+			} else {
+				REC_LOG_V("R3000ACPU_NOTIFY_DMA3_EXE_LOAD\n");
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+static void recReset()
+{
+	memset(code_pages, 0, sizeof(code_pages));
+	memset(recRAM, 0, REC_RAM_SIZE);
+	memset(recROM, 0, REC_ROM_SIZE);
+	psxSmcReset();
+
+	recMem = recMemBase;
+	rec_stats_add_flush();
+
+	// Set default recompilation options and any per-game options
+	rec_set_options();
+}
+
+
+R3000Acpu psxRec =
+{
+	recInit,
+	recReset,
+	recExecute,
+	recExecuteBlock,
+	recClear,
+	recNotify,
+	recShutdown
+};
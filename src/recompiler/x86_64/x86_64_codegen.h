@@ -0,0 +1,567 @@
+/*
+ * x86_64_codegen.h
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#ifndef X86_64_CODEGEN_H
+#define X86_64_CODEGEN_H
+
+/* Host registers
+ *
+ *    USAGE RESTRICTIONS IN CODE EMITTERS:
+ *
+ * HOST_RBX        Holds pointer to psxRegs struct, a.k.a. PERM_REG_1.
+ *                  Callee-saved: it survives calls to C code.
+ *
+ * HOST_R12        Holds branch condition or indirect jump target while the
+ *                  instruction in a branch delay slot is recompiled, a.k.a.
+ *                  BRANCH_REG. Callee-saved: it survives calls to C code.
+ *
+ * HOST_EAX,ECX,   Temporaries, clobbered by any call to C code. PS1 GPRs
+ * HOST_EDX,ESI,    are not cached in host regs: every emitter loads what it
+ * HOST_EDI         needs from psxRegs and stores its result back.
+ *                 Only EAX,ECX,EDX may be used as 8-bit regs (no REX needed).
+ *
+ * Blocks are entered through a normal C call from the dispatch loop. Their
+ * prologue pushes RBX,R12 and realigns the stack to 16 bytes, so emitted
+ * code can call C functions directly.
+ */
+typedef enum {
+	HOST_EAX = 0,
+	HOST_ECX,
+	HOST_EDX,
+	HOST_EBX,
+	HOST_ESP,
+	HOST_EBP,
+	HOST_ESI,
+	HOST_EDI,
+	HOST_R8,
+	HOST_R9,
+	HOST_R10,
+	HOST_R11,
+	HOST_R12,
+	HOST_R13,
+	HOST_R14,
+	HOST_R15
+} X86Reg;
+
+#define PERM_REG_1	HOST_EBX
+#define BRANCH_REG	HOST_R12
+
+/* Condition codes, for Jcc/SETcc */
+typedef enum {
+	CC_O  = 0x0, CC_NO = 0x1, CC_B  = 0x2, CC_AE = 0x3,
+	CC_E  = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A  = 0x7,
+	CC_S  = 0x8, CC_NS = 0x9, CC_P  = 0xa, CC_NP = 0xb,
+	CC_L  = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G  = 0xf
+} X86Cond;
+
+/* Group-1 ALU op extensions, for ALU32ItoR/ALU32ItoM */
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+
+/* Group-2 shift op extensions */
+enum { SHIFT_SHL = 4, SHIFT_SHR = 5, SHIFT_SAR = 7 };
+
+extern u8 *recMem;
+
+/* Relocations: places in the block being emitted that refer to host
+ *  functions and globals, through a rel32 displacement or a 64-bit absolute
+ *  address. The persistent code cache (rec_cache.cpp.h) uses them to load
+ *  blocks at another code location, or into a relocated (PIE) executable.
+ */
+#define REC_MAX_RELOCS 1024
+enum { RELOC_REL32, RELOC_ABS64 };
+typedef struct {
+	u8  *loc;       /* Location of the displacement/address */
+	int  type;
+} RecReloc;
+extern RecReloc rec_relocs[REC_MAX_RELOCS];
+extern int      rec_num_relocs;  /* Over REC_MAX_RELOCS when some didn't fit */
+
+/* Note relocation for the displacement/address about to be written */
+static inline void emit_reloc(int type)
+{
+	if (rec_num_relocs < REC_MAX_RELOCS) {
+		rec_relocs[rec_num_relocs].loc  = recMem;
+		rec_relocs[rec_num_relocs].type = type;
+	}
+	rec_num_relocs++;
+}
+
+static inline void write8(u32 b)
+{
+	*recMem++ = (u8)b;
+}
+
+static inline void write32(u32 w)
+{
+	memcpy(recMem, &w, 4);
+	recMem += 4;
+}
+
+static inline void write64(u64 q)
+{
+	memcpy(recMem, &q, 8);
+	recMem += 8;
+}
+
+static inline bool is_imm8(s32 imm)
+{
+	return imm >= -128 && imm <= 127;
+}
+
+/* REX prefix, only emitted when it carries information */
+static inline void emit_rex(int w, int reg, int index, int base)
+{
+	u8 rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) |
+	         ((index & 8) ? 2 : 0) | ((base & 8) ? 1 : 0);
+	if (rex != 0x40)
+		write8(rex);
+}
+
+/* Opcodes above 0xff are two-byte 0x0f-escaped opcodes */
+static inline void emit_opcode(u32 op)
+{
+	if (op > 0xff)
+		write8(op >> 8);
+	write8(op & 0xff);
+}
+
+/* <op> reg, rm  (register-direct) */
+static inline void emit_reg(int w, u32 op, int reg, int rm)
+{
+	emit_rex(w, reg, 0, rm);
+	emit_opcode(op);
+	write8(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* <op> reg, [base+disp] */
+static inline void emit_mem(int w, u32 op, int reg, int base, s32 disp)
+{
+	int mod;
+
+	if (disp == 0 && (base & 7) != HOST_EBP)
+		mod = 0;
+	else if (is_imm8(disp))
+		mod = 1;
+	else
+		mod = 2;
+
+	emit_rex(w, reg, 0, base);
+	emit_opcode(op);
+	write8((mod << 6) | ((reg & 7) << 3) | (base & 7));
+	if ((base & 7) == HOST_ESP)
+		write8(0x24);       // SIB: no index, base = RSP/R12
+	if (mod == 1)
+		write8(disp);
+	else if (mod == 2)
+		write32(disp);
+}
+
+/* <op> reg, [base+index*scale]   (scale is 1,2,4 or 8) */
+static inline void emit_sib(int w, u32 op, int reg, int base, int index, int scale)
+{
+	int ss = (scale == 8) ? 3 : (scale == 4) ? 2 : (scale == 2) ? 1 : 0;
+	int mod = ((base & 7) == HOST_EBP) ? 1 : 0;
+
+	emit_rex(w, reg, index, base);
+	emit_opcode(op);
+	write8((mod << 6) | ((reg & 7) << 3) | 0x04);
+	write8((ss << 6) | ((index & 7) << 3) | (base & 7));
+	if (mod == 1)
+		write8(0);
+}
+
+
+/********************************
+ * Moves                        *
+ ********************************/
+
+/* All 'M' operands are offsets into psxRegs, addressed through PERM_REG_1 */
+#define MOV32MtoR(r, o)        emit_mem(0, 0x8b, r, PERM_REG_1, o)
+#define MOV32RtoM(o, r)        emit_mem(0, 0x89, r, PERM_REG_1, o)
+#define MOV64MtoR(r, o)        emit_mem(1, 0x8b, r, PERM_REG_1, o)
+#define MOV32RtoR(d, s)        emit_reg(0, 0x89, s, d)
+#define MOV64RtoR(d, s)        emit_reg(1, 0x89, s, d)
+
+static inline void MOV32ItoM(u32 o, u32 imm)
+{
+	emit_mem(0, 0xc7, 0, PERM_REG_1, o);
+	write32(imm);
+}
+
+/* NOTE: Loading zero uses XOR and clobbers host flags */
+static inline void MOV32ItoR(int r, u32 imm)
+{
+	if (imm == 0) {
+		emit_reg(0, 0x31, r, r);
+	} else {
+		emit_rex(0, 0, 0, r);
+		write8(0xb8 + (r & 7));
+		write32(imm);
+	}
+}
+
+static inline void MOV64ItoR(int r, u64 imm)
+{
+	if (imm <= 0xffffffffULL) {
+		emit_rex(0, 0, 0, r);
+		write8(0xb8 + (r & 7));
+		write32((u32)imm);
+	} else {
+		emit_rex(1, 0, 0, r);
+		write8(0xb8 + (r & 7));
+		write64(imm);
+	}
+}
+
+/* Load absolute host address, always as a relocatable 64-bit immediate */
+static inline void MOV64AddrtoR(int r, const void *addr)
+{
+	emit_rex(1, 0, 0, r);
+	write8(0xb8 + (r & 7));
+	emit_reloc(RELOC_ABS64);
+	write64((uptr)addr);
+}
+
+/* Loads with base register and displacement */
+#define MOV32BDtoR(r, b, d)    emit_mem(0, 0x8b,   r, b, d)
+#define MOV64BDtoR(r, b, d)    emit_mem(1, 0x8b,   r, b, d)
+#define MOVZX8BDtoR(r, b, d)   emit_mem(0, 0x0fb6, r, b, d)
+#define MOVSX8BDtoR(r, b, d)   emit_mem(0, 0x0fbe, r, b, d)
+#define MOVZX16BDtoR(r, b, d)  emit_mem(0, 0x0fb7, r, b, d)
+#define MOVSX16BDtoR(r, b, d)  emit_mem(0, 0x0fbf, r, b, d)
+
+/* Loads/stores with base and index registers */
+#define MOV32SIBtoR(r, b, i)   emit_sib(0, 0x8b,   r, b, i, 1)
+#define MOV64SIB8toR(r, b, i)  emit_sib(1, 0x8b,   r, b, i, 8)
+#define MOVZX8SIBtoR(r, b, i)  emit_sib(0, 0x0fb6, r, b, i, 1)
+#define MOVSX8SIBtoR(r, b, i)  emit_sib(0, 0x0fbe, r, b, i, 1)
+#define MOVZX16SIBtoR(r, b, i) emit_sib(0, 0x0fb7, r, b, i, 1)
+#define MOVSX16SIBtoR(r, b, i) emit_sib(0, 0x0fbf, r, b, i, 1)
+#define MOV32RtoSIB(b, i, r)   emit_sib(0, 0x89,   r, b, i, 1)
+#define MOV8RtoSIB(b, i, r)    emit_sib(0, 0x88,   r, b, i, 1)
+
+static inline void MOV16RtoSIB(int b, int i, int r)
+{
+	write8(0x66);
+	emit_sib(0, 0x89, r, b, i, 1);
+}
+
+/* Zero/sign extension between registers */
+#define MOVZX8RtoR(d, s)       emit_reg(0, 0x0fb6, d, s)
+#define MOVSX8RtoR(d, s)       emit_reg(0, 0x0fbe, d, s)
+#define MOVZX16RtoR(d, s)      emit_reg(0, 0x0fb7, d, s)
+#define MOVSX16RtoR(d, s)      emit_reg(0, 0x0fbf, d, s)
+
+
+/********************************
+ * ALU                          *
+ ********************************/
+
+#define ADD32RtoR(d, s)        emit_reg(0, 0x01, s, d)
+#define OR32RtoR(d, s)         emit_reg(0, 0x09, s, d)
+#define AND32RtoR(d, s)        emit_reg(0, 0x21, s, d)
+#define SUB32RtoR(d, s)        emit_reg(0, 0x29, s, d)
+#define XOR32RtoR(d, s)        emit_reg(0, 0x31, s, d)
+#define CMP32RtoR(d, s)        emit_reg(0, 0x39, s, d)
+#define TEST32RtoR(d, s)       emit_reg(0, 0x85, s, d)
+#define TEST64RtoR(d, s)       emit_reg(1, 0x85, s, d)
+
+#define ADD32MtoR(r, o)        emit_mem(0, 0x03, r, PERM_REG_1, o)
+#define OR32MtoR(r, o)         emit_mem(0, 0x0b, r, PERM_REG_1, o)
+#define AND32MtoR(r, o)        emit_mem(0, 0x23, r, PERM_REG_1, o)
+#define SUB32MtoR(r, o)        emit_mem(0, 0x2b, r, PERM_REG_1, o)
+#define XOR32MtoR(r, o)        emit_mem(0, 0x33, r, PERM_REG_1, o)
+#define CMP32MtoR(r, o)        emit_mem(0, 0x3b, r, PERM_REG_1, o)
+
+/* Group-1 op with memory source has opcode (ext << 3) | 3, e.g. 0x03 ADD */
+#define ALU32MtoR(ext, r, o)   emit_mem(0, ((ext) << 3) | 3, r, PERM_REG_1, o)
+
+static inline void ALU32ItoR(int ext, int r, s32 imm)
+{
+	if (is_imm8(imm)) {
+		emit_reg(0, 0x83, ext, r);
+		write8(imm);
+	} else {
+		emit_reg(0, 0x81, ext, r);
+		write32(imm);
+	}
+}
+
+static inline void ALU32ItoM(int ext, u32 o, s32 imm)
+{
+	if (is_imm8(imm)) {
+		emit_mem(0, 0x83, ext, PERM_REG_1, o);
+		write8(imm);
+	} else {
+		emit_mem(0, 0x81, ext, PERM_REG_1, o);
+		write32(imm);
+	}
+}
+
+#define ADD32ItoR(r, i)        ALU32ItoR(ALU_ADD, r, i)
+#define OR32ItoR(r, i)         ALU32ItoR(ALU_OR,  r, i)
+#define AND32ItoR(r, i)        ALU32ItoR(ALU_AND, r, i)
+#define SUB32ItoR(r, i)        ALU32ItoR(ALU_SUB, r, i)
+#define XOR32ItoR(r, i)        ALU32ItoR(ALU_XOR, r, i)
+#define CMP32ItoR(r, i)        ALU32ItoR(ALU_CMP, r, i)
+
+#define ADD32ItoM(o, i)        ALU32ItoM(ALU_ADD, o, i)
+#define OR32ItoM(o, i)         ALU32ItoM(ALU_OR,  o, i)
+#define AND32ItoM(o, i)        ALU32ItoM(ALU_AND, o, i)
+#define XOR32ItoM(o, i)        ALU32ItoM(ALU_XOR, o, i)
+
+#define NOT32R(r)              emit_reg(0, 0xf7, 2, r)
+#define NEG32R(r)              emit_reg(0, 0xf7, 3, r)
+
+static inline void SHIFT32ItoR(int ext, int r, u32 sa)
+{
+	emit_reg(0, 0xc1, ext, r);
+	write8(sa & 31);
+}
+
+#define SHL32ItoR(r, sa)       SHIFT32ItoR(SHIFT_SHL, r, sa)
+#define SHR32ItoR(r, sa)       SHIFT32ItoR(SHIFT_SHR, r, sa)
+#define SAR32ItoR(r, sa)       SHIFT32ItoR(SHIFT_SAR, r, sa)
+
+/* Shift by CL: x86 masks the count to 5 bits, just like the R3000A */
+#define SHL32CLtoR(r)          emit_reg(0, 0xd3, SHIFT_SHL, r)
+#define SHR32CLtoR(r)          emit_reg(0, 0xd3, SHIFT_SHR, r)
+#define SAR32CLtoR(r)          emit_reg(0, 0xd3, SHIFT_SAR, r)
+
+/* SETcc on EAX,ECX,EDX only (other low-byte regs would need a REX) */
+static inline void SETCC8R(int cc, int r)
+{
+	write8(0x0f);
+	write8(0x90 | cc);
+	write8(0xc0 | (r & 7));
+}
+
+/* EDX:EAX = EAX * op, EAX = EDX:EAX / op, EDX = EDX:EAX % op */
+#define MUL32M(o)              emit_mem(0, 0xf7, 4, PERM_REG_1, o)
+#define IMUL32M(o)             emit_mem(0, 0xf7, 5, PERM_REG_1, o)
+#define MUL32R(r)              emit_reg(0, 0xf7, 4, r)
+#define IMUL32R(r)             emit_reg(0, 0xf7, 5, r)
+#define DIV32R(r)              emit_reg(0, 0xf7, 6, r)
+#define IDIV32R(r)             emit_reg(0, 0xf7, 7, r)
+#define CDQ()                  write8(0x99)
+
+/* Bit test in bitstring at [base], bit index in reg. Sets CF. */
+#define BT32RtoBD(b, r)        emit_mem(0, 0x0fa3, r, b, 0)
+
+
+/********************************
+ * Control flow                 *
+ ********************************/
+
+/* Conditional jump with 32-bit displacement. Returns location of the
+ *  displacement, for use with fixup_branch() once target is known. */
+static inline u8 *JCC32(int cc)
+{
+	write8(0x0f);
+	write8(0x80 | cc);
+	u8 *backpatch = recMem;
+	write32(0);
+	return backpatch;
+}
+
+static inline u8 *JMP32()
+{
+	write8(0xe9);
+	u8 *backpatch = recMem;
+	write32(0);
+	return backpatch;
+}
+
+/* Point a forward jump emitted by JCC32()/JMP32() at current location */
+static inline void fixup_branch(u8 *backpatch)
+{
+	s32 rel = (s32)(recMem - (backpatch + 4));
+	memcpy(backpatch, &rel, 4);
+}
+
+static inline bool is_rel32(const void *target, const u8 *from)
+{
+	s64 rel = (s64)((uptr)target - (uptr)from);
+	return rel == (s64)(s32)rel;
+}
+
+/* Call C function, directly if within reach of a rel32 displacement.
+ *  Clobbers RAX when an indirect call is needed. */
+static inline void CALLFunc(const void *func)
+{
+	if (is_rel32(func, recMem + 5)) {
+		write8(0xe8);
+		emit_reloc(RELOC_REL32);
+		write32((u32)((uptr)func - (uptr)(recMem + 4)));
+	} else {
+		MOV64AddrtoR(HOST_EAX, func);
+		emit_reg(0, 0xff, 2, HOST_EAX);  // call rax
+	}
+}
+
+/* Load address of a host global into 64-bit reg */
+static inline void LEA64ItoR(int r, const void *addr)
+{
+	if (is_rel32(addr, recMem + 7)) {
+		// lea r, [rip+disp32]
+		emit_rex(1, r, 0, 0);
+		write8(0x8d);
+		write8(((r & 7) << 3) | 0x05);
+		emit_reloc(RELOC_REL32);
+		write32((u32)((uptr)addr - (uptr)(recMem + 4)));
+	} else {
+		MOV64AddrtoR(r, addr);
+	}
+}
+
+/* Load 64-bit host global (i.e. a pointer variable) into reg */
+static inline void MOV64GtoR(int r, const void *addr)
+{
+	if (is_rel32(addr, recMem + 7)) {
+		// mov r, [rip+disp32]
+		emit_rex(1, r, 0, 0);
+		write8(0x8b);
+		write8(((r & 7) << 3) | 0x05);
+		emit_reloc(RELOC_REL32);
+		write32((u32)((uptr)addr - (uptr)(recMem + 4)));
+	} else {
+		MOV64AddrtoR(r, addr);
+		MOV64BDtoR(r, r, 0);
+	}
+}
+
+static inline void PUSH64R(int r)
+{
+	emit_rex(0, 0, 0, r);
+	write8(0x50 + (r & 7));
+}
+
+static inline void POP64R(int r)
+{
+	emit_rex(0, 0, 0, r);
+	write8(0x58 + (r & 7));
+}
+
+#define ADD64ItoRSP(i)         do { emit_reg(1, 0x83, ALU_ADD, HOST_ESP); write8(i); } while (0)
+#define SUB64ItoRSP(i)         do { emit_reg(1, 0x83, ALU_SUB, HOST_ESP); write8(i); } while (0)
+#define RET()                  write8(0xc3)
+
+
+/* Crazy macro to calculate offset of the field in the structure.
+ *  (Can't use standard offsetof() with non-const expressions)
+ */
+#ifndef OFFSET_OF
+#define OFFSET_OF(T,F) ((unsigned int)((char *)&((T *)0L)->F - (char *)0L))
+#endif
+
+/* GPR offset */
+#define offGPR(rx)	OFFSET_OF(psxRegisters, GPR.r[rx])
+
+/* CP0 offset */
+#define offCP0(rx)	OFFSET_OF(psxRegisters, CP0.r[rx])
+
+#define off(field)	OFFSET_OF(psxRegisters, field)
+
+/* Guest code words read while recompiling current block: the range
+ *  [rec_code_lo,rec_code_hi) read mostly sequentially, plus up to
+ *  REC_MAX_CODE_DEPS other words (branch targets etc). The persistent code
+ *  cache (rec_cache.cpp.h) checks all of them before reusing the block.
+ */
+#define REC_MAX_CODE_DEPS 16
+extern u32 rec_code_lo, rec_code_hi;
+extern u32 rec_code_deps[REC_MAX_CODE_DEPS];
+extern int rec_num_code_deps;  /* Over REC_MAX_CODE_DEPS when some didn't fit */
+
+static inline void rec_note_code_read(u32 loc)
+{
+	if (loc >= rec_code_lo && loc < rec_code_hi)
+		return;
+
+	// Just past the range: extend it. Words skipped over lie in the same
+	//  64KB page as 'loc' or the last one in range, so are readable.
+	if (loc >= rec_code_hi && loc - rec_code_hi < 64*4) {
+		rec_code_hi = loc + 4;
+		return;
+	}
+
+	for (int i = 0; i < rec_num_code_deps && i < REC_MAX_CODE_DEPS; i++) {
+		if (rec_code_deps[i] == loc)
+			return;
+	}
+	if (rec_num_code_deps < REC_MAX_CODE_DEPS)
+		rec_code_deps[rec_num_code_deps] = loc;
+	rec_num_code_deps++;
+}
+
+/* Get u32 opcode val at location in PS1 code.
+ * See notes in psxMemWrite32_CacheCtrlPort() regarding why it is best
+ *  to read code here using PSXM*() macros, i.e. through psxMemRLUT[].
+ */
+static inline u32 rec_opcode_at(u32 loc)
+{
+	rec_note_code_read(loc);
+	return PSXMu32(loc);
+}
+#define OPCODE_AT(loc) rec_opcode_at(loc)
+
+static inline u32 ADJUST_CLOCK(u32 cycles)
+{
+	extern u32 cycle_multiplier;
+	return (cycles * cycle_multiplier) >> 8;
+}
+
+
+static inline bool opcodeIsBranch(const u32 opcode)
+{
+	return (_fOp_(opcode) == 0x01 && (_fRt_(opcode) == 0x00 || // BLTZ
+	                                  _fRt_(opcode) == 0x01 || // BGEZ
+	                                  _fRt_(opcode) == 0x10 || // BLTZAL
+	                                  _fRt_(opcode) == 0x11))  // BGEZAL
+	       ||
+	       (_fOp_(opcode) >= 0x04 && _fOp_(opcode) <= 0x07);   // BEQ,BNE,BLEZ,BGTZ
+}
+
+static inline bool opcodeIsIndirectJump(const u32 opcode)
+{
+	return _fOp_(opcode) == 0x00 && (_fFunct_(opcode) == 0x08 || // JR
+	                                 _fFunct_(opcode) == 0x09);  // JALR
+}
+
+static inline bool opcodeIsDirectJump(const u32 opcode)
+{
+	return _fOp_(opcode) == 0x02 || _fOp_(opcode) == 0x03;       // J,JAL
+}
+
+static inline bool opcodeIsJump(const u32 opcode)
+{
+	return opcodeIsIndirectJump(opcode) || opcodeIsDirectJump(opcode);
+}
+
+static inline bool opcodeIsBranchOrJump(const u32 opcode)
+{
+	return opcodeIsBranch(opcode) || opcodeIsJump(opcode);
+}
+
+#endif /* X86_64_CODEGEN_H */